@@ -4,6 +4,9 @@
 
 #include "bench.h"
 
+#include "chainparams.h"
+#include "crypto/scrypt.h"
+#include "crypto/x11.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -13,6 +16,9 @@ main(int argc, char** argv)
 {
     ECC_Start();
     SetupEnvironment();
+    SelectParams(CBaseChainParams::MAIN); // CheckBlockHeader and friends use the global Params()
+    scrypt_multi_detect();
+    x11_multi_detect();
     fPrintToDebugLog = false; // don't want to write to debug.log file
 
     benchmark::BenchRunner::RunAll();
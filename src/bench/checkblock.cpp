@@ -46,7 +46,8 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
         assert(stream.Rewind(sizeof(block_bench::block413567)));
 
         CValidationState validationState;
-        assert(CheckBlock(block, validationState));
+        // block413567 is a Bitcoin block, so its header has no valid scrypt/X11 PoW
+        assert(CheckBlock(block, validationState, false));
     }
 }
 
@@ -10,6 +10,7 @@
 #include <vector>
 #include <boost/thread/thread.hpp>
 #include "random.h"
+#include "crypto/sha256.h"
 
 
 // This Benchmark tests the CheckQueue with the lightest
@@ -99,5 +100,57 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.interrupt_all();
     tg.join_all();
 }
+
+// This Benchmark measures how the CheckQueue scales with the number of
+// worker threads when every check does a small, fixed amount of hashing,
+// roughly the cost of a cheap signature check. A block is simulated by
+// adding many small batches, as ConnectBlock does per transaction.
+static void CCheckQueueScaling(benchmark::State& state, int nThreads)
+{
+    struct HashJob {
+        uint32_t n;
+        HashJob() : n(0) {}
+        explicit HashJob(uint32_t nIn) : n(nIn) {}
+        bool operator()()
+        {
+            unsigned char hash[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write((const unsigned char*)&n, sizeof(n)).Finalize(hash);
+            for (int i = 0; i < 16; i++)
+                CSHA256().Write(hash, sizeof(hash)).Finalize(hash);
+            return hash[0] != 0 || hash[1] != 0 || hash[2] != 0 || hash[3] != 0;
+        }
+        void swap(HashJob& x) { std::swap(n, x.n); };
+    };
+    CCheckQueue<HashJob> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < nThreads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (size_t nBatch = 0; nBatch < BATCHES * 4; ++nBatch) {
+            std::vector<HashJob> vChecks;
+            vChecks.reserve(BATCH_SIZE);
+            for (size_t x = 0; x < BATCH_SIZE; ++x)
+                vChecks.emplace_back(nBatch * BATCH_SIZE + x);
+            control.Add(vChecks);
+        }
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void CCheckQueueScaling1(benchmark::State& state) { CCheckQueueScaling(state, 1); }
+static void CCheckQueueScaling4(benchmark::State& state) { CCheckQueueScaling(state, 4); }
+static void CCheckQueueScaling16(benchmark::State& state) { CCheckQueueScaling(state, 16); }
+static void CCheckQueueScaling32(benchmark::State& state) { CCheckQueueScaling(state, 32); }
+static void CCheckQueueScaling64(benchmark::State& state) { CCheckQueueScaling(state, 64); }
+
 BENCHMARK(CCheckQueueSpeed);
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueueScaling1);
+BENCHMARK(CCheckQueueScaling4);
+BENCHMARK(CCheckQueueScaling16);
+BENCHMARK(CCheckQueueScaling32);
+BENCHMARK(CCheckQueueScaling64);
@@ -8,11 +8,14 @@
 #include "bloom.h"
 #include "hash.h"
 #include "uint256.h"
+#include "utilstrencodings.h"
 #include "utiltime.h"
 #include "crypto/ripemd160.h"
+#include "crypto/scrypt.h"
 #include "crypto/sha1.h"
 #include "crypto/sha256.h"
 #include "crypto/sha512.h"
+#include "crypto/x11.h"
 
 /* Number of bytes to hash per iteration */
 static const uint64_t BUFFER_SIZE = 1000*1000;
@@ -69,6 +72,54 @@ static void SipHash_32b(benchmark::State& state)
     }
 }
 
+/* Hash the same 16 headers per iteration at every lane width, so the timings compare directly */
+static void ScryptMulti(benchmark::State& state, int nLanes)
+{
+    if (!scrypt_multi_select(nLanes)) {
+        std::cout << "Scrypt_" << nLanes << "way: not supported on this CPU, skipped\n";
+        return;
+    }
+    std::vector<char> in(16 * 80, 0);
+    std::vector<uint256> out(16);
+    while (state.KeepRunning())
+        scrypt_1024_1_1_256_multi(in.data(), BEGIN(out[0]), 16);
+    scrypt_multi_detect();
+}
+
+static void Scrypt_1way(benchmark::State& state) { ScryptMulti(state, 1); }
+static void Scrypt_4way(benchmark::State& state) { ScryptMulti(state, 4); }
+static void Scrypt_8way(benchmark::State& state) { ScryptMulti(state, 8); }
+static void Scrypt_16way(benchmark::State& state) { ScryptMulti(state, 16); }
+
+static void X11_Hash11(benchmark::State& state)
+{
+    std::vector<unsigned char> in(16 * 80, 0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 16; i++)
+            Hash11(in.begin() + i * 80, in.begin() + (i + 1) * 80);
+    }
+}
+
+/* Same 16 headers as X11_Hash11, through the staged pipeline with the given kernels */
+static void X11Multi(benchmark::State& state, int nLanes, bool fAESNI)
+{
+    if (!x11_multi_select(nLanes, fAESNI)) {
+        std::cout << "X11_" << nLanes << "way" << (fAESNI ? "_AESNI" : "") << ": not supported on this CPU, skipped\n";
+        return;
+    }
+    std::vector<unsigned char> in(16 * 80, 0);
+    std::vector<uint256> out(16);
+    while (state.KeepRunning())
+        x11_hash_multi(in.data(), 80, 16, out[0].begin());
+    x11_multi_detect();
+}
+
+static void X11_1way(benchmark::State& state) { X11Multi(state, 1, false); }
+static void X11_1way_AESNI(benchmark::State& state) { X11Multi(state, 1, true); }
+static void X11_4way_AESNI(benchmark::State& state) { X11Multi(state, 4, true); }
+static void X11_8way_AESNI(benchmark::State& state) { X11Multi(state, 8, true); }
+static void X11_16way_AESNI(benchmark::State& state) { X11Multi(state, 16, true); }
+
 BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
 BENCHMARK(SHA256);
@@ -76,3 +127,15 @@ BENCHMARK(SHA512);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
+
+BENCHMARK(Scrypt_1way);
+BENCHMARK(Scrypt_4way);
+BENCHMARK(Scrypt_8way);
+BENCHMARK(Scrypt_16way);
+
+BENCHMARK(X11_Hash11);
+BENCHMARK(X11_1way);
+BENCHMARK(X11_1way_AESNI);
+BENCHMARK(X11_4way_AESNI);
+BENCHMARK(X11_8way_AESNI);
+BENCHMARK(X11_16way_AESNI);
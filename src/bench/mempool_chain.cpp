@@ -0,0 +1,66 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "policy/policy.h"
+#include "txmempool.h"
+
+#include <vector>
+
+static const int CHAIN_DEPTH = 500;
+
+// A chain of CHAIN_DEPTH transactions, each spending the only output of the one before
+static std::vector<CTransactionRef> CreateChain()
+{
+    std::vector<CTransactionRef> vChain;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    for (int i = 0; i < CHAIN_DEPTH; i++) {
+        vChain.push_back(MakeTransactionRef(tx));
+        tx.vin[0].prevout = COutPoint(vChain.back()->GetHash(), 0);
+        tx.vout[0].nValue -= 1000;
+    }
+    return vChain;
+}
+
+static void AddChain(const std::vector<CTransactionRef>& vChain, CTxMemPool& pool)
+{
+    LockPoints lp;
+    for (const CTransactionRef& tx : vChain) {
+        pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, 1000, 0, 10.0, 1, tx->GetValueOut(), false, 4, lp));
+    }
+}
+
+// Add a deep chain, then evict it from the root as a conflict or expiry would
+static void MempoolChainRemoveRecursive(benchmark::State& state)
+{
+    std::vector<CTransactionRef> vChain = CreateChain();
+    CTxMemPool pool(CFeeRate(1000));
+
+    while (state.KeepRunning()) {
+        AddChain(vChain, pool);
+        pool.removeRecursive(*vChain[0]);
+        assert(pool.size() == 0);
+    }
+}
+
+// Add a deep chain, then confirm all of it in one block
+static void MempoolChainRemoveForBlock(benchmark::State& state)
+{
+    std::vector<CTransactionRef> vChain = CreateChain();
+    CTxMemPool pool(CFeeRate(1000));
+
+    while (state.KeepRunning()) {
+        AddChain(vChain, pool);
+        pool.removeForBlock(vChain, 1);
+        assert(pool.size() == 0);
+    }
+}
+
+BENCHMARK(MempoolChainRemoveRecursive);
+BENCHMARK(MempoolChainRemoveForBlock);
@@ -0,0 +1,151 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "arith_uint256.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "checkqueue.h"
+#include "crypto/scrypt.h"
+#include "pow.h"
+#include "primitives/block.h"
+#include "random.h"
+#include "validation.h"
+
+#include <vector>
+#include <boost/thread/thread.hpp>
+
+// Headers hashed per iteration, i.e. one eighth of a full headers message.
+// Divide by the average time to get headers/second.
+static const size_t HEADERS_PER_RUN = 256;
+
+// Scrypt-era headers (after the X11 window) verified the way ProcessNewBlockHeaders
+// does it: runs of scrypt_multi_lanes() headers spread over a CCheckQueue.
+static void HeaderPoWCheck(benchmark::State& state, int nThreads)
+{
+    std::vector<CBlockHeader> vHeaders(HEADERS_PER_RUN);
+    for (size_t i = 0; i < vHeaders.size(); i++) {
+        vHeaders[i].nVersion = 2;
+        vHeaders[i].nTime = 1730000000 + i;
+        vHeaders[i].nBits = 0x1e0ffff0;
+        vHeaders[i].nNonce = i;
+    }
+    std::vector<uint256> vHashes(vHeaders.size());
+
+    CCheckQueue<CHeaderPoWCheck> queue(1);
+    boost::thread_group tg;
+    for (int i = 0; i < nThreads - 1; i++) {
+        tg.create_thread([&]{queue.Thread();});
+    }
+    const size_t nRun = std::max(1, scrypt_multi_lanes());
+    while (state.KeepRunning()) {
+        CCheckQueueControl<CHeaderPoWCheck> control(&queue);
+        std::vector<CHeaderPoWCheck> vChecks;
+        for (size_t i = 0; i < vHeaders.size(); i += nRun)
+            vChecks.emplace_back(&vHeaders[i], &vHashes[i], std::min(nRun, vHeaders.size() - i));
+        control.Add(vChecks);
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+static void HeaderPoWCheck_1thread(benchmark::State& state) { HeaderPoWCheck(state, 1); }
+static void HeaderPoWCheck_2threads(benchmark::State& state) { HeaderPoWCheck(state, 2); }
+static void HeaderPoWCheck_4threads(benchmark::State& state) { HeaderPoWCheck(state, 4); }
+static void HeaderPoWCheck_8threads(benchmark::State& state) { HeaderPoWCheck(state, 8); }
+static void HeaderPoWCheck_16threads(benchmark::State& state) { HeaderPoWCheck(state, 16); }
+
+BENCHMARK(HeaderPoWCheck_1thread);
+BENCHMARK(HeaderPoWCheck_2threads);
+BENCHMARK(HeaderPoWCheck_4threads);
+BENCHMARK(HeaderPoWCheck_8threads);
+BENCHMARK(HeaderPoWCheck_16threads);
+
+// Nonce iteration as done by the miner: 16 consecutive nonces of one header,
+// either through GetPoWHash() per nonce or through a CPoWHasher.
+static CBlockHeader NonceHeader(uint32_t nTime)
+{
+    CBlockHeader header;
+    header.nVersion = 2;
+    header.nTime = nTime;
+    header.nBits = 0x1e0ffff0;
+    header.nNonce = 0;
+    return header;
+}
+
+static void PoWHash_GetPoWHash(benchmark::State& state, uint32_t nTime)
+{
+    CBlockHeader header = NonceHeader(nTime);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 16; i++) {
+            header.GetPoWHash();
+            header.nNonce++;
+        }
+    }
+}
+
+static void PoWHash_PoWHasher(benchmark::State& state, uint32_t nTime)
+{
+    CBlockHeader header = NonceHeader(nTime);
+    CPoWHasher hasher(header);
+    std::vector<uint256> vHashes(16);
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        hasher.Hash(nNonce, vHashes.size(), vHashes.data());
+        nNonce += vHashes.size();
+    }
+}
+
+static void PoWHash_X11_GetPoWHash(benchmark::State& state) { PoWHash_GetPoWHash(state, 1500000000); }
+static void PoWHash_X11_PoWHasher(benchmark::State& state) { PoWHash_PoWHasher(state, 1500000000); }
+static void PoWHash_Scrypt_GetPoWHash(benchmark::State& state) { PoWHash_GetPoWHash(state, 1730000000); }
+static void PoWHash_Scrypt_PoWHasher(benchmark::State& state) { PoWHash_PoWHasher(state, 1730000000); }
+
+BENCHMARK(PoWHash_X11_GetPoWHash);
+BENCHMARK(PoWHash_X11_PoWHasher);
+BENCHMARK(PoWHash_Scrypt_GetPoWHash);
+BENCHMARK(PoWHash_Scrypt_PoWHasher);
+
+// Blocks per retarget replay run
+static const int RETARGET_BLOCKS = 2000;
+
+typedef unsigned int (*RetargetFunc)(const CBlockIndex*, const CBlockHeader*, const Consensus::Params&);
+
+// Generate a chain with the retarget rule itself and jittered block times, then
+// recompute every block's nBits in height order, as header sync and block
+// connection do. Blocks without a hash cannot use the retarget cache, which
+// gives the cost of walking pprev and decoding nBits for every window.
+static void RetargetReplay(benchmark::State& state, RetargetFunc retarget, bool fHashes)
+{
+    const Consensus::Params& params = Params().GetConsensus(0);
+    std::vector<uint256> vHashes(RETARGET_BLOCKS);
+    std::vector<CBlockIndex> vBlocks(RETARGET_BLOCKS);
+    int64_t nTime = 1500000000;
+    for (int i = 0; i < RETARGET_BLOCKS; i++) {
+        CBlockIndex& index = vBlocks[i];
+        vHashes[i] = GetRandHash();
+        index.phashBlock = fHashes ? &vHashes[i] : NULL;
+        index.pprev = i ? &vBlocks[i - 1] : NULL;
+        index.nHeight = i;
+        nTime += params.nPowTargetSpacing + (i * 7919) % 61 - 30;
+        index.nTime = nTime;
+        index.nBits = i ? retarget(index.pprev, NULL, params) : UintToArith256(params.powLimit).GetCompact();
+    }
+
+    while (state.KeepRunning()) {
+        for (int i = 1; i < RETARGET_BLOCKS; i++)
+            assert(retarget(vBlocks[i].pprev, NULL, params) == vBlocks[i].nBits);
+    }
+}
+
+static void Retarget_KGW(benchmark::State& state) { RetargetReplay(state, KimotoGravityWell, true); }
+static void Retarget_KGW_Walk(benchmark::State& state) { RetargetReplay(state, KimotoGravityWell, false); }
+static void Retarget_DGW(benchmark::State& state) { RetargetReplay(state, DarkGravityWave, true); }
+static void Retarget_DGW_Walk(benchmark::State& state) { RetargetReplay(state, DarkGravityWave, false); }
+
+BENCHMARK(Retarget_KGW);
+BENCHMARK(Retarget_KGW_Walk);
+BENCHMARK(Retarget_DGW);
+BENCHMARK(Retarget_DGW_Walk);
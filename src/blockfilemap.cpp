@@ -0,0 +1,101 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "chain.h"
+#include "util.h"
+#include "validation.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CBlockFileMapCache blockfilemaps;
+
+CBlockFileMap::~CBlockFileMap()
+{
+#ifndef WIN32
+    munmap(const_cast<unsigned char*>(pchData), nSize);
+#endif
+}
+
+static std::shared_ptr<const CBlockFileMap> MapBlockFile(int nFile)
+{
+#ifndef WIN32
+    boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced
+    close(fd);
+    if (p == MAP_FAILED) {
+        LogPrint("db", "%s: cannot map %s: %s\n", __func__, path.string(), strerror(errno));
+        return nullptr;
+    }
+    return std::make_shared<CBlockFileMap>(static_cast<const unsigned char*>(p), st.st_size);
+#else
+    return nullptr;
+#endif
+}
+
+void CBlockFileMapCache::EvictOldest()
+{
+    std::map<int, Entry>::iterator itOldest = mapMaps.begin();
+    for (std::map<int, Entry>::iterator it = mapMaps.begin(); it != mapMaps.end(); ++it) {
+        if (it->second.nLastUse < itOldest->second.nLastUse)
+            itOldest = it;
+    }
+    mapMaps.erase(itOldest);
+}
+
+void CBlockFileMapCache::SetMaxMaps(size_t nMaxMapsIn)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    nMaxMaps = nMaxMapsIn;
+    while (mapMaps.size() > nMaxMaps)
+        EvictOldest();
+}
+
+std::shared_ptr<const CBlockFileMap> CBlockFileMapCache::Get(int nFile, uint64_t nEnd)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    if (nMaxMaps == 0)
+        return nullptr;
+
+    std::map<int, Entry>::iterator it = mapMaps.find(nFile);
+    if (it != mapMaps.end()) {
+        if (it->second.map->size() >= nEnd) {
+            it->second.nLastUse = ++nUseCounter;
+            return it->second.map;
+        }
+        // The file grew since it was mapped
+        mapMaps.erase(it);
+    }
+
+    std::shared_ptr<const CBlockFileMap> map = MapBlockFile(nFile);
+    if (!map || map->size() < nEnd)
+        return nullptr;
+    if (mapMaps.size() >= nMaxMaps)
+        EvictOldest();
+    Entry& entry = mapMaps[nFile];
+    entry.map = map;
+    entry.nLastUse = ++nUseCounter;
+    return map;
+}
+
+void CBlockFileMapCache::Invalidate(int nFile)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    mapMaps.erase(nFile);
+}
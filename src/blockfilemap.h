@@ -0,0 +1,75 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boost/thread/mutex.hpp>
+
+/** Default for -blockfilemaps: number of block files kept mapped (none on 32-bit, for address space) */
+static const int DEFAULT_BLOCKFILE_MAPS = sizeof(void*) >= 8 ? 16 : 0;
+/** Maximum for -blockfilemaps */
+static const int MAX_BLOCKFILE_MAPS = 1024;
+
+/** A read-only memory mapping of a whole blk?????.dat file. */
+class CBlockFileMap
+{
+public:
+    CBlockFileMap(const unsigned char* pchDataIn, size_t nSizeIn) : pchData(pchDataIn), nSize(nSizeIn) {}
+    ~CBlockFileMap();
+
+    const unsigned char* data() const { return pchData; }
+    size_t size() const { return nSize; }
+
+private:
+    CBlockFileMap(const CBlockFileMap&);
+    CBlockFileMap& operator=(const CBlockFileMap&);
+
+    const unsigned char* const pchData;
+    const size_t nSize;
+};
+
+/**
+ * Keeps the most recently used block files mapped into memory, so blocks can
+ * be deserialized or served straight from the page cache instead of through
+ * fopen/fseek/fread. A mapping stays valid for as long as a caller holds on
+ * to it, even after it was evicted or invalidated here.
+ */
+class CBlockFileMapCache
+{
+public:
+    CBlockFileMapCache() : nMaxMaps(0), nUseCounter(0) {}
+
+    //! Change the number of mappings kept; 0 disables mapping.
+    void SetMaxMaps(size_t nMaxMapsIn);
+
+    //! Map block file nFile covering at least its first nEnd bytes. Returns NULL when disabled or the file cannot be mapped.
+    std::shared_ptr<const CBlockFileMap> Get(int nFile, uint64_t nEnd);
+
+    //! Forget the mapping of a block file that is being truncated or deleted.
+    void Invalidate(int nFile);
+
+private:
+    struct Entry {
+        std::shared_ptr<const CBlockFileMap> map;
+        uint64_t nLastUse;
+    };
+
+    boost::mutex cs;
+    size_t nMaxMaps;
+    uint64_t nUseCounter;
+    std::map<int, Entry> mapMaps;
+
+    void EvictOldest();
+};
+
+/** Mappings of the block files, shared by all readers */
+extern CBlockFileMapCache blockfilemaps;
+
+#endif // BITCOIN_BLOCKFILEMAP_H
@@ -0,0 +1,184 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockpipeline.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "consensus/validation.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+#include "version.h"
+
+#include <boost/bind/bind.hpp>
+
+CBlockPipeline::CBlockPipeline(int nDepthIn) : nDepth(std::max(1, nDepthIn)), fStop(false)
+{
+    threadRead = boost::thread(boost::bind(&CBlockPipeline::ThreadRead, this));
+    threadCheck = boost::thread(boost::bind(&CBlockPipeline::ThreadCheck, this));
+}
+
+CBlockPipeline::~CBlockPipeline()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+    }
+    cond.notify_all();
+    threadRead.join();
+    threadCheck.join();
+}
+
+void CBlockPipeline::Enqueue(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+        return;
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (queue.size() >= nDepth || mapJobs.count(pindex->GetBlockHash()))
+        return;
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->hash = pindex->GetBlockHash();
+    job->pos = pindex->GetBlockPos();
+    job->nHeight = pindex->nHeight;
+    job->state = JOB_QUEUED;
+    queue.push_back(job);
+    mapJobs.emplace(job->hash, job);
+    cond.notify_all();
+}
+
+std::shared_ptr<const CBlock> CBlockPipeline::Take(const uint256& hash)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    auto it = mapJobs.find(hash);
+    if (it == mapJobs.end())
+        return nullptr;
+    std::shared_ptr<Job> job = it->second;
+    // Anything queued before this block is not going to be connected next
+    while (queue.front() != job) {
+        mapJobs.erase(queue.front()->hash);
+        queue.pop_front();
+    }
+    if (job->state != JOB_DONE)
+        stats.nStalls++;
+    while (job->state != JOB_DONE && mapJobs.count(hash) && !fStop)
+        cond.wait(lock);
+    if (!mapJobs.count(hash) || job->state != JOB_DONE)
+        return nullptr;
+    queue.pop_front();
+    mapJobs.erase(hash);
+    cond.notify_all();
+    return job->pblock;
+}
+
+void CBlockPipeline::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    queue.clear();
+    mapJobs.clear();
+    cond.notify_all();
+}
+
+void CBlockPipeline::RecordConnect(size_t nTx, int64_t nMicros)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    stats.connect.nBlocks++;
+    stats.connect.nTx += nTx;
+    stats.connect.nMicros += nMicros;
+}
+
+CBlockPipelineStats CBlockPipeline::GetStats() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    CBlockPipelineStats ret = stats;
+    ret.nPending = queue.size();
+    return ret;
+}
+
+void CBlockPipeline::ThreadRead()
+{
+    RenameThread("smartcoin-blockread");
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (true) {
+        std::shared_ptr<Job> job;
+        while (!fStop) {
+            for (const auto& j : queue) {
+                if (j->state == JOB_QUEUED) {
+                    job = j;
+                    break;
+                }
+            }
+            if (job)
+                break;
+            cond.wait(lock);
+        }
+        if (fStop)
+            return;
+
+        lock.unlock();
+        int64_t nStart = GetTimeMicros();
+        std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+        try {
+            if (!ReadBlockFromDisk(*pblock, job->pos, Params().GetConsensus(job->nHeight), false) || pblock->GetHash() != job->hash)
+                pblock.reset();
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+            pblock.reset();
+        }
+        size_t nBytes = pblock ? ::GetSerializeSize(*pblock, SER_DISK, CLIENT_VERSION) : 0;
+        int64_t nTime = GetTimeMicros() - nStart;
+        LogPrint("bench", "Pipeline read block %d: %.2fms\n", job->nHeight, nTime * 0.001);
+        lock.lock();
+
+        if (pblock) {
+            stats.read.nBlocks++;
+            stats.read.nTx += pblock->vtx.size();
+            stats.read.nBytes += nBytes;
+            stats.read.nMicros += nTime;
+        }
+        job->pblock = pblock;
+        // A block that could not be read is handed back as missing; the validation thread reads it itself
+        job->state = pblock ? JOB_READ : JOB_DONE;
+        cond.notify_all();
+    }
+}
+
+void CBlockPipeline::ThreadCheck()
+{
+    RenameThread("smartcoin-blockcheck");
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (true) {
+        std::shared_ptr<Job> job;
+        while (!fStop) {
+            for (const auto& j : queue) {
+                if (j->state == JOB_READ) {
+                    job = j;
+                    break;
+                }
+            }
+            if (job)
+                break;
+            cond.wait(lock);
+        }
+        if (fStop)
+            return;
+
+        lock.unlock();
+        int64_t nStart = GetTimeMicros();
+        // On success the block remembers it was checked and ConnectBlock skips the work;
+        // on failure ConnectBlock repeats the check and reports it.
+        CValidationState state;
+        CheckBlock(*job->pblock, state);
+        int64_t nTime = GetTimeMicros() - nStart;
+        LogPrint("bench", "Pipeline check block %d: %.2fms\n", job->nHeight, nTime * 0.001);
+        lock.lock();
+
+        stats.check.nBlocks++;
+        stats.check.nTx += job->pblock->vtx.size();
+        stats.check.nMicros += nTime;
+        job->state = JOB_DONE;
+        cond.notify_all();
+    }
+}
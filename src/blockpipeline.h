@@ -0,0 +1,104 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKPIPELINE_H
+#define BITCOIN_BLOCKPIPELINE_H
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdint.h>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+/** Default for -blockpipeline, the number of blocks loaded ahead of the tip */
+static const int DEFAULT_BLOCK_PIPELINE_DEPTH = 16;
+/** Maximum for -blockpipeline */
+static const int MAX_BLOCK_PIPELINE_DEPTH = 256;
+
+/** Work done by one stage of the block pipeline */
+struct CBlockPipelineStageStats
+{
+    uint64_t nBlocks;
+    uint64_t nTx;
+    uint64_t nBytes;
+    int64_t nMicros;
+
+    CBlockPipelineStageStats() : nBlocks(0), nTx(0), nBytes(0), nMicros(0) {}
+};
+
+struct CBlockPipelineStats
+{
+    CBlockPipelineStageStats read;
+    CBlockPipelineStageStats check;
+    CBlockPipelineStageStats connect;
+    //! Blocks queued or loaded but not yet taken
+    size_t nPending;
+    //! Blocks the validation thread had to wait for
+    uint64_t nStalls;
+
+    CBlockPipelineStats() : nPending(0), nStalls(0) {}
+};
+
+/**
+ * Loads blocks below the assumed-valid block ahead of the validation thread
+ * during initial sync. One thread reads and deserializes queued blocks from
+ * disk, a second one runs the context-free CheckBlock (merkle root, proof of
+ * work, transaction sanity), so that ConnectTip only has to apply the block to
+ * the UTXO set. The pipeline never decides about validity: a block that fails
+ * to load or check is handed back unchecked and ConnectBlock reports the error.
+ */
+class CBlockPipeline
+{
+public:
+    explicit CBlockPipeline(int nDepthIn);
+    ~CBlockPipeline();
+
+    //! Queue a block for loading unless it is already queued or the pipeline is full. Requires cs_main.
+    void Enqueue(const CBlockIndex* pindex);
+
+    //! Return the loaded block with this hash, waiting for it if it is still in flight. Discards blocks queued before it.
+    std::shared_ptr<const CBlock> Take(const uint256& hash);
+
+    //! Drop all queued and loaded blocks, e.g. after a reorganisation.
+    void Clear();
+
+    //! Account for applying a pipelined block to the chain state.
+    void RecordConnect(size_t nTx, int64_t nMicros);
+
+    CBlockPipelineStats GetStats() const;
+
+private:
+    enum JobState { JOB_QUEUED, JOB_READ, JOB_DONE };
+
+    struct Job {
+        uint256 hash;
+        CDiskBlockPos pos;
+        int nHeight;
+        JobState state;
+        std::shared_ptr<CBlock> pblock;
+    };
+
+    void ThreadRead();
+    void ThreadCheck();
+
+    const size_t nDepth;
+    mutable boost::mutex mutex;
+    boost::condition_variable cond;
+    //! Jobs in chain order; every job is owned by the stage its state names
+    std::deque<std::shared_ptr<Job> > queue;
+    std::map<uint256, std::shared_ptr<Job> > mapJobs;
+    CBlockPipelineStats stats;
+    bool fStop;
+    boost::thread threadRead;
+    boost::thread threadCheck;
+};
+
+#endif // BITCOIN_BLOCKPIPELINE_H
@@ -5,7 +5,12 @@
 #ifndef BITCOIN_CHECKQUEUE_H
 #define BITCOIN_CHECKQUEUE_H
 
+#include "sync.h"
+
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -16,7 +21,10 @@
 template <typename T>
 class CCheckQueueControl;
 
-/** 
+/** Number of work deques in a CCheckQueue: one for the master and one per worker. Workers beyond that share. */
+static const int CHECKQUEUE_MAX_SLOTS = 65;
+
+/**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
   * operator(), returning a bool.
@@ -25,12 +33,35 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every thread has its own deque of pending checks, guarded by its own
+  * mutex. The master deals new checks out over the deques; a thread takes
+  * work from the back of its own deque and, when that runs dry, steals half
+  * of another thread's deque from the front. The shared mutex is only used
+  * to put idle threads to sleep and wake them up again.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    struct Slot {
+        boost::mutex mutex;
+        std::deque<T> queue;
+    };
+
+    //! Per-thread work deques; slot 0 belongs to the master
+    std::vector<std::unique_ptr<Slot> > slots;
+
+    //! Number of slots that have a thread serving them
+    std::atomic<int> nSlotsActive;
+
+    //! Number of worker threads that have registered
+    std::atomic<int> nWorkers;
+
+    //! Slot the next small batch is dealt to
+    std::atomic<unsigned int> nNextSlot;
+
+    //! Mutex for sleeping and waking up threads
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,90 +70,99 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! Number of threads sleeping on condWorker
+    std::atomic<int> nIdle;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
+
+    //! Number of checks sitting in the deques, not yet taken by a thread
+    std::atomic<unsigned int> nQueued;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
-
-    //! Whether we're shutting down.
-    bool fQuit;
+    std::atomic<unsigned int> nTodo;
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    /** Move up to half of the checks in slot (at most nBatchSize) into vChecks. */
+    bool Take(Slot& slot, std::vector<T>& vChecks, bool fOwn)
+    {
+        boost::unique_lock<boost::mutex> lock(slot.mutex);
+        if (slot.queue.empty())
+            return false;
+        unsigned int nNow = std::max(1U, std::min(nBatchSize, (unsigned int)(slot.queue.size() + 1) / 2));
+        vChecks.resize(nNow);
+        for (unsigned int i = 0; i < nNow; i++) {
+            // The owner works from the back, thieves from the front
+            if (fOwn) {
+                vChecks[i].swap(slot.queue.back());
+                slot.queue.pop_back();
+            } else {
+                vChecks[i].swap(slot.queue.front());
+                slot.queue.pop_front();
+            }
+        }
+        nQueued -= nNow;
+        return true;
+    }
+
+    /** Find a batch of work for the thread serving slot nSlot. */
+    bool Find(int nSlot, std::vector<T>& vChecks)
+    {
+        if (Take(*slots[nSlot], vChecks, true))
+            return true;
+        int nActive = nSlotsActive;
+        for (int i = 1; i < nActive && nQueued > 0; i++) {
+            if (Take(*slots[(nSlot + i) % nActive], vChecks, false))
+                return true;
+        }
+        return false;
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(int nSlot)
     {
-        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        const bool fMaster = nSlot == 0;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
+            if (!Find(nSlot, vChecks)) {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if ((fMaster || fQuit) && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
+                if (fMaster) {
+                    while (nQueued == 0 && nTodo != 0)
+                        condMaster.wait(lock);
+                    if (nQueued == 0) {
                         // reset the status for new work later
-                        if (fMaster)
-                            fAllOk = true;
-                        // return the current status
-                        return fRet;
+                        return fAllOk.exchange(true);
                     }
+                } else {
                     nIdle++;
-                    cond.wait(lock); // wait
+                    while (nQueued == 0)
+                        condWorker.wait(lock); // wait
                     nIdle--;
                 }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+                continue;
             }
             // execute work
+            bool fOk = fAllOk;
             BOOST_FOREACH (T& check, vChecks)
                 if (fOk)
                     fOk = check();
+            if (!fOk)
+                fAllOk = false;
+            unsigned int nNow = vChecks.size();
+            // Checks are destroyed before they are accounted as done
             vChecks.clear();
+            if ((nTodo -= nNow) == 0 && !fMaster) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
         } while (true);
     }
 
@@ -131,33 +171,55 @@ public:
     boost::mutex ControlMutex;
 
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : nSlotsActive(1), nWorkers(0), nNextSlot(0), nIdle(0), fAllOk(true), nQueued(0), nTodo(0), nBatchSize(nBatchSizeIn)
+    {
+        for (int i = 0; i < CHECKQUEUE_MAX_SLOTS; i++)
+            slots.emplace_back(new Slot());
+    }
 
     //! Worker thread
     void Thread()
     {
-        Loop();
+        int nSlot = 1 + (nWorkers++ % (CHECKQUEUE_MAX_SLOTS - 1));
+        int nActive = nSlotsActive;
+        while (nActive <= nSlot && !nSlotsActive.compare_exchange_weak(nActive, nSlot + 1)) {}
+        Loop(nSlot);
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        return Loop(0);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+        const unsigned int nActive = nSlotsActive;
+        // Small batches go to one deque in turn, larger ones are spread over all of them
+        const size_t nRun = std::max<size_t>(nBatchSize, (vChecks.size() + nActive - 1) / nActive);
         nTodo += vChecks.size();
-        if (vChecks.size() == 1)
-            condWorker.notify_one();
-        else if (vChecks.size() > 1)
-            condWorker.notify_all();
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nRun) {
+            const size_t nEnd = std::min(vChecks.size(), nStart + nRun);
+            Slot& slot = *slots[nNextSlot++ % nActive];
+            {
+                boost::unique_lock<boost::mutex> lock(slot.mutex);
+                for (size_t i = nStart; i < nEnd; i++) {
+                    slot.queue.push_back(T());
+                    vChecks[i].swap(slot.queue.back());
+                }
+                nQueued += nEnd - nStart;
+            }
+        }
+        if (nIdle > 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (vChecks.size() == 1)
+                condWorker.notify_one();
+            else
+                condWorker.notify_all();
+        }
     }
 
     ~CCheckQueue()
@@ -166,7 +228,7 @@ public:
 
 };
 
-/** 
+/**
  * RAII-style controller object for a CCheckQueue that guarantees the passed
  * queue is finished before continuing.
  */
@@ -32,8 +32,18 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <atomic>
+#include <vector>
 #include <openssl/sha.h>
 
+#if defined(__GNUC__)
+#include "crypto/scrypt_multi.h"
+#endif
+
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX512F)
+#include <cpuid.h>
+#endif
+
 #if defined(USE_SSE2) && !defined(USE_SSE2_ALWAYS)
 #ifdef _MSC_VER
 // MSVC 64bit is unable to use inline asm
@@ -115,6 +125,34 @@ PBKDF2_SHA256(const uint8_t *passwd, size_t passwdlen, const uint8_t *salt,
 	}
 }
 
+/**
+ * PBKDF2_SHA256 with c = 1, starting from an HMAC context already keyed with
+ * the password. scrypt derives two keys from the same password, so keying the
+ * context once (rather than once per HMAC instance per call) saves most of the
+ * SHA256 compressions outside ROMix.
+ */
+static void PBKDF2_SHA256_keyed(const CHMAC_SHA256 &base, const uint8_t *salt,
+    size_t saltlen, uint8_t *buf, size_t dkLen)
+{
+	CHMAC_SHA256 PShctx = base;
+	uint8_t ivec[4];
+	uint8_t U[CHMAC_SHA256::OUTPUT_SIZE];
+	size_t i, clen;
+
+	PShctx.Write(salt, saltlen);
+	for (i = 0; i * 32 < dkLen; i++) {
+		CHMAC_SHA256 hctx = PShctx;
+		be32enc(ivec, (uint32_t)(i + 1));
+		hctx.Write(ivec, 4);
+		hctx.Finalize(U);
+
+		clen = dkLen - i * CHMAC_SHA256::OUTPUT_SIZE;
+		if (clen > CHMAC_SHA256::OUTPUT_SIZE)
+			clen = CHMAC_SHA256::OUTPUT_SIZE;
+		memcpy(&buf[i * CHMAC_SHA256::OUTPUT_SIZE], U, clen);
+	}
+}
+
 #define ROTL(a, b) (((a) << (b)) | ((a) >> (32 - (b))))
 
 static inline void xor_salsa8(uint32_t B[16], const uint32_t Bx[16])
@@ -183,20 +221,10 @@ static inline void xor_salsa8(uint32_t B[16], const uint32_t Bx[16])
 	B[15] += x15;
 }
 
-void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad)
+static void scrypt_core(uint32_t *X, uint32_t *V)
 {
-	uint8_t B[128];
-	uint32_t X[32];
-	uint32_t *V;
 	uint32_t i, j, k;
 
-	V = (uint32_t *)(((uintptr_t)(scratchpad) + 63) & ~ (uintptr_t)(63));
-
-	PBKDF2_SHA256((const uint8_t *)input, 80, (const uint8_t *)input, 80, 1, B, 128);
-
-	for (k = 0; k < 32; k++)
-		X[k] = le32dec(&B[4 * k]);
-
 	for (i = 0; i < 1024; i++) {
 		memcpy(&V[i * 32], X, 128);
 		xor_salsa8(&X[0], &X[16]);
@@ -209,11 +237,35 @@ void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scrat
 		xor_salsa8(&X[0], &X[16]);
 		xor_salsa8(&X[16], &X[0]);
 	}
+}
+
+/* scrypt(1024,1,1) of one 80-byte input whose password HMAC is already keyed. */
+static void scrypt_1024_1_1_256_keyed(const char *input, const CHMAC_SHA256 &hmac, char *output, char *scratchpad)
+{
+	uint8_t B[128];
+	uint32_t X[32];
+	uint32_t *V;
+	uint32_t k;
+
+	V = (uint32_t *)(((uintptr_t)(scratchpad) + 63) & ~ (uintptr_t)(63));
+
+	PBKDF2_SHA256_keyed(hmac, (const uint8_t *)input, 80, B, 128);
+
+	for (k = 0; k < 32; k++)
+		X[k] = le32dec(&B[4 * k]);
+
+	scrypt_core(X, V);
 
 	for (k = 0; k < 32; k++)
 		le32enc(&B[4 * k], X[k]);
 
-	PBKDF2_SHA256((const uint8_t *)input, 80, B, 128, 1, (uint8_t *)output, 32);
+	PBKDF2_SHA256_keyed(hmac, B, 128, (uint8_t *)output, 32);
+}
+
+void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad)
+{
+	CHMAC_SHA256 hmac((const uint8_t *)input, 80);
+	scrypt_1024_1_1_256_keyed(input, hmac, output, scratchpad);
 }
 
 #if defined(USE_SSE2)
@@ -257,3 +309,203 @@ void scrypt_1024_1_1_256(const char *input, char *output)
 	char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
     scrypt_1024_1_1_256_sp(input, output, scratchpad);
 }
+
+#if defined(__GNUC__)
+/* 4 lanes fit a 128-bit register; built with the baseline flags (SSE2 on x86-64). */
+typedef uint32_t scrypt_vec4 __attribute__((vector_size(16)));
+
+static void scrypt_core_4way(uint32_t *X, uint32_t *V)
+{
+	scrypt_core_multi<scrypt_vec4>(X, V);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace scrypt_avx2 {
+void scrypt_core_8way(uint32_t *X, uint32_t *V);
+}
+#endif
+
+#if defined(ENABLE_AVX512F)
+namespace scrypt_avx512 {
+void scrypt_core_16way(uint32_t *X, uint32_t *V);
+}
+#endif
+
+typedef void (*scrypt_core_multi_fn)(uint32_t *X, uint32_t *V);
+
+static const int SCRYPT_MULTI_MAX_LANES = 16;
+
+struct scrypt_multi_kernel {
+	int lanes;
+	scrypt_core_multi_fn core;
+	const char *name;
+};
+
+/* Ordered from widest to narrowest; the scalar kernel (core == NULL) is always last. */
+static const scrypt_multi_kernel scrypt_multi_kernels[] = {
+#if defined(ENABLE_AVX512F)
+	{16, &scrypt_avx512::scrypt_core_16way, "avx512f(16-way)"},
+#endif
+#if defined(ENABLE_AVX2)
+	{8, &scrypt_avx2::scrypt_core_8way, "avx2(8-way)"},
+#endif
+#if defined(__GNUC__)
+	{4, &scrypt_core_4way, "vec128(4-way)"},
+#endif
+	{1, NULL, "generic(1-way)"},
+};
+static const int scrypt_multi_nkernels = sizeof(scrypt_multi_kernels) / sizeof(scrypt_multi_kernels[0]);
+
+/* Index into scrypt_multi_kernels of the widest kernel in use. The 4-way kernel
+ * (when built) needs nothing beyond the baseline instruction set, so it is a
+ * safe default until scrypt_multi_detect() has run. Atomic, as it may be
+ * changed while other threads hash; each call reads it once. */
+static std::atomic<int> scrypt_multi_selected(scrypt_multi_nkernels > 1 ? scrypt_multi_nkernels - 2 : 0);
+
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX512F)
+static int scrypt_multi_cpu_max_lanes()
+{
+	uint32_t eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 4;
+	/* Require OSXSAVE and AVX, then ask the OS which register state it saves. */
+	if (!(ecx & (1 << 27)) || !(ecx & (1 << 28)))
+		return 4;
+	uint32_t xcr0_lo, xcr0_hi;
+	__asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+	if ((xcr0_lo & 0x6) != 0x6)
+		return 4;
+	if (__get_cpuid_max(0, NULL) < 7)
+		return 4;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	if ((ebx & (1 << 16)) && (xcr0_lo & 0xe6) == 0xe6)
+		return 16;
+	if (ebx & (1 << 5))
+		return 8;
+	return 4;
+}
+#endif
+
+bool scrypt_multi_select(int lanes)
+{
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX512F)
+	if (lanes > scrypt_multi_cpu_max_lanes())
+		return false;
+#endif
+	for (int i = 0; i < scrypt_multi_nkernels; i++) {
+		if (scrypt_multi_kernels[i].lanes == lanes) {
+			scrypt_multi_selected = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+const char *scrypt_multi_detect()
+{
+	for (int i = 0; i < scrypt_multi_nkernels; i++) {
+		if (scrypt_multi_select(scrypt_multi_kernels[i].lanes))
+			break;
+	}
+	return scrypt_multi_kernels[scrypt_multi_selected.load()].name;
+}
+
+int scrypt_multi_lanes()
+{
+	return scrypt_multi_kernels[scrypt_multi_selected.load()].lanes;
+}
+
+/* Hash kernel.lanes inputs: PBKDF2 per lane, interleaved ROMix, PBKDF2 per lane. */
+static void scrypt_multi_chunk(const scrypt_multi_kernel &kernel, const char *input, const CHMAC_SHA256 *hmac, char *output, uint32_t *V)
+{
+	const int lanes = kernel.lanes;
+	uint8_t B[SCRYPT_MULTI_MAX_LANES][128];
+	uint32_t X[32 * SCRYPT_MULTI_MAX_LANES];
+	int k, l;
+
+	for (l = 0; l < lanes; l++) {
+		const uint8_t *in = (const uint8_t *)input + 80 * l;
+		PBKDF2_SHA256_keyed(hmac[l], in, 80, B[l], 128);
+		for (k = 0; k < 32; k++)
+			X[k * lanes + l] = le32dec(&B[l][4 * k]);
+	}
+
+	kernel.core(X, V);
+
+	for (l = 0; l < lanes; l++) {
+		for (k = 0; k < 32; k++)
+			le32enc(&B[l][4 * k], X[k * lanes + l]);
+		PBKDF2_SHA256_keyed(hmac[l], B[l], 128, (uint8_t *)output + 32 * l, 32);
+	}
+}
+
+/* Walk the kernels from the selected one down; hmac[i] is keyed with input i. */
+static void scrypt_multi_run(const char *input, const CHMAC_SHA256 *hmac, char *output, size_t n, char *scratchpad)
+{
+	uint32_t *V = (uint32_t *)(((uintptr_t)(scratchpad) + 63) & ~ (uintptr_t)(63));
+
+	for (int i = scrypt_multi_selected.load(); i < scrypt_multi_nkernels && scrypt_multi_kernels[i].lanes > 1; i++) {
+		const scrypt_multi_kernel &kernel = scrypt_multi_kernels[i];
+		while (n >= (size_t)kernel.lanes) {
+			scrypt_multi_chunk(kernel, input, hmac, output, V);
+			input += 80 * kernel.lanes;
+			output += 32 * kernel.lanes;
+			hmac += kernel.lanes;
+			n -= kernel.lanes;
+		}
+	}
+
+	/* Leftover inputs (fewer than the narrowest kernel) go through the scalar path. */
+	for (; n > 0; n--, input += 80, output += 32, hmac++)
+		scrypt_1024_1_1_256_keyed(input, *hmac, output, scratchpad);
+}
+
+void scrypt_1024_1_1_256_multi_sp(const char *input, char *output, size_t n, char *scratchpad)
+{
+	std::vector<CHMAC_SHA256> hmac;
+	hmac.reserve(n);
+	for (size_t i = 0; i < n; i++)
+		hmac.emplace_back((const uint8_t *)input + 80 * i, 80);
+	scrypt_multi_run(input, hmac.data(), output, n, scratchpad);
+}
+
+CScryptMidstate::CScryptMidstate(const char *input)
+{
+	memcpy(data, input, 80);
+	keyctx.Write((const uint8_t *)data, 64);
+}
+
+void CScryptMidstate::Hash(uint32_t nonce, char *output, size_t n, char *scratchpad)
+{
+	uint8_t key[CSHA256::OUTPUT_SIZE];
+
+	inputs.resize(80 * n);
+	hmac.clear();
+	for (size_t i = 0; i < n; i++) {
+		char *in = &inputs[80 * i];
+		memcpy(in, data, 76);
+		le32enc(in + 76, nonce + (uint32_t)i);
+		/* HMAC with a key longer than a block is HMAC keyed with its hash. */
+		CSHA256(keyctx).Write((const uint8_t *)in + 64, 16).Finalize(key);
+		hmac.emplace_back(key, sizeof(key));
+	}
+	scrypt_multi_run(inputs.data(), hmac.data(), output, n, scratchpad);
+}
+
+void scrypt_1024_1_1_256_multi(const char *input, char *output, size_t n)
+{
+	if (n < 4 || scrypt_multi_lanes() == 1) {
+		char scratchpad[SCRYPT_SCRATCHPAD_SIZE];
+		for (; n > 0; n--, input += 80, output += 32)
+			scrypt_1024_1_1_256_sp(input, output, scratchpad);
+		return;
+	}
+
+	/* One scratchpad sized for the widest kernel serves all narrower ones. It
+	 * is kept for the life of the thread, as this runs for every header and
+	 * mining round. */
+	static thread_local std::vector<char> scratchpad;
+	scratchpad.resize(SCRYPT_MULTI_SCRATCHPAD_SIZE);
+	scrypt_1024_1_1_256_multi_sp(input, output, n, scratchpad.data());
+}
@@ -2,12 +2,59 @@
 #define SCRYPT_H
 #include <stdlib.h>
 #include <stdint.h>
+#include <vector>
+
+#include "crypto/hmac_sha256.h"
+#include "crypto/sha256.h"
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
 void scrypt_1024_1_1_256(const char *input, char *output);
 void scrypt_1024_1_1_256_sp_generic(const char *input, char *output, char *scratchpad);
 
+/**
+ * Hash n independent 80-byte inputs, stored back to back in input, into n
+ * 32-byte outputs. Several inputs are interleaved as lanes of one SIMD register
+ * through the Salsa20/8 core, using the widest kernel selected by
+ * scrypt_multi_detect(). Results are identical to scrypt_1024_1_1_256.
+ */
+void scrypt_1024_1_1_256_multi(const char *input, char *output, size_t n);
+/** Scratchpad size for scrypt_1024_1_1_256_multi_sp, enough for the widest kernel. */
+static const int SCRYPT_MULTI_SCRATCHPAD_SIZE = 16 * 131072 + 63;
+/** As scrypt_1024_1_1_256_multi, with a caller-owned scratchpad of SCRYPT_MULTI_SCRATCHPAD_SIZE bytes. */
+void scrypt_1024_1_1_256_multi_sp(const char *input, char *output, size_t n, char *scratchpad);
+/** Select the widest multi-lane kernel supported by this CPU. Returns its name. */
+const char *scrypt_multi_detect();
+/** Force a lane width (1, 4, 8 or 16). Returns false if it is not supported here. */
+bool scrypt_multi_select(int lanes);
+/** Lane width of the currently selected multi-lane kernel. */
+int scrypt_multi_lanes();
+
+/**
+ * scrypt_1024_1_1_256 of 80-byte inputs that differ only in their last four
+ * bytes, such as a block header whose nonce is being iterated. scrypt keys its
+ * HMAC with SHA256 of the whole input; the SHA256 state after the first 64
+ * bytes does not depend on the nonce and is computed once.
+ */
+class CScryptMidstate
+{
+public:
+    explicit CScryptMidstate(const char *input);
+    /**
+     * Hash n inputs whose last four bytes are the little endian nonces
+     * nonce, nonce + 1, ... through the multi-lane kernel. scratchpad must
+     * hold SCRYPT_MULTI_SCRATCHPAD_SIZE bytes.
+     */
+    void Hash(uint32_t nonce, char *output, size_t n, char *scratchpad);
+
+private:
+    CSHA256 keyctx;
+    char data[80];
+    // Reused between calls so that hashing does not allocate
+    std::vector<char> inputs;
+    std::vector<CHMAC_SHA256> hmac;
+};
+
 #if defined(USE_SSE2)
 #if defined(_M_X64) || defined(__x86_64__) || defined(_M_AMD64) || (defined(MAC_OSX) && defined(__i386__))
 #define USE_SSE2_ALWAYS 1
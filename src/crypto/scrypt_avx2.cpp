@@ -0,0 +1,22 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with -mavx2; only call into it after checking CPU support.
+
+#ifdef ENABLE_AVX2
+
+#include "crypto/scrypt_multi.h"
+
+namespace scrypt_avx2 {
+
+typedef uint32_t vec8 __attribute__((vector_size(32)));
+
+void scrypt_core_8way(uint32_t *X, uint32_t *V)
+{
+    scrypt_core_multi<vec8>(X, V);
+}
+
+} // namespace scrypt_avx2
+
+#endif
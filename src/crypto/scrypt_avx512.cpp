@@ -0,0 +1,22 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with -mavx512f; only call into it after checking CPU support.
+
+#ifdef ENABLE_AVX512F
+
+#include "crypto/scrypt_multi.h"
+
+namespace scrypt_avx512 {
+
+typedef uint32_t vec16 __attribute__((vector_size(64)));
+
+void scrypt_core_16way(uint32_t *X, uint32_t *V)
+{
+    scrypt_core_multi<vec16>(X, V);
+}
+
+} // namespace scrypt_avx512
+
+#endif
@@ -0,0 +1,126 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Multi-lane scrypt(1024,1,1) core. Each element of a vector holds the same
+// state word of a different input, so every Salsa20/8 operation advances all
+// lanes at once. The including translation unit picks the vector width (and
+// the compiler flags to go with it); this header is not part of the public API.
+
+#ifndef BITCOIN_CRYPTO_SCRYPT_MULTI_H
+#define BITCOIN_CRYPTO_SCRYPT_MULTI_H
+
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+template <typename vec>
+inline vec scrypt_multi_rotl(vec a, int b)
+{
+    return (a << b) | (a >> (32 - b));
+}
+
+template <typename vec>
+inline void xor_salsa8_multi(vec B[16], const vec Bx[16])
+{
+    vec x00, x01, x02, x03, x04, x05, x06, x07, x08, x09, x10, x11, x12, x13, x14, x15;
+
+    x00 = (B[ 0] ^= Bx[ 0]);
+    x01 = (B[ 1] ^= Bx[ 1]);
+    x02 = (B[ 2] ^= Bx[ 2]);
+    x03 = (B[ 3] ^= Bx[ 3]);
+    x04 = (B[ 4] ^= Bx[ 4]);
+    x05 = (B[ 5] ^= Bx[ 5]);
+    x06 = (B[ 6] ^= Bx[ 6]);
+    x07 = (B[ 7] ^= Bx[ 7]);
+    x08 = (B[ 8] ^= Bx[ 8]);
+    x09 = (B[ 9] ^= Bx[ 9]);
+    x10 = (B[10] ^= Bx[10]);
+    x11 = (B[11] ^= Bx[11]);
+    x12 = (B[12] ^= Bx[12]);
+    x13 = (B[13] ^= Bx[13]);
+    x14 = (B[14] ^= Bx[14]);
+    x15 = (B[15] ^= Bx[15]);
+    for (int i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        x04 ^= scrypt_multi_rotl(x00 + x12,  7);  x09 ^= scrypt_multi_rotl(x05 + x01,  7);
+        x14 ^= scrypt_multi_rotl(x10 + x06,  7);  x03 ^= scrypt_multi_rotl(x15 + x11,  7);
+
+        x08 ^= scrypt_multi_rotl(x04 + x00,  9);  x13 ^= scrypt_multi_rotl(x09 + x05,  9);
+        x02 ^= scrypt_multi_rotl(x14 + x10,  9);  x07 ^= scrypt_multi_rotl(x03 + x15,  9);
+
+        x12 ^= scrypt_multi_rotl(x08 + x04, 13);  x01 ^= scrypt_multi_rotl(x13 + x09, 13);
+        x06 ^= scrypt_multi_rotl(x02 + x14, 13);  x11 ^= scrypt_multi_rotl(x07 + x03, 13);
+
+        x00 ^= scrypt_multi_rotl(x12 + x08, 18);  x05 ^= scrypt_multi_rotl(x01 + x13, 18);
+        x10 ^= scrypt_multi_rotl(x06 + x02, 18);  x15 ^= scrypt_multi_rotl(x11 + x07, 18);
+
+        /* Operate on rows. */
+        x01 ^= scrypt_multi_rotl(x00 + x03,  7);  x06 ^= scrypt_multi_rotl(x05 + x04,  7);
+        x11 ^= scrypt_multi_rotl(x10 + x09,  7);  x12 ^= scrypt_multi_rotl(x15 + x14,  7);
+
+        x02 ^= scrypt_multi_rotl(x01 + x00,  9);  x07 ^= scrypt_multi_rotl(x06 + x05,  9);
+        x08 ^= scrypt_multi_rotl(x11 + x10,  9);  x13 ^= scrypt_multi_rotl(x12 + x15,  9);
+
+        x03 ^= scrypt_multi_rotl(x02 + x01, 13);  x04 ^= scrypt_multi_rotl(x07 + x06, 13);
+        x09 ^= scrypt_multi_rotl(x08 + x11, 13);  x14 ^= scrypt_multi_rotl(x13 + x12, 13);
+
+        x00 ^= scrypt_multi_rotl(x03 + x02, 18);  x05 ^= scrypt_multi_rotl(x04 + x07, 18);
+        x10 ^= scrypt_multi_rotl(x09 + x08, 18);  x15 ^= scrypt_multi_rotl(x14 + x13, 18);
+    }
+    B[ 0] += x00;
+    B[ 1] += x01;
+    B[ 2] += x02;
+    B[ 3] += x03;
+    B[ 4] += x04;
+    B[ 5] += x05;
+    B[ 6] += x06;
+    B[ 7] += x07;
+    B[ 8] += x08;
+    B[ 9] += x09;
+    B[10] += x10;
+    B[11] += x11;
+    B[12] += x12;
+    B[13] += x13;
+    B[14] += x14;
+    B[15] += x15;
+}
+
+/**
+ * Run the ROMix step of scrypt(1024,1,1) on LANES interleaved inputs.
+ * X holds 32 state words, each as LANES consecutive uint32_t (word-major).
+ * V is a scratchpad of 1024 * 32 * LANES words, aligned to sizeof(vec).
+ */
+template <typename vec>
+void scrypt_core_multi(uint32_t *Xio, uint32_t *Vio)
+{
+    static const int LANES = sizeof(vec) / sizeof(uint32_t);
+    vec X[32];
+    vec *V = (vec *)Vio;
+    int i, k, l;
+
+    memcpy(X, Xio, sizeof(X));
+
+    for (i = 0; i < 1024; i++) {
+        memcpy(&V[i * 32], X, sizeof(X));
+        xor_salsa8_multi(&X[0], &X[16]);
+        xor_salsa8_multi(&X[16], &X[0]);
+    }
+    for (i = 0; i < 1024; i++) {
+        // Each lane reads its own (data-dependent) row of the scratchpad.
+        for (l = 0; l < LANES; l++) {
+            uint32_t j = 32 * (X[16][l] & 1023);
+            for (k = 0; k < 32; k++)
+                X[k][l] ^= V[j + k][l];
+        }
+        xor_salsa8_multi(&X[0], &X[16]);
+        xor_salsa8_multi(&X[16], &X[0]);
+    }
+
+    memcpy(Xio, X, sizeof(X));
+}
+
+} // namespace
+
+#endif // BITCOIN_CRYPTO_SCRYPT_MULTI_H
@@ -0,0 +1,272 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/x11.h"
+
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_cubehash.h"
+#include "crypto/sph_echo.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_luffa.h"
+#include "crypto/sph_shavite.h"
+#include "crypto/sph_simd.h"
+#include "crypto/sph_skein.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+
+#if defined(__GNUC__)
+#include "crypto/x11_multi.h"
+#endif
+
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX512F) || defined(ENABLE_AESNI)
+#include <cpuid.h>
+#endif
+
+typedef void (*x11_multi_stage_fn)(const unsigned char *in, unsigned char *out);
+
+#if defined(__GNUC__)
+/* 128-bit vectors; built with the baseline flags (SSE2 on x86-64). */
+typedef uint32_t x11_vec32x4 __attribute__((vector_size(16)));
+
+static void cubehash512_64_4way(const unsigned char *in, unsigned char *out)
+{
+    cubehash512_64_multi<x11_vec32x4>(in, out);
+}
+#endif
+
+#if defined(ENABLE_AVX2)
+namespace x11_avx2 {
+void cubehash512_64_8way(const unsigned char *in, unsigned char *out);
+void blake512_80_4way(const unsigned char *in, unsigned char *out);
+void bmw512_64_4way(const unsigned char *in, unsigned char *out);
+void skein512_64_4way(const unsigned char *in, unsigned char *out);
+}
+#endif
+
+#if defined(ENABLE_AVX512F)
+namespace x11_avx512 {
+void cubehash512_64_16way(const unsigned char *in, unsigned char *out);
+void keccak512_64_8way(const unsigned char *in, unsigned char *out);
+void blake512_80_8way(const unsigned char *in, unsigned char *out);
+void bmw512_64_8way(const unsigned char *in, unsigned char *out);
+void skein512_64_8way(const unsigned char *in, unsigned char *out);
+}
+#endif
+
+#if defined(ENABLE_AESNI)
+namespace x11_aesni {
+void groestl512_64(const unsigned char *in, unsigned char *out, size_t n);
+void shavite512_64(const unsigned char *in, unsigned char *out, size_t n);
+void echo512_64(const unsigned char *in, unsigned char *out, size_t n);
+}
+#endif
+
+struct x11_multi_kernel {
+    int lanes;
+    x11_multi_stage_fn cubehash;
+    /* Kernels on 64-bit words, each running lanes64 messages. */
+    int lanes64;
+    x11_multi_stage_fn blake80;
+    x11_multi_stage_fn bmw;
+    x11_multi_stage_fn skein;
+    x11_multi_stage_fn keccak;
+    const char *name;
+    const char *name_aesni;
+};
+
+/* Ordered from widest to narrowest; the reference-only entry is always last.
+ * Keccak only has an AVX-512 kernel: without a 64-bit vector rotate, four
+ * lanes are no faster than the scalar code. The 128-bit entry has no 64-bit
+ * kernels for the same reason. */
+static const x11_multi_kernel x11_multi_kernels[] = {
+#if defined(ENABLE_AVX512F)
+    {16, &x11_avx512::cubehash512_64_16way, 8, &x11_avx512::blake512_80_8way, &x11_avx512::bmw512_64_8way, &x11_avx512::skein512_64_8way, &x11_avx512::keccak512_64_8way, "avx512f(16-way)", "avx512f(16-way)+aes-ni"},
+#endif
+#if defined(ENABLE_AVX2)
+    {8, &x11_avx2::cubehash512_64_8way, 4, &x11_avx2::blake512_80_4way, &x11_avx2::bmw512_64_4way, &x11_avx2::skein512_64_4way, NULL, "avx2(8-way)", "avx2(8-way)+aes-ni"},
+#endif
+#if defined(__GNUC__)
+    {4, &cubehash512_64_4way, 1, NULL, NULL, NULL, NULL, "vec128(4-way)", "vec128(4-way)+aes-ni"},
+#endif
+    {1, NULL, 1, NULL, NULL, NULL, NULL, "generic", "generic+aes-ni"},
+};
+static const int x11_multi_nkernels = sizeof(x11_multi_kernels) / sizeof(x11_multi_kernels[0]);
+
+/* As in scrypt.cpp, default to the baseline 128-bit kernel (when built) until
+ * x11_multi_detect() has run. The kernel index and the AES-NI flag share one
+ * atomic (index * 2 + aesni) so that a hash never sees half a selection. */
+static std::atomic<int> x11_multi_selected((x11_multi_nkernels > 1 ? x11_multi_nkernels - 2 : 0) * 2);
+
+static void x11_multi_cpu_features(int &max_lanes, bool &fAESNI)
+{
+    max_lanes = 4;
+    fAESNI = false;
+#if defined(ENABLE_AVX2) || defined(ENABLE_AVX512F) || defined(ENABLE_AESNI)
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return;
+    /* The AES-NI kernels also use SSSE3 byte shuffles. */
+    fAESNI = (ecx & (1 << 25)) && (ecx & (1 << 9));
+    /* Require OSXSAVE and AVX, then ask the OS which register state it saves. */
+    if (!(ecx & (1 << 27)) || !(ecx & (1 << 28)))
+        return;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6) != 0x6)
+        return;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if ((ebx & (1 << 16)) && (xcr0_lo & 0xe6) == 0xe6)
+        max_lanes = 16;
+    else if (ebx & (1 << 5))
+        max_lanes = 8;
+#endif
+}
+
+bool x11_multi_select(int lanes, bool fAESNI)
+{
+    int max_lanes;
+    bool fCPUAESNI;
+    x11_multi_cpu_features(max_lanes, fCPUAESNI);
+    if (lanes > max_lanes)
+        return false;
+#if defined(ENABLE_AESNI)
+    if (fAESNI && !fCPUAESNI)
+        return false;
+#else
+    if (fAESNI)
+        return false;
+#endif
+    for (int i = 0; i < x11_multi_nkernels; i++) {
+        if (x11_multi_kernels[i].lanes == lanes) {
+            x11_multi_selected = i * 2 + (fAESNI ? 1 : 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *x11_multi_detect()
+{
+    bool fSelected = false;
+    for (int fAESNI = 1; fAESNI >= 0 && !fSelected; fAESNI--) {
+        for (int i = 0; i < x11_multi_nkernels && !fSelected; i++)
+            fSelected = x11_multi_select(x11_multi_kernels[i].lanes, fAESNI);
+    }
+    const int selected = x11_multi_selected.load();
+    const x11_multi_kernel &kernel = x11_multi_kernels[selected / 2];
+    return (selected & 1) ? kernel.name_aesni : kernel.name;
+}
+
+typedef void (*sph_update_fn)(void *cc, const void *data, size_t len);
+typedef void (*sph_close_fn)(void *cc, void *dst);
+
+/* Run count 64-byte messages through one sph stage. */
+static void x11_stage(void *cc, sph_update_fn update, sph_close_fn close, const unsigned char *in, unsigned char *out, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        update(cc, in + 64 * i, 64);
+        close(cc, out + 64 * i);
+    }
+}
+
+/* As x11_stage, but hand as many messages as possible to the multi-lane kernel. */
+static void x11_stage_multi(int lanes, x11_multi_stage_fn kernel, void *cc, sph_update_fn update, sph_close_fn close, const unsigned char *in, unsigned char *out, size_t count)
+{
+    size_t i = 0;
+    if (kernel) {
+        for (; i + lanes <= count; i += lanes)
+            kernel(in + 64 * i, out + 64 * i);
+    }
+    x11_stage(cc, update, close, in + 64 * i, out + 64 * i, count - i);
+}
+
+/* Inputs per pass through the chain; a multiple of the widest kernel. */
+static const size_t X11_MULTI_CHUNK = 16;
+
+void x11_hash_multi(const unsigned char *input, size_t len, size_t n, unsigned char *output)
+{
+    const int selected = x11_multi_selected.load();
+    const x11_multi_kernel &kernel = x11_multi_kernels[selected / 2];
+#if defined(ENABLE_AESNI)
+    const bool fAESNI = selected & 1;
+#endif
+
+    /* Every sph close() re-initialises its context, so one set serves all inputs. */
+    sph_blake512_context     ctx_blake;
+    sph_bmw512_context       ctx_bmw;
+    sph_groestl512_context   ctx_groestl;
+    sph_skein512_context     ctx_skein;
+    sph_jh512_context        ctx_jh;
+    sph_keccak512_context    ctx_keccak;
+    sph_luffa512_context     ctx_luffa;
+    sph_cubehash512_context  ctx_cubehash;
+    sph_shavite512_context   ctx_shavite;
+    sph_simd512_context      ctx_simd;
+    sph_echo512_context      ctx_echo;
+    sph_blake512_init(&ctx_blake);
+    sph_bmw512_init(&ctx_bmw);
+    sph_groestl512_init(&ctx_groestl);
+    sph_skein512_init(&ctx_skein);
+    sph_jh512_init(&ctx_jh);
+    sph_keccak512_init(&ctx_keccak);
+    sph_luffa512_init(&ctx_luffa);
+    sph_cubehash512_init(&ctx_cubehash);
+    sph_shavite512_init(&ctx_shavite);
+    sph_simd512_init(&ctx_simd);
+    sph_echo512_init(&ctx_echo);
+
+    /* Intermediate 512-bit hashes ping-pong between two buffers. */
+    unsigned char buf[2][X11_MULTI_CHUNK * 64] __attribute__((aligned(64)));
+
+    for (size_t begin = 0; begin < n; begin += X11_MULTI_CHUNK) {
+        const size_t count = std::min(n - begin, X11_MULTI_CHUNK);
+        unsigned char *a = buf[0], *b = buf[1];
+
+        /* The blake kernel only takes block headers. */
+        size_t i = 0;
+        if (kernel.blake80 && len == 80) {
+            for (; i + kernel.lanes64 <= count; i += kernel.lanes64)
+                kernel.blake80(input + (begin + i) * len, a + 64 * i);
+        }
+        for (; i < count; i++) {
+            sph_blake512(&ctx_blake, input + (begin + i) * len, len);
+            sph_blake512_close(&ctx_blake, a + 64 * i);
+        }
+        x11_stage_multi(kernel.lanes64, kernel.bmw, &ctx_bmw, sph_bmw512, sph_bmw512_close, a, b, count);
+#if defined(ENABLE_AESNI)
+        if (fAESNI)
+            x11_aesni::groestl512_64(b, a, count);
+        else
+#endif
+            x11_stage(&ctx_groestl, sph_groestl512, sph_groestl512_close, b, a, count);
+        x11_stage_multi(kernel.lanes64, kernel.skein, &ctx_skein, sph_skein512, sph_skein512_close, a, b, count);
+        x11_stage(&ctx_jh, sph_jh512, sph_jh512_close, b, a, count);
+        x11_stage_multi(kernel.lanes64, kernel.keccak, &ctx_keccak, sph_keccak512, sph_keccak512_close, a, b, count);
+        x11_stage(&ctx_luffa, sph_luffa512, sph_luffa512_close, b, a, count);
+        x11_stage_multi(kernel.lanes, kernel.cubehash, &ctx_cubehash, sph_cubehash512, sph_cubehash512_close, a, b, count);
+#if defined(ENABLE_AESNI)
+        if (fAESNI)
+            x11_aesni::shavite512_64(b, a, count);
+        else
+#endif
+            x11_stage(&ctx_shavite, sph_shavite512, sph_shavite512_close, b, a, count);
+        x11_stage(&ctx_simd, sph_simd512, sph_simd512_close, a, b, count);
+#if defined(ENABLE_AESNI)
+        if (fAESNI)
+            x11_aesni::echo512_64(b, a, count);
+        else
+#endif
+            x11_stage(&ctx_echo, sph_echo512, sph_echo512_close, b, a, count);
+
+        for (i = 0; i < count; i++)
+            memcpy(output + (begin + i) * 32, a + 64 * i, 32);
+    }
+}
@@ -0,0 +1,25 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_X11_H
+#define BITCOIN_CRYPTO_X11_H
+
+#include <stddef.h>
+
+/**
+ * X11 of n inputs of len bytes each, stored back to back; writes n 32-byte
+ * hashes (the truncated result, as returned by Hash11). The inputs go through
+ * the chain one stage at a time, so stages with a kernel selected by
+ * x11_multi_detect() process several of them at once. The remaining stages
+ * use the sph reference code, with one set of contexts for the whole call.
+ */
+void x11_hash_multi(const unsigned char *input, size_t len, size_t n, unsigned char *output);
+/** Select the widest kernels this CPU supports and return their name. */
+const char *x11_multi_detect();
+/** Use kernels of at most the given width (16, 8, 4 or 1 = reference only),
+ * plus AES-NI if fAESNI. Returns false if that combination is not built or
+ * not supported by this CPU. */
+bool x11_multi_select(int lanes, bool fAESNI);
+
+#endif // BITCOIN_CRYPTO_X11_H
@@ -0,0 +1,328 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with -mssse3 -maes; only call into it after checking CPU support.
+
+#ifdef ENABLE_AESNI
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+
+namespace x11_aesni {
+
+/* Multiply every byte by x in GF(2^8), as the MixColumns step of echo.c does on words. */
+static inline __m128i echo_xtime(__m128i a)
+{
+    const __m128i lo7 = _mm_set1_epi8(0x7F);
+    __m128i hi = _mm_srli_epi32(_mm_andnot_si128(lo7, a), 7);
+    /* hi holds 0 or 1 per byte, so 0x1B * hi can be built from shifts without carries. */
+    __m128i red = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(hi, 4), _mm_slli_epi32(hi, 3)),
+                                _mm_xor_si128(_mm_slli_epi32(hi, 1), hi));
+    return _mm_xor_si128(_mm_slli_epi32(_mm_and_si128(a, lo7), 1), red);
+}
+
+static inline void echo_mix_column(__m128i W[16], int ia)
+{
+    __m128i a = W[ia], b = W[ia + 1], c = W[ia + 2], d = W[ia + 3];
+    __m128i ab = _mm_xor_si128(a, b);
+    __m128i bc = _mm_xor_si128(b, c);
+    __m128i cd = _mm_xor_si128(c, d);
+    __m128i abx = echo_xtime(ab);
+    __m128i bcx = echo_xtime(bc);
+    __m128i cdx = echo_xtime(cd);
+    W[ia] = _mm_xor_si128(abx, _mm_xor_si128(bc, d));
+    W[ia + 1] = _mm_xor_si128(bcx, _mm_xor_si128(a, cd));
+    W[ia + 2] = _mm_xor_si128(cdx, _mm_xor_si128(ab, d));
+    W[ia + 3] = _mm_xor_si128(_mm_xor_si128(abx, bcx), _mm_xor_si128(cdx, _mm_xor_si128(ab, c)));
+}
+
+/**
+ * ECHO-512 of n 64-byte messages stored back to back at in; writes n 64-byte
+ * digests to out. A 64-byte message plus padding is a single compression, so
+ * the chaining value, padding and counter are all constants.
+ */
+void echo512_64(const unsigned char *in, unsigned char *out, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    /* Initial chaining words hold the output size in bits; so does the counter. */
+    const __m128i V = _mm_set_epi32(0, 0, 0, 512);
+
+    for (size_t m = 0; m < n; m++, in += 64, out += 64) {
+        __m128i M[4], W[16], tmp;
+        int u;
+
+        for (u = 0; u < 4; u++)
+            M[u] = _mm_loadu_si128((const __m128i *)(in + 16 * u));
+        for (u = 0; u < 8; u++)
+            W[u] = V;
+        for (u = 0; u < 4; u++)
+            W[8 + u] = M[u];
+        W[12] = _mm_set_epi32(0, 0, 0, 0x80);
+        W[13] = zero;
+        W[14] = _mm_set_epi32(512 << 16, 0, 0, 0);
+        W[15] = V;
+
+        uint32_t K = 512;
+        for (int round = 0; round < 10; round++) {
+            /* SubWords: two AES rounds per word, the first keyed by the counter. */
+            for (u = 0; u < 16; u++) {
+                W[u] = _mm_aesenc_si128(W[u], _mm_set_epi32(0, 0, 0, K++));
+                W[u] = _mm_aesenc_si128(W[u], zero);
+            }
+            /* ShiftRows */
+            tmp = W[1]; W[1] = W[5]; W[5] = W[9]; W[9] = W[13]; W[13] = tmp;
+            tmp = W[2]; W[2] = W[10]; W[10] = tmp;
+            tmp = W[6]; W[6] = W[14]; W[14] = tmp;
+            tmp = W[15]; W[15] = W[11]; W[11] = W[7]; W[7] = W[3]; W[3] = tmp;
+            /* MixColumns */
+            echo_mix_column(W, 0);
+            echo_mix_column(W, 4);
+            echo_mix_column(W, 8);
+            echo_mix_column(W, 12);
+        }
+
+        for (u = 0; u < 4; u++) {
+            __m128i h = _mm_xor_si128(_mm_xor_si128(V, M[u]), _mm_xor_si128(W[u], W[u + 8]));
+            _mm_storeu_si128((__m128i *)(out + 16 * u), h);
+        }
+    }
+}
+
+/* Multiply every byte by x in GF(2^8), with the AES reduction polynomial. */
+static inline __m128i groestl_xtime(__m128i a)
+{
+    __m128i hi = _mm_cmplt_epi8(a, _mm_setzero_si128());
+    return _mm_xor_si128(_mm_add_epi8(a, a), _mm_and_si128(hi, _mm_set1_epi8(0x1B)));
+}
+
+/*
+ * Transpose the 8x8 matrix of 16-bit elements held in X. Together with a byte
+ * shuffle that pairs up the two columns in each register, this converts
+ * between the Groestl byte order (column by column, eight rows each) and one
+ * register per row; being its own inverse, it serves both directions.
+ */
+static inline void groestl_transpose(__m128i X[8])
+{
+    __m128i a[8], b[8];
+    int i;
+
+    for (i = 0; i < 8; i += 2) {
+        a[i] = _mm_unpacklo_epi16(X[i], X[i + 1]);
+        a[i + 1] = _mm_unpackhi_epi16(X[i], X[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4) {
+        b[i] = _mm_unpacklo_epi32(a[i], a[i + 2]);
+        b[i + 1] = _mm_unpackhi_epi32(a[i], a[i + 2]);
+        b[i + 2] = _mm_unpacklo_epi32(a[i + 1], a[i + 3]);
+        b[i + 3] = _mm_unpackhi_epi32(a[i + 1], a[i + 3]);
+    }
+    for (i = 0; i < 4; i++) {
+        X[2 * i] = _mm_unpacklo_epi64(b[i], b[i + 4]);
+        X[2 * i + 1] = _mm_unpackhi_epi64(b[i], b[i + 4]);
+    }
+}
+
+static inline void groestl_to_rows(__m128i X[8])
+{
+    const __m128i mask = _mm_setr_epi8(0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15);
+    for (int i = 0; i < 8; i++)
+        X[i] = _mm_shuffle_epi8(X[i], mask);
+    groestl_transpose(X);
+}
+
+static inline void groestl_from_rows(__m128i X[8])
+{
+    const __m128i mask = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    groestl_transpose(X);
+    for (int i = 0; i < 8; i++)
+        X[i] = _mm_shuffle_epi8(X[i], mask);
+}
+
+/* MixBytes: row i becomes sum over d of b[d] * row (i + d), b = (2, 2, 3, 4, 5, 3, 5, 7). */
+static inline void groestl_mix_bytes(__m128i R[8])
+{
+    __m128i t[8], out[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        t[i] = _mm_xor_si128(R[i], R[(i + 1) & 7]);
+    for (i = 0; i < 8; i++) {
+        /* The terms with a factor x^0, x^1 and x^2 respectively. */
+        __m128i x0 = _mm_xor_si128(R[(i + 2) & 7], _mm_xor_si128(t[(i + 4) & 7], t[(i + 6) & 7]));
+        __m128i x1 = _mm_xor_si128(_mm_xor_si128(t[i], R[(i + 2) & 7]), _mm_xor_si128(R[(i + 5) & 7], R[(i + 7) & 7]));
+        __m128i x2 = _mm_xor_si128(t[(i + 3) & 7], t[(i + 6) & 7]);
+        out[i] = _mm_xor_si128(x0, groestl_xtime(_mm_xor_si128(x1, groestl_xtime(x2))));
+    }
+    for (i = 0; i < 8; i++)
+        R[i] = out[i];
+}
+
+/*
+ * One Groestl-1024 permutation of the state held as rows. aesenclast with a
+ * zero key is SubBytes after the AES ShiftRows; the byte shuffle before it
+ * undoes ShiftRows and applies the row's own rotation instead.
+ */
+static inline void groestl_perm(__m128i R[8], bool fQ)
+{
+    static const int shiftP[8] = {0, 1, 2, 3, 4, 5, 6, 11};
+    static const int shiftQ[8] = {1, 3, 5, 11, 0, 2, 4, 6};
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i inv_shift_rows = _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+    const __m128i columns = _mm_setr_epi8(0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+                                          (char)0x80, (char)0x90, (char)0xA0, (char)0xB0, (char)0xC0, (char)0xD0, (char)0xE0, (char)0xF0);
+    const __m128i ones = _mm_set1_epi8((char)0xFF);
+    __m128i shift[8];
+    int i;
+
+    for (i = 0; i < 8; i++)
+        shift[i] = _mm_and_si128(_mm_add_epi8(inv_shift_rows, _mm_set1_epi8(fQ ? shiftQ[i] : shiftP[i])), _mm_set1_epi8(0x0F));
+    for (int round = 0; round < 14; round++) {
+        /* AddRoundConstant */
+        const __m128i rc = _mm_xor_si128(columns, _mm_set1_epi8(round));
+        if (fQ) {
+            for (i = 0; i < 7; i++)
+                R[i] = _mm_xor_si128(R[i], ones);
+            R[7] = _mm_xor_si128(R[7], _mm_xor_si128(rc, ones));
+        } else {
+            R[0] = _mm_xor_si128(R[0], rc);
+        }
+        /* SubBytes and ShiftBytes */
+        for (i = 0; i < 8; i++)
+            R[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(R[i], shift[i]), zero);
+        groestl_mix_bytes(R);
+    }
+}
+
+/**
+ * Groestl-512 of n 64-byte messages stored back to back at in; writes n
+ * 64-byte digests to out. The message and its padding fill one block.
+ */
+void groestl512_64(const unsigned char *in, unsigned char *out, size_t n)
+{
+    /* The initial value is zero but for the digest size in bits in the last two bytes. */
+    __m128i IV[8];
+    for (int u = 0; u < 8; u++)
+        IV[u] = _mm_setzero_si128();
+    IV[7] = _mm_set_epi32(0x00020000, 0, 0, 0);
+    groestl_to_rows(IV);
+
+    for (size_t m = 0; m < n; m++, in += 64, out += 64) {
+        __m128i M[8], H[8], T[8];
+        int u;
+
+        for (u = 0; u < 4; u++)
+            M[u] = _mm_loadu_si128((const __m128i *)(in + 16 * u));
+        /* Padding bit, then the number of blocks (one) as a big-endian 64-bit value. */
+        M[4] = _mm_set_epi32(0, 0, 0, 0x80);
+        M[5] = _mm_setzero_si128();
+        M[6] = _mm_setzero_si128();
+        M[7] = _mm_set_epi32(0x01000000, 0, 0, 0);
+        groestl_to_rows(M);
+
+        /* Compression: H = P(IV ^ M) ^ Q(M) ^ IV */
+        for (u = 0; u < 8; u++)
+            H[u] = _mm_xor_si128(IV[u], M[u]);
+        groestl_perm(H, false);
+        groestl_perm(M, true);
+        for (u = 0; u < 8; u++)
+            H[u] = _mm_xor_si128(_mm_xor_si128(H[u], M[u]), IV[u]);
+
+        /* Output transformation: the second half of P(H) ^ H */
+        for (u = 0; u < 8; u++)
+            T[u] = H[u];
+        groestl_perm(T, false);
+        for (u = 0; u < 8; u++)
+            T[u] = _mm_xor_si128(T[u], H[u]);
+        groestl_from_rows(T);
+        for (u = 0; u < 4; u++)
+            _mm_storeu_si128((__m128i *)(out + 16 * u), T[4 + u]);
+    }
+}
+
+static const uint32_t shavite512_iv[16] = {
+    0x72FCCDD8, 0x79CA4727, 0x128A077B, 0x40D55AEC, 0xD1901A06, 0x430AE307, 0xB29F5CD1, 0xDF07FBFC,
+    0x8E45D73D, 0x681AB538, 0xBDE86578, 0xDD577E47, 0xE275EADE, 0x502D9FCD, 0xB9357178, 0x022A4B9A
+};
+
+/**
+ * SHAvite-3-512 of n 64-byte messages stored back to back at in; writes n
+ * 64-byte digests to out. The message and its padding fill one block, so the
+ * bit counter mixed into the key schedule is the constant 512.
+ */
+void shavite512_64(const unsigned char *in, unsigned char *out, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    /* The counter words (512, 0, 0, 0), inverted last and rotated as the key schedule does (see shavite.c). */
+    const __m128i count32 = _mm_set_epi32(-1, 0, 0, 512);
+    const __m128i count164 = _mm_set_epi32(~512, 0, 0, 0);
+    const __m128i count316 = _mm_set_epi32(-1, 512, 0, 0);
+    const __m128i count440 = _mm_set_epi32(-1, 0, 512, 0);
+
+    for (size_t m = 0; m < n; m++, in += 64, out += 64) {
+        uint32_t rk[448] __attribute__((aligned(16)));
+        __m128i P[4], x;
+        int u, r;
+
+        memcpy(rk, in, 64);
+        memset(rk + 16, 0, 64);
+        rk[16] = 0x80;
+        rk[27] = 0x02000000;
+        rk[31] = 0x02000000;
+
+        /* Key schedule: alternately four pairs of AES-derived words and eight linear ones. */
+        u = 32;
+        while (true) {
+            for (int s = 0; s < 8; s++, u += 4) {
+                x = _mm_shuffle_epi32(_mm_load_si128((const __m128i *)(rk + u - 32)), 0x39);
+                x = _mm_aesenc_si128(x, zero);
+                x = _mm_xor_si128(x, _mm_load_si128((const __m128i *)(rk + u - 4)));
+                if (u == 32)
+                    x = _mm_xor_si128(x, count32);
+                else if (u == 164)
+                    x = _mm_xor_si128(x, count164);
+                else if (u == 316)
+                    x = _mm_xor_si128(x, count316);
+                else if (u == 440)
+                    x = _mm_xor_si128(x, count440);
+                _mm_store_si128((__m128i *)(rk + u), x);
+            }
+            if (u == 448)
+                break;
+            for (int s = 0; s < 8; s++, u += 4) {
+                x = _mm_xor_si128(_mm_load_si128((const __m128i *)(rk + u - 32)), _mm_loadu_si128((const __m128i *)(rk + u - 7)));
+                _mm_store_si128((__m128i *)(rk + u), x);
+            }
+        }
+
+        for (u = 0; u < 4; u++)
+            P[u] = _mm_loadu_si128((const __m128i *)(shavite512_iv + 4 * u));
+        const __m128i *k = (const __m128i *)rk;
+        for (r = 0; r < 14; r++, k += 8) {
+            x = _mm_aesenc_si128(_mm_xor_si128(P[1], k[0]), k[1]);
+            x = _mm_aesenc_si128(x, k[2]);
+            x = _mm_aesenc_si128(x, k[3]);
+            P[0] = _mm_xor_si128(P[0], _mm_aesenc_si128(x, zero));
+            x = _mm_aesenc_si128(_mm_xor_si128(P[3], k[4]), k[5]);
+            x = _mm_aesenc_si128(x, k[6]);
+            x = _mm_aesenc_si128(x, k[7]);
+            P[2] = _mm_xor_si128(P[2], _mm_aesenc_si128(x, zero));
+            x = P[3];
+            P[3] = P[2];
+            P[2] = P[1];
+            P[1] = P[0];
+            P[0] = x;
+        }
+        for (u = 0; u < 4; u++) {
+            x = _mm_xor_si128(P[u], _mm_loadu_si128((const __m128i *)(shavite512_iv + 4 * u)));
+            _mm_storeu_si128((__m128i *)(out + 16 * u), x);
+        }
+    }
+}
+
+} // namespace x11_aesni
+
+#endif
@@ -0,0 +1,38 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with -mavx2; only call into it after checking CPU support.
+
+#ifdef ENABLE_AVX2
+
+#include "crypto/x11_multi.h"
+
+namespace x11_avx2 {
+
+typedef uint32_t vec32x8 __attribute__((vector_size(32)));
+typedef uint64_t vec64x4 __attribute__((vector_size(32)));
+
+void blake512_80_4way(const unsigned char *in, unsigned char *out)
+{
+    blake512_80_multi<vec64x4>(in, out);
+}
+
+void bmw512_64_4way(const unsigned char *in, unsigned char *out)
+{
+    bmw512_64_multi<vec64x4>(in, out);
+}
+
+void skein512_64_4way(const unsigned char *in, unsigned char *out)
+{
+    skein512_64_multi<vec64x4>(in, out);
+}
+
+void cubehash512_64_8way(const unsigned char *in, unsigned char *out)
+{
+    cubehash512_64_multi<vec32x8>(in, out);
+}
+
+} // namespace x11_avx2
+
+#endif
@@ -0,0 +1,43 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is compiled with -mavx512f; only call into it after checking CPU support.
+
+#ifdef ENABLE_AVX512F
+
+#include "crypto/x11_multi.h"
+
+namespace x11_avx512 {
+
+typedef uint32_t vec32x16 __attribute__((vector_size(64)));
+typedef uint64_t vec64x8 __attribute__((vector_size(64)));
+
+void blake512_80_8way(const unsigned char *in, unsigned char *out)
+{
+    blake512_80_multi<vec64x8>(in, out);
+}
+
+void bmw512_64_8way(const unsigned char *in, unsigned char *out)
+{
+    bmw512_64_multi<vec64x8>(in, out);
+}
+
+void skein512_64_8way(const unsigned char *in, unsigned char *out)
+{
+    skein512_64_multi<vec64x8>(in, out);
+}
+
+void cubehash512_64_16way(const unsigned char *in, unsigned char *out)
+{
+    cubehash512_64_multi<vec32x16>(in, out);
+}
+
+void keccak512_64_8way(const unsigned char *in, unsigned char *out)
+{
+    keccak512_64_multi<vec64x8>(in, out);
+}
+
+} // namespace x11_avx512
+
+#endif
@@ -0,0 +1,500 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Multi-lane X11 stages for 64-byte messages (the only length any stage after
+// blake sees) and, for blake, 80-byte block headers. As in scrypt_multi.h each vector element holds the same state
+// word of a different message; the including translation unit picks the vector
+// width. Results are identical to the sph_* reference implementations.
+
+#ifndef BITCOIN_CRYPTO_X11_MULTI_H
+#define BITCOIN_CRYPTO_X11_MULTI_H
+
+#include "crypto/common.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+template <typename vec>
+inline vec x11_multi_rotl32(vec a, int b)
+{
+    return (a << b) | (a >> (32 - b));
+}
+
+template <typename vec>
+inline vec x11_multi_rotl64(vec a, int b)
+{
+    return (a << b) | (a >> (64 - b));
+}
+
+/** A vector of 64-bit elements all set to x. */
+template <typename vec>
+inline vec x11_multi_set64(uint64_t x)
+{
+    vec v = {};
+    return v + x;
+}
+
+static const uint32_t x11_multi_cubehash512_iv[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E, 0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537, 0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532, 0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576, 0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+/** 16 CubeHash rounds, unrolled in pairs so the word swaps become renames (see cubehash.c). */
+template <typename vec>
+inline void cubehash_16rounds_multi(vec x[32])
+{
+    for (int r = 0; r < 8; r++) {
+        /* Even round. */
+        x[16] += x[0]; x[0] = x11_multi_rotl32(x[0], 7);  x[17] += x[1]; x[1] = x11_multi_rotl32(x[1], 7);
+        x[18] += x[2]; x[2] = x11_multi_rotl32(x[2], 7);  x[19] += x[3]; x[3] = x11_multi_rotl32(x[3], 7);
+        x[20] += x[4]; x[4] = x11_multi_rotl32(x[4], 7);  x[21] += x[5]; x[5] = x11_multi_rotl32(x[5], 7);
+        x[22] += x[6]; x[6] = x11_multi_rotl32(x[6], 7);  x[23] += x[7]; x[7] = x11_multi_rotl32(x[7], 7);
+        x[24] += x[8]; x[8] = x11_multi_rotl32(x[8], 7);  x[25] += x[9]; x[9] = x11_multi_rotl32(x[9], 7);
+        x[26] += x[10]; x[10] = x11_multi_rotl32(x[10], 7);  x[27] += x[11]; x[11] = x11_multi_rotl32(x[11], 7);
+        x[28] += x[12]; x[12] = x11_multi_rotl32(x[12], 7);  x[29] += x[13]; x[13] = x11_multi_rotl32(x[13], 7);
+        x[30] += x[14]; x[14] = x11_multi_rotl32(x[14], 7);  x[31] += x[15]; x[15] = x11_multi_rotl32(x[15], 7);
+        x[8] ^= x[16];  x[9] ^= x[17];  x[10] ^= x[18];  x[11] ^= x[19];
+        x[12] ^= x[20];  x[13] ^= x[21];  x[14] ^= x[22];  x[15] ^= x[23];
+        x[0] ^= x[24];  x[1] ^= x[25];  x[2] ^= x[26];  x[3] ^= x[27];
+        x[4] ^= x[28];  x[5] ^= x[29];  x[6] ^= x[30];  x[7] ^= x[31];
+        x[18] += x[8]; x[8] = x11_multi_rotl32(x[8], 11);  x[19] += x[9]; x[9] = x11_multi_rotl32(x[9], 11);
+        x[16] += x[10]; x[10] = x11_multi_rotl32(x[10], 11);  x[17] += x[11]; x[11] = x11_multi_rotl32(x[11], 11);
+        x[22] += x[12]; x[12] = x11_multi_rotl32(x[12], 11);  x[23] += x[13]; x[13] = x11_multi_rotl32(x[13], 11);
+        x[20] += x[14]; x[14] = x11_multi_rotl32(x[14], 11);  x[21] += x[15]; x[15] = x11_multi_rotl32(x[15], 11);
+        x[26] += x[0]; x[0] = x11_multi_rotl32(x[0], 11);  x[27] += x[1]; x[1] = x11_multi_rotl32(x[1], 11);
+        x[24] += x[2]; x[2] = x11_multi_rotl32(x[2], 11);  x[25] += x[3]; x[3] = x11_multi_rotl32(x[3], 11);
+        x[30] += x[4]; x[4] = x11_multi_rotl32(x[4], 11);  x[31] += x[5]; x[5] = x11_multi_rotl32(x[5], 11);
+        x[28] += x[6]; x[6] = x11_multi_rotl32(x[6], 11);  x[29] += x[7]; x[7] = x11_multi_rotl32(x[7], 11);
+        x[12] ^= x[18];  x[13] ^= x[19];  x[14] ^= x[16];  x[15] ^= x[17];
+        x[8] ^= x[22];  x[9] ^= x[23];  x[10] ^= x[20];  x[11] ^= x[21];
+        x[4] ^= x[26];  x[5] ^= x[27];  x[6] ^= x[24];  x[7] ^= x[25];
+        x[0] ^= x[30];  x[1] ^= x[31];  x[2] ^= x[28];  x[3] ^= x[29];
+        /* Odd round. */
+        x[19] += x[12]; x[12] = x11_multi_rotl32(x[12], 7);  x[18] += x[13]; x[13] = x11_multi_rotl32(x[13], 7);
+        x[17] += x[14]; x[14] = x11_multi_rotl32(x[14], 7);  x[16] += x[15]; x[15] = x11_multi_rotl32(x[15], 7);
+        x[23] += x[8]; x[8] = x11_multi_rotl32(x[8], 7);  x[22] += x[9]; x[9] = x11_multi_rotl32(x[9], 7);
+        x[21] += x[10]; x[10] = x11_multi_rotl32(x[10], 7);  x[20] += x[11]; x[11] = x11_multi_rotl32(x[11], 7);
+        x[27] += x[4]; x[4] = x11_multi_rotl32(x[4], 7);  x[26] += x[5]; x[5] = x11_multi_rotl32(x[5], 7);
+        x[25] += x[6]; x[6] = x11_multi_rotl32(x[6], 7);  x[24] += x[7]; x[7] = x11_multi_rotl32(x[7], 7);
+        x[31] += x[0]; x[0] = x11_multi_rotl32(x[0], 7);  x[30] += x[1]; x[1] = x11_multi_rotl32(x[1], 7);
+        x[29] += x[2]; x[2] = x11_multi_rotl32(x[2], 7);  x[28] += x[3]; x[3] = x11_multi_rotl32(x[3], 7);
+        x[4] ^= x[19];  x[5] ^= x[18];  x[6] ^= x[17];  x[7] ^= x[16];
+        x[0] ^= x[23];  x[1] ^= x[22];  x[2] ^= x[21];  x[3] ^= x[20];
+        x[12] ^= x[27];  x[13] ^= x[26];  x[14] ^= x[25];  x[15] ^= x[24];
+        x[8] ^= x[31];  x[9] ^= x[30];  x[10] ^= x[29];  x[11] ^= x[28];
+        x[17] += x[4]; x[4] = x11_multi_rotl32(x[4], 11);  x[16] += x[5]; x[5] = x11_multi_rotl32(x[5], 11);
+        x[19] += x[6]; x[6] = x11_multi_rotl32(x[6], 11);  x[18] += x[7]; x[7] = x11_multi_rotl32(x[7], 11);
+        x[21] += x[0]; x[0] = x11_multi_rotl32(x[0], 11);  x[20] += x[1]; x[1] = x11_multi_rotl32(x[1], 11);
+        x[23] += x[2]; x[2] = x11_multi_rotl32(x[2], 11);  x[22] += x[3]; x[3] = x11_multi_rotl32(x[3], 11);
+        x[25] += x[12]; x[12] = x11_multi_rotl32(x[12], 11);  x[24] += x[13]; x[13] = x11_multi_rotl32(x[13], 11);
+        x[27] += x[14]; x[14] = x11_multi_rotl32(x[14], 11);  x[26] += x[15]; x[15] = x11_multi_rotl32(x[15], 11);
+        x[29] += x[8]; x[8] = x11_multi_rotl32(x[8], 11);  x[28] += x[9]; x[9] = x11_multi_rotl32(x[9], 11);
+        x[31] += x[10]; x[10] = x11_multi_rotl32(x[10], 11);  x[30] += x[11]; x[11] = x11_multi_rotl32(x[11], 11);
+        x[0] ^= x[17];  x[1] ^= x[16];  x[2] ^= x[19];  x[3] ^= x[18];
+        x[4] ^= x[21];  x[5] ^= x[20];  x[6] ^= x[23];  x[7] ^= x[22];
+        x[8] ^= x[25];  x[9] ^= x[24];  x[10] ^= x[27];  x[11] ^= x[26];
+        x[12] ^= x[29];  x[13] ^= x[28];  x[14] ^= x[31];  x[15] ^= x[30];
+    }
+}
+
+/**
+ * CubeHash-512 of LANES 64-byte messages stored back to back at in; writes
+ * LANES 64-byte digests to out.
+ */
+template <typename vec>
+void cubehash512_64_multi(const unsigned char *in, unsigned char *out)
+{
+    static const int LANES = sizeof(vec) / sizeof(uint32_t);
+    vec x[32];
+    int i, l;
+
+    for (i = 0; i < 32; i++)
+        for (l = 0; l < LANES; l++)
+            x[i][l] = x11_multi_cubehash512_iv[i];
+    for (int block = 0; block < 2; block++) {
+        for (i = 0; i < 8; i++)
+            for (l = 0; l < LANES; l++)
+                x[i][l] ^= ReadLE32(in + 64 * l + 32 * block + 4 * i);
+        cubehash_16rounds_multi(x);
+    }
+    /* Padding block, then the finalization flag and ten more sets of rounds. */
+    x[0] ^= 0x80;
+    cubehash_16rounds_multi(x);
+    x[31] ^= 1;
+    for (i = 0; i < 10; i++)
+        cubehash_16rounds_multi(x);
+    for (i = 0; i < 16; i++)
+        for (l = 0; l < LANES; l++)
+            WriteLE32(out + 64 * l + 4 * i, x[i][l]);
+}
+
+static const uint64_t x11_multi_blake512_iv[8] = {
+    0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+    0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+};
+static const uint64_t x11_multi_blake512_cb[16] = {
+    0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL,
+    0x452821E638D01377ULL, 0xBE5466CF34E90C6CULL, 0xC0AC29B7C97C50DDULL, 0x3F84D5B5B5470917ULL,
+    0x9216D5D98979FB1BULL, 0xD1310BA698DFB5ACULL, 0x2FFD72DBD01ADFB7ULL, 0xB8E1AFED6A267E96ULL,
+    0xBA7C9045F12C7F99ULL, 0x24A19947B3916CF7ULL, 0x0801F2E2858EFC16ULL, 0x636920D871574E69ULL
+};
+static const unsigned char x11_multi_blake_sigma[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+template <typename vec>
+inline void blake512_g_multi(const vec M[16], const unsigned char *sigma, int i, vec &a, vec &b, vec &c, vec &d)
+{
+    const int s0 = sigma[2 * i], s1 = sigma[2 * i + 1];
+    a += b + (M[s0] ^ x11_multi_blake512_cb[s1]);
+    d = x11_multi_rotl64(d ^ a, 32);
+    c += d;
+    b = x11_multi_rotl64(b ^ c, 39);
+    a += b + (M[s1] ^ x11_multi_blake512_cb[s0]);
+    d = x11_multi_rotl64(d ^ a, 48);
+    c += d;
+    b = x11_multi_rotl64(b ^ c, 53);
+}
+
+/**
+ * BLAKE-512 of LANES 80-byte messages (block headers) stored back to back at
+ * in; writes LANES 64-byte digests to out. The message and its padding fill
+ * exactly one block, so the counter is a constant.
+ */
+template <typename vec>
+void blake512_80_multi(const unsigned char *in, unsigned char *out)
+{
+    static const int LANES = sizeof(vec) / sizeof(uint64_t);
+    vec M[16], V[16];
+    int i, l;
+
+    for (i = 0; i < 10; i++)
+        for (l = 0; l < LANES; l++)
+            M[i][l] = ReadBE64(in + 80 * l + 8 * i);
+    for (i = 10; i < 16; i++)
+        M[i] = x11_multi_set64<vec>(0);
+    /* Padding bit, the bit marking a 512-bit digest and the length in bits. */
+    M[10] ^= 0x8000000000000000ULL;
+    M[13] ^= 1;
+    M[15] ^= 640;
+
+    for (i = 0; i < 8; i++)
+        V[i] = x11_multi_set64<vec>(x11_multi_blake512_iv[i]);
+    for (i = 0; i < 8; i++)
+        V[8 + i] = x11_multi_set64<vec>(x11_multi_blake512_cb[i]);
+    V[12] ^= 640;
+    V[13] ^= 640;
+
+    for (int round = 0; round < 16; round++) {
+        const unsigned char *sigma = x11_multi_blake_sigma[round % 10];
+        blake512_g_multi(M, sigma, 0, V[0], V[4], V[8], V[12]);
+        blake512_g_multi(M, sigma, 1, V[1], V[5], V[9], V[13]);
+        blake512_g_multi(M, sigma, 2, V[2], V[6], V[10], V[14]);
+        blake512_g_multi(M, sigma, 3, V[3], V[7], V[11], V[15]);
+        blake512_g_multi(M, sigma, 4, V[0], V[5], V[10], V[15]);
+        blake512_g_multi(M, sigma, 5, V[1], V[6], V[11], V[12]);
+        blake512_g_multi(M, sigma, 6, V[2], V[7], V[8], V[13]);
+        blake512_g_multi(M, sigma, 7, V[3], V[4], V[9], V[14]);
+    }
+
+    for (i = 0; i < 8; i++) {
+        vec h = V[i] ^ V[i + 8] ^ x11_multi_blake512_iv[i];
+        for (l = 0; l < LANES; l++)
+            WriteBE64(out + 64 * l + 8 * i, h[l]);
+    }
+}
+
+static const uint64_t x11_multi_bmw512_iv[16] = {
+    0x8081828384858687ULL, 0x88898A8B8C8D8E8FULL, 0x9091929394959697ULL, 0x98999A9B9C9D9E9FULL,
+    0xA0A1A2A3A4A5A6A7ULL, 0xA8A9AAABACADAEAFULL, 0xB0B1B2B3B4B5B6B7ULL, 0xB8B9BABBBCBDBEBFULL,
+    0xC0C1C2C3C4C5C6C7ULL, 0xC8C9CACBCCCDCECFULL, 0xD0D1D2D3D4D5D6D7ULL, 0xD8D9DADBDCDDDEDFULL,
+    0xE0E1E2E3E4E5E6E7ULL, 0xE8E9EAEBECEDEEEFULL, 0xF0F1F2F3F4F5F6F7ULL, 0xF8F9FAFBFCFDFEFFULL
+};
+
+template <typename vec> inline vec bmw512_s0(vec x) { return (x >> 1) ^ (x << 3) ^ x11_multi_rotl64(x, 4) ^ x11_multi_rotl64(x, 37); }
+template <typename vec> inline vec bmw512_s1(vec x) { return (x >> 1) ^ (x << 2) ^ x11_multi_rotl64(x, 13) ^ x11_multi_rotl64(x, 43); }
+template <typename vec> inline vec bmw512_s2(vec x) { return (x >> 2) ^ (x << 1) ^ x11_multi_rotl64(x, 19) ^ x11_multi_rotl64(x, 53); }
+template <typename vec> inline vec bmw512_s3(vec x) { return (x >> 2) ^ (x << 2) ^ x11_multi_rotl64(x, 28) ^ x11_multi_rotl64(x, 59); }
+template <typename vec> inline vec bmw512_s4(vec x) { return (x >> 1) ^ x; }
+template <typename vec> inline vec bmw512_s5(vec x) { return (x >> 2) ^ x; }
+
+template <typename vec>
+inline vec bmw512_add_elt(const vec M[16], const vec H[16], int j)
+{
+    return (x11_multi_rotl64(M[j & 15], (j & 15) + 1) + x11_multi_rotl64(M[(j + 3) & 15], ((j + 3) & 15) + 1)
+        - x11_multi_rotl64(M[(j + 10) & 15], ((j + 10) & 15) + 1) + (uint64_t)(j + 16) * 0x0555555555555555ULL) ^ H[(j + 7) & 15];
+}
+
+/** One BMW-512 compression of message M with chaining value H into dH (see bmw.c). */
+template <typename vec>
+inline void bmw512_compress_multi(const vec M[16], const vec H[16], vec dH[16])
+{
+    vec Q[32], W[16], MH[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        MH[i] = M[i] ^ H[i];
+    W[0] = MH[5] - MH[7] + MH[10] + MH[13] + MH[14];
+    W[1] = MH[6] - MH[8] + MH[11] + MH[14] - MH[15];
+    W[2] = MH[0] + MH[7] + MH[9] - MH[12] + MH[15];
+    W[3] = MH[0] - MH[1] + MH[8] - MH[10] + MH[13];
+    W[4] = MH[1] + MH[2] + MH[9] - MH[11] - MH[14];
+    W[5] = MH[3] - MH[2] + MH[10] - MH[12] + MH[15];
+    W[6] = MH[4] - MH[0] - MH[3] - MH[11] + MH[13];
+    W[7] = MH[1] - MH[4] - MH[5] - MH[12] - MH[14];
+    W[8] = MH[2] - MH[5] - MH[6] + MH[13] - MH[15];
+    W[9] = MH[0] - MH[3] + MH[6] - MH[7] + MH[14];
+    W[10] = MH[8] - MH[1] - MH[4] - MH[7] + MH[15];
+    W[11] = MH[8] - MH[0] - MH[2] - MH[5] + MH[9];
+    W[12] = MH[1] + MH[3] - MH[6] - MH[9] + MH[10];
+    W[13] = MH[2] + MH[4] + MH[7] + MH[10] + MH[11];
+    W[14] = MH[3] - MH[5] + MH[8] - MH[11] - MH[12];
+    W[15] = MH[12] - MH[4] - MH[6] - MH[9] + MH[13];
+
+    for (i = 0; i < 15; i += 5) {
+        Q[i + 0] = bmw512_s0(W[i + 0]) + H[i + 1];
+        Q[i + 1] = bmw512_s1(W[i + 1]) + H[i + 2];
+        Q[i + 2] = bmw512_s2(W[i + 2]) + H[i + 3];
+        Q[i + 3] = bmw512_s3(W[i + 3]) + H[i + 4];
+        Q[i + 4] = bmw512_s4(W[i + 4]) + H[i + 5];
+    }
+    Q[15] = bmw512_s0(W[15]) + H[0];
+
+    for (i = 16; i < 18; i++) {
+        Q[i] = bmw512_s1(Q[i - 16]) + bmw512_s2(Q[i - 15]) + bmw512_s3(Q[i - 14]) + bmw512_s0(Q[i - 13])
+            + bmw512_s1(Q[i - 12]) + bmw512_s2(Q[i - 11]) + bmw512_s3(Q[i - 10]) + bmw512_s0(Q[i - 9])
+            + bmw512_s1(Q[i - 8]) + bmw512_s2(Q[i - 7]) + bmw512_s3(Q[i - 6]) + bmw512_s0(Q[i - 5])
+            + bmw512_s1(Q[i - 4]) + bmw512_s2(Q[i - 3]) + bmw512_s3(Q[i - 2]) + bmw512_s0(Q[i - 1])
+            + bmw512_add_elt(M, H, i - 16);
+    }
+    for (i = 18; i < 32; i++) {
+        Q[i] = Q[i - 16] + x11_multi_rotl64(Q[i - 15], 5) + Q[i - 14] + x11_multi_rotl64(Q[i - 13], 11)
+            + Q[i - 12] + x11_multi_rotl64(Q[i - 11], 27) + Q[i - 10] + x11_multi_rotl64(Q[i - 9], 32)
+            + Q[i - 8] + x11_multi_rotl64(Q[i - 7], 37) + Q[i - 6] + x11_multi_rotl64(Q[i - 5], 43)
+            + Q[i - 4] + x11_multi_rotl64(Q[i - 3], 53) + bmw512_s4(Q[i - 2]) + bmw512_s5(Q[i - 1])
+            + bmw512_add_elt(M, H, i - 16);
+    }
+
+    vec XL = Q[16] ^ Q[17] ^ Q[18] ^ Q[19] ^ Q[20] ^ Q[21] ^ Q[22] ^ Q[23];
+    vec XH = XL ^ Q[24] ^ Q[25] ^ Q[26] ^ Q[27] ^ Q[28] ^ Q[29] ^ Q[30] ^ Q[31];
+    dH[0] = ((XH << 5) ^ (Q[16] >> 5) ^ M[0]) + (XL ^ Q[24] ^ Q[0]);
+    dH[1] = ((XH >> 7) ^ (Q[17] << 8) ^ M[1]) + (XL ^ Q[25] ^ Q[1]);
+    dH[2] = ((XH >> 5) ^ (Q[18] << 5) ^ M[2]) + (XL ^ Q[26] ^ Q[2]);
+    dH[3] = ((XH >> 1) ^ (Q[19] << 5) ^ M[3]) + (XL ^ Q[27] ^ Q[3]);
+    dH[4] = ((XH >> 3) ^ Q[20] ^ M[4]) + (XL ^ Q[28] ^ Q[4]);
+    dH[5] = ((XH << 6) ^ (Q[21] >> 6) ^ M[5]) + (XL ^ Q[29] ^ Q[5]);
+    dH[6] = ((XH >> 4) ^ (Q[22] << 6) ^ M[6]) + (XL ^ Q[30] ^ Q[6]);
+    dH[7] = ((XH >> 11) ^ (Q[23] << 2) ^ M[7]) + (XL ^ Q[31] ^ Q[7]);
+    dH[8] = x11_multi_rotl64(dH[4], 9) + (XH ^ Q[24] ^ M[8]) + ((XL << 8) ^ Q[23] ^ Q[8]);
+    dH[9] = x11_multi_rotl64(dH[5], 10) + (XH ^ Q[25] ^ M[9]) + ((XL >> 6) ^ Q[16] ^ Q[9]);
+    dH[10] = x11_multi_rotl64(dH[6], 11) + (XH ^ Q[26] ^ M[10]) + ((XL << 6) ^ Q[17] ^ Q[10]);
+    dH[11] = x11_multi_rotl64(dH[7], 12) + (XH ^ Q[27] ^ M[11]) + ((XL << 4) ^ Q[18] ^ Q[11]);
+    dH[12] = x11_multi_rotl64(dH[0], 13) + (XH ^ Q[28] ^ M[12]) + ((XL >> 3) ^ Q[19] ^ Q[12]);
+    dH[13] = x11_multi_rotl64(dH[1], 14) + (XH ^ Q[29] ^ M[13]) + ((XL >> 4) ^ Q[20] ^ Q[13]);
+    dH[14] = x11_multi_rotl64(dH[2], 15) + (XH ^ Q[30] ^ M[14]) + ((XL >> 7) ^ Q[21] ^ Q[14]);
+    dH[15] = x11_multi_rotl64(dH[3], 16) + (XH ^ Q[31] ^ M[15]) + ((XL >> 2) ^ Q[22] ^ Q[15]);
+}
+
+/**
+ * BMW-512 of LANES 64-byte messages stored back to back at in; writes LANES
+ * 64-byte digests to out. The message and its padding fill one block, which
+ * is followed by the final compression with the constant chaining value.
+ */
+template <typename vec>
+void bmw512_64_multi(const unsigned char *in, unsigned char *out)
+{
+    static const int LANES = sizeof(vec) / sizeof(uint64_t);
+    vec M[16], H[16], H2[16];
+    int i, l;
+
+    for (i = 0; i < 8; i++)
+        for (l = 0; l < LANES; l++)
+            M[i][l] = ReadLE64(in + 64 * l + 8 * i);
+    for (i = 8; i < 16; i++)
+        M[i] = x11_multi_set64<vec>(0);
+    M[8] ^= 0x80;
+    M[15] ^= 512;
+    for (i = 0; i < 16; i++)
+        H[i] = x11_multi_set64<vec>(x11_multi_bmw512_iv[i]);
+    bmw512_compress_multi(M, H, H2);
+    for (i = 0; i < 16; i++)
+        H[i] = x11_multi_set64<vec>(0xaaaaaaaaaaaaaaa0ULL + i);
+    bmw512_compress_multi(H2, H, M);
+    for (i = 0; i < 8; i++)
+        for (l = 0; l < LANES; l++)
+            WriteLE64(out + 64 * l + 8 * i, M[8 + i][l]);
+}
+
+static const uint64_t x11_multi_skein512_iv[8] = {
+    0x4903ADFF749C51CEULL, 0x0D95DE399746DF03ULL, 0x8FD1934127C79BCEULL, 0x9A255629FF352CB1ULL,
+    0x5DB62599DF6CA7B0ULL, 0xEABE394CA9D5C3F4ULL, 0x991112C71A75B523ULL, 0xAE18A40B660FCC33ULL
+};
+
+template <typename vec>
+inline void skein512_mix8(vec &w0, vec &w1, vec &w2, vec &w3, vec &w4, vec &w5, vec &w6, vec &w7, int r0, int r1, int r2, int r3)
+{
+    w0 += w1; w1 = x11_multi_rotl64(w1, r0) ^ w0;
+    w2 += w3; w3 = x11_multi_rotl64(w3, r1) ^ w2;
+    w4 += w5; w5 = x11_multi_rotl64(w5, r2) ^ w4;
+    w6 += w7; w7 = x11_multi_rotl64(w7, r3) ^ w6;
+}
+
+/**
+ * One UBI block of Skein-512: Threefish-512 keyed by h with tweak (t0, t1)
+ * over the message m, fed forward into h. The tweak is the same for every lane.
+ */
+template <typename vec>
+inline void skein512_ubi_multi(vec h[8], const vec m[8], uint64_t t0, uint64_t t1)
+{
+    /* The key and tweak words repeated, so subkey s starts at k[s] and t[s]. */
+    vec k[26], p[8];
+    const uint64_t t[20] = {t0, t1, t0 ^ t1, t0, t1, t0 ^ t1, t0, t1, t0 ^ t1, t0, t1, t0 ^ t1,
+                            t0, t1, t0 ^ t1, t0, t1, t0 ^ t1, t0, t1};
+    int i;
+
+    k[8] = h[0] ^ h[1] ^ h[2] ^ h[3] ^ h[4] ^ h[5] ^ h[6] ^ h[7] ^ 0x1BD11BDAA9FC1A22ULL;
+    for (i = 0; i < 8; i++) {
+        k[i] = h[i];
+        p[i] = m[i];
+    }
+    for (i = 9; i < 26; i++)
+        k[i] = k[i - 9];
+    for (int s = 0; s < 18; s += 2) {
+        for (i = 0; i < 8; i++)
+            p[i] += k[s + i];
+        p[5] += t[s];
+        p[6] += t[s + 1];
+        p[7] += (uint64_t)s;
+        skein512_mix8(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], 46, 36, 19, 37);
+        skein512_mix8(p[2], p[1], p[4], p[7], p[6], p[5], p[0], p[3], 33, 27, 14, 42);
+        skein512_mix8(p[4], p[1], p[6], p[3], p[0], p[5], p[2], p[7], 17, 49, 36, 39);
+        skein512_mix8(p[6], p[1], p[0], p[7], p[2], p[5], p[4], p[3], 44, 9, 54, 56);
+        for (i = 0; i < 8; i++)
+            p[i] += k[s + 1 + i];
+        p[5] += t[s + 1];
+        p[6] += t[s + 2];
+        p[7] += (uint64_t)(s + 1);
+        skein512_mix8(p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7], 39, 30, 34, 24);
+        skein512_mix8(p[2], p[1], p[4], p[7], p[6], p[5], p[0], p[3], 13, 50, 10, 17);
+        skein512_mix8(p[4], p[1], p[6], p[3], p[0], p[5], p[2], p[7], 25, 29, 39, 43);
+        skein512_mix8(p[6], p[1], p[0], p[7], p[2], p[5], p[4], p[3], 8, 35, 56, 22);
+    }
+    for (i = 0; i < 8; i++)
+        p[i] += k[18 + i];
+    p[5] += t[18];
+    p[6] += t[19];
+    p[7] += (uint64_t)18;
+    for (i = 0; i < 8; i++)
+        h[i] = m[i] ^ p[i];
+}
+
+/**
+ * Skein-512-512 of LANES 64-byte messages stored back to back at in; writes
+ * LANES 64-byte digests to out: one final message block, then the output block.
+ */
+template <typename vec>
+void skein512_64_multi(const unsigned char *in, unsigned char *out)
+{
+    static const int LANES = sizeof(vec) / sizeof(uint64_t);
+    vec h[8], m[8];
+    int i, l;
+
+    for (i = 0; i < 8; i++)
+        for (l = 0; l < LANES; l++)
+            m[i][l] = ReadLE64(in + 64 * l + 8 * i);
+    for (i = 0; i < 8; i++)
+        h[i] = x11_multi_set64<vec>(x11_multi_skein512_iv[i]);
+    /* First and final message block of 64 bytes. */
+    skein512_ubi_multi(h, m, 64, 0xF000000000000000ULL);
+    /* Output block: the counter 0, 8 bytes long. */
+    for (i = 0; i < 8; i++)
+        m[i] = x11_multi_set64<vec>(0);
+    skein512_ubi_multi(h, m, 8, 0xFF00000000000000ULL);
+    for (i = 0; i < 8; i++)
+        for (l = 0; l < LANES; l++)
+            WriteLE64(out + 64 * l + 8 * i, h[i][l]);
+}
+
+static const uint64_t x11_multi_keccak_rc[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL, 0x8000000080008000ULL,
+    0x000000000000808BULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008AULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+    0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800AULL, 0x800000008000000AULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+static const int x11_multi_keccak_rotc[24] = {
+    1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14, 27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44
+};
+static const int x11_multi_keccak_piln[24] = {
+    10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4, 15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1
+};
+
+/**
+ * Keccak-512 (with the original 0x01 padding used by sph_keccak512) of LANES
+ * 64-byte messages stored back to back at in; writes LANES 64-byte digests to out.
+ */
+template <typename vec>
+void keccak512_64_multi(const unsigned char *in, unsigned char *out)
+{
+    static const int LANES = sizeof(vec) / sizeof(uint64_t);
+    vec A[25], C[5], t;
+    int i, l, x, y;
+
+    memset(A, 0, sizeof(A));
+    for (i = 0; i < 8; i++)
+        for (l = 0; l < LANES; l++)
+            A[i][l] = ReadLE64(in + 64 * l + 8 * i);
+    /* The message plus padding fills exactly one 72-byte block. */
+    A[8] ^= 0x8000000000000001ULL;
+
+    for (int round = 0; round < 24; round++) {
+        /* Theta */
+        for (x = 0; x < 5; x++)
+            C[x] = A[x] ^ A[x + 5] ^ A[x + 10] ^ A[x + 15] ^ A[x + 20];
+        for (x = 0; x < 5; x++) {
+            t = C[(x + 4) % 5] ^ x11_multi_rotl64(C[(x + 1) % 5], 1);
+            for (y = 0; y < 25; y += 5)
+                A[y + x] ^= t;
+        }
+        /* Rho and pi */
+        t = A[1];
+        for (i = 0; i < 24; i++) {
+            int j = x11_multi_keccak_piln[i];
+            C[0] = A[j];
+            A[j] = x11_multi_rotl64(t, x11_multi_keccak_rotc[i]);
+            t = C[0];
+        }
+        /* Chi */
+        for (y = 0; y < 25; y += 5) {
+            for (x = 0; x < 5; x++)
+                C[x] = A[y + x];
+            for (x = 0; x < 5; x++)
+                A[y + x] = C[x] ^ (~C[(x + 1) % 5] & C[(x + 2) % 5]);
+        }
+        /* Iota */
+        A[0] ^= x11_multi_keccak_rc[round];
+    }
+
+    for (i = 0; i < 8; i++)
+        for (l = 0; l < LANES; l++)
+            WriteLE64(out + 64 * l + 8 * i, A[i][l]);
+}
+
+} // namespace
+
+#endif // BITCOIN_CRYPTO_X11_MULTI_H
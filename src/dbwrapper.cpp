@@ -7,6 +7,7 @@
 #include "util.h"
 #include "random.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
 
 #include <leveldb/cache.h>
@@ -15,14 +16,69 @@
 #include <memenv.h>
 #include <stdint.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+bool CDBOptions::Parse(const std::string& str, std::string& strError)
+{
+    std::vector<std::string> vItems;
+    boost::split(vItems, str, boost::is_any_of(","));
+    for (const std::string& strItem : vItems) {
+        if (strItem.empty())
+            continue;
+        size_t nEq = strItem.find('=');
+        int64_t nValue;
+        if (nEq == std::string::npos || !ParseInt64(strItem.substr(nEq + 1), &nValue)) {
+            strError = strprintf("expected key=number, got '%s'", strItem);
+            return false;
+        }
+        std::string strKey = strItem.substr(0, nEq);
+        int64_t nMin, nMax;
+        if (strKey == "blocksize") {
+            nMin = 1024; nMax = 4 << 20;
+        } else if (strKey == "compression") {
+            nMin = 0; nMax = 1;
+        } else if (strKey == "bloombits") {
+            nMin = 0; nMax = 32;
+        } else if (strKey == "maxopenfiles") {
+            nMin = 16; nMax = 50000;
+        } else if (strKey == "writebuffer") {
+            nMin = 1; nMax = 45;
+        } else {
+            strError = strprintf("unknown option '%s'", strKey);
+            return false;
+        }
+        if (nValue < nMin || nValue > nMax) {
+            strError = strprintf("%s must be between %d and %d", strKey, nMin, nMax);
+            return false;
+        }
+        if (strKey == "blocksize")
+            nBlockSize = nValue;
+        else if (strKey == "compression")
+            fCompression = nValue;
+        else if (strKey == "bloombits")
+            nBloomBits = nValue;
+        else if (strKey == "maxopenfiles")
+            nMaxOpenFiles = nValue;
+        else
+            nWriteBufferPercent = nValue;
+    }
+    return true;
+}
+
+std::string CDBOptions::ToString() const
+{
+    return strprintf("blocksize=%u,compression=%d,bloombits=%d,maxopenfiles=%d,writebuffer=%d",
+        nBlockSize, fCompression, nBloomBits, nMaxOpenFiles, nWriteBufferPercent);
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    options.write_buffer_size = nCacheSize / 100 * dbOptions.nWriteBufferPercent;
+    // up to two write buffers may be held in memory simultaneously
+    options.block_cache = leveldb::NewLRUCache(nCacheSize - 2 * options.write_buffer_size);
+    options.block_size = dbOptions.nBlockSize;
+    options.filter_policy = dbOptions.nBloomBits > 0 ? leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits) : NULL;
+    options.compression = dbOptions.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = dbOptions.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -31,14 +87,15 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const CDBOptions& dbOptionsIn) : dbOptions(dbOptionsIn)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, dbOptions);
+    nBlockCacheSize = nCacheSize - 2 * options.write_buffer_size;
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -50,7 +107,7 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
             dbwrapper_private::HandleError(result);
         }
         TryCreateDirectory(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s (%s)\n", path.string(), dbOptions.ToString());
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
@@ -115,6 +172,21 @@ std::vector<unsigned char> CDBWrapper::CreateObfuscateKey() const
 
 }
 
+bool CDBWrapper::GetProperty(const std::string& strName, std::string& strValue) const
+{
+    return pdb->GetProperty(strName, &strValue);
+}
+
+uint64_t CDBWrapper::GetApproximateSize() const
+{
+    // Every key in use starts with a type byte below 0xff
+    const std::string strEnd(32, '\xff');
+    leveldb::Range range("", strEnd);
+    uint64_t nSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &nSize);
+    return nSize;
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
@@ -28,6 +28,31 @@ public:
 
 class CDBWrapper;
 
+/** LevelDB tuning of a single database */
+struct CDBOptions
+{
+    //! Approximate amount of uncompressed data per table block, in bytes
+    size_t nBlockSize;
+    //! Snappy-compress table blocks
+    bool fCompression;
+    //! Bloom filter bits per key; 0 disables the filter
+    int nBloomBits;
+    //! Table files LevelDB keeps open
+    int nMaxOpenFiles;
+    //! Share of the cache, in percent, for the write buffer. A full write buffer is
+    //! written out as a level-0 table, which is what starts a compaction. Up to two
+    //! write buffers are held at once; the block cache gets the remainder.
+    int nWriteBufferPercent;
+
+    CDBOptions() : nBlockSize(4096), fCompression(false), nBloomBits(10), nMaxOpenFiles(64), nWriteBufferPercent(25) {}
+
+    /** Apply a comma-separated list of key=value overrides (blocksize, compression,
+     *  bloombits, maxopenfiles, writebuffer). Returns false and sets strError on
+     *  unknown keys or out of range values. */
+    bool Parse(const std::string& str, std::string& strError);
+    std::string ToString() const;
+};
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -56,11 +81,19 @@ private:
     CDataStream ssKey;
     CDataStream ssValue;
 
+    size_t size_estimate;
+
 public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION) { };
+    CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), size_estimate(0) { };
+
+    void Clear()
+    {
+        batch.Clear();
+        size_estimate = 0;
+    }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -75,6 +108,14 @@ public:
         leveldb::Slice slValue(ssValue.data(), ssValue.size());
 
         batch.Put(slKey, slValue);
+        // LevelDB serializes writes as:
+        // - byte: header
+        // - varint: key length (1 byte up to 127B, 2 bytes up to 16383B, ...)
+        // - byte[]: key
+        // - varint: value length
+        // - byte[]: value
+        // The formula below assumes the key and value are both less than 16k.
+        size_estimate += 3 + (slKey.size() > 127) + slKey.size() + (slValue.size() > 127) + slValue.size();
         ssKey.clear();
         ssValue.clear();
     }
@@ -87,8 +128,16 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         batch.Delete(slKey);
+        // LevelDB serializes erases as:
+        // - byte: header
+        // - varint: key length
+        // - byte[]: key
+        // The formula below assumes the key is less than 16kB.
+        size_estimate += 2 + (slKey.size() > 127) + slKey.size();
         ssKey.clear();
     }
+
+    size_t SizeEstimate() const { return size_estimate; }
 };
 
 class CDBIterator
@@ -164,6 +213,12 @@ private:
     //! database options used
     leveldb::Options options;
 
+    //! tuning the options were derived from
+    CDBOptions dbOptions;
+
+    //! capacity of options.block_cache
+    size_t nBlockCacheSize;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -198,8 +253,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] dbOptions   LevelDB tuning for this database.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const CDBOptions& dbOptions = CDBOptions());
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -286,6 +342,30 @@ public:
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    /** Compact the key range [key_begin, key_end] */
+    template<typename K>
+    void CompactRange(const K& key_begin, const K& key_end) const
+    {
+        CDataStream ssKey1(SER_DISK, CLIENT_VERSION), ssKey2(SER_DISK, CLIENT_VERSION);
+        ssKey1.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        leveldb::Slice slKey1(ssKey1.data(), ssKey1.size());
+        leveldb::Slice slKey2(ssKey2.data(), ssKey2.size());
+        pdb->CompactRange(&slKey1, &slKey2);
+    }
+
+    const CDBOptions& GetDBOptions() const { return dbOptions; }
+    size_t GetBlockCacheSize() const { return nBlockCacheSize; }
+    size_t GetWriteBufferSize() const { return options.write_buffer_size; }
+
+    /** Read a LevelDB property such as "leveldb.stats" or "leveldb.num-files-at-level<N>" */
+    bool GetProperty(const std::string& strName, std::string& strValue) const;
+
+    /** Approximate space the whole database takes up on disk, in bytes */
+    uint64_t GetApproximateSize() const;
 };
 
 #endif // BITCOIN_DBWRAPPER_H
@@ -219,6 +219,20 @@ public:
  */
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 
+/** Optimized SipHash-2-4 implementation for uint256 followed by a 32-bit integer.
+ *
+ *  It is identical to:
+ *    SipHasher(k0, k1)
+ *      .Write(val.GetUint64(0))
+ *      .Write(val.GetUint64(1))
+ *      .Write(val.GetUint64(2))
+ *      .Write(val.GetUint64(3))
+ *      .Write(extra, 4)
+ *      .Finalize()
+ *  where extra is written as its 4-byte little-endian encoding.
+ */
+uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
+
 /** X11 hashing */
 template<typename T1>
 inline uint256 Hash11(const T1 pbegin, const T1 pend)
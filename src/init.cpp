@@ -11,11 +11,15 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockfilemap.h"
+#include "blockpipeline.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "crypto/scrypt.h"
+#include "crypto/x11.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -30,6 +34,7 @@
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "stratum.h"
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -151,9 +156,9 @@ class CCoinsViewErrorCatcher : public CCoinsViewBacked
 {
 public:
     CCoinsViewErrorCatcher(CCoinsView* view) : CCoinsViewBacked(view) {}
-    bool GetCoins(const uint256 &txid, CCoins &coins) const {
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const {
         try {
-            return CCoinsViewBacked::GetCoins(txid, coins);
+            return CCoinsViewBacked::GetCoin(outpoint, coin);
         } catch(const std::runtime_error& e) {
             uiInterface.ThreadSafeMessageBox(_("Error reading from database, shutting down."), "", CClientUIInterface::MSG_ERROR);
             LogPrintf("Error reading from database: %s\n", e.what());
@@ -167,7 +172,6 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -178,6 +182,7 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
     if (g_connman)
         g_connman->Interrupt();
     threadGroup.interrupt_all();
@@ -202,6 +207,9 @@ void Shutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    StopStratumServer();
+    g_miningService.reset();
+    g_blockTemplateCache.reset();
 #ifdef ENABLE_WALLET
     // Smartcoin 1.14 TODO: ShutdownRPCMining();
     if (pwalletMain)
@@ -214,8 +222,9 @@ void Shutdown()
 
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
+    // The mempool file is written while the chain state and wallet flush
     if (fDumpMempoolLater)
-        DumpMempool();
+        StartDumpMempool();
 
     if (fFeeEstimatesInitialized)
     {
@@ -230,6 +239,8 @@ void Shutdown()
 
     {
         LOCK(cs_main);
+        delete pblockpipeline;
+        pblockpipeline = NULL;
         if (pcoinsTip != NULL) {
             FlushStateToDisk();
         }
@@ -237,6 +248,8 @@ void Shutdown()
         pcoinsTip = NULL;
         delete pcoinscatcher;
         pcoinscatcher = NULL;
+        delete pcoinsflusher;
+        pcoinsflusher = NULL;
         delete pcoinsdbview;
         pcoinsdbview = NULL;
         delete pblocktree;
@@ -254,6 +267,7 @@ void Shutdown()
         pzmqNotificationInterface = NULL;
     }
 #endif
+    FinishDumpMempool();
 
 #ifndef WIN32
     try {
@@ -329,7 +343,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alerts", strprintf(_("Receive and display P2P network alerts (default: %u)"), DEFAULT_ALERTS));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-blockfilemaps=<n>", strprintf(_("Number of block files to keep memory-mapped for reading blocks (0 to disable, up to %d, default: %d)"), MAX_BLOCKFILE_MAPS, DEFAULT_BLOCKFILE_MAPS));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash, %i is replaced by block number)"));
+    strUsage += HelpMessageOpt("-blockpipeline=<n>", strprintf(_("Number of assumed-valid blocks to read and check ahead of validation on background threads (0 to disable, up to %d, default: %d)"), MAX_BLOCK_PIPELINE_DEPTH, DEFAULT_BLOCK_PIPELINE_DEPTH));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), Params(CBaseChainParams::MAIN).GetConsensus(0).defaultAssumeValid.GetHex(), Params(CBaseChainParams::TESTNET).GetConsensus(0).defaultAssumeValid.GetHex()));
@@ -342,6 +358,7 @@ std::string HelpMessage(HelpMessageMode mode)
     }
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbprofile=<profile>", strprintf(_("Tune the chain state and block index databases: default or highmem (default: %s)"), DEFAULT_DB_PROFILE));
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
@@ -354,6 +371,8 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
+    strUsage += HelpMessageOpt("-prefetchthreads=<n>", strprintf(_("Set the number of threads reading block inputs from the coins database ahead of validation, including the validation thread (0 or 1 = off, up to %d, default: %d)"),
+        MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS));
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
@@ -428,6 +447,9 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", Params(CBaseChainParams::MAIN).DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
+        strUsage += HelpMessageOpt("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize));
+        strUsage += HelpMessageOpt("-chainstatedbopts=<opts>", "Override the -dbprofile tuning of the chain state database with a comma-separated list of blocksize=<bytes>, compression=<0|1>, bloombits=<n>, maxopenfiles=<n> and writebuffer=<percent of its cache>");
+        strUsage += HelpMessageOpt("-blockindexdbopts=<opts>", "Override the -dbprofile tuning of the block index database, like -chainstatedbopts");
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
@@ -439,7 +461,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT));
         strUsage += HelpMessageOpt("-bip9params=deployment:start:end", "Use given start/end times for specified BIP9 deployment (regtest-only)");
     }
-    std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, tor, zmq"; // Don't translate these and qt below
+    std::string debugCategories = "addrman, alert, bench, cmpctblock, coindb, db, http, libevent, lock, mempool, mempoolrej, net, proxy, prune, rand, reindex, rpc, selectcoins, stratum, tor, zmq"; // Don't translate these and qt below
     if (mode == HMM_BITCOIN_QT)
         debugCategories += ", qt";
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
@@ -487,9 +509,18 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockmaxsize=<n>", strprintf(_("Set maximum block size in bytes (default: %d)"), DEFAULT_BLOCK_MAX_SIZE));
     strUsage += HelpMessageOpt("-blockprioritysize=<n>", strprintf(_("Set maximum size of high-priority/low-fee transactions in bytes (default: %d)"), DEFAULT_BLOCK_PRIORITY_SIZE));
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
+    strUsage += HelpMessageOpt("-genthreads=<n>", strprintf(_("Set the number of threads generate uses to search for a nonce (<= 0: one per core, default: %d)"), DEFAULT_GENERATE_THREADS));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratum", strprintf(_("Serve mining jobs to pools and miners over the stratum protocol (default: %u)"), DEFAULT_STRATUM));
+    strUsage += HelpMessageOpt("-stratumaddress=<addr>", _("Pay the rewards of blocks mined through the stratum server to <addr>"));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>", _("Bind to given address to listen for stratum connections. Use [host]:port notation for IPv6. This option can be specified multiple times (default: bind to all interfaces)"));
+    strUsage += HelpMessageOpt("-stratumport=<port>", strprintf(_("Listen for stratum connections on <port> (default: %u)"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumallowip=<ip>", _("Allow stratum connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-stratumdifficulty=<n>", strprintf(_("Accept shares at 1/<n> of the proof-of-work limit target (default: %d)"), DEFAULT_STRATUM_DIFFICULTY));
+
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
@@ -667,6 +698,9 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         }
     }
 
+    // Blocks whose parent never showed up are not going to connect
+    ClearBlocksUnknownParent();
+
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
     CValidationState state;
     if (!ActivateBestChain(state, chainparams)) {
@@ -803,6 +837,8 @@ ServiceFlags nRelevantServices = NODE_NETWORK;
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
+static CDBOptions chainstateDBOptions;
+static CDBOptions blockIndexDBOptions;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
 }
@@ -891,19 +927,31 @@ bool AppInitParameterInteraction()
             return InitError(_("Prune mode is incompatible with -txindex."));
     }
 
+    // LevelDB tuning of the chain state and block index
+    std::string strDBProfile = GetArg("-dbprofile", DEFAULT_DB_PROFILE);
+    if (!GetDBProfile(strDBProfile, chainstateDBOptions, blockIndexDBOptions))
+        return InitError(strprintf(_("Unknown -dbprofile '%s'"), strDBProfile));
+    std::string strDBError;
+    if (!chainstateDBOptions.Parse(GetArg("-chainstatedbopts", ""), strDBError))
+        return InitError(strprintf("Invalid -chainstatedbopts: %s", strDBError));
+    if (!blockIndexDBOptions.Parse(GetArg("-blockindexdbopts", ""), strDBError))
+        return InitError(strprintf("Invalid -blockindexdbopts: %s", strDBError));
+
     // Make sure enough file descriptors are available
     int nBind = std::max(
                 (mapMultiArgs.count("-bind") ? mapMultiArgs.at("-bind").size() : 0) +
                 (mapMultiArgs.count("-whitebind") ? mapMultiArgs.at("-whitebind").size() : 0), size_t(1));
     nUserMaxConnections = GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
+    // Table files kept open beyond the default LevelDB limits come on top of the core descriptors
+    int nMinCoreFD = MIN_CORE_FILEDESCRIPTORS + std::max(0, chainstateDBOptions.nMaxOpenFiles + blockIndexDBOptions.nMaxOpenFiles - 2 * CDBOptions().nMaxOpenFiles);
 
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
-    nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
-    if (nFD < MIN_CORE_FILEDESCRIPTORS)
+    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - nMinCoreFD - MAX_ADDNODE_CONNECTIONS)), 0);
+    nFD = RaiseFileDescriptorLimit(nMaxConnections + nMinCoreFD + MAX_ADDNODE_CONNECTIONS);
+    if (nFD < nMinCoreFD)
         return InitError(_("Not enough file descriptors available."));
-    nMaxConnections = std::min(nFD - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
+    nMaxConnections = std::min(nFD - nMinCoreFD - MAX_ADDNODE_CONNECTIONS, nMaxConnections);
 
     if (nMaxConnections < nUserMaxConnections)
         InitWarning(strprintf(_("Reducing -maxconnections from %d to %d, because of system limitations."), nUserMaxConnections, nMaxConnections));
@@ -975,6 +1023,13 @@ bool AppInitParameterInteraction()
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // -prefetchthreads counts the validation thread, so 1 (or less) disables prefetching
+    nPrefetchThreads = GetArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS);
+    if (nPrefetchThreads <= 1)
+        nPrefetchThreads = 0;
+    else if (nPrefetchThreads > MAX_PREFETCH_THREADS)
+        nPrefetchThreads = MAX_PREFETCH_THREADS;
+
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = GetArg("-prune", 0);
     if (nPruneArg < 0) {
@@ -1192,6 +1247,23 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        // Header PoW and block import checks only hash, so threads beyond
+        // the number of cores would sit idle
+        int nHashCheckThreads = std::min(nScriptCheckThreads, GetNumCores());
+        LogPrintf("Using %u threads for header PoW and block import verification\n", nHashCheckThreads);
+        for (int i=0; i<nHashCheckThreads-1; i++) {
+            threadGroup.create_thread(&ThreadHeaderPoWCheck);
+            threadGroup.create_thread(&ThreadBlockLoad);
+        }
+    }
+    int nBlockFileMaps = std::max(0, std::min((int)GetArg("-blockfilemaps", DEFAULT_BLOCKFILE_MAPS), MAX_BLOCKFILE_MAPS));
+    blockfilemaps.SetMaxMaps(nBlockFileMaps);
+    if (nBlockFileMaps)
+        LogPrintf("Keeping up to %d block files memory-mapped\n", nBlockFileMaps);
+    if (nPrefetchThreads) {
+        LogPrintf("Using %u threads for block input prefetch\n", nPrefetchThreads);
+        for (int i=0; i<nPrefetchThreads-1; i++)
+            threadGroup.create_thread(&ThreadCoinsPrefetch);
     }
 
     // Start the lightweight task scheduler thread
@@ -1215,6 +1287,8 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 #if defined(USE_SSE2)
     scrypt_detect_sse2();
 #endif
+    LogPrintf("Using %s scrypt kernel for batched hashing\n", scrypt_multi_detect());
+    LogPrintf("Using %s X11 kernels for batched hashing\n", x11_multi_detect());
 
     // ********************************************************* Step 5: verify wallet database integrity
 #ifdef ENABLE_WALLET
@@ -1437,13 +1511,21 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             try {
                 UnloadBlockIndex();
                 delete pcoinsTip;
-                delete pcoinsdbview;
                 delete pcoinscatcher;
+                delete pcoinsflusher;
+                delete pcoinsdbview;
                 delete pblocktree;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState);
-                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, blockIndexDBOptions);
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex || fReindexChainState, chainstateDBOptions);
+                pcoinsflusher = new CCoinsViewAsyncFlush(pcoinsdbview);
+                pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsflusher);
+
+                // If necessary, upgrade from the older per-transaction chainstate format.
+                if (!pcoinsdbview->Upgrade()) {
+                    strLoadError = _("Error upgrading chainstate database");
+                    break;
+                }
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
                 if (fReindex) {
@@ -1508,7 +1590,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     }
                 }
 
-                if (!CVerifyDB().VerifyDB(chainparams, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                if (!CVerifyDB().VerifyDB(chainparams, pcoinsflusher, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
                               GetArg("-checkblocks", DEFAULT_CHECKBLOCKS))) {
                     strLoadError = _("Corrupted block database detected");
                     break;
@@ -1608,6 +1690,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (IsArgSet("-blocknotify"))
         uiInterface.NotifyBlockTip.connect(BlockNotifyCallback);
 
+    int nBlockPipelineDepth = std::min((int)GetArg("-blockpipeline", DEFAULT_BLOCK_PIPELINE_DEPTH), MAX_BLOCK_PIPELINE_DEPTH);
+    if (!hashAssumeValid.IsNull() && nBlockPipelineDepth > 0) {
+        LogPrintf("Loading up to %d assumed-valid blocks ahead of validation\n", nBlockPipelineDepth);
+        pblockpipeline = new CBlockPipeline(nBlockPipelineDepth);
+    }
+
     std::vector<boost::filesystem::path> vImportFiles;
     if (mapMultiArgs.count("-loadblock"))
     {
@@ -1660,6 +1748,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     // ********************************************************* Step 12: finished
 
+    g_blockTemplateCache.reset(new CBlockTemplateCache(chainparams, mempool));
+    g_miningService.reset(new CMiningService(chainparams));
+    if (!StartStratumServer(chainparams))
+        return false;
+
     SetRPCWarmupFinished();
     uiInterface.InitMessage(_("Done loading"));
 
@@ -12,6 +12,7 @@
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/scrypt.h"
 #include "hash.h"
 #include "validation.h"
 #include "net.h"
@@ -21,16 +22,21 @@
 #include "script/standard.h"
 #include "timedata.h"
 #include "txmempool.h"
+#include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
 
 #include <algorithm>
+#include <limits>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
 #include <utility>
 
+#include <boost/bind/bind.hpp>
+using namespace boost::placeholders;
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // BitcoinMiner
@@ -183,16 +189,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     nLastBlockWeight = nBlockWeight;
 
     // Create coinbase transaction.
-    CMutableTransaction coinbaseTx;
-    coinbaseTx.vin.resize(1);
-    coinbaseTx.vin[0].prevout.SetNull();
-    coinbaseTx.vout.resize(1);
-    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
-    coinbaseTx.vout[0].nValue = nFees + GetSmartcoinBlockSubsidy(nHeight, consensus, pindexPrev->GetBlockHash());
-    coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
-    pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
-    pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, consensus);
-    pblocktemplate->vTxFees[0] = -nFees;
+    CreateCoinbase(scriptPubKeyIn, pindexPrev, consensus);
+    pblocktemplate->nBlockWeight = nBlockWeight;
+    pblocktemplate->nBlockSize = nBlockSize;
+    pblocktemplate->nBlockSigOpsCost = nBlockSigOpsCost;
 
     uint64_t nSerializeSize = GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION);
     LogPrintf("CreateNewBlock(): total size: %u block weight: %u txs: %u fees: %ld sigops %d\n", nSerializeSize, GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
@@ -202,7 +202,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     UpdateTime(pblock, consensus, pindexPrev);
     pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, consensus);
     pblock->nNonce         = 0;
-    pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
 
     CValidationState state;
     if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
@@ -215,6 +214,132 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     return std::move(pblocktemplate);
 }
 
+std::unique_ptr<CBlockTemplate> BlockAssembler::UpdateBlockTemplate(const CBlockTemplate& blocktemplate, const std::vector<uint256>& vRemoved, const std::vector<uint256>& vAdded, bool fMineWitnessTx)
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    resetBlock();
+
+    pblocktemplate.reset(new CBlockTemplate(blocktemplate));
+    pblock = &pblocktemplate->block;
+
+    LOCK2(cs_main, mempool.cs);
+    CBlockIndex* pindexPrev = chainActive.Tip();
+    if (pblock->hashPrevBlock != pindexPrev->GetBlockHash())
+        return nullptr;
+    nHeight = pindexPrev->nHeight + 1;
+
+    const Consensus::Params& consensus = chainparams.GetConsensus(nHeight);
+
+    nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                       ? pindexPrev->GetMedianTimePast()
+                       : pblock->GetBlockTime();
+    fIncludeWitness = IsWitnessEnabled(pindexPrev, consensus) && fMineWitnessTx;
+
+    nBlockWeight = pblocktemplate->nBlockWeight;
+    nBlockSize = pblocktemplate->nBlockSize;
+    nBlockSigOpsCost = pblocktemplate->nBlockSigOpsCost;
+    nBlockTx = pblock->vtx.size() - 1;
+    nFees = -pblocktemplate->vTxFees[0];
+
+    // Drop the removed transactions. Their in-block descendants are removed
+    // from the mempool with them, so anything still spending one means the
+    // changes are incomplete and only a rebuild is safe.
+    std::set<uint256> setRemoved(vRemoved.begin(), vRemoved.end());
+    size_t nKept = 1;
+    for (size_t i = 1; i < pblock->vtx.size(); i++) {
+        const CTransaction& tx = *pblock->vtx[i];
+        if (setRemoved.count(tx.GetHash())) {
+            nBlockWeight -= GetTransactionWeight(tx);
+            if (fNeedSizeAccounting) {
+                nBlockSize -= ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            }
+            nBlockSigOpsCost -= pblocktemplate->vTxSigOpsCost[i];
+            nFees -= pblocktemplate->vTxFees[i];
+            --nBlockTx;
+            continue;
+        }
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            if (setRemoved.count(txin.prevout.hash))
+                return nullptr;
+        }
+        pblock->vtx[nKept] = pblock->vtx[i];
+        pblocktemplate->vTxFees[nKept] = pblocktemplate->vTxFees[i];
+        pblocktemplate->vTxSigOpsCost[nKept] = pblocktemplate->vTxSigOpsCost[i];
+        nKept++;
+    }
+    pblock->vtx.resize(nKept);
+    pblocktemplate->vTxFees.resize(nKept);
+    pblocktemplate->vTxSigOpsCost.resize(nKept);
+
+    // Append the new transactions that can go in as they are. One whose
+    // parents are not all in the block waits for the next rebuild.
+    std::set<uint256> setInBlock;
+    if (!vAdded.empty()) {
+        for (size_t i = 1; i < pblock->vtx.size(); i++)
+            setInBlock.insert(pblock->vtx[i]->GetHash());
+    }
+    int nAdded = 0;
+    BOOST_FOREACH(const uint256& hash, vAdded) {
+        if (setInBlock.count(hash))
+            continue;
+        CTxMemPool::txiter it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end())
+            continue;
+        bool fParentsInBlock = true;
+        BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(it)) {
+            if (!setInBlock.count(parent->GetTx().GetHash())) {
+                fParentsInBlock = false;
+                break;
+            }
+        }
+        if (!fParentsInBlock)
+            continue;
+        if (it->GetModifiedFee() < blockMinFeeRate.GetFee(it->GetTxSize()))
+            continue;
+        if (!TestPackage(it->GetTxSize(), it->GetSigOpCost()))
+            continue;
+        CTxMemPool::setEntries package;
+        package.insert(it);
+        if (!TestPackageTransactions(package))
+            continue;
+        AddToBlock(it);
+        setInBlock.insert(hash);
+        nAdded++;
+    }
+
+    CreateCoinbase(pblock->vtx[0]->vout[0].scriptPubKey, pindexPrev, consensus);
+    pblocktemplate->nBlockWeight = nBlockWeight;
+    pblocktemplate->nBlockSize = nBlockSize;
+    pblocktemplate->nBlockSigOpsCost = nBlockSigOpsCost;
+
+    // The template is handed to miners, so it gets the same check as a new one
+    CValidationState state;
+    if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+        LogPrintf("%s: TestBlockValidity failed: %s\n", __func__, FormatStateMessage(state));
+        return nullptr;
+    }
+
+    LogPrint("bench", "UpdateBlockTemplate(): %u removed, %d added, %u txs: %.2fms\n", blocktemplate.block.vtx.size() - nKept, nAdded, nBlockTx, 0.001 * (GetTimeMicros() - nTimeStart));
+
+    return std::move(pblocktemplate);
+}
+
+void BlockAssembler::CreateCoinbase(const CScript& scriptPubKeyIn, const CBlockIndex* pindexPrev, const Consensus::Params& consensus)
+{
+    CMutableTransaction coinbaseTx;
+    coinbaseTx.vin.resize(1);
+    coinbaseTx.vin[0].prevout.SetNull();
+    coinbaseTx.vout.resize(1);
+    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
+    coinbaseTx.vout[0].nValue = nFees + GetSmartcoinBlockSubsidy(nHeight, consensus, pindexPrev->GetBlockHash());
+    coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, consensus);
+    pblocktemplate->vTxFees[0] = -nFees;
+    pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
+}
+
 bool BlockAssembler::isStillDependent(CTxMemPool::txiter iter)
 {
     BOOST_FOREACH(CTxMemPool::txiter parent, mempool.GetMemPoolParents(iter))
@@ -628,6 +753,129 @@ void BlockAssembler::addPriorityTxs()
     fNeedSizeAccounting = fSizeAccounting;
 }
 
+std::unique_ptr<CBlockTemplateCache> g_blockTemplateCache;
+
+CBlockTemplateCache::CBlockTemplateCache(const CChainParams& chainparamsIn, CTxMemPool& poolIn) :
+    chainparams(chainparamsIn), pool(poolIn), fCurrentWitness(false),
+    nCurrentTime(0), nBuildTime(0), fUpdatedSinceBuild(false), fRebuild(false), fChanged(false), fNewTip(false)
+{
+    pool.NotifyEntryAdded.connect(boost::bind(&CBlockTemplateCache::TransactionAdded, this, _1));
+    pool.NotifyEntryRemoved.connect(boost::bind(&CBlockTemplateCache::TransactionRemoved, this, _1, _2));
+    RegisterValidationInterface(this);
+}
+
+CBlockTemplateCache::~CBlockTemplateCache()
+{
+    UnregisterValidationInterface(this);
+    pool.NotifyEntryAdded.disconnect(boost::bind(&CBlockTemplateCache::TransactionAdded, this, _1));
+    pool.NotifyEntryRemoved.disconnect(boost::bind(&CBlockTemplateCache::TransactionRemoved, this, _1, _2));
+}
+
+void CBlockTemplateCache::TransactionAdded(CTransactionRef tx)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fChanged = true;
+    if (fRebuild || !pcurrent)
+        return;
+    vAdded.push_back(tx->GetHash());
+    if (vAdded.size() + vRemoved.size() > MAX_TEMPLATE_CHANGES)
+        fRebuild = true;
+}
+
+void CBlockTemplateCache::TransactionRemoved(CTransactionRef tx, MemPoolRemovalReason reason)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fChanged = true;
+    if (fRebuild || !pcurrent)
+        return;
+    // Transactions leave the mempool for a new block (or a reorg) only
+    // together with a tip change, which rebuilds the template anyway
+    if (reason == MemPoolRemovalReason::BLOCK || reason == MemPoolRemovalReason::REORG) {
+        fRebuild = true;
+        return;
+    }
+    vRemoved.push_back(tx->GetHash());
+    if (vAdded.size() + vRemoved.size() > MAX_TEMPLATE_CHANGES)
+        fRebuild = true;
+}
+
+void CBlockTemplateCache::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (pcurrent && pcurrent->block.hashPrevBlock != pindexNew->GetBlockHash()) {
+        fNewTip = true;
+        fRebuild = true;
+    }
+}
+
+bool CBlockTemplateCache::IsCurrentStale() const
+{
+    return fNewTip || (fChanged && GetTime() - nCurrentTime > MINING_TEMPLATE_REFRESH);
+}
+
+bool CBlockTemplateCache::IsStale(const std::shared_ptr<const CBlockTemplate>& blocktemplate) const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return blocktemplate != pcurrent || IsCurrentStale();
+}
+
+std::shared_ptr<const CBlockTemplate> CBlockTemplateCache::Get(const CScript& scriptPubKeyIn, bool fMineWitnessTx)
+{
+    // The tip is checked directly too, as UpdatedBlockTip() is only signalled
+    // after the new tip is connected
+    LOCK(cs_main);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (pcurrent && scriptPubKeyIn == scriptCurrent && fMineWitnessTx == fCurrentWitness &&
+            pcurrent->block.hashPrevBlock == chainActive.Tip()->GetBlockHash() && !IsCurrentStale())
+            return pcurrent;
+    }
+
+    // Holding cs_main and pool.cs keeps the tip and the mempool in step with
+    // the queued changes while they are taken over and applied
+    LOCK(pool.cs);
+    std::shared_ptr<const CBlockTemplate> pold;
+    std::vector<uint256> vAddedNow, vRemovedNow;
+    bool fRebuildNow;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (scriptPubKeyIn == scriptCurrent && fMineWitnessTx == fCurrentWitness)
+            pold = pcurrent;
+        vAddedNow.swap(vAdded);
+        vRemovedNow.swap(vRemoved);
+        fRebuildNow = fRebuild || !pold ||
+            pold->block.hashPrevBlock != chainActive.Tip()->GetBlockHash() ||
+            GetTime() - nBuildTime > MINING_TEMPLATE_REBUILD;
+        fRebuild = false;
+        fChanged = false;
+        fNewTip = false;
+        if (!fRebuildNow && vAddedNow.empty() && vRemovedNow.empty())
+            return pcurrent;
+    }
+
+    std::unique_ptr<CBlockTemplate> pnew;
+    if (!fRebuildNow)
+        pnew = BlockAssembler(chainparams).UpdateBlockTemplate(*pold, vRemovedNow, vAddedNow, fMineWitnessTx);
+    const bool fUpdated = (bool)pnew;
+    if (!pnew)
+        pnew = BlockAssembler(chainparams).CreateNewBlock(scriptPubKeyIn, fMineWitnessTx);
+    if (!pnew)
+        return nullptr;
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    pcurrent = std::move(pnew);
+    scriptCurrent = scriptPubKeyIn;
+    fCurrentWitness = fMineWitnessTx;
+    nCurrentTime = GetTime();
+    if (fUpdated) {
+        fUpdatedSinceBuild = true;
+    } else {
+        nBuildTime = GetTime();
+        fUpdatedSinceBuild = false;
+    }
+    return pcurrent;
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -646,3 +894,290 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+static std::atomic<double> dGenerateHashRate(0);
+
+double GetGenerateHashRate()
+{
+    return dGenerateHashRate;
+}
+
+CNonceSearch::CNonceSearch(int nThreadsIn) :
+    nThreads(nThreadsIn <= 0 ? std::max(GetNumCores(), 1) : nThreadsIn),
+    fQuit(false), nJob(0), nFinished(0), fRunning(false), fInterrupted(false),
+    pconsensusParams(NULL), nRange(0), nFoundOffset(0), nHashesDone(0),
+    nNextRun(0), fStop(false), fTipChanged(false),
+    nTotalHashes(0), nTotalMicros(0)
+{
+    for (int i = 0; i < nThreads; i++)
+        threadGroup.create_thread(boost::bind(&CNonceSearch::ThreadSearch, this));
+    RegisterValidationInterface(this);
+}
+
+CNonceSearch::~CNonceSearch()
+{
+    UnregisterValidationInterface(this);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fQuit = true;
+    }
+    condWork.notify_all();
+    threadGroup.join_all();
+}
+
+void CNonceSearch::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (fRunning && pindexNew->GetBlockHash() != header.hashPrevBlock) {
+        fTipChanged = true;
+        fStop = true;
+    }
+}
+
+void CNonceSearch::Interrupt()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    fInterrupted = true;
+    fStop = true;
+}
+
+void CNonceSearch::ThreadSearch()
+{
+    RenameThread("smartcoin-gen");
+    std::vector<char> vScratchpad(SCRYPT_MULTI_SCRATCHPAD_SIZE);
+    std::vector<uint256> vHashes;
+    uint64_t nJobDone = 0;
+
+    while (true) {
+        CBlockHeader headerJob;
+        const Consensus::Params* pparams;
+        uint64_t nRangeJob;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fQuit && nJob == nJobDone)
+                condWork.wait(lock);
+            if (fQuit)
+                return;
+            nJobDone = nJob;
+            headerJob = header;
+            pparams = pconsensusParams;
+            nRangeJob = nRange;
+        }
+
+        CPoWHasher hasher(headerJob);
+        const unsigned int nRun = std::max(1, scrypt_multi_lanes());
+        uint64_t nHashes = 0;
+        uint64_t nFound = nRangeJob;
+        while (!fStop) {
+            uint64_t nOffset = nNextRun.fetch_add(nRun);
+            if (nOffset >= nRangeJob)
+                break;
+            unsigned int nBatch = std::min<uint64_t>(nRun, nRangeJob - nOffset);
+            vHashes.resize(nBatch);
+            hasher.Hash(headerJob.nNonce + nOffset, nBatch, vHashes.data(), vScratchpad.data());
+            nHashes += nBatch;
+            for (unsigned int i = 0; i < nBatch; i++) {
+                if (CheckProofOfWork(vHashes[i], headerJob.nBits, *pparams)) {
+                    nFound = nOffset + i;
+                    fStop = true;
+                    break;
+                }
+            }
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nHashesDone += nHashes;
+            nFoundOffset = std::min(nFoundOffset, nFound);
+            if (++nFinished == nThreads)
+                condDone.notify_all();
+        }
+    }
+}
+
+CNonceSearch::Result CNonceSearch::Solve(CBlock& block, const Consensus::Params& consensusParams, uint32_t nNonceEnd, uint64_t& nMaxTries)
+{
+    int64_t nTimeStart = GetTimeMicros();
+    uint64_t nRangeJob = std::min<uint64_t>(nNonceEnd > block.nNonce ? nNonceEnd - block.nNonce : 0, nMaxTries);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        header = block.GetBlockHeader();
+        pconsensusParams = &consensusParams;
+        nRange = nRangeJob;
+        nFoundOffset = nRangeJob;
+        nHashesDone = 0;
+        nNextRun = 0;
+        fStop = fInterrupted;
+        fTipChanged = false;
+        nFinished = 0;
+        fRunning = true;
+        ++nJob;
+    }
+    condWork.notify_all();
+
+    uint64_t nFound, nHashes;
+    bool fTipChangedJob, fInterruptedJob;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (nFinished < nThreads)
+            condDone.wait(lock);
+        fRunning = false;
+        nFound = nFoundOffset;
+        nHashes = nHashesDone;
+        fTipChangedJob = fTipChanged;
+        fInterruptedJob = fInterrupted;
+    }
+
+    nTotalHashes += nHashes;
+    nTotalMicros += GetTimeMicros() - nTimeStart;
+    if (nTotalMicros > 0)
+        dGenerateHashRate = nTotalHashes * 1e6 / nTotalMicros;
+
+    nMaxTries -= nHashes;
+    if (nFound < nRangeJob) {
+        block.nNonce += nFound;
+        return NONCE_FOUND;
+    }
+    if (fInterruptedJob)
+        return NONCE_INTERRUPTED;
+    if (fTipChangedJob)
+        return NONCE_TIP_CHANGED;
+    block.nNonce += nRangeJob;
+    if (nMaxTries == 0)
+        return NONCE_TRIES_EXHAUSTED;
+    return NONCE_RANGE_EXHAUSTED;
+}
+
+std::unique_ptr<CMiningService> g_miningService;
+
+CMiningService::CMiningService(const CChainParams& chainparamsIn) :
+    chainparams(chainparamsIn), fStopRequested(false), fRunning(false), dHashRate(0)
+{
+}
+
+CMiningService::~CMiningService()
+{
+    Stop();
+}
+
+void CMiningService::Start(boost::shared_ptr<CReserveScript> coinbaseScriptIn, int nThreads)
+{
+    boost::unique_lock<boost::mutex> lockControl(controlMutex);
+    StopThread();
+    boost::unique_lock<boost::mutex> lock(mutex);
+    coinbaseScript = coinbaseScriptIn;
+    search.reset(new CNonceSearch(nThreads));
+    fStopRequested = false;
+    fRunning = true;
+    thread = boost::thread(boost::bind(&CMiningService::ThreadMiner, this));
+    LogPrintf("%s: mining on %d threads\n", __func__, search->GetThreadCount());
+}
+
+void CMiningService::Stop()
+{
+    boost::unique_lock<boost::mutex> lockControl(controlMutex);
+    StopThread();
+}
+
+void CMiningService::StopThread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (!search)
+            return;
+        fStopRequested = true;
+        search->Interrupt();
+    }
+    thread.join();
+    boost::unique_lock<boost::mutex> lock(mutex);
+    search.reset();
+    coinbaseScript.reset();
+}
+
+bool CMiningService::IsRunning() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return fRunning;
+}
+
+int CMiningService::GetThreadCount() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return search ? search->GetThreadCount() : 0;
+}
+
+double CMiningService::GetHashRate() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return dHashRate;
+}
+
+void CMiningService::SetStatus(bool fMining, double dHashRateIn)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fRunning = fMining;
+        dHashRate = dHashRateIn;
+    }
+    uiInterface.NotifyMiningStatusChanged(fMining, dHashRateIn);
+}
+
+void CMiningService::ThreadMiner()
+{
+    // The first round is short; later rounds are sized to last about a second
+    uint64_t nRoundTries = 4096;
+    CBlockTemplateCache templateCache(chainparams, mempool);
+    std::shared_ptr<const CBlockTemplate> pblocktemplate;
+    CBlock block;
+    const CBlockIndex* pindexPrev = NULL;
+    unsigned int nExtraNonce = 0;
+
+    RenameThread("smartcoin-miner");
+    SetStatus(true, 0);
+    try {
+        while (!fStopRequested) {
+            // A new tip is picked up at once, mempool changes every
+            // MINING_TEMPLATE_REFRESH seconds
+            if (!pblocktemplate || templateCache.IsStale(pblocktemplate)) {
+                LOCK(cs_main);
+                pblocktemplate = templateCache.Get(coinbaseScript->reserveScript, false);
+                if (!pblocktemplate)
+                    throw std::runtime_error("CreateNewBlock failed");
+                BlockMap::iterator mi = mapBlockIndex.find(pblocktemplate->block.hashPrevBlock);
+                assert(mi != mapBlockIndex.end());
+                pindexPrev = mi->second;
+                block = pblocktemplate->block;
+                IncrementExtraNonce(&block, pindexPrev, nExtraNonce);
+            }
+
+            CBlock* pblock = &block;
+            const Consensus::Params& consensusParams = chainparams.GetConsensus(pindexPrev->nHeight + 1);
+            uint64_t nTries = nRoundTries;
+            int64_t nTimeStart = GetTimeMicros();
+            CNonceSearch::Result result = search->Solve(*pblock, consensusParams, std::numeric_limits<uint32_t>::max(), nTries);
+            int64_t nElapsed = GetTimeMicros() - nTimeStart;
+            if (nElapsed > 0 && nTries < nRoundTries) {
+                double dRate = (nRoundTries - nTries) * 1e6 / nElapsed;
+                nRoundTries = std::max<uint64_t>(4096, dRate);
+                SetStatus(true, dRate);
+            }
+
+            if (result == CNonceSearch::NONCE_FOUND) {
+                std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
+                if (ProcessNewBlock(chainparams, shared_pblock, true, NULL)) {
+                    LogPrintf("%s: mined block %s\n", __func__, pblock->GetHash().ToString());
+                    coinbaseScript->KeepScript();
+                }
+                pblocktemplate.reset();
+            } else if (result == CNonceSearch::NONCE_RANGE_EXHAUSTED) {
+                LOCK(cs_main);
+                UpdateTime(pblock, consensusParams, pindexPrev);
+                IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+                pblock->nNonce = 0;
+            }
+        }
+    } catch (const std::exception& e) {
+        PrintExceptionContinue(&e, "CMiningService::ThreadMiner()");
+    }
+    SetStatus(false, 0);
+}
@@ -8,9 +8,15 @@
 
 #include "primitives/block.h"
 #include "txmempool.h"
+#include "validationinterface.h"
 
+#include <atomic>
 #include <stdint.h>
 #include <memory>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
 
@@ -19,10 +25,13 @@ class CChainParams;
 class CReserveKey;
 class CScript;
 class CWallet;
+class CReserveScript;
 
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -genthreads, the number of nonce search threads used by generate (<= 0: one per core) */
+static const int DEFAULT_GENERATE_THREADS = 1;
 
 struct CBlockTemplate
 {
@@ -30,6 +39,12 @@ struct CBlockTemplate
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOpsCost;
     std::vector<unsigned char> vchCoinbaseCommitment;
+    // Resources used, as counted by BlockAssembler (including the space
+    // reserved for the coinbase), so that a template can be updated without
+    // recounting every transaction
+    uint64_t nBlockWeight;
+    uint64_t nBlockSize;
+    int64_t nBlockSigOpsCost;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -166,6 +181,11 @@ public:
     BlockAssembler(const CChainParams& chainparams);
     /** Construct a new block template with coinbase to scriptPubKeyIn */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx);
+    /** Apply mempool changes to a template built on the current tip: drop the
+     *  transactions in vRemoved, then append those in vAdded whose in-mempool
+     *  parents are already in the block and that still fit. Returns the
+     *  updated copy, or nullptr if the template has to be rebuilt instead. */
+    std::unique_ptr<CBlockTemplate> UpdateBlockTemplate(const CBlockTemplate& blocktemplate, const std::vector<uint256>& vRemoved, const std::vector<uint256>& vAdded, bool fMineWitnessTx);
 
 private:
     // utility functions
@@ -173,6 +193,8 @@ private:
     void resetBlock();
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
+    /** Create the coinbase paying nFees plus the subsidy to scriptPubKeyIn */
+    void CreateCoinbase(const CScript& scriptPubKeyIn, const CBlockIndex* pindexPrev, const Consensus::Params& consensus);
 
     // Methods for how to add transactions to a block.
     /** Add transactions based on tx "priority" */
@@ -209,6 +231,184 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/**
+ * Multi-threaded proof-of-work search over the nonce field of a block header.
+ * The worker threads are started once and each keeps its own scrypt
+ * scratchpad. Solve() hands out runs of scrypt_multi_lanes() consecutive
+ * nonces to whichever worker is free, and abandons the search as soon as the
+ * active chain tip moves away from the block's parent.
+ */
+class CNonceSearch : public CValidationInterface
+{
+public:
+    enum Result {
+        NONCE_FOUND,            //! block.nNonce solves the block
+        NONCE_TRIES_EXHAUSTED,  //! nMaxTries reached zero
+        NONCE_TIP_CHANGED,      //! the block no longer builds on the active tip
+        NONCE_RANGE_EXHAUSTED,  //! no solution below nNonceEnd
+        NONCE_INTERRUPTED,      //! Interrupt() was called
+    };
+
+    /** Start nThreads workers (<= 0: one per core) */
+    explicit CNonceSearch(int nThreads);
+    ~CNonceSearch();
+
+    /**
+     * Try nonces from block.nNonce up to (not including) nNonceEnd, but no
+     * more than nMaxTries of them. nMaxTries is reduced by the number of
+     * hashes computed. On NONCE_FOUND block.nNonce holds the lowest solution
+     * found, otherwise the first nonce that was not searched.
+     */
+    Result Solve(CBlock& block, const Consensus::Params& consensusParams, uint32_t nNonceEnd, uint64_t& nMaxTries);
+    /** Abort the running Solve() call and make every later one return immediately */
+    void Interrupt();
+
+    int GetThreadCount() const { return nThreads; }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+
+private:
+    void ThreadSearch();
+
+    int nThreads;
+    boost::thread_group threadGroup;
+
+    boost::mutex mutex;
+    boost::condition_variable condWork;
+    boost::condition_variable condDone;
+    bool fQuit;
+    //! Incremented for every Solve() call; workers wait for it to change
+    uint64_t nJob;
+    //! Number of workers done with the current job
+    int nFinished;
+    //! True while Solve() is waiting for the workers
+    bool fRunning;
+    bool fInterrupted;
+
+    // The current job, written by Solve() under mutex before nJob is bumped
+    CBlockHeader header;
+    const Consensus::Params* pconsensusParams;
+    uint64_t nRange;
+    uint64_t nFoundOffset;
+    uint64_t nHashesDone;
+
+    //! Offset (from header.nNonce) of the next run of nonces to hand out
+    std::atomic<uint64_t> nNextRun;
+    std::atomic<bool> fStop;
+    std::atomic<bool> fTipChanged;
+
+    // Totals for GetGenerateHashRate()
+    uint64_t nTotalHashes;
+    int64_t nTotalMicros;
+};
+
+/** Hashes per second achieved by the most recent generate call, 0 if there was none */
+double GetGenerateHashRate();
+
+/**
+ * Background miner for the GUI. A coordinator thread takes its block
+ * template from a CBlockTemplateCache, picking up a new one whenever the
+ * cached one goes stale, and feeds it to a CNonceSearch in rounds of about a second so that nonce and extranonce
+ * progress carry over between rounds. State and hash rate are reported
+ * through uiInterface.NotifyMiningStatusChanged.
+ */
+class CMiningService
+{
+public:
+    CMiningService(const CChainParams& chainparams);
+    ~CMiningService();
+
+    /** Start mining to coinbaseScript on nThreads threads (<= 0: one per core). Restarts if already running. */
+    void Start(boost::shared_ptr<CReserveScript> coinbaseScript, int nThreads);
+    void Stop();
+    bool IsRunning() const;
+    int GetThreadCount() const;
+    /** Hashes per second over the most recent round, 0 when stopped */
+    double GetHashRate() const;
+
+private:
+    void ThreadMiner();
+    void SetStatus(bool fMining, double dHashRateIn);
+    //! Stop the miner thread and wait for it; requires controlMutex
+    void StopThread();
+
+    const CChainParams& chainparams;
+    //! Serializes Start() and Stop(), so only one caller ever joins thread
+    boost::mutex controlMutex;
+    mutable boost::mutex mutex;
+    boost::thread thread;
+    std::unique_ptr<CNonceSearch> search;
+    boost::shared_ptr<CReserveScript> coinbaseScript;
+    std::atomic<bool> fStopRequested;
+    bool fRunning;
+    double dHashRate;
+};
+
+/** Seconds a template is kept after the mempool changed before it is stale, as getblocktemplate longpoll waits */
+static const int64_t MINING_TEMPLATE_REFRESH = 60;
+/** Seconds an incrementally updated template is kept before it is rebuilt from scratch */
+static const int64_t MINING_TEMPLATE_REBUILD = 600;
+/** Queued mempool changes above which CBlockTemplateCache rebuilds instead of updating */
+static const size_t MAX_TEMPLATE_CHANGES = 1000;
+
+/**
+ * Keeps a block template current for repeated requests. A template goes
+ * stale on a new tip, or once the mempool has changed and it is older than
+ * MINING_TEMPLATE_REFRESH seconds; until then Get() hands out the same one.
+ * Mempool additions and removals are queued as they happen and applied to a
+ * stale template with BlockAssembler::UpdateBlockTemplate(), which is much
+ * cheaper than CreateNewBlock(). The template is built from scratch on a new
+ * tip, when an update is not possible, and every MINING_TEMPLATE_REBUILD
+ * seconds, so that the transaction selection catches up with the best fee
+ * order. Returned templates are never modified.
+ */
+class CBlockTemplateCache : public CValidationInterface
+{
+public:
+    CBlockTemplateCache(const CChainParams& chainparams, CTxMemPool& pool);
+    ~CBlockTemplateCache();
+
+    /** The template paying to scriptPubKeyIn on the current tip, updated or rebuilt as needed */
+    std::shared_ptr<const CBlockTemplate> Get(const CScript& scriptPubKeyIn, bool fMineWitnessTx);
+    /** Whether Get() would no longer return blocktemplate; cheap enough to poll */
+    bool IsStale(const std::shared_ptr<const CBlockTemplate>& blocktemplate) const;
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+
+private:
+    void TransactionAdded(CTransactionRef tx);
+    void TransactionRemoved(CTransactionRef tx, MemPoolRemovalReason reason);
+    //! Whether pcurrent is stale; requires mutex
+    bool IsCurrentStale() const;
+
+    const CChainParams& chainparams;
+    CTxMemPool& pool;
+
+    mutable boost::mutex mutex;
+    std::shared_ptr<const CBlockTemplate> pcurrent;
+    CScript scriptCurrent;
+    bool fCurrentWitness;
+    //! When pcurrent was made, when it was last built from scratch, and whether it was updated since
+    int64_t nCurrentTime;
+    int64_t nBuildTime;
+    bool fUpdatedSinceBuild;
+    //! Mempool changes not yet applied to pcurrent
+    std::vector<uint256> vAdded;
+    std::vector<uint256> vRemoved;
+    bool fRebuild;
+    //! Whether the mempool changed, and whether the tip moved, since pcurrent was made
+    bool fChanged;
+    bool fNewTip;
+};
+
+/** The template cache used by getblocktemplate, created during init */
+extern std::unique_ptr<CBlockTemplateCache> g_blockTemplateCache;
+
+/** The background miner used by the GUI, created during init */
+extern std::unique_ptr<CMiningService> g_miningService;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
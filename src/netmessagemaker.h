@@ -29,6 +29,15 @@ public:
         return Make(0, std::move(sCommand), std::forward<Args>(args)...);
     }
 
+    //! Wrap a payload that is already serialized, e.g. a block as stored on disk
+    CSerializedNetMsg MakeRaw(std::string sCommand, std::vector<unsigned char>&& vchPayload) const
+    {
+        CSerializedNetMsg msg;
+        msg.command = std::move(sCommand);
+        msg.data = std::move(vchPayload);
+        return msg;
+    }
+
 private:
     const int nVersion;
 };
@@ -7,9 +7,113 @@
 #include "arith_uint256.h"
 #include "chain.h"
 #include "primitives/block.h"
+#include "sync.h"
 #include "uint256.h"
 #include "util.h"
 
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+/** The header fields a retarget reads, with nBits already expanded */
+struct CRetargetEntry
+{
+    uint256 hash;
+    int64_t nTime;
+    arith_uint256 bnTarget;
+
+    explicit CRetargetEntry(const CBlockIndex* pindex) : nTime(pindex->GetBlockTime())
+    {
+        if (pindex->phashBlock)
+            hash = *pindex->phashBlock;
+        bnTarget.SetCompact(pindex->nBits);
+    }
+};
+
+/**
+ * Contiguous per-height copy of the recent part of the chain retargets run on.
+ * KimotoGravityWell and DarkGravityWave read their window from here instead of
+ * chasing pprev through the block index and decoding nBits for every block, so
+ * moving to the next block costs one new entry. Following a different branch
+ * rewrites the entries above the fork point; entries are matched by block hash,
+ * so nothing here ever points into the block index.
+ */
+class CRetargetArena
+{
+private:
+    //! vEntries[i] is the block at height nBase + i; each is the parent of the next
+    std::vector<CRetargetEntry> vEntries;
+    int nBase;
+    //! Window for blocks without a hash, which cannot be matched against vEntries
+    std::vector<CRetargetEntry> vScratch;
+
+public:
+    CRetargetArena() : nBase(0) {}
+
+    /**
+     * Return the entry for pindexLast. The entries just below it are its
+     * ancestors; nBlocks is set to how many, pindexLast included, are usable:
+     * at most nDepth, and never the genesis block.
+     */
+    const CRetargetEntry* Window(const CBlockIndex* pindexLast, int nDepth, int& nBlocks)
+    {
+        const int nFloor = std::max(1, pindexLast->nHeight - nDepth + 1);
+
+        // Walk back until reaching a block the arena already has. That is only
+        // useful if the arena reaches down to nFloor; otherwise start over.
+        std::vector<const CBlockIndex*> vMissing;
+        const CBlockIndex* pindex = pindexLast;
+        bool fFound = false;
+        bool fHashes = true;
+        while (pindex && pindex->nHeight >= nFloor) {
+            fHashes &= pindex->phashBlock != NULL;
+            const int i = pindex->nHeight - nBase;
+            if (fHashes && nBase <= nFloor && i < (int)vEntries.size() && vEntries[i].hash == *pindex->phashBlock) {
+                fFound = true;
+                break;
+            }
+            vMissing.push_back(pindex);
+            pindex = pindex->pprev;
+        }
+
+        if (!fHashes) {
+            vScratch.clear();
+            for (std::vector<const CBlockIndex*>::reverse_iterator it = vMissing.rbegin(); it != vMissing.rend(); ++it)
+                vScratch.push_back(CRetargetEntry(*it));
+            nBlocks = vScratch.size();
+            return &vScratch.back();
+        }
+
+        if (fFound) {
+            vEntries.erase(vEntries.begin() + (pindex->nHeight - nBase + 1), vEntries.end());
+        } else {
+            vEntries.clear();
+            nBase = vMissing.back()->nHeight;
+        }
+        for (std::vector<const CBlockIndex*>::reverse_iterator it = vMissing.rbegin(); it != vMissing.rend(); ++it)
+            vEntries.push_back(CRetargetEntry(*it));
+
+        // Forget old heights now and then, keeping enough for any window
+        const size_t nKeep = std::max(nDepth, 1024);
+        if (vEntries.size() > 2 * nKeep) {
+            const size_t nDrop = vEntries.size() - nKeep;
+            vEntries.erase(vEntries.begin(), vEntries.begin() + nDrop);
+            nBase += nDrop;
+        }
+
+        nBlocks = pindexLast->nHeight - std::max(nBase, nFloor) + 1;
+        return &vEntries.back();
+    }
+};
+
+CCriticalSection cs_retarget;
+CRetargetArena retargetArena GUARDED_BY(cs_retarget);
+//! KimotoGravityWell's event horizon deviation by PastBlocksMass, filled on demand
+std::vector<double> vEventHorizonDeviation GUARDED_BY(cs_retarget);
+
+} // anon namespace
+
 // Determine if the for the given block, a min difficulty setting applies
 bool AllowMinDifficultyForBlock(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
 {
@@ -125,10 +229,6 @@ unsigned int KimotoGravityWell(const CBlockIndex* pindexLast, const CBlockHeader
     uint64_t PastBlocksMin = PastSecondsMin / TargetBlocksSpacingSeconds;
     uint64_t PastBlocksMax = PastSecondsMax / TargetBlocksSpacingSeconds;
 
-    const CBlockIndex *BlockLastSolved = pindexLast;
-    const CBlockIndex *BlockReading = pindexLast;
-    const CBlockHeader *BlockCreating = pblock;
-    BlockCreating = BlockCreating;
     uint64_t PastBlocksMass = 0;
     int64_t PastRateActualSeconds = 0;
     int64_t PastRateTargetSeconds = 0;
@@ -139,41 +239,42 @@ unsigned int KimotoGravityWell(const CBlockIndex* pindexLast, const CBlockHeader
     double EventHorizonDeviationFast;
     double EventHorizonDeviationSlow;
 
-    if (BlockLastSolved == NULL || BlockLastSolved->nHeight == 0 || (uint64_t)BlockLastSolved->nHeight < PastBlocksMin)
+    if (pindexLast == NULL || pindexLast->nHeight == 0 || (uint64_t)pindexLast->nHeight < PastBlocksMin)
         return UintToArith256(params.powLimit).GetCompact();
 
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (PastBlocksMax > 0 && i > PastBlocksMax) { break; }
+    LOCK(cs_retarget);
+    int nBlocks;
+    const CRetargetEntry* BlockLastSolved = retargetArena.Window(pindexLast, PastBlocksMax > 0 ? (int)PastBlocksMax : pindexLast->nHeight, nBlocks);
 
+    for (int i = 1; i <= nBlocks; i++) {
+        const CRetargetEntry* BlockReading = BlockLastSolved - (i - 1);
         PastBlocksMass++;
 
         if (i == 1) { 
-            PastDifficultyAverage.SetCompact(BlockReading->nBits); 
+            PastDifficultyAverage = BlockReading->bnTarget;
         }
         else { 
-            arith_uint256 lastDifficulty;
-            lastDifficulty.SetCompact(BlockReading->nBits);
-            PastDifficultyAverage = ((lastDifficulty - PastDifficultyAveragePrev) / i) + PastDifficultyAveragePrev; 
+            PastDifficultyAverage = ((BlockReading->bnTarget - PastDifficultyAveragePrev) / i) + PastDifficultyAveragePrev;
         }
         PastDifficultyAveragePrev = PastDifficultyAverage;
 
-        PastRateActualSeconds = BlockLastSolved->GetBlockTime() - BlockReading->GetBlockTime();
+        PastRateActualSeconds = BlockLastSolved->nTime - BlockReading->nTime;
         PastRateTargetSeconds = TargetBlocksSpacingSeconds * PastBlocksMass;
         PastRateAdjustmentRatio = double(1);
         if (PastRateActualSeconds < 0) { PastRateActualSeconds = 0; }
         if (PastRateActualSeconds != 0 && PastRateTargetSeconds != 0) {
         PastRateAdjustmentRatio = double(PastRateTargetSeconds) / double(PastRateActualSeconds);
         }
-        EventHorizonDeviation = 1 + (0.7084 * pow((double(PastBlocksMass)/double(39.96)), -1.228));
-        EventHorizonDeviationFast = EventHorizonDeviation;
-        EventHorizonDeviationSlow = 1 / EventHorizonDeviation;
 
         if (PastBlocksMass >= PastBlocksMin) {
-            if ((PastRateAdjustmentRatio <= EventHorizonDeviationSlow) || (PastRateAdjustmentRatio >= EventHorizonDeviationFast)) { assert(BlockReading); break; }
+            while (vEventHorizonDeviation.size() <= PastBlocksMass) {
+                vEventHorizonDeviation.push_back(1 + (0.7084 * pow((double(vEventHorizonDeviation.size())/double(39.96)), -1.228)));
+            }
+            EventHorizonDeviation = vEventHorizonDeviation[PastBlocksMass];
+            EventHorizonDeviationFast = EventHorizonDeviation;
+            EventHorizonDeviationSlow = 1 / EventHorizonDeviation;
+            if ((PastRateAdjustmentRatio <= EventHorizonDeviationSlow) || (PastRateAdjustmentRatio >= EventHorizonDeviationFast)) { break; }
         }
-        if (BlockReading->pprev == NULL) { assert(BlockReading); break; }
-
-        BlockReading = BlockReading->pprev;
     }
 
     arith_uint256 bnNew(PastDifficultyAverage);
@@ -189,7 +290,7 @@ unsigned int KimotoGravityWell(const CBlockIndex* pindexLast, const CBlockHeader
 
     //if (fDebug) {
     //  LogPrintf("KimotoGravityWell: PastRateAdjustmentRatio = %g\n", PastRateAdjustmentRatio);
-    //  LogPrintf("Before: %08x %s\n", BlockLastSolved->nBits, arith_uint256().SetCompact(BlockLastSolved->nBits).ToString().c_str());
+    //  LogPrintf("Before: %08x %s\n", pindexLast->nBits, arith_uint256().SetCompact(pindexLast->nBits).ToString().c_str());
     //  LogPrintf("After: %08x %s\n", bnNew.GetCompact(), bnNew.ToString().c_str());
     //}
 
@@ -267,10 +368,6 @@ unsigned int DigiShield(const CBlockIndex* pindexLast, const CBlockHeader *pbloc
 
 unsigned int DarkGravityWave(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params) {
 	/* current difficulty formula, darkcoin - DarkGravity v3, written by Evan Duffield - evan@darkcoin.io */
-	const CBlockIndex *BlockLastSolved = pindexLast;
-	const CBlockIndex *BlockReading = pindexLast;
-	const CBlockHeader *BlockCreating = pblock;
-	BlockCreating = BlockCreating;
 	int64_t nActualTimespan = 0;
 	int64_t LastBlockTime = 0;
 	int64_t PastBlocksMin = 24;
@@ -279,34 +376,33 @@ unsigned int DarkGravityWave(const CBlockIndex* pindexLast, const CBlockHeader *
 	arith_uint256 PastDifficultyAverage;
 	arith_uint256 PastDifficultyAveragePrev;
 
-	if (BlockLastSolved == NULL || BlockLastSolved->nHeight == 0 || BlockLastSolved->nHeight < PastBlocksMin) {
+	if (pindexLast == NULL || pindexLast->nHeight == 0 || pindexLast->nHeight < PastBlocksMin) {
 		return UintToArith256(params.powLimit).GetCompact();
 	}
 
-	for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-		if (PastBlocksMax > 0 && i > PastBlocksMax) { break; }
+	LOCK(cs_retarget);
+	int nBlocks;
+	const CRetargetEntry* BlockLastSolved = retargetArena.Window(pindexLast, PastBlocksMax, nBlocks);
+
+	for (int i = 1; i <= nBlocks; i++) {
+		const CRetargetEntry* BlockReading = BlockLastSolved - (i - 1);
 		CountBlocks++;
 
 		if (CountBlocks <= PastBlocksMin) {
 			if (CountBlocks == 1) {
-                PastDifficultyAverage.SetCompact(BlockReading->nBits);
+                PastDifficultyAverage = BlockReading->bnTarget;
             }
 			else {
-                arith_uint256 currentDifficulty;
-                currentDifficulty.SetCompact(BlockReading->nBits);
-                PastDifficultyAverage = ((PastDifficultyAveragePrev * CountBlocks) + currentDifficulty) / (CountBlocks + 1);
+                PastDifficultyAverage = ((PastDifficultyAveragePrev * CountBlocks) + BlockReading->bnTarget) / (CountBlocks + 1);
             }
 			PastDifficultyAveragePrev = PastDifficultyAverage;
 		}
 
 		if (LastBlockTime > 0) {
-			int64_t Diff = (LastBlockTime - BlockReading->GetBlockTime());
+			int64_t Diff = (LastBlockTime - BlockReading->nTime);
 			nActualTimespan += Diff;
 		}
-		LastBlockTime = BlockReading->GetBlockTime();
-
-		if (BlockReading->pprev == NULL) { assert(BlockReading); break; }
-		BlockReading = BlockReading->pprev;
+		LastBlockTime = BlockReading->nTime;
 	}
 
     arith_uint256 bnNew(PastDifficultyAverage);
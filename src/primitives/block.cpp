@@ -7,6 +7,7 @@
 
 #include "crypto/common.h"
 #include "crypto/scrypt.h"
+#include "crypto/x11.h"
 #include "hash.h"
 #include "streams.h"
 #include "tinyformat.h"
@@ -17,13 +18,20 @@ uint256 CBlockHeader::GetHash() const
     return SerializeHash(*this);
 }
 
+static bool IsX11Time(uint32_t nTime)
+{
+    return nTime > 1406160000 && nTime < 1721779200; // July 24 2014 12:00:00 AM UTC, X11 fork - but let's go back to Scrypt for relaunch
+}
+
 uint256 CBlockHeader::GetPoWHash() const
 {
-    if (nTime > 1406160000 && nTime < 1721779200) { // July 24 2014 12:00:00 AM UTC, X11 fork - but let's go back to Scrypt for relaunch
+    if (IsX11Time(nTime)) {
         std::vector<unsigned char> vch(80);
         CVectorWriter ss(SER_NETWORK, PROTOCOL_VERSION, vch, 0);
         ss << *this;
-        return Hash11((const char *)vch.data(), (const char *)vch.data() + vch.size());
+        uint256 thash;
+        x11_hash_multi(vch.data(), vch.size(), 1, thash.begin());
+        return thash;
     }
     else {
         uint256 thash;
@@ -32,6 +40,68 @@ uint256 CBlockHeader::GetPoWHash() const
     }
 }
 
+void GetPoWHashes(const CBlockHeader* pheaders, size_t n, uint256* phashes)
+{
+    // Collect the headers of each era so they can share the multi-lane kernels
+    std::vector<unsigned char> vInput[2];
+    std::vector<size_t> vIndex[2];
+    for (size_t i = 0; i < n; i++) {
+        const int nEra = IsX11Time(pheaders[i].nTime) ? 1 : 0;
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, vInput[nEra], vInput[nEra].size()) << pheaders[i];
+        vIndex[nEra].push_back(i);
+    }
+
+    std::vector<uint256> vOutput(n);
+    if (!vIndex[0].empty())
+        scrypt_1024_1_1_256_multi((const char*)vInput[0].data(), BEGIN(vOutput[0]), vIndex[0].size());
+    for (size_t i = 0; i < vIndex[0].size(); i++)
+        phashes[vIndex[0][i]] = vOutput[i];
+    if (!vIndex[1].empty())
+        x11_hash_multi(vInput[1].data(), 80, vIndex[1].size(), vOutput[0].begin());
+    for (size_t i = 0; i < vIndex[1].size(); i++)
+        phashes[vIndex[1][i]] = vOutput[i];
+}
+
+CPoWHasher::CPoWHasher(const CBlockHeader& blockHeader) : fX11(IsX11Time(blockHeader.nTime))
+{
+    std::vector<unsigned char> vch;
+    CVectorWriter(SER_NETWORK, PROTOCOL_VERSION, vch, 0) << blockHeader;
+    assert(vch.size() == sizeof(header));
+    memcpy(header, vch.data(), sizeof(header));
+    if (!fX11)
+        scrypt.reset(new CScryptMidstate((const char*)header));
+}
+
+CPoWHasher::~CPoWHasher()
+{
+}
+
+uint256 CPoWHasher::Hash(uint32_t nNonce)
+{
+    uint256 hash;
+    Hash(nNonce, 1, &hash);
+    return hash;
+}
+
+void CPoWHasher::Hash(uint32_t nNonce, size_t n, uint256* phashes, char* scratchpad)
+{
+    if (fX11) {
+        // Lay out the n headers back to back so they share the X11 kernels
+        vX11Input.resize(n * sizeof(header));
+        for (size_t i = 0; i < n; i++) {
+            memcpy(&vX11Input[i * sizeof(header)], header, sizeof(header));
+            WriteLE32(&vX11Input[i * sizeof(header) + 76], nNonce + (uint32_t)i);
+        }
+        x11_hash_multi(vX11Input.data(), sizeof(header), n, phashes[0].begin());
+        return;
+    }
+    if (!scratchpad) {
+        vScratchpad.resize(SCRYPT_MULTI_SCRATCHPAD_SIZE);
+        scratchpad = vScratchpad.data();
+    }
+    scrypt->Hash(nNonce, BEGIN(phashes[0]), n, scratchpad);
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -10,6 +10,13 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <memory>
+
+class CScryptMidstate;
+
+/** Serialized size of a block header; the block hash covers exactly these bytes */
+static const size_t BLOCK_HEADER_SIZE = 80;
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -162,4 +169,34 @@ struct CBlockLocator
 /** Compute the consensus-critical block weight (see BIP 141). */
 int64_t GetBlockWeight(const CBlock& tx);
 
+/** Compute GetPoWHash() for n headers at once. Scrypt-era headers are hashed
+ *  together through the multi-lane scrypt kernel. */
+void GetPoWHashes(const CBlockHeader* pheaders, size_t n, uint256* phashes);
+
+/**
+ * Proof-of-work hashing of one block header over many nonces, as done by the
+ * miner. The header is serialized once and only the nonce is patched per try.
+ * For scrypt-era headers the nonce-independent SHA256 midstate of the scrypt
+ * key derivation is kept as well (see CScryptMidstate).
+ */
+class CPoWHasher
+{
+public:
+    explicit CPoWHasher(const CBlockHeader& header);
+    ~CPoWHasher();
+
+    /** GetPoWHash() of the header with its nonce set to nNonce */
+    uint256 Hash(uint32_t nNonce);
+    /** Hashes of the n consecutive nonces starting at nNonce. The optional
+     *  scratchpad must hold SCRYPT_MULTI_SCRATCHPAD_SIZE bytes. */
+    void Hash(uint32_t nNonce, size_t n, uint256* phashes, char* scratchpad = NULL);
+
+private:
+    bool fX11;
+    unsigned char header[80];
+    std::unique_ptr<CScryptMidstate> scrypt;
+    std::vector<char> vScratchpad;
+    std::vector<unsigned char> vX11Input;
+};
+
 #endif // BITCOIN_PRIMITIVES_BLOCK_H
@@ -14,10 +14,12 @@
 #include "checkpoints.h"
 #include "clientversion.h"
 #include "validation.h"
+#include "miner.h"
 #include "net.h"
 #include "txmempool.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "validationinterface.h"
 
 #include <stdint.h>
 
@@ -216,6 +218,29 @@ bool ClientModel::getNetworkActive() const
     return false;
 }
 
+bool ClientModel::startMining(int nThreads)
+{
+    if (!g_miningService)
+        return false;
+    boost::shared_ptr<CReserveScript> coinbaseScript;
+    GetMainSignals().ScriptForMining(coinbaseScript);
+    if (!coinbaseScript || coinbaseScript->reserveScript.empty())
+        return false;
+    g_miningService->Start(coinbaseScript, nThreads);
+    return true;
+}
+
+void ClientModel::stopMining()
+{
+    if (g_miningService)
+        g_miningService->Stop();
+}
+
+bool ClientModel::isMining() const
+{
+    return g_miningService && g_miningService->IsRunning();
+}
+
 QString ClientModel::getStatusBarWarnings() const
 {
     return QString::fromStdString(GetWarnings("gui"));
@@ -302,6 +327,13 @@ static void BannedListChanged(ClientModel *clientmodel)
     QMetaObject::invokeMethod(clientmodel, "updateBanlist", Qt::QueuedConnection);
 }
 
+static void NotifyMiningStatusChanged(ClientModel *clientmodel, bool fMining, double dHashRate)
+{
+    QMetaObject::invokeMethod(clientmodel, "miningStatusChanged", Qt::QueuedConnection,
+                              Q_ARG(bool, fMining),
+                              Q_ARG(double, dHashRate));
+}
+
 static void BlockTipChanged(ClientModel *clientmodel, bool initialSync, const CBlockIndex *pIndex, bool fHeader)
 {
     // lock free async UI updates in case we have a new block tip
@@ -338,6 +370,7 @@ void ClientModel::subscribeToCoreSignals()
     uiInterface.NotifyNetworkActiveChanged.connect(boost::bind(NotifyNetworkActiveChanged, this, _1));
     uiInterface.NotifyAlertChanged.connect(boost::bind(NotifyAlertChanged, this, _1, _2));
     uiInterface.BannedListChanged.connect(boost::bind(BannedListChanged, this));
+    uiInterface.NotifyMiningStatusChanged.connect(boost::bind(NotifyMiningStatusChanged, this, _1, _2));
     uiInterface.NotifyBlockTip.connect(boost::bind(BlockTipChanged, this, _1, _2, false));
     uiInterface.NotifyHeaderTip.connect(boost::bind(BlockTipChanged, this, _1, _2, true));
 }
@@ -350,6 +383,7 @@ void ClientModel::unsubscribeFromCoreSignals()
     uiInterface.NotifyNetworkActiveChanged.disconnect(boost::bind(NotifyNetworkActiveChanged, this, _1));
     uiInterface.NotifyAlertChanged.disconnect(boost::bind(NotifyAlertChanged, this, _1, _2));
     uiInterface.BannedListChanged.disconnect(boost::bind(BannedListChanged, this));
+    uiInterface.NotifyMiningStatusChanged.disconnect(boost::bind(NotifyMiningStatusChanged, this, _1, _2));
     uiInterface.NotifyBlockTip.disconnect(boost::bind(BlockTipChanged, this, _1, _2, false));
     uiInterface.NotifyHeaderTip.disconnect(boost::bind(BlockTipChanged, this, _1, _2, true));
 }
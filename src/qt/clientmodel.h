@@ -74,6 +74,11 @@ public:
     bool getNetworkActive() const;
     //! Toggle network activity state in core
     void setNetworkActive(bool active);
+    //! Start the background miner on nThreads threads, paying to a script
+    //! from the wallet. Returns false if no script is available.
+    bool startMining(int nThreads);
+    void stopMining();
+    bool isMining() const;
     //! Return warnings to be displayed in status bar
     QString getStatusBarWarnings() const;
 
@@ -104,6 +109,7 @@ Q_SIGNALS:
     void networkActiveChanged(bool networkActive);
     void alertsChanged(const QString &warnings);
     void bytesChanged(quint64 totalBytesIn, quint64 totalBytesOut);
+    void miningStatusChanged(bool mining, double hashRate);
 
     //! Fired when a message should be reported to the user
     void message(const QString &title, const QString &message, unsigned int style);
@@ -2,6 +2,7 @@
 #include "clientmodel.h"
 #include "walletmodel.h"
 #include "platformstyle.h"
+#include "miner.h"
 #include "univalue.h"
 #include "util.h"
 #include "rpc/client.h"
@@ -12,105 +13,13 @@
 #include <QVBoxLayout>
 #include <QPushButton>
 #include <QLabel>
-#include <QTimer>
-#include <QThread>
-
-const int MiningWorker::MINING_INTERVAL;
-
-// MiningWorker method implementations
-void MiningWorker::calibrateMaxTries()
-{
-    // Run a test mining operation with 10,000 tries and measure time
-    const uint64_t TEST_TRIES = 10000;
-    QElapsedTimer timer;
-    timer.start();
-
-    JSONRPCRequest request;
-    request.strMethod = "generate";
-    request.params = UniValue(UniValue::VARR);
-    request.params.push_back(1);        // Generate 1 block
-    request.params.push_back(TEST_TRIES); // Use test number of tries
-
-    try {
-        tableRPC.execute(request);
-    } catch (const UniValue& objError) {
-        // Ignore errors during calibration
-    }
-
-    // Calculate how many tries we can do in MINING_INTERVAL milliseconds
-    int elapsed = timer.elapsed();
-    if (elapsed > 0) {
-        m_maxTriesPerInterval = (TEST_TRIES * MINING_INTERVAL) / elapsed;
-        m_maxTriesPerInterval = m_maxTriesPerInterval * 9 / 10;  // Safety margin
-        
-        // Calculate hash rate (hashes per second)
-        double hashRate = (m_maxTriesPerInterval * 1000.0) / MINING_INTERVAL;
-        Q_EMIT hashRateChanged(hashRate);
-        
-        LogPrintf("Mining calibration: %d tries took %.2f seconds\n", 
-                  TEST_TRIES, elapsed/1000.0);
-        LogPrintf("Mining calibration: will use %lu tries per %d ms interval\n", 
-                  m_maxTriesPerInterval, MINING_INTERVAL);
-    }
-}
-
-void MiningWorker::startMining()
-{
-    if (m_mining)
-        return;
-
-    m_mining = true;
-    
-    // Calibrate maxTries before starting
-    calibrateMaxTries();
-    
-    Q_EMIT miningStarted();
-    
-    // Start periodic mining
-    m_miningTimer->start(MINING_INTERVAL);
-    mineBlock(); // Mine first block immediately
-}
-
-void MiningWorker::mineBlock()
-{
-    if (!m_mining)
-        return;
-
-    JSONRPCRequest request;
-    request.strMethod = "generate";
-    request.params = UniValue(UniValue::VARR);
-    request.params.push_back(1);     // Generate 1 block
-    request.params.push_back(m_maxTriesPerInterval);  // Use calibrated value
-
-    try {
-        UniValue result = tableRPC.execute(request);
-    } catch (const UniValue& objError) {
-        QString errorMessage = QString::fromStdString(find_value(objError, "message").get_str());
-        Q_EMIT miningFailed(errorMessage);
-        stopMining();
-    }
-}
-
-void MiningWorker::stopMining()
-{
-    if (!m_mining)
-        return;
-
-    m_mining = false;
-    if (m_miningTimer) {
-        m_miningTimer->stop();
-    }
-    Q_EMIT hashRateChanged(0);  // Set hash rate to 0
-    Q_EMIT miningStopped();
-}
+#include <QSpinBox>
 
 // MiningView method implementations
 MiningView::MiningView(const PlatformStyle *platformStyle, QWidget *parent) :
     QWidget(parent),
     clientModel(nullptr),
-    walletModel(nullptr),
-    miningWorker(nullptr),
-    miningThread(nullptr)
+    walletModel(nullptr)
 {
     QVBoxLayout *mainLayout = new QVBoxLayout();
     setLayout(mainLayout);
@@ -120,11 +29,18 @@ MiningView::MiningView(const PlatformStyle *platformStyle, QWidget *parent) :
     startMiningButton = new QPushButton(tr("Start Mining"));
     stopMiningButton = new QPushButton(tr("Stop Mining"));
     stopMiningButton->setEnabled(false);
+    threadsSpinBox = new QSpinBox();
+    threadsSpinBox->setRange(0, 64);
+    threadsSpinBox->setSpecialValueText(tr("All cores"));
+    threadsSpinBox->setValue(std::max<int>(0, GetArg("-genthreads", DEFAULT_GENERATE_THREADS)));
+    threadsSpinBox->setToolTip(tr("Number of mining threads"));
     hashRateLabel = new QLabel(tr("Hash Rate: 0 H/s"));
     networkHashRateLabel = new QLabel(tr("Network Hash Rate: 0 H/s"));
     
     controlsLayout->addWidget(startMiningButton);
     controlsLayout->addWidget(stopMiningButton);
+    controlsLayout->addWidget(new QLabel(tr("Threads:")));
+    controlsLayout->addWidget(threadsSpinBox);
     controlsLayout->addStretch();
     controlsLayout->addWidget(hashRateLabel);
     controlsLayout->addWidget(networkHashRateLabel);
@@ -138,26 +54,10 @@ MiningView::MiningView(const PlatformStyle *platformStyle, QWidget *parent) :
     
     // Update network hash rate when the view loads
     updateNetworkHashRate();
-
-    // Create the mining worker and thread
-    miningWorker = new MiningWorker();
-    miningThread = new QThread(this);
-    miningWorker->moveToThread(miningThread);
-
-    connect(miningThread, &QThread::finished, miningWorker, &QObject::deleteLater);
-    connect(this, &MiningView::startMiningSignal, miningWorker, &MiningWorker::startMining);
-    connect(this, &MiningView::stopMiningSignal, miningWorker, &MiningWorker::stopMining);
-    connect(miningWorker, &MiningWorker::miningStopped, this, &MiningView::onMiningStopped);
-    connect(miningWorker, &MiningWorker::miningFailed, this, &MiningView::onMiningFailed);
-    connect(miningWorker, &MiningWorker::hashRateChanged, this, &MiningView::onHashRateChanged);
-
-    miningThread->start();
 }
 
 MiningView::~MiningView()
 {
-    miningThread->quit();
-    miningThread->wait();
 }
 
 void MiningView::setClientModel(ClientModel *model)
@@ -167,6 +67,9 @@ void MiningView::setClientModel(ClientModel *model)
     if (model) {
         // Connect to blockchain signals
         connect(model, &ClientModel::numBlocksChanged, this, &MiningView::updateNetworkHashRate);
+        connect(model, &ClientModel::miningStatusChanged, this, &MiningView::onMiningStatusChanged);
+        if (model->isMining())
+            onMiningStatusChanged(true, 0);
     }
 }
 
@@ -180,10 +83,13 @@ void MiningView::startMining()
     if (!clientModel)
         return;
 
+    if (!clientModel->startMining(threadsSpinBox->value())) {
+        hashRateLabel->setText(tr("Mining failed: no address available for the block reward"));
+        return;
+    }
     startMiningButton->setEnabled(false);
     stopMiningButton->setEnabled(true);
-
-    Q_EMIT startMiningSignal();
+    threadsSpinBox->setEnabled(false);
 }
 
 void MiningView::stopMining()
@@ -191,21 +97,18 @@ void MiningView::stopMining()
     if (!clientModel)
         return;
 
-    Q_EMIT stopMiningSignal();
+    clientModel->stopMining();
 }
 
-void MiningView::onMiningStopped()
+void MiningView::onMiningStatusChanged(bool mining, double hashRate)
 {
-    startMiningButton->setEnabled(true);
-    stopMiningButton->setEnabled(false);
-    hashRateLabel->setText(tr("Mining stopped"));
-}
-
-void MiningView::onMiningFailed(const QString &errorMessage)
-{
-    startMiningButton->setEnabled(true);
-    stopMiningButton->setEnabled(false);
-    hashRateLabel->setText(tr("Mining failed: %1").arg(errorMessage));
+    startMiningButton->setEnabled(!mining);
+    stopMiningButton->setEnabled(mining);
+    threadsSpinBox->setEnabled(!mining);
+    if (mining)
+        hashRateLabel->setText(tr("Hash Rate: %1").arg(formatHashRate(hashRate)));
+    else
+        hashRateLabel->setText(tr("Mining stopped"));
 }
 
 QString MiningView::formatHashRate(double hashRate) const
@@ -226,11 +129,6 @@ QString MiningView::formatHashRate(double hashRate) const
     return QString("%1 %2").arg(hashRate, 0, 'f', 2).arg(unit);
 }
 
-void MiningView::onHashRateChanged(double hashRate)
-{
-    hashRateLabel->setText(tr("Hash Rate: %1").arg(formatHashRate(hashRate)));
-}
-
 void MiningView::updateNetworkHashRate()
 {
     JSONRPCRequest request;
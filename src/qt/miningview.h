@@ -3,9 +3,6 @@
 
 #include <QObject>
 #include <QWidget>
-#include <QKeyEvent>
-#include <QThread>
-#include <QTimer>
 
 class WalletModel;
 class ClientModel;
@@ -15,50 +12,10 @@ QT_BEGIN_NAMESPACE
 class QTableView;
 class QPushButton;
 class QLabel;
+class QSpinBox;
 QT_END_NAMESPACE
 
-class MiningWorker : public QObject
-{
-    Q_OBJECT
-
-private:
-    bool m_mining;
-    QTimer* m_miningTimer;
-    static constexpr int MINING_INTERVAL = 5000; // 5 seconds
-    uint64_t m_maxTriesPerInterval;  // Calibrated value
-    
-    void calibrateMaxTries();  // New method
-
-public:
-    ~MiningWorker()
-    {
-        if (m_miningTimer) {
-            m_miningTimer->stop();
-            delete m_miningTimer;
-            m_miningTimer = nullptr;
-        }
-    }
-    explicit MiningWorker(QObject *parent = nullptr) : 
-        QObject(parent), 
-        m_mining(false),
-        m_miningTimer(new QTimer(this)),
-        m_maxTriesPerInterval(1000000) // Start with default, will be calibrated
-    {
-        connect(m_miningTimer, &QTimer::timeout, this, &MiningWorker::mineBlock);
-    }
-
-Q_SIGNALS:
-    void miningStarted();
-    void miningStopped();
-    void miningFailed(const QString &errorMessage);
-    void hashRateChanged(double hashRate);
-
-public Q_SLOTS:
-    void startMining();
-    void stopMining();
-    void mineBlock();
-};
-
+/** View over the core background miner (CMiningService), driven through ClientModel */
 class MiningView : public QWidget
 {
     Q_OBJECT
@@ -76,24 +33,17 @@ private:
     
     QPushButton *startMiningButton;
     QPushButton *stopMiningButton;
+    QSpinBox *threadsSpinBox;
     QLabel *hashRateLabel;
     QLabel *networkHashRateLabel;
-    MiningWorker *miningWorker;
-    QThread *miningThread;
     
     QString formatHashRate(double hashRate) const;
 
-Q_SIGNALS:
-    void startMiningSignal();
-    void stopMiningSignal();
-
 private Q_SLOTS:
     void startMining();
     void stopMining();
     void updateNetworkHashRate();
-    void onMiningStopped();
-    void onMiningFailed(const QString &errorMessage);
-    void onHashRateChanged(double hashRate);
+    void onMiningStatusChanged(bool mining, double hashRate);
 };
 
 #endif // BITCOIN_QT_MININGVIEW_H
\ No newline at end of file
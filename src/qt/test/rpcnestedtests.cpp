@@ -49,7 +49,8 @@ void RPCNestedTests::rpcNestedTests()
     //mempool.setSanityCheck(1.0);
     pblocktree = new CBlockTreeDB(1 << 20, true);
     pcoinsdbview = new CCoinsViewDB(1 << 23, true);
-    pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+    pcoinsflusher = new CCoinsViewAsyncFlush(pcoinsdbview);
+    pcoinsTip = new CCoinsViewCache(pcoinsflusher);
     InitBlockIndex(chainparams);
     {
         CValidationState state;
@@ -149,6 +150,7 @@ void RPCNestedTests::rpcNestedTests()
 #endif
 
     delete pcoinsTip;
+    delete pcoinsflusher;
     delete pcoinsdbview;
     delete pblocktree;
 
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "blockpipeline.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -15,15 +16,20 @@
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
+#include "txoutset.h"
+#include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "validationinterface.h"
 #include "hash.h"
 
 #include <stdint.h>
 
 #include <univalue.h>
 
+#include <boost/filesystem.hpp>
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
 #include <mutex>
@@ -747,6 +753,11 @@ UniValue getblock(const JSONRPCRequest& request)
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
 
+    std::vector<unsigned char> vchRawBlock;
+    if (!fVerbose && IsRawBlockSerialization(pblockindex, RPCSerializationFlags(), Params().GetConsensus(pblockindex->nHeight)) &&
+        ReadRawBlockFromDisk(vchRawBlock, pblockindex))
+        return HexStr(vchRawBlock.begin(), vchRawBlock.end());
+
     if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(pblockindex->nHeight)))
         // Block not found on disk. This could be because we have the block
         // header in our index but don't have the block (for example if a
@@ -766,57 +777,29 @@ UniValue getblock(const JSONRPCRequest& request)
     return blockToJSON(block, pblockindex);
 }
 
-struct CCoinsStats
-{
-    int nHeight;
-    uint256 hashBlock;
-    uint64_t nTransactions;
-    uint64_t nTransactionOutputs;
-    uint64_t nSerializedSize;
-    uint256 hashSerialized;
-    arith_uint256 nTotalAmount;
-
-    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
-};
-
 //! Calculate statistics about the unspent transaction output set
 static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
 {
     std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
 
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
+    CCoinsStatsHasher hasher(stats, pcursor->GetBestBlock());
     {
         LOCK(cs_main);
         stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
     }
-    ss << stats.hashBlock;
-    arith_uint256 nTotalAmount = 0;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        uint256 key;
-        CCoins coins;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coins)) {
-            stats.nTransactions++;
-            ss << key;
-            for (unsigned int i=0; i<coins.vout.size(); i++) {
-                const CTxOut &out = coins.vout[i];
-                if (!out.IsNull()) {
-                    stats.nTransactionOutputs++;
-                    ss << VARINT(i+1);
-                    ss << out;
-                    nTotalAmount += out.nValue;
-                }
-            }
+        COutPoint key;
+        Coin coin;
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            hasher.Add(key, coin);
             stats.nSerializedSize += 32 + pcursor->GetValueSize();
-            ss << VARINT(0);
         } else {
             return error("%s: unable to read value", __func__);
         }
         pcursor->Next();
     }
-    stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
+    hasher.Finish();
     return true;
 }
 
@@ -909,6 +892,242 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the unspent transaction output set at the current tip to a snapshot file for loadtxoutset.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"    (string, required) The file to write, relative to the data directory. It must not exist yet.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"path\": \"str\",         (string) The absolute path of the snapshot file\n"
+            "  \"base_hash\": \"hex\",    (string) The block the output set belongs to\n"
+            "  \"base_height\": n,      (numeric) The height of that block\n"
+            "  \"txouts\": n,           (numeric) The number of outputs written\n"
+            "  \"bytes\": n,            (numeric) The size of the snapshot file\n"
+            "  \"hash_serialized\": \"hash\" (string) The serialized hash, as gettxoutsetinfo reports it at base_hash\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    boost::filesystem::path pathTemp = path.string() + ".incomplete";
+    if (boost::filesystem::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    // The cursor reads a database snapshot, so the tip may move on while writing
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    CTxOutSetSnapshotHeader header;
+    {
+        LOCK(cs_main);
+        FlushStateToDisk();
+        pcursor.reset(pcoinsTip->Cursor());
+        const CBlockIndex* pindex = mapBlockIndex.find(pcursor->GetBestBlock())->second;
+        header = CTxOutSetSnapshotHeader(Params().MessageStart(), pindex->GetBlockHash(), pindex->nHeight, pindex->nChainTx);
+    }
+
+    CAutoFile fileout(fopen(pathTemp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to open " + pathTemp.string() + " for writing");
+    CCoinsStats stats;
+    stats.nHeight = header.nHeight;
+    try {
+        WriteTxOutSetSnapshot(fileout, header, pcursor.get(), stats);
+        FileCommit(fileout.Get());
+        fileout.fclose();
+    } catch (const std::exception& e) {
+        fileout.fclose();
+        boost::filesystem::remove(pathTemp);
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("Unable to write UTXO snapshot: %s", e.what()));
+    }
+    if (!RenameOver(pathTemp, path))
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to rename " + pathTemp.string() + " to " + path.string());
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("path", path.string()));
+    ret.push_back(Pair("base_hash", header.hashBlock.GetHex()));
+    ret.push_back(Pair("base_height", (int64_t)header.nHeight));
+    ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+    ret.push_back(Pair("bytes", (int64_t)boost::filesystem::file_size(path)));
+    ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
+    return ret;
+}
+
+UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            "loadtxoutset \"path\" ( \"hash_serialized\" )\n"
+            "\nReplaces the chain state by a snapshot written with dumptxoutset, skipping the validation of all blocks up to it.\n"
+            "The headers up to the snapshot block must be known and lead on from the current tip. Only pruned nodes can load\n"
+            "a snapshot, since the blocks below it are never downloaded; the wallet is not rescanned and the chain cannot\n"
+            "be reorganized below the snapshot block. The file is checked completely before the chain state is touched.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"             (string, required) The snapshot file, relative to the data directory\n"
+            "2. \"hash_serialized\"  (string, optional) The expected serialized hash of the output set, from a trusted source\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"base_hash\": \"hex\",    (string) The new tip\n"
+            "  \"base_height\": n,      (numeric) The height of the new tip\n"
+            "  \"txouts\": n,           (numeric) The number of outputs loaded\n"
+            "  \"hash_serialized\": \"hash\" (string) The serialized hash of the loaded output set\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    if (!fPruneMode)
+        throw JSONRPCError(RPC_MISC_ERROR, "Cannot load a UTXO snapshot because node is not in prune mode.");
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    CTxOutSetSnapshotHeader header;
+    CCoinsStats stats;
+    // Both passes read through this handle, so renaming another file over
+    // path in between cannot swap the snapshot
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unable to open " + path.string());
+    long nCoinsPos;
+    {
+        try {
+            filein >> header;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Unable to read UTXO snapshot header");
+        }
+        nCoinsPos = ftell(filein.Get());
+        if (!header.IsValid())
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Not a UTXO snapshot or unsupported version");
+        if (memcmp(header.pchMessageStart, Params().MessageStart(), sizeof(header.pchMessageStart)) != 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "UTXO snapshot is for a different network");
+
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(header.hashBlock);
+            if (mi == mapBlockIndex.end() || mi->second->nHeight != header.nHeight)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Snapshot block %s at height %d is not known", header.hashBlock.GetHex(), header.nHeight));
+            if (mi->second->nHeight <= chainActive.Height() || mi->second->GetAncestor(chainActive.Height()) != chainActive.Tip())
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Snapshot block does not extend the active chain");
+        }
+
+        // Read the whole file once without locks, so a damaged snapshot never reaches the database
+        try {
+            CTxOutSetSnapshotReader reader(filein, header, stats);
+            COutPoint outpoint;
+            Coin coin;
+            while (reader.Next(outpoint, coin))
+                boost::this_thread::interruption_point();
+        } catch (const std::ios_base::failure& e) {
+            throw JSONRPCError(RPC_DESERIALIZATION_ERROR, strprintf("Invalid UTXO snapshot: %s", e.what()));
+        }
+    }
+    if (request.params.size() > 1 && ParseHashV(request.params[1], "hash_serialized") != stats.hashSerialized)
+        throw JSONRPCError(RPC_VERIFY_ERROR, strprintf("UTXO snapshot hash_serialized is %s, expected %s", stats.hashSerialized.GetHex(), request.params[1].get_str()));
+
+    if (nCoinsPos < 0 || fseek(filein.Get(), nCoinsPos, SEEK_SET) != 0)
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to rewind " + path.string());
+
+    CValidationState state;
+    CBlockIndex* pindex;
+    CBlockIndex* pindexFork;
+    bool fInitialDownload;
+    {
+        LOCK(cs_main);
+        pindex = mapBlockIndex.find(header.hashBlock)->second;
+        pindexFork = chainActive.Tip();
+        CCoinsStats statsLoad;
+        CTxOutSetSnapshotReader reader(filein, header, statsLoad);
+        // Only commit the coins read again if they are the ones checked above
+        if (!ActivateTxOutSetSnapshot(state, Params(), pindex, header.nChainTx,
+                                      [&reader](COutPoint& outpoint, Coin& coin) { return reader.Next(outpoint, coin); },
+                                      [&statsLoad, &stats]() { return statsLoad.nTransactionOutputs == stats.nTransactionOutputs && statsLoad.hashSerialized == stats.hashSerialized; }))
+            throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+        fInitialDownload = IsInitialBlockDownload();
+    }
+    GetMainSignals().UpdatedBlockTip(pindex, pindexFork, fInitialDownload);
+    uiInterface.NotifyBlockTip(fInitialDownload, pindex);
+
+    // Connect whatever blocks above the snapshot are already there
+    ActivateBestChain(state, Params());
+    if (!state.IsValid())
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("base_hash", header.hashBlock.GetHex()));
+    ret.push_back(Pair("base_height", (int64_t)header.nHeight));
+    ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
+    ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
+    return ret;
+}
+
+static UniValue DBStatsToJSON(const CDBWrapper& db)
+{
+    const CDBOptions& dbOptions = db.GetDBOptions();
+    UniValue options(UniValue::VOBJ);
+    options.push_back(Pair("blocksize", (uint64_t)dbOptions.nBlockSize));
+    options.push_back(Pair("compression", dbOptions.fCompression));
+    options.push_back(Pair("bloombits", dbOptions.nBloomBits));
+    options.push_back(Pair("maxopenfiles", dbOptions.nMaxOpenFiles));
+    options.push_back(Pair("writebuffer", (uint64_t)db.GetWriteBufferSize()));
+    options.push_back(Pair("blockcache", (uint64_t)db.GetBlockCacheSize()));
+
+    UniValue levels(UniValue::VARR);
+    std::string strValue;
+    for (int nLevel = 0; db.GetProperty(strprintf("leveldb.num-files-at-level%d", nLevel), strValue); nLevel++)
+        levels.push_back(atoi(strValue));
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("options", options));
+    ret.push_back(Pair("approximate_size", db.GetApproximateSize()));
+    ret.push_back(Pair("files_per_level", levels));
+    if (db.GetProperty("leveldb.stats", strValue))
+        ret.push_back(Pair("stats", strValue));
+    return ret;
+}
+
+UniValue getdbstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns the tuning and LevelDB statistics of the chain state and block index databases.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {           (object) The chain state database\n"
+            "    \"options\": {\n"
+            "      \"blocksize\": n,        (numeric) Uncompressed bytes per table block\n"
+            "      \"compression\": true|false, (boolean) Whether table blocks are compressed\n"
+            "      \"bloombits\": n,        (numeric) Bloom filter bits per key, 0 for none\n"
+            "      \"maxopenfiles\": n,     (numeric) Table files kept open\n"
+            "      \"writebuffer\": n,      (numeric) Write buffer size in bytes\n"
+            "      \"blockcache\": n        (numeric) Block cache size in bytes\n"
+            "    },\n"
+            "    \"approximate_size\": n,   (numeric) Approximate size on disk in bytes\n"
+            "    \"files_per_level\": [n, ...], (array) Number of table files in each level\n"
+            "    \"stats\": \"str\"          (string) LevelDB's compaction statistics\n"
+            "  },\n"
+            "  \"blockindex\": { ... }     (object) The block index database, same fields\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    LOCK(cs_main);
+    UniValue ret(UniValue::VOBJ);
+    if (pcoinsdbview)
+        ret.push_back(Pair("chainstate", DBStatsToJSON(pcoinsdbview->GetDB())));
+    if (pblocktree)
+        ret.push_back(Pair("blockindex", DBStatsToJSON(*pblocktree)));
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -934,7 +1153,6 @@ UniValue gettxout(const JSONRPCRequest& request)
             "        ,...\n"
             "     ]\n"
             "  },\n"
-            "  \"version\" : n,            (numeric) The version\n"
             "  \"coinbase\" : true|false   (boolean) Coinbase or not\n"
             "}\n"
 
@@ -958,33 +1176,35 @@ UniValue gettxout(const JSONRPCRequest& request)
     if (request.params.size() > 2)
         fMempool = request.params[2].get_bool();
 
-    CCoins coins;
+    if (n < 0)
+        return NullUniValue;
+    COutPoint out(hash, n);
+
+    Coin coin;
     if (fMempool) {
         LOCK(mempool.cs);
         CCoinsViewMemPool view(pcoinsTip, mempool);
-        if (!view.GetCoins(hash, coins))
+        if (!view.GetCoin(out, coin) || mempool.isSpent(out)) { // TODO: filtering spent coins should be done by the CCoinsViewMemPool
             return NullUniValue;
-        mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
+        }
     } else {
-        if (!pcoinsTip->GetCoins(hash, coins))
+        if (!pcoinsTip->GetCoin(out, coin)) {
             return NullUniValue;
+        }
     }
-    if (n<0 || (unsigned int)n>=coins.vout.size() || coins.vout[n].IsNull())
-        return NullUniValue;
 
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *pindex = it->second;
     ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
-    if ((unsigned int)coins.nHeight == MEMPOOL_HEIGHT)
+    if (coin.nHeight == MEMPOOL_HEIGHT)
         ret.push_back(Pair("confirmations", 0));
     else
-        ret.push_back(Pair("confirmations", pindex->nHeight - coins.nHeight + 1));
-    ret.push_back(Pair("value", ValueFromAmount(coins.vout[n].nValue)));
+        ret.push_back(Pair("confirmations", (int64_t)(pindex->nHeight - coin.nHeight + 1)));
+    ret.push_back(Pair("value", ValueFromAmount(coin.out.nValue)));
     UniValue o(UniValue::VOBJ);
-    ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
+    ScriptPubKeyToJSON(coin.out.scriptPubKey, o, true);
     ret.push_back(Pair("scriptPubKey", o));
-    ret.push_back(Pair("version", coins.nVersion));
-    ret.push_back(Pair("coinbase", coins.fCoinBase));
+    ret.push_back(Pair("coinbase", (bool)coin.fCoinBase));
 
     return ret;
 }
@@ -1077,6 +1297,17 @@ void BIP9SoftForkDescPushBack(UniValue& bip9_softforks, const std::string &name,
         bip9_softforks.push_back(Pair(name, BIP9SoftForkDesc(consensusParams, id)));
 }
 
+static UniValue BlockPipelineStageDesc(const CBlockPipelineStageStats& stage)
+{
+    UniValue rv(UniValue::VOBJ);
+    rv.push_back(Pair("blocks", (uint64_t)stage.nBlocks));
+    rv.push_back(Pair("transactions", (uint64_t)stage.nTx));
+    rv.push_back(Pair("bytes", (uint64_t)stage.nBytes));
+    rv.push_back(Pair("seconds", stage.nMicros * 0.000001));
+    rv.push_back(Pair("blockspersec", stage.nMicros > 0 ? stage.nBlocks * 1000000.0 / stage.nMicros : 0.0));
+    return rv;
+}
+
 UniValue getblockchaininfo(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0)
@@ -1096,6 +1327,17 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"chainwork\": \"xxxx\"     (string) total amount of work in active chain, in hexadecimal\n"
             "  \"pruned\": xx,             (boolean) if the blocks are subject to pruning\n"
             "  \"pruneheight\": xxxxxx,    (numeric) lowest-height complete block stored\n"
+            "  \"blockpipeline\": {        (object, optional) work done loading assumed-valid blocks ahead of validation, if enabled\n"
+            "     \"read\" | \"check\" | \"connect\": {  (object) one stage: read from disk, context-free checks, UTXO application\n"
+            "        \"blocks\": xx,         (numeric) blocks handled by the stage\n"
+            "        \"transactions\": xx,   (numeric) transactions in those blocks\n"
+            "        \"bytes\": xx,          (numeric) serialized size of those blocks (read stage only)\n"
+            "        \"seconds\": xx.xx,     (numeric) time spent in the stage\n"
+            "        \"blockspersec\": xx.x  (numeric) stage throughput\n"
+            "     },\n"
+            "     \"pending\": xx,           (numeric) blocks queued or loaded but not connected yet\n"
+            "     \"stalls\": xx             (numeric) times validation had to wait for the pipeline\n"
+            "  },\n"
             "  \"softforks\": [            (array) status of softforks in progress\n"
             "     {\n"
             "        \"id\": \"xxxx\",        (string) name of softfork\n"
@@ -1154,6 +1396,17 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
 
         obj.push_back(Pair("pruneheight",        block->nHeight));
     }
+
+    if (pblockpipeline) {
+        CBlockPipelineStats stats = pblockpipeline->GetStats();
+        UniValue pipeline(UniValue::VOBJ);
+        pipeline.push_back(Pair("read", BlockPipelineStageDesc(stats.read)));
+        pipeline.push_back(Pair("check", BlockPipelineStageDesc(stats.check)));
+        pipeline.push_back(Pair("connect", BlockPipelineStageDesc(stats.connect)));
+        pipeline.push_back(Pair("pending", (uint64_t)stats.nPending));
+        pipeline.push_back(Pair("stalls", (uint64_t)stats.nStalls));
+        obj.push_back(Pair("blockpipeline", pipeline));
+    }
     return obj;
 }
 
@@ -1310,6 +1563,42 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getmempoolfeehistogram(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getmempoolfeehistogram\n"
+            "\nReturns the mempool transactions grouped by their own fee rate, including prioritisation.\n"
+            "Only buckets holding transactions are listed, lowest fee rate first.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"feerate\": x.xxxx,     (numeric) Lowest fee rate of the bucket in " + CURRENCY_UNIT + "/kB\n"
+            "    \"count\": xxxxx,        (numeric) Number of transactions\n"
+            "    \"size\": xxxxx,         (numeric) Sum of their virtual sizes\n"
+            "    \"fees\": x.xxxx         (numeric) Sum of their modified fees in " + CURRENCY_UNIT + "\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmempoolfeehistogram", "")
+            + HelpExampleRpc("getmempoolfeehistogram", "")
+        );
+
+    std::vector<FeeHistogramBucket> vHistogram = mempool.GetFeeHistogram();
+    UniValue ret(UniValue::VARR);
+    for (unsigned int i = 0; i < vHistogram.size(); i++) {
+        if (vHistogram[i].nCount == 0)
+            continue;
+        UniValue bucket(UniValue::VOBJ);
+        bucket.push_back(Pair("feerate", ValueFromAmount(FEE_HISTOGRAM_BOUNDS[i])));
+        bucket.push_back(Pair("count", (int64_t)vHistogram[i].nCount));
+        bucket.push_back(Pair("size", (int64_t)vHistogram[i].nSize));
+        bucket.push_back(Pair("fees", ValueFromAmount(vHistogram[i].nFees)));
+        ret.push_back(bucket);
+    }
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1426,6 +1715,7 @@ UniValue reconsiderblock(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafe argNames
   //  --------------------- ------------------------  -----------------------  ------ ----------
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true,  {"path"} },
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,  {} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
     { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
@@ -1433,14 +1723,17 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {} },
+    { "blockchain",         "getdbstats",             &getdbstats,             true,  {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    true,  {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
+    { "blockchain",         "getmempoolfeehistogram", &getmempoolfeehistogram, true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           false, {"path","hash_serialized"} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
 
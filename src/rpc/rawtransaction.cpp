@@ -283,9 +283,9 @@ UniValue gettxoutproof(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
         pblockindex = mapBlockIndex[hashBlock];
     } else {
-        CCoins coins;
-        if (pcoinsTip->GetCoins(oneTxid, coins) && coins.nHeight > 0 && coins.nHeight <= chainActive.Height())
-            pblockindex = chainActive[coins.nHeight];
+        const Coin& coin = AccessByTxid(*pcoinsTip, oneTxid);
+        if (!coin.IsSpent() && coin.nHeight > 0 && (int)coin.nHeight <= chainActive.Height())
+            pblockindex = chainActive[coin.nHeight];
     }
 
     if (pblockindex == NULL)
@@ -692,9 +692,7 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
         view.SetBackend(viewMempool); // temporarily switch cache backend to db+mempool view
 
         BOOST_FOREACH(const CTxIn& txin, mergedTx.vin) {
-            const uint256& prevHash = txin.prevout.hash;
-            CCoins coins;
-            view.AccessCoins(prevHash); // this is certainly allowed to fail
+            view.AccessCoin(txin.prevout); // Load entries from viewChain into view; can fail.
         }
 
         view.SetBackend(viewDummy); // switch back to avoid locking mempool for too long
@@ -745,24 +743,26 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
             if (nOut < 0)
                 throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "vout must be positive");
 
+            COutPoint out(txid, nOut);
             vector<unsigned char> pkData(ParseHexO(prevOut, "scriptPubKey"));
             CScript scriptPubKey(pkData.begin(), pkData.end());
 
             {
-                CCoinsModifier coins = view.ModifyCoins(txid);
-                if (coins->IsAvailable(nOut) && coins->vout[nOut].scriptPubKey != scriptPubKey) {
+                const Coin& coin = view.AccessCoin(out);
+                if (!coin.IsSpent() && coin.out.scriptPubKey != scriptPubKey) {
                     string err("Previous output scriptPubKey mismatch:\n");
-                    err = err + ScriptToAsmStr(coins->vout[nOut].scriptPubKey) + "\nvs:\n"+
+                    err = err + ScriptToAsmStr(coin.out.scriptPubKey) + "\nvs:\n"+
                         ScriptToAsmStr(scriptPubKey);
                     throw JSONRPCError(RPC_DESERIALIZATION_ERROR, err);
                 }
-                if ((unsigned int)nOut >= coins->vout.size())
-                    coins->vout.resize(nOut+1);
-                coins->vout[nOut].scriptPubKey = scriptPubKey;
-                coins->vout[nOut].nValue = 0;
+                Coin newcoin;
+                newcoin.out.scriptPubKey = scriptPubKey;
+                newcoin.out.nValue = 0;
                 if (prevOut.exists("amount")) {
-                    coins->vout[nOut].nValue = AmountFromValue(find_value(prevOut, "amount"));
+                    newcoin.out.nValue = AmountFromValue(find_value(prevOut, "amount"));
                 }
+                newcoin.nHeight = 1;
+                view.AddCoin(out, std::move(newcoin), true);
             }
 
             // if redeemScript given and not using the local wallet (private keys
@@ -820,13 +820,13 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
     // Sign what we can:
     for (unsigned int i = 0; i < mergedTx.vin.size(); i++) {
         CTxIn& txin = mergedTx.vin[i];
-        const CCoins* coins = view.AccessCoins(txin.prevout.hash);
-        if (coins == NULL || !coins->IsAvailable(txin.prevout.n)) {
+        const Coin& coin = view.AccessCoin(txin.prevout);
+        if (coin.IsSpent()) {
             TxInErrorToJSON(txin, vErrors, "Input not found or already spent");
             continue;
         }
-        const CScript& prevPubKey = coins->vout[txin.prevout.n].scriptPubKey;
-        const CAmount& amount = coins->vout[txin.prevout.n].nValue;
+        const CScript& prevPubKey = coin.out.scriptPubKey;
+        const CAmount& amount = coin.out.nValue;
 
         SignatureData sigdata;
         // Only sign SIGHASH_SINGLE if there's a corresponding output:
@@ -882,7 +882,6 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
             + HelpExampleRpc("sendrawtransaction", "\"signedhex\"")
         );
 
-    LOCK(cs_main);
     RPCTypeCheck(request.params, boost::assign::list_of(UniValue::VSTR)(UniValue::VBOOL));
 
     // parse hex string from parameter
@@ -897,12 +896,20 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
     if (request.params.size() > 1 && request.params[1].get_bool())
         nMaxRawTxFee = 0;
 
-    CCoinsViewCache &view = *pcoinsTip;
-    const CCoins* existingCoins = view.AccessCoins(hashTx);
-    bool fHaveMempool = mempool.exists(hashTx);
-    bool fHaveChain = existingCoins && existingCoins->nHeight < 1000000000;
+    bool fHaveChain = false;
+    bool fHaveMempool;
+    {
+        LOCK(cs_main);
+        CCoinsViewCache &view = *pcoinsTip;
+        for (size_t o = 0; !fHaveChain && o < tx->vout.size(); o++) {
+            const Coin& existingCoin = view.AccessCoin(COutPoint(hashTx, o));
+            fHaveChain = !existingCoin.IsSpent();
+        }
+        fHaveMempool = mempool.exists(hashTx);
+    }
     if (!fHaveMempool && !fHaveChain) {
-        // push to local node and sync with wallets
+        // push to local node and sync with wallets; scripts are checked
+        // without cs_main, so concurrent calls verify in parallel
         CValidationState state;
         bool fMissingInputs;
         if (!AcceptToMemoryPool(mempool, state, std::move(tx), fLimitFree, &fMissingInputs, NULL, false, nMaxRawTxFee)) {
@@ -929,6 +936,157 @@ UniValue sendrawtransaction(const JSONRPCRequest& request)
     return hashTx.GetHex();
 }
 
+UniValue sendrawtransactions(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            "sendrawtransactions [\"hexstring\",...] ( allowhighfees )\n"
+            "\nSubmits a batch of raw transactions (serialized, hex-encoded) to local node and network.\n"
+            "Transactions may spend outputs of other transactions in the batch, in any order; parents are\n"
+            "submitted before their children. Scripts of the whole batch are checked on the script verification threads.\n"
+            "\nArguments:\n"
+            "1. \"hexstrings\"     (array, required) The hex strings of the raw transactions\n"
+            "     [\n"
+            "       \"hexstring\"  (string) A raw transaction\n"
+            "       ,...\n"
+            "     ]\n"
+            "2. allowhighfees    (boolean, optional, default=false) Allow high fees\n"
+            "\nResult:\n"
+            "[                   (array) One object per hex string, in the same order\n"
+            "  {\n"
+            "    \"txid\": \"hex\",          (string) The transaction hash, missing if the hex string did not decode\n"
+            "    \"accepted\": true|false, (boolean) Whether the transaction is in the mempool\n"
+            "    \"error\": \"str\"          (string) Why it was not accepted, only present if accepted is false\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("sendrawtransactions", "\"[\\\"signedhex\\\",\\\"signedhex\\\"]\"")
+            + HelpExampleRpc("sendrawtransactions", "[\"signedhex\",\"signedhex\"]")
+        );
+
+    RPCTypeCheck(request.params, boost::assign::list_of(UniValue::VARR)(UniValue::VBOOL));
+
+    const UniValue& hexstrings = request.params[0].get_array();
+    CAmount nMaxRawTxFee = maxTxFee;
+    if (request.params.size() > 1 && request.params[1].get_bool())
+        nMaxRawTxFee = 0;
+
+    const size_t nTx = hexstrings.size();
+    std::vector<CTransactionRef> vtx(nTx);
+    std::vector<std::string> vError(nTx);
+    std::map<uint256, size_t> mapIndex;
+    for (size_t i = 0; i < nTx; i++) {
+        CMutableTransaction mtx;
+        if (!DecodeHexTx(mtx, hexstrings[i].get_str())) {
+            vError[i] = "TX decode failed";
+            continue;
+        }
+        vtx[i] = MakeTransactionRef(std::move(mtx));
+        if (!mapIndex.emplace(vtx[i]->GetHash(), i).second)
+            vError[i] = "duplicate transaction in batch";
+    }
+
+    // Order the batch so that parents come before their children
+    std::vector<std::vector<size_t> > vParents(nTx), vChildren(nTx);
+    std::vector<size_t> vWaiting(nTx, 0);
+    std::deque<size_t> queue;
+    for (size_t i = 0; i < nTx; i++) {
+        if (!vError[i].empty())
+            continue;
+        std::set<size_t> setParents;
+        for (const CTxIn& txin : vtx[i]->vin) {
+            auto it = mapIndex.find(txin.prevout.hash);
+            if (it != mapIndex.end() && vError[it->second].empty())
+                setParents.insert(it->second);
+        }
+        for (size_t nParent : setParents) {
+            vParents[i].push_back(nParent);
+            vChildren[nParent].push_back(i);
+        }
+        vWaiting[i] = setParents.size();
+        if (setParents.empty())
+            queue.push_back(i);
+    }
+    std::vector<size_t> vOrder;
+    std::vector<CTransactionRef> vtxOrdered;
+    while (!queue.empty()) {
+        size_t i = queue.front();
+        queue.pop_front();
+        vOrder.push_back(i);
+        vtxOrdered.push_back(vtx[i]);
+        for (size_t nChild : vChildren[i]) {
+            if (--vWaiting[nChild] == 0)
+                queue.push_back(nChild);
+        }
+    }
+
+    PreverifyMemPoolScripts(mempool, vtxOrdered);
+
+    // Submit one by one; the signatures are cached now, so this is mostly lookups
+    std::vector<bool> vAccepted(nTx, false);
+    for (size_t i : vOrder) {
+        const CTransactionRef& tx = vtx[i];
+        bool fParentRejected = false;
+        for (size_t nParent : vParents[i])
+            fParentRejected |= !vAccepted[nParent];
+        if (fParentRejected) {
+            vError[i] = "parent transaction in batch not accepted";
+            continue;
+        }
+
+        bool fHaveChain = false;
+        bool fHaveMempool;
+        {
+            LOCK(cs_main);
+            for (size_t o = 0; !fHaveChain && o < tx->vout.size(); o++)
+                fHaveChain = !pcoinsTip->AccessCoin(COutPoint(tx->GetHash(), o)).IsSpent();
+            fHaveMempool = mempool.exists(tx->GetHash());
+        }
+        if (fHaveChain) {
+            vError[i] = "transaction already in block chain";
+            continue;
+        }
+        if (!fHaveMempool) {
+            CValidationState state;
+            bool fMissingInputs;
+            if (!AcceptToMemoryPool(mempool, state, tx, false, &fMissingInputs, NULL, false, nMaxRawTxFee)) {
+                if (state.IsInvalid())
+                    vError[i] = strprintf("%i: %s", state.GetRejectCode(), state.GetRejectReason());
+                else if (fMissingInputs)
+                    vError[i] = "Missing inputs";
+                else
+                    vError[i] = state.GetRejectReason();
+                continue;
+            }
+        }
+        vAccepted[i] = true;
+    }
+
+    std::vector<CInv> vInv;
+    UniValue result(UniValue::VARR);
+    for (size_t i = 0; i < nTx; i++) {
+        UniValue entry(UniValue::VOBJ);
+        if (vtx[i])
+            entry.push_back(Pair("txid", vtx[i]->GetHash().GetHex()));
+        entry.push_back(Pair("accepted", (bool)vAccepted[i]));
+        if (vAccepted[i])
+            vInv.push_back(CInv(MSG_TX, vtx[i]->GetHash()));
+        else
+            entry.push_back(Pair("error", vError[i]));
+        result.push_back(entry);
+    }
+
+    if (g_connman && !vInv.empty()) {
+        g_connman->ForEachNode([&vInv](CNode* pnode)
+        {
+            for (const CInv& inv : vInv)
+                pnode->PushInventory(inv);
+        });
+    }
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
@@ -937,6 +1095,7 @@ static const CRPCCommand commands[] =
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true,  {"hexstring"} },
     { "rawtransactions",    "decodescript",           &decodescript,           true,  {"hexstring"} },
     { "rawtransactions",    "sendrawtransaction",     &sendrawtransaction,     false, {"hexstring","allowhighfees"} },
+    { "rawtransactions",    "sendrawtransactions",    &sendrawtransactions,    false, {"hexstrings","allowhighfees"} },
     { "rawtransactions",    "signrawtransaction",     &signrawtransaction,     false, {"hexstring","prevtxs","privkeys","sighashtype"} }, /* uses wallet if enabled */
 
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true,  {"txids", "blockhash"} },
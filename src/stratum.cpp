@@ -0,0 +1,611 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "arith_uint256.h"
+#include "base58.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "crypto/common.h"
+#include "miner.h"
+#include "netbase.h"
+#include "pow.h"
+#include "random.h"
+#include "streams.h"
+#include "sync.h"
+#include "timedata.h"
+#include "txmempool.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <set>
+
+#include <boost/bind/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+/** Longest request line accepted from a miner */
+static const size_t MAX_STRATUM_LINE = 16384;
+/** Jobs kept around for late submissions; all of them are dropped on a new tip */
+static const size_t MAX_STRATUM_JOBS = 16;
+
+CStratumJob::CStratumJob(std::shared_ptr<const CBlockTemplate> pblocktemplateIn, int nHeightIn) :
+    pblocktemplate(pblocktemplateIn), nHeight(nHeightIn)
+{
+    const CBlock& block = pblocktemplate->block;
+
+    // Same scriptSig layout as IncrementExtraNonce, with room for both extranonces
+    CMutableTransaction coinbase(*block.vtx[0]);
+    CScript scriptSig = CScript() << nHeight;
+    const size_t nHeightSize = scriptSig.size();
+    scriptSig << std::vector<unsigned char>(STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE);
+    coinbase.vin[0].scriptSig = scriptSig + COINBASE_FLAGS;
+    assert(coinbase.vin[0].scriptSig.size() <= 100);
+
+    // Miners hash the coinbase for its txid, so it goes out without witness
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << coinbase;
+    // version, input count, prevout, script length, height push, extranonce push opcode
+    const size_t nOffset = 4 + GetSizeOfCompactSize(1) + 36 + GetSizeOfCompactSize(coinbase.vin[0].scriptSig.size()) + nHeightSize + 1;
+    vCoinbase1.assign(ss.begin(), ss.begin() + nOffset);
+    vCoinbase2.assign(ss.begin() + nOffset + STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE, ss.end());
+
+    vMerkleBranch = BlockMerkleBranch(block, 0);
+}
+
+CBlock CStratumJob::BuildBlock(const std::vector<unsigned char>& vExtraNonce, uint32_t nTime, uint32_t nNonce) const
+{
+    CBlock block(pblocktemplate->block);
+    CMutableTransaction coinbase(*block.vtx[0]);
+    coinbase.vin[0].scriptSig = (CScript() << nHeight << vExtraNonce) + COINBASE_FLAGS;
+    block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+    block.hashMerkleRoot = ComputeMerkleRootFromBranch(block.vtx[0]->GetHash(), vMerkleBranch, 0);
+    block.nTime = nTime;
+    block.nNonce = nNonce;
+    return block;
+}
+
+namespace {
+
+class StratumServer;
+
+/** A connected miner */
+struct StratumClient
+{
+    StratumServer* server;
+    struct bufferevent* bev;
+    CService addr;
+    std::vector<unsigned char> vExtraNonce1;
+    bool fSubscribed;
+    bool fAuthorized;
+};
+
+/** A job together with the valid shares already submitted for it */
+struct StratumJobEntry
+{
+    std::shared_ptr<const CStratumJob> job;
+    std::set<uint256> setSubmitted;
+};
+
+/**
+ * Line-based JSON-RPC server speaking the usual mining.subscribe,
+ * mining.authorize, mining.notify and mining.submit methods. Everything runs
+ * on the event loop thread; the only outside entry point is the block tip
+ * notification, which just wakes the loop up.
+ */
+class StratumServer
+{
+private:
+    const CChainParams& chainparams;
+    const CScript scriptPayout;
+    const int64_t nDifficulty;
+    const std::vector<CSubNet> vAllowSubnets;
+    CBlockTemplateCache templateCache;
+
+    struct event_base* base;
+    std::vector<struct evconnlistener*> vListeners;
+    //! Looks for a new template once a second, and right away on a new tip
+    struct event* evUpdate;
+
+    std::set<StratumClient*> setClients;
+    uint32_t nNextExtraNonce1;
+
+    std::map<std::string, StratumJobEntry> mapJobs;
+    std::deque<std::string> vJobIds;
+    uint32_t nNextJobId;
+
+    static void accept_cb(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* sa, int socklen, void* ctx);
+    static void read_cb(struct bufferevent* bev, void* ctx);
+    static void event_cb(struct bufferevent* bev, short what, void* ctx);
+    static void update_cb(evutil_socket_t fd, short what, void* ctx);
+
+    bool ClientAllowed(const CNetAddr& netaddr) const;
+    void Disconnect(StratumClient* client);
+    void Send(StratumClient* client, const UniValue& message);
+    bool HandleLine(StratumClient* client, const std::string& line);
+    UniValue HandleSubmit(StratumClient* client, const UniValue& params);
+    void UpdateJob();
+    UniValue NotifyMessage(const std::string& strJobId, bool fClean) const;
+
+public:
+    StratumServer(const CChainParams& chainparams, struct event_base* base, const CScript& scriptPayout, int64_t nDifficulty, const std::vector<CSubNet>& vAllowSubnets);
+    ~StratumServer();
+
+    bool Bind(const std::string& strHost, int nPort);
+    void Wake();
+};
+
+UniValue StratumError(int nCode, const std::string& strMessage)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back(nCode);
+    error.push_back(strMessage);
+    error.push_back(NullUniValue);
+    return error;
+}
+
+/** Hex of a 32-bit header field, most significant byte first */
+std::string HexBE32(uint32_t n)
+{
+    unsigned char buf[4];
+    WriteBE32(buf, n);
+    return HexStr(buf, buf + 4);
+}
+
+bool ParseHexBE32(const UniValue& value, uint32_t& n)
+{
+    if (!value.isStr() || value.get_str().size() != 8 || !IsHex(value.get_str()))
+        return false;
+    std::vector<unsigned char> v = ParseHex(value.get_str());
+    n = ReadBE32(v.data());
+    return true;
+}
+
+/** Previous block hash in stratum's word order: each 32-bit word byte swapped */
+std::string StratumPrevHash(const uint256& hash)
+{
+    std::vector<unsigned char> v(hash.begin(), hash.end());
+    for (size_t i = 0; i < v.size(); i += 4)
+        std::reverse(v.begin() + i, v.begin() + i + 4);
+    return HexStr(v);
+}
+
+StratumServer::StratumServer(const CChainParams& chainparamsIn, struct event_base* baseIn, const CScript& scriptPayoutIn, int64_t nDifficultyIn, const std::vector<CSubNet>& vAllowSubnetsIn) :
+    chainparams(chainparamsIn), scriptPayout(scriptPayoutIn), nDifficulty(nDifficultyIn), vAllowSubnets(vAllowSubnetsIn),
+    templateCache(chainparamsIn, mempool), base(baseIn), nNextJobId(0)
+{
+    nNextExtraNonce1 = GetRand(std::numeric_limits<uint32_t>::max());
+    evUpdate = event_new(base, -1, EV_PERSIST, update_cb, this);
+    struct timeval tv = {1, 0};
+    event_add(evUpdate, &tv);
+}
+
+StratumServer::~StratumServer()
+{
+    while (!setClients.empty())
+        Disconnect(*setClients.begin());
+    for (struct evconnlistener* listener : vListeners)
+        evconnlistener_free(listener);
+    event_free(evUpdate);
+}
+
+bool StratumServer::Bind(const std::string& strHost, int nPort)
+{
+    CService service;
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!Lookup(strHost.c_str(), service, nPort, false) || !service.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        LogPrintf("stratum: cannot resolve bind address %s\n", strHost);
+        return false;
+    }
+    struct evconnlistener* listener = evconnlistener_new_bind(base, accept_cb, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len);
+    if (!listener) {
+        LogPrintf("stratum: binding on address %s failed\n", service.ToString());
+        return false;
+    }
+    LogPrintf("stratum: listening on %s\n", service.ToString());
+    vListeners.push_back(listener);
+    return true;
+}
+
+void StratumServer::Wake()
+{
+    event_active(evUpdate, 0, 0);
+}
+
+bool StratumServer::ClientAllowed(const CNetAddr& netaddr) const
+{
+    if (!netaddr.IsValid())
+        return false;
+    for (const CSubNet& subnet : vAllowSubnets)
+        if (subnet.Match(netaddr))
+            return true;
+    return false;
+}
+
+void StratumServer::accept_cb(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* sa, int socklen, void* ctx)
+{
+    StratumServer* self = (StratumServer*)ctx;
+    CService addr;
+    addr.SetSockAddr(sa);
+    if (!self->ClientAllowed(addr)) {
+        LogPrint("stratum", "Rejecting connection from %s\n", addr.ToString());
+        evutil_closesocket(fd);
+        return;
+    }
+
+    StratumClient* client = new StratumClient();
+    client->server = self;
+    client->addr = addr;
+    client->vExtraNonce1.resize(STRATUM_EXTRANONCE1_SIZE);
+    WriteBE32(client->vExtraNonce1.data(), self->nNextExtraNonce1++);
+    client->fSubscribed = false;
+    client->fAuthorized = false;
+    client->bev = bufferevent_socket_new(self->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!client->bev) {
+        evutil_closesocket(fd);
+        delete client;
+        return;
+    }
+    bufferevent_setcb(client->bev, read_cb, NULL, event_cb, client);
+    bufferevent_enable(client->bev, EV_READ | EV_WRITE);
+    self->setClients.insert(client);
+    LogPrint("stratum", "New connection from %s\n", addr.ToString());
+}
+
+void StratumServer::read_cb(struct bufferevent* bev, void* ctx)
+{
+    StratumClient* client = (StratumClient*)ctx;
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t n_read_out = 0;
+    char* line;
+    while ((line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF)) != NULL) {
+        std::string s(line, n_read_out);
+        free(line);
+        if (s.empty())
+            continue;
+        if (!client->server->HandleLine(client, s)) {
+            LogPrint("stratum", "Disconnecting %s after a malformed request\n", client->addr.ToString());
+            client->server->Disconnect(client);
+            return;
+        }
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE) {
+        LogPrint("stratum", "Disconnecting %s because MAX_STRATUM_LINE was exceeded\n", client->addr.ToString());
+        client->server->Disconnect(client);
+    }
+}
+
+void StratumServer::event_cb(struct bufferevent* bev, short what, void* ctx)
+{
+    StratumClient* client = (StratumClient*)ctx;
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        LogPrint("stratum", "Connection from %s closed\n", client->addr.ToString());
+        client->server->Disconnect(client);
+    }
+}
+
+void StratumServer::update_cb(evutil_socket_t fd, short what, void* ctx)
+{
+    ((StratumServer*)ctx)->UpdateJob();
+}
+
+void StratumServer::Disconnect(StratumClient* client)
+{
+    bufferevent_free(client->bev);
+    setClients.erase(client);
+    delete client;
+}
+
+void StratumServer::Send(StratumClient* client, const UniValue& message)
+{
+    std::string s = message.write() + "\n";
+    bufferevent_write(client->bev, s.data(), s.size());
+}
+
+UniValue StratumServer::NotifyMessage(const std::string& strJobId, bool fClean) const
+{
+    const CStratumJob& job = *mapJobs.at(strJobId).job;
+    const CBlock& block = job.pblocktemplate->block;
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : job.vMerkleBranch)
+        branch.push_back(HexStr(hash.begin(), hash.end()));
+
+    UniValue params(UniValue::VARR);
+    params.push_back(strJobId);
+    params.push_back(StratumPrevHash(block.hashPrevBlock));
+    params.push_back(HexStr(job.vCoinbase1));
+    params.push_back(HexStr(job.vCoinbase2));
+    params.push_back(branch);
+    params.push_back(HexBE32(block.nVersion));
+    params.push_back(HexBE32(block.nBits));
+    params.push_back(HexBE32(block.nTime));
+    params.push_back(fClean);
+
+    UniValue message(UniValue::VOBJ);
+    message.push_back(Pair("id", NullUniValue));
+    message.push_back(Pair("method", "mining.notify"));
+    message.push_back(Pair("params", params));
+    return message;
+}
+
+void StratumServer::UpdateJob()
+{
+    if (IsInitialBlockDownload())
+        return;
+
+    std::shared_ptr<const CBlockTemplate> pblocktemplate;
+    int nHeight;
+    {
+        LOCK(cs_main);
+        const bool fNewTip = vJobIds.empty() || mapJobs.at(vJobIds.back()).job->pblocktemplate->block.hashPrevBlock != chainActive.Tip()->GetBlockHash();
+        // Mempool changes go out at the pace templates go stale; a new tip goes out at once
+        if (!fNewTip && !templateCache.IsStale(mapJobs.at(vJobIds.back()).job->pblocktemplate))
+            return;
+        pblocktemplate = templateCache.Get(scriptPayout, true);
+        nHeight = chainActive.Height() + 1;
+    }
+    if (!pblocktemplate)
+        return;
+
+    const bool fClean = vJobIds.empty() || mapJobs.at(vJobIds.back()).job->pblocktemplate->block.hashPrevBlock != pblocktemplate->block.hashPrevBlock;
+    if (fClean) {
+        mapJobs.clear();
+        vJobIds.clear();
+    }
+    const std::string strJobId = strprintf("%x", nNextJobId++);
+    mapJobs[strJobId].job = std::make_shared<const CStratumJob>(pblocktemplate, nHeight);
+    vJobIds.push_back(strJobId);
+    while (vJobIds.size() > MAX_STRATUM_JOBS) {
+        mapJobs.erase(vJobIds.front());
+        vJobIds.pop_front();
+    }
+
+    UniValue message = NotifyMessage(strJobId, fClean);
+    for (StratumClient* client : setClients) {
+        if (client->fSubscribed)
+            Send(client, message);
+    }
+    LogPrint("stratum", "New job %s at height %d with %u transactions, sent to %u miners\n", strJobId, nHeight, pblocktemplate->block.vtx.size(), setClients.size());
+}
+
+bool StratumServer::HandleLine(StratumClient* client, const std::string& line)
+{
+    UniValue request;
+    if (!request.read(line) || !request.isObject())
+        return false;
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr())
+        return false;
+
+    UniValue result = NullUniValue;
+    UniValue error = NullUniValue;
+    bool fSendJob = false;
+    if (method.get_str() == "mining.subscribe") {
+        const std::string strExtraNonce1 = HexStr(client->vExtraNonce1);
+        UniValue subscriptions(UniValue::VARR);
+        for (const char* name : {"mining.set_difficulty", "mining.notify"}) {
+            UniValue subscription(UniValue::VARR);
+            subscription.push_back(name);
+            subscription.push_back(strExtraNonce1);
+            subscriptions.push_back(subscription);
+        }
+        result = UniValue(UniValue::VARR);
+        result.push_back(subscriptions);
+        result.push_back(strExtraNonce1);
+        result.push_back((int)STRATUM_EXTRANONCE2_SIZE);
+        client->fSubscribed = true;
+        fSendJob = true;
+    } else if (method.get_str() == "mining.authorize") {
+        // Accounting is the pool's business; any worker name will do
+        client->fAuthorized = true;
+        result = UniValue(true);
+    } else if (method.get_str() == "mining.submit") {
+        if (!params.isArray())
+            return false;
+        error = HandleSubmit(client, params);
+        if (error.isNull())
+            result = UniValue(true);
+    } else {
+        error = StratumError(20, "Method not found");
+    }
+
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("result", result));
+    reply.push_back(Pair("error", error));
+    Send(client, reply);
+
+    if (fSendJob) {
+        UniValue difficulty(UniValue::VOBJ);
+        UniValue difficultyParams(UniValue::VARR);
+        difficultyParams.push_back(nDifficulty);
+        difficulty.push_back(Pair("id", NullUniValue));
+        difficulty.push_back(Pair("method", "mining.set_difficulty"));
+        difficulty.push_back(Pair("params", difficultyParams));
+        Send(client, difficulty);
+        if (!vJobIds.empty())
+            Send(client, NotifyMessage(vJobIds.back(), true));
+    }
+    return true;
+}
+
+UniValue StratumServer::HandleSubmit(StratumClient* client, const UniValue& params)
+{
+    if (!client->fSubscribed)
+        return StratumError(25, "Not subscribed");
+    if (!client->fAuthorized)
+        return StratumError(24, "Unauthorized worker");
+    if (params.size() < 5 || !params[1].isStr() || !params[2].isStr())
+        return StratumError(20, "Invalid parameters");
+
+    std::map<std::string, StratumJobEntry>::iterator it = mapJobs.find(params[1].get_str());
+    if (it == mapJobs.end())
+        return StratumError(21, "Job not found");
+    const CStratumJob& job = *it->second.job;
+
+    std::vector<unsigned char> vExtraNonce = client->vExtraNonce1;
+    const std::string& strExtraNonce2 = params[2].get_str();
+    if (strExtraNonce2.size() != 2 * STRATUM_EXTRANONCE2_SIZE || !IsHex(strExtraNonce2))
+        return StratumError(20, "Invalid extranonce2");
+    std::vector<unsigned char> vExtraNonce2 = ParseHex(strExtraNonce2);
+    vExtraNonce.insert(vExtraNonce.end(), vExtraNonce2.begin(), vExtraNonce2.end());
+
+    uint32_t nTime, nNonce;
+    if (!ParseHexBE32(params[3], nTime) || !ParseHexBE32(params[4], nNonce))
+        return StratumError(20, "Invalid ntime or nonce");
+    // Same future limit as ContextualCheckBlockHeader
+    if (nTime < job.pblocktemplate->block.nTime || nTime > GetAdjustedTime() + 2 * 60 * 60)
+        return StratumError(20, "ntime out of range");
+
+    CBlock block = job.BuildBlock(vExtraNonce, nTime, nNonce);
+    const Consensus::Params& consensus = chainparams.GetConsensus(job.nHeight);
+    const uint256 hashPoW = block.GetPoWHash();
+    const bool fBlock = CheckProofOfWork(hashPoW, block.nBits, consensus);
+    if (!fBlock && UintToArith256(hashPoW) > UintToArith256(consensus.powLimit) / nDifficulty)
+        return StratumError(23, "Low difficulty share");
+
+    // Only valid shares are remembered, so junk submissions cannot grow the set
+    if (!it->second.setSubmitted.insert(block.GetHash()).second)
+        return StratumError(22, "Duplicate share");
+
+    if (fBlock) {
+        bool fNewBlock = false;
+        const bool fAccepted = ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block), true, &fNewBlock);
+        LogPrintf("stratum: block %s at height %d from %s %s\n", block.GetHash().ToString(), job.nHeight, client->addr.ToString(), fAccepted ? "accepted" : "rejected");
+        if (!fAccepted)
+            return StratumError(20, "Block rejected");
+    }
+    return NullUniValue;
+}
+
+//! Event loop of the stratum server thread
+struct event_base* stratumBase = 0;
+StratumServer* stratumServer = 0;
+boost::thread stratumThread;
+
+void StratumThread()
+{
+    event_base_dispatch(stratumBase);
+}
+
+void StratumBlockTip(bool fInitialDownload, const CBlockIndex* pindex)
+{
+    if (!fInitialDownload && stratumServer)
+        stratumServer->Wake();
+}
+
+} // anon namespace
+
+bool StartStratumServer(const CChainParams& chainparams)
+{
+    if (!GetBoolArg("-stratum", DEFAULT_STRATUM))
+        return true;
+    assert(!stratumBase);
+
+    CBitcoinAddress address(GetArg("-stratumaddress", ""));
+    if (!address.IsValid())
+        return InitError(_("-stratum requires a valid -stratumaddress to pay block rewards to"));
+    const int64_t nDifficulty = GetArg("-stratumdifficulty", DEFAULT_STRATUM_DIFFICULTY);
+    if (nDifficulty < 1)
+        return InitError(strprintf(_("Invalid -stratumdifficulty: %d"), nDifficulty));
+
+    // Same access rules as the RPC server: loopback only unless told otherwise
+    std::vector<CSubNet> vAllowSubnets;
+    CNetAddr localv4;
+    CNetAddr localv6;
+    LookupHost("127.0.0.1", localv4, false);
+    LookupHost("::1", localv6, false);
+    vAllowSubnets.push_back(CSubNet(localv4, 8));
+    vAllowSubnets.push_back(CSubNet(localv6));
+    if (mapMultiArgs.count("-stratumallowip")) {
+        for (const std::string& strAllow : mapMultiArgs.at("-stratumallowip")) {
+            CSubNet subnet;
+            LookupSubNet(strAllow.c_str(), subnet);
+            if (!subnet.IsValid())
+                return InitError(strprintf(_("Invalid -stratumallowip subnet specification: %s"), strAllow));
+            vAllowSubnets.push_back(subnet);
+        }
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    stratumBase = event_base_new();
+    if (!stratumBase) {
+        LogPrintf("stratum: Unable to create event_base\n");
+        return false;
+    }
+    stratumServer = new StratumServer(chainparams, stratumBase, GetScriptForDestination(address.Get()), nDifficulty, vAllowSubnets);
+
+    const int nPort = GetArg("-stratumport", DEFAULT_STRATUM_PORT);
+    bool fBound = false;
+    if (!IsArgSet("-stratumallowip")) {
+        fBound |= stratumServer->Bind("::1", nPort);
+        fBound |= stratumServer->Bind("127.0.0.1", nPort);
+        if (IsArgSet("-stratumbind"))
+            LogPrintf("WARNING: option -stratumbind was ignored because -stratumallowip was not specified, refusing to allow everyone to connect\n");
+    } else if (mapMultiArgs.count("-stratumbind")) {
+        for (const std::string& strBind : mapMultiArgs.at("-stratumbind")) {
+            int port = nPort;
+            std::string host;
+            SplitHostPort(strBind, port, host);
+            fBound |= stratumServer->Bind(host, port);
+        }
+    } else {
+        fBound |= stratumServer->Bind("::", nPort);
+        fBound |= stratumServer->Bind("0.0.0.0", nPort);
+    }
+    if (!fBound) {
+        delete stratumServer;
+        stratumServer = 0;
+        event_base_free(stratumBase);
+        stratumBase = 0;
+        return InitError(_("Unable to bind any endpoint for the stratum server"));
+    }
+
+    uiInterface.NotifyBlockTip.connect(StratumBlockTip);
+    stratumServer->Wake();
+    stratumThread = boost::thread(boost::bind(&TraceThread<void (*)()>, "stratum", &StratumThread));
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (stratumBase) {
+        LogPrintf("stratum: Thread interrupt\n");
+        event_base_loopbreak(stratumBase);
+    }
+}
+
+void StopStratumServer()
+{
+    if (stratumBase) {
+        uiInterface.NotifyBlockTip.disconnect(StratumBlockTip);
+        stratumThread.join();
+        delete stratumServer;
+        stratumServer = 0;
+        event_base_free(stratumBase);
+        stratumBase = 0;
+    }
+}
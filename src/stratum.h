@@ -0,0 +1,59 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Stratum-style work server for pools and mining proxies.
+ */
+#ifndef BITCOIN_STRATUM_H
+#define BITCOIN_STRATUM_H
+
+#include "primitives/block.h"
+#include "uint256.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class CChainParams;
+struct CBlockTemplate;
+
+static const bool DEFAULT_STRATUM = false;
+static const unsigned short DEFAULT_STRATUM_PORT = 3333;
+static const int64_t DEFAULT_STRATUM_DIFFICULTY = 1;
+/** Bytes of extranonce chosen by the server, one value per connection */
+static const unsigned int STRATUM_EXTRANONCE1_SIZE = 4;
+/** Bytes of extranonce left to the miner */
+static const unsigned int STRATUM_EXTRANONCE2_SIZE = 4;
+
+/**
+ * A block template as handed to stratum miners: the coinbase transaction is
+ * split around an extranonce of STRATUM_EXTRANONCE1_SIZE +
+ * STRATUM_EXTRANONCE2_SIZE bytes pushed right after the height in its
+ * scriptSig, and the merkle branch links the coinbase to the header.
+ */
+class CStratumJob
+{
+public:
+    std::shared_ptr<const CBlockTemplate> pblocktemplate;
+    int nHeight;
+    //! Serialized coinbase (without witness) up to the extranonce
+    std::vector<unsigned char> vCoinbase1;
+    //! Serialized coinbase (without witness) after the extranonce
+    std::vector<unsigned char> vCoinbase2;
+    std::vector<uint256> vMerkleBranch;
+
+    CStratumJob(std::shared_ptr<const CBlockTemplate> pblocktemplateIn, int nHeightIn);
+
+    /** Assemble the block for a solution; vExtraNonce is extranonce1 followed by extranonce2 */
+    CBlock BuildBlock(const std::vector<unsigned char>& vExtraNonce, uint32_t nTime, uint32_t nNonce) const;
+};
+
+/** Start the stratum server if -stratum is set. Returns false on a fatal configuration or bind error. */
+bool StartStratumServer(const CChainParams& chainparams);
+/** Interrupt the stratum server thread */
+void InterruptStratumServer();
+/** Stop the stratum server */
+void StopStratumServer();
+
+#endif // BITCOIN_STRATUM_H
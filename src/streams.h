@@ -138,6 +138,69 @@ private:
     size_t nPos;
 };
 
+/* Minimal stream for reading from an existing, immutable range of bytes,
+ * such as a memory-mapped block file
+ *
+ * The referenced memory must stay valid while the reader is in use
+ */
+class CMemoryReader
+{
+ public:
+
+/*
+ * @param[in]  nTypeIn Serialization Type
+ * @param[in]  nVersionIn Serialization Version (including any flags)
+ * @param[in]  pchDataIn  Start of the bytes to read
+ * @param[in]  nSizeIn Number of bytes that may be read
+*/
+    CMemoryReader(int nTypeIn, int nVersionIn, const unsigned char* pchDataIn, size_t nSizeIn) : nType(nTypeIn), nVersion(nVersionIn), pchData(pchDataIn), nSize(nSizeIn), nPos(0)
+    {
+    }
+    void read(char* pch, size_t nRead)
+    {
+        if (nRead > nSize - nPos)
+            throw std::ios_base::failure("CMemoryReader::read(): end of data");
+        memcpy(pch, pchData + nPos, nRead);
+        nPos += nRead;
+    }
+    void ignore(size_t nSkip)
+    {
+        if (nSkip > nSize - nPos)
+            throw std::ios_base::failure("CMemoryReader::ignore(): end of data");
+        nPos += nSkip;
+    }
+    template<typename T>
+    CMemoryReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+    int GetVersion() const
+    {
+        return nVersion;
+    }
+    int GetType() const
+    {
+        return nType;
+    }
+    //! Number of bytes not read yet
+    size_t size() const
+    {
+        return nSize - nPos;
+    }
+    bool empty() const
+    {
+        return nPos == nSize;
+    }
+private:
+    const int nType;
+    const int nVersion;
+    const unsigned char* pchData;
+    const size_t nSize;
+    size_t nPos;
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -366,6 +366,12 @@ BOOST_AUTO_TEST_CASE( divide )
     BOOST_CHECK(R2L / MaxL == ZeroL);
     BOOST_CHECK(MaxL / R2L == 1);
     BOOST_CHECK_THROW(R2L / ZeroL, uint_error);
+    // Single word divisors
+    arith_uint256 D3L("ECD75171");
+    arith_uint256 Q1L = R1L / D3L;
+    BOOST_CHECK(Q1L * D3L <= R1L && R1L - Q1L * D3L < D3L);
+    BOOST_CHECK(MaxL / 3 * 3 == MaxL);
+    BOOST_CHECK((MaxL / 0xFFFFFFFFULL).ToString() == "0000000100000001000000010000000100000001000000010000000100000001");
 }
 
 
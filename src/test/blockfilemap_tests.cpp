@@ -0,0 +1,100 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "clientversion.h"
+#include "streams.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilemap_tests, TestChain240Setup)
+
+static std::vector<unsigned char> SerializeBlock(const CBlock& block)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+BOOST_AUTO_TEST_CASE(blockfilemap_read)
+{
+    std::vector<CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        for (int nHeight = 0; nHeight <= chainActive.Height(); nHeight += 17)
+            vIndex.push_back(chainActive[nHeight]);
+        vIndex.push_back(chainActive.Tip());
+    }
+
+    // Read every block through the file and through the mapping
+    blockfilemaps.SetMaxMaps(0);
+    std::vector<std::vector<unsigned char> > vFromFile;
+    for (const CBlockIndex* pindex : vIndex) {
+        BOOST_CHECK(!blockfilemaps.Get(pindex->GetBlockPos().nFile, 0));
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus(pindex->nHeight)));
+        vFromFile.push_back(SerializeBlock(block));
+    }
+
+    blockfilemaps.SetMaxMaps(DEFAULT_BLOCKFILE_MAPS ? DEFAULT_BLOCKFILE_MAPS : 1);
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        const CBlockIndex* pindex = vIndex[i];
+        std::shared_ptr<const CBlockFileMap> map = blockfilemaps.Get(pindex->GetBlockPos().nFile, pindex->GetBlockPos().nPos);
+        BOOST_REQUIRE(map);
+        BOOST_CHECK(map->size() > pindex->GetBlockPos().nPos);
+        CBlock block;
+        BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus(pindex->nHeight)));
+        BOOST_CHECK(block.GetHash() == pindex->GetBlockHash());
+        BOOST_CHECK(SerializeBlock(block) == vFromFile[i]);
+    }
+
+    // A mapping outlives its cache entry, and a mapping that is too short is not returned
+    int nFile = vIndex[0]->GetBlockPos().nFile;
+    std::shared_ptr<const CBlockFileMap> map = blockfilemaps.Get(nFile, 0);
+    BOOST_REQUIRE(map);
+    blockfilemaps.Invalidate(nFile);
+    BOOST_CHECK(map->data()[vIndex[0]->GetBlockPos().nPos - 8] == Params().MessageStart()[0]);
+    BOOST_CHECK(!blockfilemaps.Get(nFile, map->size() + 1));
+    BOOST_CHECK(!blockfilemaps.Get(nFile + 1000, 0));
+
+    blockfilemaps.SetMaxMaps(0);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilemap_read_raw)
+{
+    LOCK(cs_main);
+    std::vector<CBlockIndex*> vIndex;
+    for (int nHeight = 0; nHeight <= chainActive.Height(); nHeight += 29)
+        vIndex.push_back(chainActive[nHeight]);
+    vIndex.push_back(chainActive.Tip());
+
+    // The stored bytes are the serialized block, with and without the mapping
+    for (int nMaps = 0; nMaps <= 1; nMaps++) {
+        blockfilemaps.SetMaxMaps(nMaps);
+        for (const CBlockIndex* pindex : vIndex) {
+            CBlock block;
+            BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus(pindex->nHeight)));
+            std::vector<unsigned char> vchRaw;
+            BOOST_REQUIRE(ReadRawBlockFromDisk(vchRaw, pindex));
+            BOOST_CHECK(vchRaw == SerializeBlock(block));
+            BOOST_CHECK(IsRawBlockSerialization(pindex, 0, Params().GetConsensus(pindex->nHeight)));
+        }
+    }
+
+    // Bytes that do not hash to the index entry are refused
+    uint256 hashOther = vIndex[1]->GetBlockHash();
+    CBlockIndex index(*vIndex[0]);
+    index.phashBlock = &hashOther;
+    std::vector<unsigned char> vchRaw;
+    BOOST_CHECK(!ReadRawBlockFromDisk(vchRaw, &index));
+
+    blockfilemaps.SetMaxMaps(0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
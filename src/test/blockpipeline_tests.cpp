@@ -0,0 +1,69 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockpipeline.h"
+#include "chain.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockpipeline_tests, TestChain240Setup)
+
+BOOST_AUTO_TEST_CASE(blockpipeline_load)
+{
+    CBlockPipeline pipeline(8);
+    {
+        LOCK(cs_main);
+        // Only the first eight fit
+        for (int nHeight = 1; nHeight <= 12; nHeight++)
+            pipeline.Enqueue(chainActive[nHeight]);
+        // Queueing a block twice is a no-op
+        pipeline.Enqueue(chainActive[1]);
+    }
+    BOOST_CHECK_EQUAL(pipeline.GetStats().nPending, 8);
+
+    for (int nHeight = 1; nHeight <= 8; nHeight++) {
+        std::shared_ptr<const CBlock> pblock = pipeline.Take(chainActive[nHeight]->GetBlockHash());
+        BOOST_REQUIRE(pblock);
+        BOOST_CHECK(pblock->GetHash() == chainActive[nHeight]->GetBlockHash());
+        BOOST_CHECK(pblock->fChecked);
+    }
+    // Not queued, so the caller has to read it itself
+    BOOST_CHECK(!pipeline.Take(chainActive[9]->GetBlockHash()));
+
+    CBlockPipelineStats stats = pipeline.GetStats();
+    BOOST_CHECK_EQUAL(stats.nPending, 0);
+    BOOST_CHECK_EQUAL(stats.read.nBlocks, 8);
+    BOOST_CHECK_EQUAL(stats.check.nBlocks, 8);
+    BOOST_CHECK(stats.read.nTx >= 8);
+    BOOST_CHECK(stats.read.nBytes > 0);
+}
+
+BOOST_AUTO_TEST_CASE(blockpipeline_skip_and_clear)
+{
+    CBlockPipeline pipeline(16);
+    {
+        LOCK(cs_main);
+        for (int nHeight = 1; nHeight <= 10; nHeight++)
+            pipeline.Enqueue(chainActive[nHeight]);
+    }
+    // Taking a later block drops the ones queued before it
+    std::shared_ptr<const CBlock> pblock = pipeline.Take(chainActive[5]->GetBlockHash());
+    BOOST_REQUIRE(pblock);
+    BOOST_CHECK(pblock->GetHash() == chainActive[5]->GetBlockHash());
+    BOOST_CHECK_EQUAL(pipeline.GetStats().nPending, 5);
+    BOOST_CHECK(!pipeline.Take(chainActive[3]->GetBlockHash()));
+
+    pipeline.Clear();
+    BOOST_CHECK_EQUAL(pipeline.GetStats().nPending, 0);
+    BOOST_CHECK(!pipeline.Take(chainActive[6]->GetBlockHash()));
+
+    pipeline.RecordConnect(3, 1500);
+    BOOST_CHECK_EQUAL(pipeline.GetStats().connect.nBlocks, 1);
+    BOOST_CHECK_EQUAL(pipeline.GetStats().connect.nTx, 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -210,6 +210,41 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
 }
 
 
+/** Test that checks are all run exactly once when many more workers than
+ * cores take from and steal out of each other's deques, both for a block
+ * added in one go and for one added in many small batches.
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_ManyThreads)
+{
+    auto queue = std::unique_ptr<Correct_Queue>(new Correct_Queue {QUEUE_BATCH_SIZE});
+    boost::thread_group tg;
+    for (auto x = 0; x < MAX_SCRIPTCHECK_THREADS - 1; ++x) {
+       tg.create_thread([&]{queue->Thread();});
+    }
+    for (size_t nRound = 0; nRound < 50; ++nRound) {
+        size_t total = 1 + GetRand(20000);
+        const size_t expected = total;
+        FakeCheckCheckCompletion::n_calls = 0;
+        CCheckQueueControl<FakeCheckCheckCompletion> control(queue.get());
+        std::vector<FakeCheckCheckCompletion> vChecks;
+        if (nRound % 2) {
+            vChecks.resize(total);
+            control.Add(vChecks);
+        } else {
+            while (total) {
+                vChecks.resize(std::min(total, (size_t) GetRand(10)));
+                total -= vChecks.size();
+                control.Add(vChecks);
+            }
+        }
+        BOOST_REQUIRE(control.Wait());
+        BOOST_REQUIRE_EQUAL(FakeCheckCheckCompletion::n_calls, expected);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+
 /** Test that failing checks are caught */
 BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
 {
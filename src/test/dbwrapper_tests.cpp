@@ -318,6 +318,38 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
-
+BOOST_AUTO_TEST_CASE(dbwrapper_options)
+{
+    CDBOptions dbOptions;
+    std::string strError;
+    BOOST_CHECK(dbOptions.Parse("", strError));
+    BOOST_CHECK_EQUAL(dbOptions.ToString(), CDBOptions().ToString());
+    BOOST_CHECK(dbOptions.Parse("blocksize=16384,compression=1,bloombits=0,maxopenfiles=500,writebuffer=40", strError));
+    BOOST_CHECK_EQUAL(dbOptions.nBlockSize, 16384U);
+    BOOST_CHECK(dbOptions.fCompression);
+    BOOST_CHECK_EQUAL(dbOptions.nBloomBits, 0);
+    BOOST_CHECK_EQUAL(dbOptions.nMaxOpenFiles, 500);
+    BOOST_CHECK_EQUAL(dbOptions.nWriteBufferPercent, 40);
+    BOOST_CHECK(!dbOptions.Parse("bloombits=33", strError));
+    BOOST_CHECK(!dbOptions.Parse("writebuffer=50", strError));
+    BOOST_CHECK(!dbOptions.Parse("cachesize=1", strError));
+    BOOST_CHECK(!dbOptions.Parse("blocksize", strError));
+
+    // A database with the overrides works and reports its tuning and statistics
+    dbOptions.Parse("blocksize=16384,compression=1,bloombits=0,maxopenfiles=500,writebuffer=40", strError);
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, false, dbOptions);
+    BOOST_CHECK_EQUAL(dbw.GetWriteBufferSize(), (1 << 20) / 100 * 40);
+    BOOST_CHECK_EQUAL(dbw.GetBlockCacheSize(), (1 << 20) - 2 * dbw.GetWriteBufferSize());
+    for (int i = 0; i < 1000; i++)
+        BOOST_CHECK(dbw.Write(i, GetRandHash()));
+    uint256 res;
+    BOOST_CHECK(dbw.Read(500, res));
+    std::string strStats;
+    BOOST_CHECK(dbw.GetProperty("leveldb.stats", strStats));
+    BOOST_CHECK(strStats.find("Compactions") != std::string::npos);
+    BOOST_CHECK(dbw.GetProperty("leveldb.num-files-at-level0", strStats));
+    BOOST_CHECK(!dbw.GetProperty("leveldb.nonexistent", strStats));
+}
 
 BOOST_AUTO_TEST_SUITE_END()
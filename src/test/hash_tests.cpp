@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/x11.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
@@ -128,6 +129,47 @@ BOOST_AUTO_TEST_CASE(siphash)
     tx.nVersion = 1;
     ss << tx;
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
+
+    // SipHashUint256Extra must match the generic hasher fed the same bytes
+    for (uint32_t extra : {0u, 1u, 0x12345678u, 0xffffffffu}) {
+        uint256 val = ss.GetHash();
+        unsigned char buf[4] = {(unsigned char)extra, (unsigned char)(extra >> 8), (unsigned char)(extra >> 16), (unsigned char)(extra >> 24)};
+        CSipHasher hasher4(1, 2);
+        hasher4.Write(val.GetUint64(0)).Write(val.GetUint64(1)).Write(val.GetUint64(2)).Write(val.GetUint64(3)).Write(buf, 4);
+        BOOST_CHECK_EQUAL(SipHashUint256Extra(1, 2, val, extra), hasher4.Finalize());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x11_multi)
+{
+    // Every kernel combination must agree with the reference Hash11, for
+    // batches that do not divide evenly into the kernel width and for inputs
+    // other than 80-byte headers.
+    const size_t nInputs = 37;
+    const size_t lens[] = {80, 64, 0};
+    for (size_t nLen : lens) {
+        std::vector<unsigned char> input(nInputs * nLen);
+        for (size_t i = 0; i < input.size(); i++)
+            input[i] = (unsigned char)(i * 7 + (i >> 8));
+        std::vector<uint256> expected(nInputs);
+        for (size_t i = 0; i < nInputs; i++)
+            expected[i] = Hash11(input.begin() + i * nLen, input.begin() + (i + 1) * nLen);
+
+        const int lanes[] = {1, 4, 8, 16};
+        for (int fAESNI = 0; fAESNI <= 1; fAESNI++) {
+            for (int nLanes : lanes) {
+                if (!x11_multi_select(nLanes, fAESNI))
+                    continue;
+                for (size_t n : {(size_t)1, (size_t)5, nInputs}) {
+                    std::vector<uint256> output(n);
+                    x11_hash_multi(input.data(), nLen, n, output[0].begin());
+                    for (size_t i = 0; i < n; i++)
+                        BOOST_CHECK_EQUAL(output[i].ToString(), expected[i].ToString());
+                }
+            }
+        }
+    }
+    x11_multi_detect();
 }
 
 BOOST_AUTO_TEST_SUITE_END()
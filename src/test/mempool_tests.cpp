@@ -3,12 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "policy/policy.h"
+#include "random.h"
 #include "txmempool.h"
 #include "util.h"
 
 #include "test/test_bitcoin.h"
 
 #include <boost/test/unit_test.hpp>
+#include <algorithm>
 #include <list>
 #include <vector>
 
@@ -584,4 +586,142 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolChainRemovalTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // txRoot funds a chain of 20 transactions and, through its second
+    // output, txJoin, which also spends the fifth transaction of the chain
+    CMutableTransaction txRoot = CMutableTransaction();
+    txRoot.vout.resize(2);
+    txRoot.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txRoot.vout[0].nValue = 10 * COIN;
+    txRoot.vout[1] = txRoot.vout[0];
+    std::vector<CTransactionRef> vChain;
+    CMutableTransaction tx = CMutableTransaction();
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(txRoot.GetHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    for (int i = 0; i < 20; i++) {
+        tx.vout[0].nValue = 10 * COIN - (i + 1) * 1000;
+        vChain.push_back(MakeTransactionRef(tx));
+        tx.vin[0].prevout = COutPoint(vChain.back()->GetHash(), 0);
+    }
+    CMutableTransaction txJoin = CMutableTransaction();
+    txJoin.vin.resize(2);
+    txJoin.vin[0].prevout = COutPoint(txRoot.GetHash(), 1);
+    txJoin.vin[1].prevout = COutPoint(vChain[4]->GetHash(), 0);
+    txJoin.vout.resize(1);
+    txJoin.vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    txJoin.vout[0].nValue = COIN;
+
+    pool.addUnchecked(txRoot.GetHash(), entry.Fee(1000LL).FromTx(txRoot));
+    for (const CTransactionRef& ptx : vChain)
+        pool.addUnchecked(ptx->GetHash(), entry.Fee(1000LL).FromTx(*ptx));
+    pool.addUnchecked(txJoin.GetHash(), entry.Fee(1000LL).FromTx(txJoin));
+    BOOST_CHECK_EQUAL(pool.size(), 22);
+
+    CTxMemPool::txiter itRoot = pool.mapTx.find(txRoot.GetHash());
+    BOOST_CHECK_EQUAL(itRoot->GetCountWithDescendants(), 22);
+    BOOST_CHECK_EQUAL(itRoot->GetModFeesWithDescendants(), 22000);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(vChain[19]->GetHash())->GetCountWithAncestors(), 21);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txJoin.GetHash())->GetCountWithAncestors(), 7);
+
+    {
+        LOCK(pool.cs);
+        CTxMemPool::setEntries setDescendants;
+        pool.CalculateDescendants(pool.mapTx.find(vChain[1]->GetHash()), setDescendants);
+        BOOST_CHECK_EQUAL(setDescendants.size(), 20);
+    }
+
+    // Evicting the chain from its second transaction leaves the root
+    // counting only itself and the first
+    pool.removeRecursive(*vChain[1]);
+    BOOST_CHECK_EQUAL(pool.size(), 2);
+    BOOST_CHECK_EQUAL(itRoot->GetCountWithDescendants(), 2);
+    BOOST_CHECK_EQUAL(itRoot->GetSizeWithDescendants(), itRoot->GetTxSize() + pool.mapTx.find(vChain[0]->GetHash())->GetTxSize());
+    BOOST_CHECK_EQUAL(itRoot->GetModFeesWithDescendants(), 2000);
+    BOOST_CHECK(pool.GetMemPoolChildren(pool.mapTx.find(vChain[0]->GetHash())).empty());
+    BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(itRoot).size(), 1);
+
+    // Confirming the root and first transaction updates what is left
+    for (size_t i = 1; i < vChain.size(); i++)
+        pool.addUnchecked(vChain[i]->GetHash(), entry.Fee(1000LL).FromTx(*vChain[i]));
+    pool.addUnchecked(txJoin.GetHash(), entry.Fee(1000LL).FromTx(txJoin));
+    std::vector<CTransactionRef> vtx;
+    vtx.push_back(MakeTransactionRef(txRoot));
+    vtx.push_back(vChain[0]);
+    pool.removeForBlock(vtx, 1);
+    BOOST_CHECK_EQUAL(pool.size(), 20);
+    CTxMemPool::txiter itFirst = pool.mapTx.find(vChain[1]->GetHash());
+    BOOST_CHECK_EQUAL(itFirst->GetCountWithAncestors(), 1);
+    BOOST_CHECK_EQUAL(itFirst->GetCountWithDescendants(), 20);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(vChain[19]->GetHash())->GetCountWithAncestors(), 19);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(vChain[19]->GetHash())->GetModFeesWithAncestors(), 19000);
+    BOOST_CHECK_EQUAL(pool.mapTx.find(txJoin.GetHash())->GetCountWithAncestors(), 5);
+    BOOST_CHECK(pool.GetMemPoolParents(pool.mapTx.find(txJoin.GetHash())).size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolFeeHistogramTest)
+{
+    CTxMemPool pool(CFeeRate(0));
+    TestMemPoolEntryHelper entry;
+
+    // Independent transactions paying 1000 to 50000 satoshis for the same size
+    std::vector<CMutableTransaction> vtx(50);
+    for (int i = 0; i < 50; i++) {
+        vtx[i].vin.resize(1);
+        vtx[i].vin[0].scriptSig = CScript() << OP_11;
+        vtx[i].vin[0].prevout = COutPoint(GetRandHash(), 0);
+        vtx[i].vout.resize(1);
+        vtx[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        vtx[i].vout[0].nValue = 10 * COIN;
+        pool.addUnchecked(vtx[i].GetHash(), entry.Fee((i + 1) * 1000LL).FromTx(vtx[i]));
+    }
+    unsigned int nSize = GetVirtualTransactionSize(vtx[0]);
+
+    std::vector<FeeHistogramBucket> vHistogram = pool.GetFeeHistogram();
+    BOOST_CHECK_EQUAL(vHistogram.size(), FEE_HISTOGRAM_BUCKETS);
+    uint64_t nCount = 0;
+    CAmount nFees = 0;
+    for (unsigned int i = 0; i < vHistogram.size(); i++) {
+        nCount += vHistogram[i].nCount;
+        nFees += vHistogram[i].nFees;
+        BOOST_CHECK_EQUAL(vHistogram[i].nSize, vHistogram[i].nCount * nSize);
+    }
+    BOOST_CHECK_EQUAL(nCount, 50);
+    BOOST_CHECK_EQUAL(nFees, 50 * 51 / 2 * 1000LL);
+
+    // Prioritising moves a transaction into the bucket of its modified fee rate
+    CFeeRate feeRate(1000, nSize);
+    unsigned int nBucket = std::upper_bound(FEE_HISTOGRAM_BOUNDS, FEE_HISTOGRAM_BOUNDS + FEE_HISTOGRAM_BUCKETS, feeRate.GetFeePerK()) - FEE_HISTOGRAM_BOUNDS - 1;
+    uint64_t nCountBefore = pool.GetFeeHistogram()[nBucket].nCount;
+    double dPriorityDelta = 0;
+    pool.PrioritiseTransaction(vtx[0].GetHash(), vtx[0].GetHash().ToString(), dPriorityDelta, 100 * COIN);
+    BOOST_CHECK_EQUAL(pool.GetFeeHistogram()[nBucket].nCount, nCountBefore - 1);
+    BOOST_CHECK_EQUAL(pool.GetFeeHistogram()[FEE_HISTOGRAM_BUCKETS - 1].nCount, 1);
+
+    // Trimming evicts the lowest fee transactions, and only as many as needed
+    size_t nLimit = pool.DynamicMemoryUsage() / 2;
+    pool.TrimToSize(nLimit);
+    BOOST_CHECK(pool.DynamicMemoryUsage() <= nLimit);
+    BOOST_CHECK(pool.exists(vtx[0].GetHash()));
+    int nFirstKept = 1;
+    while (!pool.exists(vtx[nFirstKept].GetHash()))
+        nFirstKept++;
+    BOOST_CHECK(nFirstKept > 1);
+    for (int i = nFirstKept; i < 50; i++)
+        BOOST_CHECK(pool.exists(vtx[i].GetHash()));
+    pool.addUnchecked(vtx[nFirstKept - 1].GetHash(), entry.Fee(nFirstKept * 1000LL).FromTx(vtx[nFirstKept - 1]));
+    BOOST_CHECK(pool.DynamicMemoryUsage() > nLimit);
+
+    nCount = 0;
+    vHistogram = pool.GetFeeHistogram();
+    for (unsigned int i = 0; i < vHistogram.size(); i++)
+        nCount += vHistogram[i].nCount;
+    BOOST_CHECK_EQUAL(nCount, pool.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,7 +10,9 @@
 #include "validation.h"
 #include "miner.h"
 #include "policy/policy.h"
+#include "pow.h"
 #include "pubkey.h"
+#include "script/interpreter.h"
 #include "script/standard.h"
 #include "txmempool.h"
 #include "uint256.h"
@@ -596,4 +598,121 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(nonce_search)
+{
+    const Consensus::Params& params = Params(CBaseChainParams::REGTEST).GetConsensus(0);
+    CBlock block;
+    block.nVersion = 1;
+    block.nTime = 1800000000; // scrypt era
+    block.nBits = 0x207fffff;
+    block.nNonce = 0;
+
+    CNonceSearch search(2);
+    uint64_t nMaxTries = 1000;
+    BOOST_CHECK(search.Solve(block, params, 1000, nMaxTries) == CNonceSearch::NONCE_FOUND);
+    BOOST_CHECK(CheckProofOfWork(block.GetPoWHash(), block.nBits, params));
+    BOOST_CHECK(nMaxTries < 1000);
+    // The lowest solution wins, whichever thread found it
+    uint32_t nSolution = block.nNonce;
+    for (block.nNonce = 0; block.nNonce < nSolution; block.nNonce++)
+        BOOST_CHECK(!CheckProofOfWork(block.GetPoWHash(), block.nBits, params));
+
+    // A target far below the limit is not met by any of a handful of nonces
+    block.nBits = 0x1e0fffff;
+    block.nNonce = 0;
+    nMaxTries = 20;
+    BOOST_CHECK(search.Solve(block, params, 10, nMaxTries) == CNonceSearch::NONCE_RANGE_EXHAUSTED);
+    BOOST_CHECK_EQUAL(block.nNonce, 10);
+    BOOST_CHECK_EQUAL(nMaxTries, 10);
+    BOOST_CHECK(search.Solve(block, params, 100, nMaxTries) == CNonceSearch::NONCE_TRIES_EXHAUSTED);
+    BOOST_CHECK_EQUAL(block.nNonce, 20);
+    BOOST_CHECK_EQUAL(nMaxTries, 0);
+    BOOST_CHECK(GetGenerateHashRate() > 0);
+}
+
+BOOST_FIXTURE_TEST_CASE(mining_service, TestChain240Setup)
+{
+    boost::shared_ptr<CReserveScript> coinbaseScript(new CReserveScript());
+    coinbaseScript->reserveScript = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    auto height = [] { LOCK(cs_main); return chainActive.Height(); };
+    int nHeightStart = height();
+
+    CMiningService service(Params());
+    BOOST_CHECK(!service.IsRunning());
+    service.Start(coinbaseScript, 2);
+    BOOST_CHECK_EQUAL(service.GetThreadCount(), 2);
+    // The service rebuilds its template on every new tip, so it keeps extending the chain
+    for (int i = 0; i < 600 && height() < nHeightStart + 3; i++)
+        MilliSleep(100);
+    // A stop from another thread at the same time waits for the same shutdown
+    std::thread threadStop([&service]() { service.Stop(); });
+    service.Stop();
+    threadStop.join();
+    BOOST_CHECK(!service.IsRunning());
+    BOOST_CHECK(height() >= nHeightStart + 3);
+}
+
+BOOST_FIXTURE_TEST_CASE(block_template_cache, TestChain240Setup)
+{
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+    CBlockTemplateCache cache(Params(), mempool);
+    CScript scriptPubKey = CScript() << OP_TRUE;
+    std::shared_ptr<const CBlockTemplate> pblocktemplate = cache.Get(scriptPubKey, false);
+    BOOST_REQUIRE(pblocktemplate);
+    BOOST_CHECK(!cache.IsStale(pblocktemplate));
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 1);
+    CAmount nSubsidy = pblocktemplate->block.vtx[0]->vout[0].nValue;
+
+    // Spend the first coinbase
+    const CAmount nFee = CENT;
+    CMutableTransaction spend;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(coinbaseTxns[0].GetHash(), 0);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = coinbaseTxns[0].vout[0].nValue - nFee;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(coinbaseTxns[0].vout[0].scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    TestMemPoolEntryHelper entry;
+    CTransaction tx(spend);
+    mempool.addUnchecked(tx.GetHash(), entry.Fee(nFee).SpendsCoinbase(true).FromTx(tx));
+
+    // Mempool changes only make the template stale after MINING_TEMPLATE_REFRESH seconds
+    BOOST_CHECK(!cache.IsStale(pblocktemplate));
+    BOOST_CHECK(cache.Get(scriptPubKey, false) == pblocktemplate);
+    nTime += MINING_TEMPLATE_REFRESH + 1;
+    SetMockTime(nTime);
+    BOOST_CHECK(cache.IsStale(pblocktemplate));
+
+    // The new transaction is appended to a fresh copy; the old template is untouched
+    std::shared_ptr<const CBlockTemplate> pupdated = cache.Get(scriptPubKey, false);
+    BOOST_REQUIRE(pupdated);
+    BOOST_CHECK(!cache.IsStale(pupdated));
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 1);
+    BOOST_REQUIRE_EQUAL(pupdated->block.vtx.size(), 2);
+    BOOST_CHECK(pupdated->block.vtx[1]->GetHash() == tx.GetHash());
+    BOOST_CHECK_EQUAL(pupdated->block.vtx[0]->vout[0].nValue, nSubsidy + nFee);
+    BOOST_CHECK_EQUAL(pupdated->vTxFees[0], -nFee);
+    BOOST_CHECK(pupdated->nBlockWeight > pblocktemplate->nBlockWeight);
+
+    // Removing it again restores the original contents
+    mempool.removeRecursive(tx);
+    BOOST_CHECK(!cache.IsStale(pupdated));
+    nTime += MINING_TEMPLATE_REFRESH + 1;
+    SetMockTime(nTime);
+    BOOST_CHECK(cache.IsStale(pupdated));
+    std::shared_ptr<const CBlockTemplate> premoved = cache.Get(scriptPubKey, false);
+    BOOST_REQUIRE(premoved);
+    BOOST_CHECK_EQUAL(premoved->block.vtx.size(), 1);
+    BOOST_CHECK_EQUAL(premoved->block.vtx[0]->vout[0].nValue, nSubsidy);
+    BOOST_CHECK_EQUAL(premoved->vTxFees[0], 0);
+    BOOST_CHECK_EQUAL(premoved->nBlockWeight, pblocktemplate->nBlockWeight);
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -94,4 +94,46 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/* Retargets read their window from a per-height cache, which has to follow the branch being asked about */
+BOOST_AUTO_TEST_CASE(retarget_window_reorg)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const Consensus::Params& params = Params().GetConsensus(0);
+    const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
+
+    // Two branches that share their first nFork blocks, forking inside the
+    // KimotoGravityWell window but below the DarkGravityWave one. The same
+    // blocks without a hash cannot be cached and serve as the reference.
+    const int nBlocks = 2000, nFork = 1700;
+    std::vector<uint256> hashes[2];
+    std::vector<CBlockIndex> blocks[2], uncached[2];
+    for (int b = 0; b < 2; b++) {
+        hashes[b].resize(nBlocks);
+        blocks[b].resize(nBlocks);
+        uncached[b].resize(nBlocks);
+        int64_t nTime = 1400000000;
+        for (int i = 0; i < nBlocks; i++) {
+            const int nSeed = (i < nFork ? 0 : b + 1) * nBlocks + i;
+            nTime += (nSeed * 7919) % 193 - 16;
+            hashes[b][i] = ArithToUint256(arith_uint256(nSeed + 1));
+            blocks[b][i].phashBlock = &hashes[b][i];
+            for (std::vector<CBlockIndex>* chain : {&blocks[b], &uncached[b]}) {
+                CBlockIndex& index = (*chain)[i];
+                index.pprev = i ? &(*chain)[i - 1] : NULL;
+                index.nHeight = i;
+                index.nTime = nTime;
+                index.nBits = arith_uint256(bnPowLimit >> (i / 100)).GetCompact();
+            }
+        }
+    }
+
+    // Alternate between the branches to make the cache rewrite its entries above the fork
+    for (int i = 0; i < nBlocks; i++) {
+        for (int b = 0; b < 2; b++) {
+            BOOST_CHECK_EQUAL(KimotoGravityWell(&blocks[b][i], NULL, params), KimotoGravityWell(&uncached[b][i], NULL, params));
+            BOOST_CHECK_EQUAL(DarkGravityWave(&blocks[b][i], NULL, params), DarkGravityWave(&uncached[b][i], NULL, params));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,7 +6,10 @@
 #include "rpc/client.h"
 
 #include "base58.h"
+#include "core_io.h"
 #include "netbase.h"
+#include "txmempool.h"
+#include "validation.h"
 
 #include "test/test_bitcoin.h"
 
@@ -364,4 +367,39 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_FIXTURE_TEST_CASE(rpc_sendrawtransactions, TestChain240Setup)
+{
+    CMutableTransaction parent = SpendToKey(coinbaseKey, COutPoint(coinbaseTxns[0].GetHash(), 0), 11 * CENT);
+    CMutableTransaction child = SpendToKey(coinbaseKey, COutPoint(parent.GetHash(), 0), 10 * CENT);
+    CMutableTransaction invalid = SpendToKey(coinbaseKey, COutPoint(coinbaseTxns[1].GetHash(), 0), 11 * CENT, false);
+    CMutableTransaction invalidChild = SpendToKey(coinbaseKey, COutPoint(invalid.GetHash(), 0), 10 * CENT);
+
+    // Children first: the batch is put in dependency order before submission
+    std::string strBatch = "[\"" + EncodeHexTx(child) + "\",\"" + EncodeHexTx(invalidChild) + "\",\"" + EncodeHexTx(parent) + "\",\"" +
+                           EncodeHexTx(invalid) + "\",\"00\",\"" + EncodeHexTx(parent) + "\"]";
+    UniValue r;
+    BOOST_CHECK_NO_THROW(r = CallRPC("sendrawtransactions " + strBatch + " true"));
+    BOOST_REQUIRE_EQUAL(r.size(), 6);
+    BOOST_CHECK_EQUAL(find_value(r[0].get_obj(), "txid").get_str(), child.GetHash().GetHex());
+    BOOST_CHECK(find_value(r[0].get_obj(), "accepted").get_bool());
+    BOOST_CHECK(!find_value(r[1].get_obj(), "accepted").get_bool());
+    BOOST_CHECK_EQUAL(find_value(r[1].get_obj(), "error").get_str(), "parent transaction in batch not accepted");
+    BOOST_CHECK(find_value(r[2].get_obj(), "accepted").get_bool());
+    BOOST_CHECK(!find_value(r[3].get_obj(), "accepted").get_bool());
+    BOOST_CHECK(find_value(r[3].get_obj(), "error").get_str().find("mandatory-script-verify-flag-failed") != std::string::npos);
+    BOOST_CHECK(find_value(r[4].get_obj(), "txid").isNull());
+    BOOST_CHECK_EQUAL(find_value(r[4].get_obj(), "error").get_str(), "TX decode failed");
+    BOOST_CHECK_EQUAL(find_value(r[5].get_obj(), "error").get_str(), "duplicate transaction in batch");
+
+    BOOST_CHECK_EQUAL(mempool.size(), 2U);
+    BOOST_CHECK(mempool.exists(parent.GetHash()));
+    BOOST_CHECK(mempool.exists(child.GetHash()));
+
+    // Resubmitting reports the transactions as accepted again
+    BOOST_CHECK_NO_THROW(r = CallRPC("sendrawtransactions [\"" + EncodeHexTx(parent) + "\"]"));
+    BOOST_CHECK(find_value(r[0].get_obj(), "accepted").get_bool());
+    BOOST_CHECK_THROW(CallRPC("sendrawtransactions \"" + EncodeHexTx(parent) + "\""), std::runtime_error);
+    mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
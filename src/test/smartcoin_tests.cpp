@@ -3,7 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "arith_uint256.h"
+#include "chain.h"
 #include "chainparams.h"
+#include "clientversion.h"
+#include "streams.h"
 #include "validation.h"
 #include "test/test_bitcoin.h"
 
@@ -147,6 +150,55 @@ BOOST_AUTO_TEST_CASE(get_next_work_digishield_rounding)
     BOOST_CHECK_EQUAL(CalculateNextWorkRequired(&pindexLast, nLastRetargetTime, params), 0x1b19c418);
 }
 
+BOOST_AUTO_TEST_CASE(disk_block_index_pow_hash)
+{
+    const CBlock& genesis = Params(CBaseChainParams::MAIN).GenesisBlock();
+    CBlockIndex index(genesis);
+    index.nStatus = BLOCK_VALID_TREE;
+
+    // Entries without BLOCK_HAVE_POW_HASH keep the legacy layout
+    CDataStream ssLegacy(SER_DISK, CLIENT_VERSION);
+    ssLegacy << CDiskBlockIndex(&index);
+    size_t nLegacySize = ssLegacy.size();
+    CDiskBlockIndex legacy;
+    ssLegacy >> legacy;
+    BOOST_CHECK(ssLegacy.empty());
+    BOOST_CHECK(legacy.hashPoW.IsNull());
+    BOOST_CHECK(legacy.GetBlockPoWHash() == genesis.GetPoWHash());
+
+    index.hashPoW = genesis.GetPoWHash();
+    index.nStatus |= BLOCK_HAVE_POW_HASH;
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << CDiskBlockIndex(&index);
+    BOOST_CHECK(ss.size() >= nLegacySize + 32);
+    CDiskBlockIndex upgraded;
+    ss >> upgraded;
+    BOOST_CHECK(upgraded.hashPoW == genesis.GetPoWHash());
+    BOOST_CHECK(upgraded.GetBlockHash() == genesis.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(pow_hasher)
+{
+    // One header from each era: X11 and scrypt
+    const uint32_t times[] = {1500000000, 1800000000};
+    for (uint32_t nTime : times) {
+        CBlockHeader header = Params(CBaseChainParams::MAIN).GenesisBlock().GetBlockHeader();
+        header.nTime = nTime;
+        header.nNonce = 0xfffffff0; // runs across the 32-bit wraparound
+        CPoWHasher hasher(header);
+
+        std::vector<uint256> hashes(21);
+        hasher.Hash(header.nNonce, hashes.size(), hashes.data());
+        for (size_t i = 0; i < hashes.size(); i++) {
+            CBlockHeader tried = header;
+            tried.nNonce += i;
+            BOOST_CHECK(hashes[i] == tried.GetPoWHash());
+            if (i % 8 == 0)
+                BOOST_CHECK(hasher.Hash(tried.nNonce) == tried.GetPoWHash());
+        }
+    }
+}
+
 // TODO for SmartCoin forks
 /* BOOST_AUTO_TEST_CASE(hardfork_parameters)
 {
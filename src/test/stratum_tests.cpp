@@ -0,0 +1,77 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "miner.h"
+#include "pow.h"
+#include "script/interpreter.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stratum_tests, TestChain240Setup)
+
+BOOST_AUTO_TEST_CASE(stratum_job)
+{
+    // A few mempool transactions so that the merkle branch is not empty
+    TestMemPoolEntryHelper entry;
+    for (int i = 0; i < 3; i++) {
+        CMutableTransaction spend;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(coinbaseTxns[i].GetHash(), 0);
+        spend.vout.resize(1);
+        spend.vout[0].nValue = coinbaseTxns[i].vout[0].nValue - CENT;
+        spend.vout[0].scriptPubKey = CScript() << OP_TRUE;
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(coinbaseTxns[i].vout[0].scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend.vin[0].scriptSig << vchSig;
+        CTransaction tx(spend);
+        mempool.addUnchecked(tx.GetHash(), entry.Fee(CENT).SpendsCoinbase(true).FromTx(tx));
+    }
+
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    std::shared_ptr<const CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(scriptPubKey, true));
+    BOOST_REQUIRE(pblocktemplate);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 4);
+    const int nHeight = chainActive.Height() + 1;
+    CStratumJob job(pblocktemplate, nHeight);
+    BOOST_CHECK_EQUAL(job.vMerkleBranch.size(), 2);
+
+    // The miner's coinbase, coinbase1 + extranonce + coinbase2, is the one in the assembled block
+    std::vector<unsigned char> vExtraNonce = ParseHex("0102030405060708");
+    BOOST_REQUIRE_EQUAL(vExtraNonce.size(), STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE);
+    CBlock block = job.BuildBlock(vExtraNonce, pblocktemplate->block.nTime + 1, 0);
+    std::vector<unsigned char> vCoinbase(job.vCoinbase1);
+    vCoinbase.insert(vCoinbase.end(), vExtraNonce.begin(), vExtraNonce.end());
+    vCoinbase.insert(vCoinbase.end(), job.vCoinbase2.begin(), job.vCoinbase2.end());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << *block.vtx[0];
+    BOOST_CHECK(std::vector<unsigned char>(ss.begin(), ss.end()) == vCoinbase);
+    BOOST_CHECK(block.hashMerkleRoot == BlockMerkleRoot(block));
+    BOOST_CHECK(block.hashPrevBlock == chainActive.Tip()->GetBlockHash());
+
+    // Different extranonces give different work
+    CBlock block2 = job.BuildBlock(ParseHex("0102030405060709"), block.nTime, 0);
+    BOOST_CHECK(block2.hashMerkleRoot != block.hashMerkleRoot);
+    BOOST_CHECK(block2.hashMerkleRoot == BlockMerkleRoot(block2));
+
+    // A solved job is a valid block
+    const Consensus::Params& consensus = Params().GetConsensus(nHeight);
+    while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, consensus))
+        ++block.nNonce;
+    BOOST_CHECK(ProcessNewBlock(Params(), std::make_shared<const CBlock>(block), true, NULL));
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(mempool.size(), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -72,6 +72,39 @@ BOOST_AUTO_TEST_CASE(streams_vector_writer)
     vch.clear();
 }
 
+BOOST_AUTO_TEST_CASE(streams_memory_reader)
+{
+    const unsigned char bytes[] = { 1, 255, 3, 4, 5, 6 };
+
+    CMemoryReader reader(SER_NETWORK, INIT_PROTO_VERSION, bytes, sizeof(bytes));
+    BOOST_CHECK_EQUAL(reader.size(), 6);
+    BOOST_CHECK(!reader.empty());
+
+    unsigned char a, b;
+    reader >> a >> b;
+    BOOST_CHECK_EQUAL(a, 1);
+    BOOST_CHECK_EQUAL(b, 255);
+    BOOST_CHECK_EQUAL(reader.size(), 4);
+
+    uint32_t n;
+    reader >> n;
+    BOOST_CHECK_EQUAL(n, 0x06050403U);
+    BOOST_CHECK(reader.empty());
+
+    // Reading past the end fails without touching the target
+    a = 0;
+    BOOST_CHECK_THROW(reader >> a, std::ios_base::failure);
+    BOOST_CHECK_EQUAL(a, 0);
+
+    // Only the given range is readable
+    CMemoryReader short_reader(SER_NETWORK, INIT_PROTO_VERSION, bytes, 3);
+    BOOST_CHECK_THROW(short_reader >> n, std::ios_base::failure);
+    short_reader.ignore(2);
+    short_reader >> a;
+    BOOST_CHECK_EQUAL(a, 3);
+    BOOST_CHECK_THROW(short_reader.ignore(1), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
 {
     std::vector<char> in;
@@ -29,7 +29,6 @@ struct BasicTestingSetup {
  */
 class CConnman;
 struct TestingSetup: public BasicTestingSetup {
-    CCoinsViewDB *pcoinsdbview;
     boost::filesystem::path pathTemp;
     boost::thread_group threadGroup;
     CConnman* connman;
@@ -39,6 +38,7 @@ struct TestingSetup: public BasicTestingSetup {
 };
 
 class CBlock;
+class COutPoint;
 struct CMutableTransaction;
 class CScript;
 
@@ -60,6 +60,10 @@ struct TestChain240Setup : public TestingSetup {
     CKey coinbaseKey; // private/public key needed to spend coinbase transactions
 };
 
+// Spend prevout, paying to key's pubkey and paying with key's signature,
+// which is corrupted unless fSign
+CMutableTransaction SpendToKey(const CKey& key, const COutPoint& prevout, CAmount nValue, bool fSign = true);
+
 class CTxMemPoolEntry;
 class CTxMemPool;
 
@@ -0,0 +1,170 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "txdb.h"
+#include "txoutset.h"
+#include "validation.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(txoutset_tests, TestChain240Setup)
+
+static CCoinsStats HashCoins(CCoinsView* view)
+{
+    CCoinsStats stats;
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+    CCoinsStatsHasher hasher(stats, pcursor->GetBestBlock());
+    for (; pcursor->Valid(); pcursor->Next()) {
+        COutPoint key;
+        Coin coin;
+        BOOST_REQUIRE(pcursor->GetKey(key) && pcursor->GetValue(coin));
+        hasher.Add(key, coin);
+    }
+    hasher.Finish();
+    return stats;
+}
+
+static CTxOutSetSnapshotHeader DumpCoins(const boost::filesystem::path& path, CCoinsView* view, CCoinsStats& stats)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+    CTxOutSetSnapshotHeader header(Params().MessageStart(), pcursor->GetBestBlock(), chainActive.Height(), chainActive.Tip()->nChainTx);
+    CAutoFile fileout(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    WriteTxOutSetSnapshot(fileout, header, pcursor.get(), stats);
+    return header;
+}
+
+BOOST_AUTO_TEST_CASE(txoutset_dump_load)
+{
+    LOCK(cs_main);
+    FlushStateToDisk();
+    CCoinsStats statsTip = HashCoins(pcoinsdbview);
+    BOOST_CHECK(statsTip.nTransactionOutputs > 100);
+
+    boost::filesystem::path path = pathTemp / "utxo.dat";
+    CCoinsStats statsDump;
+    CTxOutSetSnapshotHeader header = DumpCoins(path, pcoinsdbview, statsDump);
+    BOOST_CHECK(statsDump.hashSerialized == statsTip.hashSerialized);
+    BOOST_CHECK_EQUAL(statsDump.nTransactionOutputs, statsTip.nTransactionOutputs);
+    BOOST_CHECK(statsDump.nTotalAmount == statsTip.nTotalAmount);
+
+    // The coins load into a database holding other coins
+    CCoinsViewDB db(1 << 20, true);
+    CCoinsMap mapStale;
+    Coin coinStale(CTxOut(1, CScript() << OP_TRUE), 1, false);
+    CCoinsCacheEntry& entry = mapStale[COutPoint(GetRandHash(), 0)];
+    entry.coin = coinStale;
+    entry.flags = CCoinsCacheEntry::DIRTY;
+    BOOST_REQUIRE(db.BatchWrite(mapStale, GetRandHash()));
+
+    // Coins that fail the final check are written but never committed
+    {
+        CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        CTxOutSetSnapshotHeader headerRead;
+        filein >> headerRead;
+        CCoinsStats statsRead;
+        CTxOutSetSnapshotReader reader(filein, headerRead, statsRead);
+        BOOST_CHECK(!db.LoadCoins([&reader](COutPoint& outpoint, Coin& coin) { return reader.Next(outpoint, coin); }, []() { return false; }, headerRead.hashBlock));
+        BOOST_CHECK(db.GetBestBlock().IsNull());
+        BOOST_CHECK_EQUAL(db.GetHeadBlocks().size(), 2);
+    }
+
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    CTxOutSetSnapshotHeader headerRead;
+    filein >> headerRead;
+    BOOST_CHECK(headerRead.IsValid());
+    BOOST_CHECK(headerRead.hashBlock == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK_EQUAL(headerRead.nHeight, chainActive.Height());
+    BOOST_CHECK_EQUAL(headerRead.nChainTx, chainActive.Tip()->nChainTx);
+    CCoinsStats statsRead;
+    CTxOutSetSnapshotReader reader(filein, headerRead, statsRead);
+    BOOST_REQUIRE(db.LoadCoins([&reader](COutPoint& outpoint, Coin& coin) { return reader.Next(outpoint, coin); },
+                               [&statsRead, &statsTip]() { return statsRead.hashSerialized == statsTip.hashSerialized; }, headerRead.hashBlock));
+    BOOST_CHECK(statsRead.hashSerialized == statsTip.hashSerialized);
+
+    BOOST_CHECK(db.GetBestBlock() == header.hashBlock);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    CCoinsStats statsLoaded = HashCoins(&db);
+    BOOST_CHECK(statsLoaded.hashSerialized == statsTip.hashSerialized);
+    BOOST_CHECK_EQUAL(statsLoaded.nTransactionOutputs, statsTip.nTransactionOutputs);
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(txoutset_large_index)
+{
+    // The database orders output 16512 between 255 and 256 by its VARINT
+    // encoded index, the snapshot has to store them by index
+    LOCK(cs_main);
+    CCoinsViewDB dbSource(1 << 20, true);
+    uint256 txid = GetRandHash();
+    const uint32_t vIndex[] = {255, 256, 16512};
+    CCoinsMap mapCoins;
+    for (uint32_t n : vIndex) {
+        CCoinsCacheEntry& entry = mapCoins[COutPoint(txid, n)];
+        entry.coin = Coin(CTxOut(n, CScript() << OP_TRUE), 7, false);
+        entry.flags = CCoinsCacheEntry::DIRTY;
+    }
+    BOOST_REQUIRE(dbSource.BatchWrite(mapCoins, GetRandHash()));
+
+    boost::filesystem::path path = pathTemp / "utxo.dat";
+    CCoinsStats statsDump;
+    DumpCoins(path, &dbSource, statsDump);
+    BOOST_CHECK_EQUAL(statsDump.nTransactionOutputs, 3);
+
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    CTxOutSetSnapshotHeader header;
+    filein >> header;
+    CCoinsStats statsRead;
+    CTxOutSetSnapshotReader reader(filein, header, statsRead);
+    COutPoint outpoint;
+    Coin coin;
+    for (uint32_t n : vIndex) {
+        BOOST_REQUIRE(reader.Next(outpoint, coin));
+        BOOST_CHECK(outpoint == COutPoint(txid, n));
+        BOOST_CHECK_EQUAL(coin.out.nValue, n);
+        BOOST_CHECK_EQUAL(coin.nHeight, 7);
+    }
+    BOOST_CHECK(!reader.Next(outpoint, coin));
+    BOOST_CHECK(statsRead.hashSerialized == statsDump.hashSerialized);
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_CASE(txoutset_corrupt)
+{
+    LOCK(cs_main);
+    FlushStateToDisk();
+    boost::filesystem::path path = pathTemp / "utxo.dat";
+    CCoinsStats statsDump;
+    DumpCoins(path, pcoinsdbview, statsDump);
+    size_t nSize = boost::filesystem::file_size(path);
+
+    // Flip a byte in the coins, then truncate the trailer
+    for (int nCase = 0; nCase < 2; nCase++) {
+        if (nCase == 0) {
+            FILE* file = fopen(path.string().c_str(), "r+b");
+            fseek(file, nSize / 2, SEEK_SET);
+            int ch = fgetc(file);
+            fseek(file, nSize / 2, SEEK_SET);
+            fputc(ch ^ 0x20, file);
+            fclose(file);
+        } else {
+            DumpCoins(path, pcoinsdbview, statsDump);
+            boost::filesystem::resize_file(path, nSize - 1);
+        }
+        CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        CTxOutSetSnapshotHeader header;
+        filein >> header;
+        CCoinsStats stats;
+        CTxOutSetSnapshotReader reader(filein, header, stats);
+        COutPoint outpoint;
+        Coin coin;
+        BOOST_CHECK_THROW(while (reader.Next(outpoint, coin)) {}, std::ios_base::failure);
+    }
+    boost::filesystem::remove(path);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,18 +2,22 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "clientversion.h"
 #include "consensus/validation.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
+#include "policy/policy.h"
 #include "pubkey.h"
 #include "txmempool.h"
 #include "random.h"
 #include "script/standard.h"
 #include "test/test_bitcoin.h"
+#include "util.h"
 #include "utiltime.h"
 
 #include <boost/test/unit_test.hpp>
+#include <boost/thread/thread.hpp>
 
 BOOST_AUTO_TEST_SUITE(tx_validationcache_tests)
 
@@ -83,4 +87,145 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain240Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(tx_mempool_concurrent_accept, TestChain240Setup)
+{
+    // Threads that do not hold cs_main submit two conflicting spends of
+    // each of several coinbases at once; exactly one of each pair gets in.
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const int nCoins = 20;
+    std::vector<CTransactionRef> vSpends;
+    for (int i = 0; i < nCoins; i++) {
+        for (int j = 0; j < 2; j++) {
+            CMutableTransaction spend;
+            spend.nVersion = 1;
+            spend.vin.resize(1);
+            spend.vin[0].prevout.hash = coinbaseTxns[i].GetHash();
+            spend.vin[0].prevout.n = 0;
+            spend.vout.resize(1);
+            spend.vout[0].nValue = (11 + j) * CENT;
+            spend.vout[0].scriptPubKey = scriptPubKey;
+
+            std::vector<unsigned char> vchSig;
+            uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+            BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+            vchSig.push_back((unsigned char)SIGHASH_ALL);
+            spend.vin[0].scriptSig << vchSig;
+            vSpends.push_back(MakeTransactionRef(spend));
+        }
+    }
+
+    // Boost.Test is not thread safe, so results are checked after joining
+    std::vector<std::string> vReasons(vSpends.size());
+    boost::thread_group threads;
+    for (int t = 0; t < 4; t++) {
+        threads.create_thread([&vSpends, &vReasons, t] {
+            for (size_t i = t; i < vSpends.size(); i += 4) {
+                CValidationState state;
+                if (!AcceptToMemoryPool(mempool, state, vSpends[i], false, NULL, NULL, true, 0))
+                    vReasons[i] = state.GetRejectReason();
+            }
+        });
+    }
+    threads.join_all();
+
+    int nAccepted = 0;
+    for (const std::string& strReason : vReasons) {
+        if (strReason.empty())
+            nAccepted++;
+        else
+            BOOST_CHECK_EQUAL(strReason, "txn-mempool-conflict");
+    }
+    BOOST_CHECK_EQUAL(nAccepted, nCoins);
+    BOOST_CHECK_EQUAL(mempool.size(), (unsigned int)nCoins);
+    for (int i = 0; i < nCoins; i++)
+        BOOST_CHECK(mempool.exists(vSpends[2 * i]->GetHash()) != mempool.exists(vSpends[2 * i + 1]->GetHash()));
+    {
+        LOCK(cs_main);
+        mempool.check(pcoinsTip);
+    }
+    mempool.clear();
+}
+
+static void ClearMemPool()
+{
+    LOCK(mempool.cs);
+    mempool.clear();
+    mempool.mapDeltas.clear();
+}
+
+/** Write a version 2 mempool.dat holding tx alone, dumped on top of hashTip */
+static void WriteMempoolDumpEntry(const CTransaction& tx, const uint256& hashTip, int64_t nTime, int64_t nFeeDelta, CAmount nFee)
+{
+    CAutoFile file(fopen((GetDataDir() / "mempool.dat").string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    file << (uint64_t)2 << hashTip << (uint32_t)STANDARD_SCRIPT_VERIFY_FLAGS << (uint64_t)1;
+    file << tx << nTime << nFeeDelta;
+    file << nFee << 0.0 << (unsigned int)chainActive.Height() << (CAmount)0 << true << (int64_t)0;
+    file << (uint64_t)1 << (uint64_t)GetVirtualTransactionSize(tx);
+    file << std::map<uint256, CAmount>();
+}
+
+BOOST_FIXTURE_TEST_CASE(tx_mempool_dump_load, TestChain240Setup)
+{
+    CScript scriptPubKey = CScript() <<  ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction txParent = SpendToKey(coinbaseKey, COutPoint(coinbaseTxns[0].GetHash(), 0), 11 * CENT);
+    CMutableTransaction txChild = SpendToKey(coinbaseKey, COutPoint(txParent.GetHash(), 0), 10 * CENT);
+    CMutableTransaction txOther = SpendToKey(coinbaseKey, COutPoint(coinbaseTxns[1].GetHash(), 0), 11 * CENT);
+    BOOST_CHECK(ToMemPool(txParent));
+    BOOST_CHECK(ToMemPool(txChild));
+    BOOST_CHECK(ToMemPool(txOther));
+    double dPriorityDelta = 0;
+    mempool.PrioritiseTransaction(txOther.GetHash(), txOther.GetHash().ToString(), dPriorityDelta, 1000);
+    CAmount nParentFee = mempool.mapTx.find(txParent.GetHash())->GetFee();
+
+    // The dump is loaded back on top of the same tip
+    DumpMempool();
+    ClearMemPool();
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 3);
+    BOOST_CHECK_EQUAL(mempool.mapTx.find(txChild.GetHash())->GetCountWithAncestors(), 2);
+    CTxMemPool::txiter itOther = mempool.mapTx.find(txOther.GetHash());
+    BOOST_CHECK_EQUAL(itOther->GetModifiedFee(), itOther->GetFee() + 1000);
+    {
+        LOCK(cs_main);
+        mempool.check(pcoinsTip);
+    }
+
+    // The recorded fee is trusted on the tip it was dumped at, but the relay
+    // policy is applied again: once -minrelaytxfee went up the entry goes
+    // through AcceptToMemoryPool, which rejects it
+    CTransaction tx(txParent);
+    uint256 hashTip = chainActive.Tip()->GetBlockHash();
+    WriteMempoolDumpEntry(tx, hashTip, GetTime(), 0, nParentFee + 1);
+    ClearMemPool();
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 1);
+    BOOST_CHECK_EQUAL(mempool.mapTx.find(tx.GetHash())->GetFee(), nParentFee + 1);
+    WriteMempoolDumpEntry(tx, hashTip, GetTime(), 0, nParentFee + 1);
+    ClearMemPool();
+    CFeeRate minRelayTxFeeOld = ::minRelayTxFee;
+    ::minRelayTxFee = CFeeRate(1000 * (nParentFee + 2));
+    BOOST_CHECK(LoadMempool());
+    ::minRelayTxFee = minRelayTxFeeOld;
+    BOOST_CHECK_EQUAL(mempool.size(), 0);
+
+    // The fee delta of an expired entry is kept, as for a version 1 file
+    WriteMempoolDumpEntry(tx, hashTip, 0, 1000, nParentFee);
+    ClearMemPool();
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 0);
+    CAmount nFeeDelta = 0;
+    mempool.ApplyDeltas(tx.GetHash(), dPriorityDelta, nFeeDelta);
+    BOOST_CHECK_EQUAL(nFeeDelta, 1000);
+
+    // Once the tip moved on the fee is recomputed
+    ClearMemPool();
+    CreateAndProcessBlock(std::vector<CMutableTransaction>(), scriptPubKey);
+    BOOST_CHECK(chainActive.Tip()->GetBlockHash() != hashTip);
+    WriteMempoolDumpEntry(tx, hashTip, GetTime(), 0, nParentFee + 1);
+    BOOST_CHECK(LoadMempool());
+    BOOST_CHECK_EQUAL(mempool.size(), 1);
+    BOOST_CHECK_EQUAL(mempool.mapTx.find(tx.GetHash())->GetFee(), nParentFee);
+    ClearMemPool();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
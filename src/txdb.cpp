@@ -7,34 +7,80 @@
 
 #include "chainparams.h"
 #include "hash.h"
+#include "init.h"
 #include "pow.h"
+#include "ui_interface.h"
 #include "uint256.h"
+#include "util.h"
 
 #include <stdint.h>
 
+#include <boost/bind/bind.hpp>
 #include <boost/thread.hpp>
 
+static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
+static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+namespace {
+
+struct CoinEntry {
+    COutPoint* outpoint;
+    char key;
+    CoinEntry(const COutPoint* ptr) : outpoint(const_cast<COutPoint*>(ptr)), key(DB_COIN)  {}
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s << key;
+        s << outpoint->hash;
+        s << VARINT(outpoint->n);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        s >> key;
+        s >> outpoint->hash;
+        s >> VARINT(outpoint->n);
+    }
+};
+
+}
+
+bool GetDBProfile(const std::string& strProfile, CDBOptions& chainstate, CDBOptions& blockindex)
+{
+    chainstate = CDBOptions();
+    blockindex = CDBOptions();
+    if (strProfile == "default")
+        return true;
+    if (strProfile == "highmem") {
+        chainstate.nMaxOpenFiles = 500;
+        chainstate.nBloomBits = 14;
+        blockindex.nBlockSize = 16 << 10;
+        blockindex.nWriteBufferPercent = 40;
+        return true;
+    }
+    return false;
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, const CDBOptions& dbOptions) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true, dbOptions)
 {
 }
 
-bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
-    return db.Read(std::make_pair(DB_COINS, txid), coins);
+bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    return db.Read(CoinEntry(&outpoint), coin);
 }
 
-bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
-    return db.Exists(std::make_pair(DB_COINS, txid));
+bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
@@ -44,30 +90,245 @@ uint256 CCoinsViewDB::GetBestBlock() const {
     return hashBestChain;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
+    std::vector<uint256> vhashHeadBlocks;
+    if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks)) {
+        return std::vector<uint256>();
+    }
+    return vhashHeadBlocks;
+}
+
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
-    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+    size_t batch_size = (size_t)GetArg("-dbbatchsize", nDefaultDbBatchSize);
+
+    if (!hashBlock.IsNull()) {
+        uint256 old_tip = GetBestBlock();
+        if (old_tip.IsNull()) {
+            // We may be in the middle of replaying.
+            std::vector<uint256> old_heads = GetHeadBlocks();
+            if (old_heads.size() == 2) {
+                assert(old_heads[0] == hashBlock);
+                old_tip = old_heads[1];
+            }
+        }
+
+        // In the first batch, mark the database as being in the middle of a
+        // transition from old_tip to hashBlock.
+        batch.Erase(DB_BEST_BLOCK);
+        batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, old_tip});
+    }
+
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); it++) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            if (it->second.coins.IsPruned())
-                batch.Erase(std::make_pair(DB_COINS, it->first));
+            CoinEntry entry(&it->first);
+            if (it->second.coin.IsSpent())
+                batch.Erase(entry);
             else
-                batch.Write(std::make_pair(DB_COINS, it->first), it->second.coins);
+                batch.Write(entry, it->second.coin);
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (batch.SizeEstimate() > batch_size) {
+            LogPrint("coindb", "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+            db.WriteBatch(batch);
+            batch.Clear();
+        }
     }
-    if (!hashBlock.IsNull())
+
+    // In the last batch, mark the database as consistent with hashBlock again.
+    if (!hashBlock.IsNull()) {
+        batch.Erase(DB_HEAD_BLOCKS);
         batch.Write(DB_BEST_BLOCK, hashBlock);
+    }
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    LogPrint("coindb", "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+    bool ret = db.WriteBatch(batch);
+    LogPrint("coindb", "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    return ret;
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+bool CCoinsViewDB::LoadCoins(const std::function<bool(COutPoint&, Coin&)>& fnNext, const std::function<bool()>& fnVerify, const uint256 &hashBlock) {
+    CDBBatch batch(db);
+    batch.Erase(DB_BEST_BLOCK);
+    batch.Write(DB_HEAD_BLOCKS, std::vector<uint256>{hashBlock, GetBestBlock()});
+    if (!db.WriteBatch(batch, true))
+        return false;
+    batch.Clear();
+
+    // Clear the old coin set
+    size_t nErased = 0;
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    COutPoint outpoint;
+    CoinEntry entryOld(&outpoint);
+    for (pcursor->Seek(DB_COIN); pcursor->Valid() && pcursor->GetKey(entryOld) && entryOld.key == DB_COIN; pcursor->Next()) {
+        batch.Erase(entryOld);
+        nErased++;
+        if (batch.SizeEstimate() > nSnapshotDbBatchSize) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+    pcursor.reset();
+
+    size_t nLoaded = 0;
+    CoinEntry entry(&outpoint);
+    Coin coin;
+    while (fnNext(outpoint, coin)) {
+        batch.Write(entry, coin);
+        if (++nLoaded % 1000000 == 0)
+            LogPrintf("Loaded %u coins...\n", nLoaded);
+        if (batch.SizeEstimate() > nSnapshotDbBatchSize) {
+            LogPrint("coindb", "Writing snapshot batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+    }
+
+    if (!db.WriteBatch(batch))
+        return false;
+    batch.Clear();
+    if (!fnVerify())
+        return false;
+
+    batch.Erase(DB_HEAD_BLOCKS);
+    batch.Write(DB_BEST_BLOCK, hashBlock);
+    if (!db.WriteBatch(batch, true))
+        return false;
+    LogPrintf("Replaced %u coins by %u from snapshot at %s\n", nErased, nLoaded, hashBlock.ToString());
+    db.CompactRange(std::make_pair(DB_COIN, uint256()), std::make_pair((char)(DB_COIN + 1), uint256()));
+    return true;
+}
+
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    bool ret = WriteCoins(mapCoins, hashBlock);
+    mapCoins.clear();
+    return ret;
+}
+
+CCoinsViewAsyncFlush::CCoinsViewAsyncFlush(CCoinsViewDB *dbIn) : CCoinsViewBacked(dbIn), db(dbIn), fWriting(false), fFailed(false), fStop(false)
+{
+    thread = boost::thread(boost::bind(&CCoinsViewAsyncFlush::ThreadWriter, this));
+}
+
+CCoinsViewAsyncFlush::~CCoinsViewAsyncFlush()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+    }
+    cond.notify_all();
+    thread.join();
+}
+
+void CCoinsViewAsyncFlush::ThreadWriter()
+{
+    RenameThread("smartcoin-coinsflush");
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (true) {
+        // A pending write is always finished, also when stopping
+        while (!fWriting && !fStop)
+            cond.wait(lock);
+        if (!fWriting)
+            return;
+
+        lock.unlock();
+        int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            // Nothing modifies mapWriting while fWriting is set
+            fOk = db->WriteCoins(mapWriting, hashWriting);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        LogPrint("coindb", "Background coins write of %u entries took %.2fms\n", mapWriting.size(), (GetTimeMicros() - nStart) * 0.001);
+        lock.lock();
+
+        if (fOk) {
+            mapWriting.clear();
+            hashWriting.SetNull();
+        } else {
+            // The database may hold part of the write; keep serving the
+            // entries from memory, startup replays the blocks to repair it
+            LogPrintf("%s: failed to write to coin database\n", __func__);
+            fFailed = true;
+        }
+        fWriting = false;
+        cond.notify_all();
+    }
+}
+
+bool CCoinsViewAsyncFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (fWriting || fFailed) {
+            CCoinsMap::const_iterator it = mapWriting.find(outpoint);
+            if (it != mapWriting.end()) {
+                coin = it->second.coin;
+                return !coin.IsSpent();
+            }
+        }
+    }
+    // The database only changes for outpoints in mapWriting
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewAsyncFlush::HaveCoin(const COutPoint &outpoint) const
+{
+    Coin coin;
+    return GetCoin(outpoint, coin);
+}
+
+uint256 CCoinsViewAsyncFlush::GetBestBlock() const
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if ((fWriting || fFailed) && !hashWriting.IsNull())
+            return hashWriting;
+    }
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewAsyncFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (fWriting) {
+        int64_t nStart = GetTimeMicros();
+        while (fWriting)
+            cond.wait(lock);
+        LogPrint("coindb", "Waited %.2fms for the previous coins write\n", (GetTimeMicros() - nStart) * 0.001);
+    }
+    if (fFailed)
+        return false;
+    // Take the whole map; clean entries are harmless and swapping keeps this O(1)
+    mapWriting.swap(mapCoins);
+    mapCoins.clear();
+    hashWriting = hashBlock;
+    fWriting = true;
+    cond.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewAsyncFlush::Cursor() const
+{
+    Sync();
+    return base->Cursor();
+}
+
+bool CCoinsViewAsyncFlush::Sync() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (fWriting)
+        cond.wait(lock);
+    return !fFailed;
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, const CDBOptions& dbOptions) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, dbOptions) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -96,29 +357,31 @@ CCoinsViewCursor *CCoinsViewDB::Cursor() const
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COINS);
+    i->pcursor->Seek(DB_COIN);
     // Cache key of first record
     if (i->pcursor->Valid()) {
-        i->pcursor->GetKey(i->keyTmp);
+        CoinEntry entry(&i->keyTmp.second);
+        i->pcursor->GetKey(entry);
+        i->keyTmp.first = entry.key;
     } else {
         i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
     }
     return i;
 }
 
-bool CCoinsViewDBCursor::GetKey(uint256 &key) const
+bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
-    if (keyTmp.first == DB_COINS) {
+    if (keyTmp.first == DB_COIN) {
         key = keyTmp.second;
         return true;
     }
     return false;
 }
 
-bool CCoinsViewDBCursor::GetValue(CCoins &coins) const
+bool CCoinsViewDBCursor::GetValue(Coin &coin) const
 {
-    return pcursor->GetValue(coins);
+    return pcursor->GetValue(coin);
 }
 
 unsigned int CCoinsViewDBCursor::GetValueSize() const
@@ -128,14 +391,18 @@ unsigned int CCoinsViewDBCursor::GetValueSize() const
 
 bool CCoinsViewDBCursor::Valid() const
 {
-    return keyTmp.first == DB_COINS;
+    return keyTmp.first == DB_COIN;
 }
 
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    if (!pcursor->Valid() || !pcursor->GetKey(keyTmp))
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
         keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
+    } else {
+        keyTmp.first = entry.key;
+    }
 }
 
 bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
@@ -179,6 +446,11 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Entries written before BLOCK_HAVE_POW_HASH existed are upgraded in place
+    CDBBatch batch(*this);
+    unsigned int nBatchUpgraded = 0;
+    unsigned int nUpgraded = 0;
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -200,6 +472,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
+                pindexNew->hashPoW        = diskindex.hashPoW;
 
                 // Litecoin: Disable PoW Sanity check while loading block index from disk.
                 // We use the sha256 hash for the block index for performance reasons, which is recorded for later use.
@@ -210,6 +483,27 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                 //if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
                 //    return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
 
+                // SmartCoin: the PoW hash is now kept in the block index. Entries from older
+                // databases get it computed once here and written back, so that
+                // ReadBlockFromDisk never has to re-run scrypt/X11 for them again.
+                if (!(diskindex.nStatus & BLOCK_HAVE_POW_HASH)) {
+                    if (nUpgraded == 0)
+                        LogPrintf("Upgrading block index: storing PoW hashes (one-time, this may take a while)...\n");
+                    diskindex.hashPoW = diskindex.GetBlockHeader().GetPoWHash();
+                    diskindex.nStatus |= BLOCK_HAVE_POW_HASH;
+                    pindexNew->hashPoW = diskindex.hashPoW;
+                    pindexNew->nStatus = diskindex.nStatus;
+                    batch.Write(std::make_pair(DB_BLOCK_INDEX, key.second), diskindex);
+                    nUpgraded++;
+                    if (++nBatchUpgraded >= 10000) {
+                        if (!WriteBatch(batch))
+                            return error("LoadBlockIndex() : failed to write upgraded block index entries");
+                        batch.Clear();
+                        nBatchUpgraded = 0;
+                        LogPrintf("Upgrading block index: %u entries done\n", nUpgraded);
+                    }
+                }
+
                 pcursor->Next();
             } else {
                 return error("LoadBlockIndex() : failed to read value");
@@ -219,5 +513,134 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
         }
     }
 
+    if (nBatchUpgraded > 0 && !WriteBatch(batch, true))
+        return error("LoadBlockIndex() : failed to write upgraded block index entries");
+    if (nUpgraded > 0)
+        LogPrintf("Upgraded %u block index entries with stored PoW hashes\n", nUpgraded);
+
     return true;
 }
+
+namespace {
+
+//! Legacy class to deserialize pre-pertxout database entries without reindex.
+class CCoins
+{
+public:
+    //! whether transaction is a coinbase
+    bool fCoinBase;
+
+    //! unspent transaction outputs; spent outputs are .IsNull(); spent outputs at the end of the array are dropped
+    std::vector<CTxOut> vout;
+
+    //! at which height this transaction was included in the active block chain
+    int nHeight;
+
+    //! empty constructor
+    CCoins() : fCoinBase(false), vout(0), nHeight(0) { }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        unsigned int nCode = 0;
+        // version
+        int nVersionDummy;
+        ::Unserialize(s, VARINT(nVersionDummy));
+        // header code
+        ::Unserialize(s, VARINT(nCode));
+        fCoinBase = nCode & 1;
+        std::vector<bool> vAvail(2, false);
+        vAvail[0] = (nCode & 2) != 0;
+        vAvail[1] = (nCode & 4) != 0;
+        unsigned int nMaskCode = (nCode / 8) + ((nCode & 6) != 0 ? 0 : 1);
+        // spentness bitmask
+        while (nMaskCode > 0) {
+            unsigned char chAvail = 0;
+            ::Unserialize(s, chAvail);
+            for (unsigned int p = 0; p < 8; p++) {
+                bool f = (chAvail & (1 << p)) != 0;
+                vAvail.push_back(f);
+            }
+            if (chAvail != 0)
+                nMaskCode--;
+        }
+        // txouts themself
+        vout.assign(vAvail.size(), CTxOut());
+        for (unsigned int i = 0; i < vAvail.size(); i++) {
+            if (vAvail[i])
+                ::Unserialize(s, REF(CTxOutCompressor(vout[i])));
+        }
+        // coinbase height
+        ::Unserialize(s, VARINT(nHeight));
+    }
+};
+
+}
+
+/** Upgrade the database from older formats.
+ *
+ * Currently implemented: from the per-tx utxo model (0.8..0.14.x) to per-txout.
+ */
+bool CCoinsViewDB::Upgrade() {
+    std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(std::make_pair(DB_COINS, uint256()));
+    if (!pcursor->Valid()) {
+        return true;
+    }
+
+    int64_t count = 0;
+    LogPrintf("Upgrading utxo-set database...\n");
+    LogPrintf("[0%%]...");
+    size_t batch_size = 1 << 24;
+    CDBBatch batch(db);
+    int reportDone = 0;
+    std::pair<char, uint256> key;
+    std::pair<char, uint256> prev_key = std::make_pair(DB_COINS, uint256());
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested()) {
+            break;
+        }
+        if (pcursor->GetKey(key) && key.first == DB_COINS) {
+            if (count++ % 256 == 0) {
+                uint32_t high = 0x100 * *key.second.begin() + *(key.second.begin() + 1);
+                int percentageDone = (int)(high * 100.0 / 65536.0 + 0.5);
+                uiInterface.ShowProgress(_("Upgrading UTXO database"), percentageDone);
+                if (reportDone < percentageDone/10) {
+                    // report max. every 10% step
+                    LogPrintf("[%d%%]...", percentageDone);
+                    reportDone = percentageDone/10;
+                }
+            }
+            CCoins old_coins;
+            if (!pcursor->GetValue(old_coins)) {
+                return error("%s: cannot parse CCoins record", __func__);
+            }
+            COutPoint outpoint(key.second, 0);
+            for (size_t i = 0; i < old_coins.vout.size(); ++i) {
+                if (!old_coins.vout[i].IsNull() && !old_coins.vout[i].scriptPubKey.IsUnspendable()) {
+                    Coin newcoin(std::move(old_coins.vout[i]), old_coins.nHeight, old_coins.fCoinBase);
+                    outpoint.n = i;
+                    CoinEntry entry(&outpoint);
+                    batch.Write(entry, newcoin);
+                }
+            }
+            batch.Erase(key);
+            if (batch.SizeEstimate() > batch_size) {
+                if (!db.WriteBatch(batch))
+                    return error("%s: failed to write upgraded coins", __func__);
+                batch.Clear();
+                db.CompactRange(prev_key, key);
+                prev_key = key;
+            }
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+    if (!db.WriteBatch(batch))
+        return error("%s: failed to write upgraded coins", __func__);
+    db.CompactRange(std::make_pair(DB_COINS, uint256()), key);
+    uiInterface.ShowProgress("", 100);
+    LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
+    return !ShutdownRequested();
+}
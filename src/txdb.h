@@ -10,12 +10,16 @@
 #include "dbwrapper.h"
 #include "chain.h"
 
+#include <functional>
 #include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
@@ -41,6 +45,21 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -dbbatchsize default (bytes)
+static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! Write batch size when bulk loading a UTXO snapshot (bytes)
+static const int64_t nSnapshotDbBatchSize = 64 << 20;
+//! -dbprofile default
+static const char* const DEFAULT_DB_PROFILE = "default";
+
+/**
+ * LevelDB tuning of the chain state and block index databases for a -dbprofile.
+ * "default" keeps both small; "highmem" trades file handles and bloom filter
+ * memory for fewer disk reads on the chain state's random lookups, and gives the
+ * block index, which is mostly written in bulk and read in order, larger blocks
+ * and write buffers. Returns false for unknown profiles.
+ */
+bool GetDBProfile(const std::string& strProfile, CDBOptions& chainstate, CDBOptions& blockindex);
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -73,13 +92,78 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CDBWrapper db;
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptions = CDBOptions());
 
-    bool GetCoins(const uint256 &txid, CCoins &coins) const;
-    bool HaveCoins(const uint256 &txid) const;
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
     uint256 GetBestBlock() const;
+    std::vector<uint256> GetHeadBlocks() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
     CCoinsViewCursor *Cursor() const;
+
+    /**
+     * Write the dirty entries of mapCoins without consuming it, in batches
+     * of at most -dbbatchsize bytes. While the batches are going in, the
+     * database records the old and new best block as head blocks instead of
+     * a best block, so an interrupted write can be finished by replaying
+     * blocks (see ReplayBlocks).
+     */
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+
+    //! Convert per-transaction records from older versions to per-output ones. Returns false on error or shutdown.
+    bool Upgrade();
+
+    /**
+     * Replace the whole coin set with the coins fnNext hands out until it
+     * returns false, making hashBlock the best block once fnVerify confirms
+     * them. While loading, the database records hashBlock and the old best
+     * block as head blocks, so an interrupted load is noticed at startup.
+     * Exceptions from fnNext, write errors and a false fnVerify leave the
+     * database in that state.
+     */
+    bool LoadCoins(const std::function<bool(COutPoint&, Coin&)>& fnNext, const std::function<bool()>& fnVerify, const uint256 &hashBlock);
+
+    const CDBWrapper& GetDB() const { return db; }
+};
+
+/**
+ * Layer between the coins cache and CCoinsViewDB that writes flushed
+ * entries on a background thread. BatchWrite takes over the flushed map
+ * and returns at once; until the write has been committed, lookups for
+ * those outpoints are answered from it. A flush that arrives while the
+ * previous one is still being written waits for it.
+ *
+ * Reads may come from several threads. Writes only come from the thread
+ * holding cs_main.
+ */
+class CCoinsViewAsyncFlush : public CCoinsViewBacked
+{
+public:
+    CCoinsViewAsyncFlush(CCoinsViewDB *dbIn);
+    ~CCoinsViewAsyncFlush();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
+    uint256 GetBestBlock() const;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    CCoinsViewCursor *Cursor() const;
+
+    //! Wait until the last flush has been written. Returns false if a background write failed.
+    bool Sync() const;
+
+private:
+    void ThreadWriter();
+
+    CCoinsViewDB *db;
+    mutable boost::mutex mutex;
+    mutable boost::condition_variable cond;
+    //! Entries being written; not modified until the write completes, kept if it fails
+    CCoinsMap mapWriting;
+    uint256 hashWriting;
+    bool fWriting;
+    bool fFailed;
+    bool fStop;
+    boost::thread thread;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -88,8 +172,8 @@ class CCoinsViewDBCursor: public CCoinsViewCursor
 public:
     ~CCoinsViewDBCursor() {}
 
-    bool GetKey(uint256 &key) const;
-    bool GetValue(CCoins &coins) const;
+    bool GetKey(COutPoint &key) const;
+    bool GetValue(Coin &coin) const;
     unsigned int GetValueSize() const;
 
     bool Valid() const;
@@ -99,7 +183,7 @@ private:
     CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
     std::unique_ptr<CDBIterator> pcursor;
-    std::pair<char, uint256> keyTmp;
+    std::pair<char, COutPoint> keyTmp;
 
     friend class CCoinsViewDB;
 };
@@ -108,7 +192,7 @@ private:
 class CBlockTreeDB : public CDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptions = CDBOptions());
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
@@ -19,13 +19,29 @@
 #include "utiltime.h"
 #include "version.h"
 
+#include <algorithm>
+
+const CAmount FEE_HISTOGRAM_BOUNDS[FEE_HISTOGRAM_BUCKETS] = {
+    0, 1000, 2000, 3000, 4000, 5000, 6000, 8000, 10000, 12000, 15000,
+    20000, 25000, 30000, 40000, 50000, 60000, 70000, 80000, 100000, 120000, 140000,
+    170000, 200000, 250000, 300000, 400000, 500000, 600000, 700000, 800000, 1000000, 1200000,
+    1400000, 1700000, 2000000, 2500000, 3000000, 4000000, 5000000, 6000000, 7000000, 8000000, 10000000
+};
+
+static unsigned int GetFeeHistogramIndex(const CTxMemPoolEntry& entry)
+{
+    CAmount nFeePerK = CFeeRate(entry.GetModifiedFee(), entry.GetTxSize()).GetFeePerK();
+    const CAmount* pbound = std::upper_bound(FEE_HISTOGRAM_BOUNDS, FEE_HISTOGRAM_BOUNDS + FEE_HISTOGRAM_BUCKETS, nFeePerK);
+    return pbound == FEE_HISTOGRAM_BOUNDS ? 0 : pbound - FEE_HISTOGRAM_BOUNDS - 1;
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                                  int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                                  CAmount _inChainInputValue,
                                  bool _spendsCoinbase, int64_t _sigOpsCost, LockPoints lp):
     tx(_tx), nFee(_nFee), nTime(_nTime), entryPriority(_entryPriority), entryHeight(_entryHeight),
     inChainInputValue(_inChainInputValue),
-    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp)
+    spendsCoinbase(_spendsCoinbase), sigOpCost(_sigOpsCost), lockPoints(lp), nEpoch(0)
 {
     nTxWeight = GetTransactionWeight(*tx);
     nModSize = tx->CalculateModifiedSize(GetTxSize());
@@ -82,13 +98,17 @@ size_t CTxMemPoolEntry::GetTxSize() const
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    EpochGuard epoch(*this);
+    vecEntries stageEntries, vAllDescendants;
+    BOOST_FOREACH(const txiter childEntry, GetMemPoolChildren(updateIt)) {
+        visited(childEntry);
+        stageEntries.push_back(childEntry);
+    }
 
     while (!stageEntries.empty()) {
-        const txiter cit = *stageEntries.begin();
-        setAllDescendants.insert(cit);
-        stageEntries.erase(cit);
+        const txiter cit = stageEntries.back();
+        stageEntries.pop_back();
+        vAllDescendants.push_back(cit);
         const setEntries &setChildren = GetMemPoolChildren(cit);
         BOOST_FOREACH(const txiter childEntry, setChildren) {
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
@@ -96,25 +116,27 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
                 // We've already calculated this one, just add the entries for this set
                 // but don't traverse again.
                 BOOST_FOREACH(const txiter cacheEntry, cacheIt->second) {
-                    setAllDescendants.insert(cacheEntry);
+                    if (!visited(cacheEntry))
+                        vAllDescendants.push_back(cacheEntry);
                 }
-            } else if (!setAllDescendants.count(childEntry)) {
+            } else if (!visited(childEntry)) {
                 // Schedule for later processing
-                stageEntries.insert(childEntry);
+                stageEntries.push_back(childEntry);
             }
         }
     }
-    // setAllDescendants now contains all in-mempool descendants of updateIt.
+    // vAllDescendants now contains all in-mempool descendants of updateIt.
     // Update and add to cached descendant map
     int64_t modifySize = 0;
     CAmount modifyFee = 0;
     int64_t modifyCount = 0;
-    BOOST_FOREACH(txiter cit, setAllDescendants) {
+    vecEntries& vCached = cachedDescendants[updateIt];
+    BOOST_FOREACH(txiter cit, vAllDescendants) {
         if (!setExclude.count(cit->GetTx().GetHash())) {
             modifySize += cit->GetTxSize();
             modifyFee += cit->GetModifiedFee();
             modifyCount++;
-            cachedDescendants[updateIt].insert(cit);
+            vCached.push_back(cit);
             // Update ancestor state for each descendant
             mapTx.modify(cit, update_ancestor_state(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost()));
         }
@@ -145,25 +167,27 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
     // setMemPoolChildren will be updated, an assumption made in
     // UpdateForDescendants.
     BOOST_REVERSE_FOREACH(const uint256 &hash, vHashesToUpdate) {
-        // we cache the in-mempool children to avoid duplicate updates
-        setEntries setChildren;
         // calculate children from mapNextTx
         txiter it = mapTx.find(hash);
         if (it == mapTx.end()) {
             continue;
         }
-        auto iter = mapNextTx.lower_bound(COutPoint(hash, 0));
-        // First calculate the children, and update setMemPoolChildren to
-        // include them, and update their setMemPoolParents to include this tx.
-        for (; iter != mapNextTx.end() && iter->first->hash == hash; ++iter) {
-            const uint256 &childHash = iter->second->GetHash();
-            txiter childIter = mapTx.find(childHash);
-            assert(childIter != mapTx.end());
-            // We can skip updating entries we've encountered before or that
-            // are in the block (which are already accounted for).
-            if (setChildren.insert(childIter).second && !setAlreadyIncluded.count(childHash)) {
-                UpdateChild(it, childIter, true);
-                UpdateParent(childIter, it, true);
+        {
+            // we mark the in-mempool children to avoid duplicate updates
+            EpochGuard epoch(*this);
+            auto iter = mapNextTx.lower_bound(COutPoint(hash, 0));
+            // First calculate the children, and update setMemPoolChildren to
+            // include them, and update their setMemPoolParents to include this tx.
+            for (; iter != mapNextTx.end() && iter->first->hash == hash; ++iter) {
+                const uint256 &childHash = iter->second->GetHash();
+                txiter childIter = mapTx.find(childHash);
+                assert(childIter != mapTx.end());
+                // We can skip updating entries we've encountered before or that
+                // are in the block (which are already accounted for).
+                if (!visited(childIter) && !setAlreadyIncluded.count(childHash)) {
+                    UpdateChild(it, childIter, true);
+                    UpdateParent(childIter, it, true);
+                }
             }
         }
         UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded);
@@ -173,8 +197,11 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
 {
     LOCK(cs);
+    EpochGuard epoch(*this);
 
-    setEntries parentHashes;
+    // Entries are marked visited when they are staged, so each ancestor is
+    // staged at most once
+    vecEntries parentHashes;
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
@@ -183,8 +210,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // iterate mapTx to find parents.
         for (unsigned int i = 0; i < tx.vin.size(); i++) {
             txiter piter = mapTx.find(tx.vin[i].prevout.hash);
-            if (piter != mapTx.end()) {
-                parentHashes.insert(piter);
+            if (piter != mapTx.end() && !visited(piter)) {
+                parentHashes.push_back(piter);
                 if (parentHashes.size() + 1 > limitAncestorCount) {
                     errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
                     return false;
@@ -195,16 +222,19 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        BOOST_FOREACH(const txiter &piter, GetMemPoolParents(it)) {
+            visited(piter);
+            parentHashes.push_back(piter);
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
+        txiter stageit = parentHashes.back();
 
         setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
+        parentHashes.pop_back();
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
@@ -221,8 +251,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
         BOOST_FOREACH(const txiter &phash, setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
-                parentHashes.insert(phash);
+            if (!visited(phash)) {
+                parentHashes.push_back(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
@@ -273,53 +303,120 @@ void CTxMemPool::UpdateChildrenForRemoval(txiter it)
 
 void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants)
 {
-    // For each entry, walk back all ancestors and decrement size associated with this
-    // transaction
-    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    // Walk parents before children, so that the ancestors of a removed parent
+    // are in mapOutsideAncestors by the time its children need them (and
+    // children before parents for the descendants). The ancestor counts are
+    // read before anything below modifies them.
+    vecEntries vOrdered(entriesToRemove.begin(), entriesToRemove.end());
+    std::sort(vOrdered.begin(), vOrdered.end(), [](const txiter& a, const txiter& b) {
+        return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+    });
     if (updateDescendants) {
         // updateDescendants should be true whenever we're not recursively
         // removing a tx and all its descendants, eg when a transaction is
         // confirmed in a block.
         // Here we only update statistics and not data in mapLinks (which
         // we need to preserve until we're finished with all operations that
-        // need to traverse the mempool).
-        BOOST_FOREACH(txiter removeIt, entriesToRemove) {
-            setEntries setDescendants;
-            CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
+        // need to traverse the mempool). Descendants that are removed as well
+        // need no update, so only the ones outside the set are collected.
+        cacheMap mapOutsideDescendants;
+        BOOST_REVERSE_FOREACH(txiter removeIt, vOrdered) {
+            vecEntries& vDescendants = mapOutsideDescendants[removeIt];
+            {
+                EpochGuard epoch(*this);
+                vecEntries vStage;
+                BOOST_FOREACH(const txiter &citer, GetMemPoolChildren(removeIt)) {
+                    visited(citer);
+                    vStage.push_back(citer);
+                }
+                while (!vStage.empty()) {
+                    txiter stageit = vStage.back();
+                    vStage.pop_back();
+                    if (entriesToRemove.count(stageit) == 0) {
+                        vDescendants.push_back(stageit);
+                    } else {
+                        cacheMap::const_iterator cacheIt = mapOutsideDescendants.find(stageit);
+                        if (cacheIt != mapOutsideDescendants.end()) {
+                            BOOST_FOREACH(const txiter &descendantIt, cacheIt->second) {
+                                if (!visited(descendantIt))
+                                    vDescendants.push_back(descendantIt);
+                            }
+                            continue;
+                        }
+                    }
+                    BOOST_FOREACH(const txiter &childiter, GetMemPoolChildren(stageit)) {
+                        if (!visited(childiter))
+                            vStage.push_back(childiter);
+                    }
+                }
+            }
             int64_t modifySize = -((int64_t)removeIt->GetTxSize());
             CAmount modifyFee = -removeIt->GetModifiedFee();
             int modifySigOps = -removeIt->GetSigOpCost();
-            BOOST_FOREACH(txiter dit, setDescendants) {
+            BOOST_FOREACH(txiter dit, vDescendants) {
                 mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee, -1, modifySigOps));
             }
         }
     }
-    BOOST_FOREACH(txiter removeIt, entriesToRemove) {
-        setEntries setAncestors;
-        const CTxMemPoolEntry &entry = *removeIt;
-        std::string dummy;
-        // Since this is a tx that is already in the mempool, we can call CMPA
-        // with fSearchForParents = false.  If the mempool is in a consistent
-        // state, then using true or false should both be correct, though false
-        // should be a bit faster.
-        // However, if we happen to be in the middle of processing a reorg, then
-        // the mempool can be in an inconsistent state.  In this case, the set
-        // of ancestors reachable via mapLinks will be the same as the set of 
-        // ancestors whose packages include this transaction, because when we
-        // add a new transaction to the mempool in addUnchecked(), we assume it
-        // has no children, and in the case of a reorg where that assumption is
-        // false, the in-mempool children aren't linked to the in-block tx's
-        // until UpdateTransactionsFromBlock() is called.
+    cacheMap mapOutsideAncestors;
+    BOOST_FOREACH(txiter removeIt, vOrdered) {
+        // Walk the ancestors reachable via mapLinks, rather than searching
+        // the inputs. If the mempool is in a consistent state both are the
+        // same. However, if we happen to be in the middle of processing a
+        // reorg, then the mempool can be in an inconsistent state.  In this
+        // case, the set of ancestors reachable via mapLinks will be the same
+        // as the set of ancestors whose packages include this transaction,
+        // because when we add a new transaction to the mempool in
+        // addUnchecked(), we assume it has no children, and in the case of a
+        // reorg where that assumption is false, the in-mempool children aren't
+        // linked to the in-block tx's until UpdateTransactionsFromBlock() is
+        // called.
         // So if we're being called during a reorg, ie before
         // UpdateTransactionsFromBlock() has been called, then mapLinks[] will
         // differ from the set of mempool parents we'd calculate by searching,
         // and it's important that we use the mapLinks[] notion of ancestor
         // transactions as the set of things to update for removal.
-        CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
-        // Note that UpdateAncestorsOf severs the child links that point to
-        // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, setAncestors);
+        vecEntries& vAncestors = mapOutsideAncestors[removeIt];
+        {
+            EpochGuard epoch(*this);
+            vecEntries vStage;
+            BOOST_FOREACH(const txiter &piter, GetMemPoolParents(removeIt)) {
+                visited(piter);
+                vStage.push_back(piter);
+            }
+            while (!vStage.empty()) {
+                txiter stageit = vStage.back();
+                vStage.pop_back();
+                if (entriesToRemove.count(stageit) == 0) {
+                    vAncestors.push_back(stageit);
+                } else {
+                    // Removed ancestors need no update, and if one was walked
+                    // already its ancestors outside the set are known
+                    cacheMap::const_iterator cacheIt = mapOutsideAncestors.find(stageit);
+                    if (cacheIt != mapOutsideAncestors.end()) {
+                        BOOST_FOREACH(const txiter &ancestorIt, cacheIt->second) {
+                            if (!visited(ancestorIt))
+                                vAncestors.push_back(ancestorIt);
+                        }
+                        continue;
+                    }
+                }
+                BOOST_FOREACH(const txiter &phash, GetMemPoolParents(stageit)) {
+                    if (!visited(phash))
+                        vStage.push_back(phash);
+                }
+            }
+        }
+        // Sever the child links that point to removeIt in the entries for the
+        // parents of removeIt, and take it out of its ancestors' packages.
+        BOOST_FOREACH(txiter piter, GetMemPoolParents(removeIt)) {
+            UpdateChild(piter, removeIt, false);
+        }
+        const int64_t modifySize = -((int64_t)removeIt->GetTxSize());
+        const CAmount modifyFee = -removeIt->GetModifiedFee();
+        BOOST_FOREACH(txiter ancestorIt, vAncestors) {
+            mapTx.modify(ancestorIt, update_descendant_state(modifySize, modifyFee, -1));
+        }
     }
     // After updating all the ancestor sizes, we can now sever the link between each
     // transaction being removed and any mempool children (ie, update setMemPoolParents
@@ -350,7 +447,7 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
 }
 
 CTxMemPool::CTxMemPool(const CFeeRate& _minReasonableRelayFee) :
-    nTransactionsUpdated(0)
+    nTransactionsUpdated(0), nEpoch(0), fHasEpochGuard(false)
 {
     _clear(); //lock free clear
 
@@ -367,17 +464,10 @@ CTxMemPool::~CTxMemPool()
     delete minerPolicyEstimator;
 }
 
-void CTxMemPool::pruneSpent(const uint256 &hashTx, CCoins &coins)
+bool CTxMemPool::isSpent(const COutPoint& outpoint)
 {
     LOCK(cs);
-
-    auto it = mapNextTx.lower_bound(COutPoint(hashTx, 0));
-
-    // iterate over all COutPoints in mapNextTx whose hash equals the provided hashTx
-    while (it != mapNextTx.end() && it->first->hash == hashTx) {
-        coins.Spend(it->first->n); // and remove those outputs from coins
-        it++;
-    }
+    return mapNextTx.count(outpoint);
 }
 
 unsigned int CTxMemPool::GetTransactionsUpdated() const
@@ -412,6 +502,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
             mapTx.modify(newit, update_fee_delta(deltas.second));
         }
     }
+    UpdateFeeHistogram(*newit, true);
 
     // Update cachedInnerUsage to include contained transaction's usage.
     // (When we update the entry for in-mempool parents, memory usage will be
@@ -468,6 +559,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
         vTxHashes.clear();
 
     totalTxSize -= it->GetTxSize();
+    UpdateFeeHistogram(*it, false);
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
     mapLinks.erase(it);
@@ -484,27 +576,58 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants)
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
+    if (setDescendants.count(entryit) != 0) {
+        return;
     }
+    EpochGuard epoch(*this);
+    vecEntries stage(1, entryit);
+    visited(entryit);
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
     while (!stage.empty()) {
-        txiter it = *stage.begin();
+        txiter it = stage.back();
         setDescendants.insert(it);
-        stage.erase(it);
+        stage.pop_back();
 
         const setEntries &setChildren = GetMemPoolChildren(it);
         BOOST_FOREACH(const txiter &childiter, setChildren) {
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (!visited(childiter) && !setDescendants.count(childiter)) {
+                stage.push_back(childiter);
+            }
+        }
+    }
+}
+
+void CTxMemPool::CalculateDescendants(txiter entryit, vecEntries &vDescendants) const
+{
+    EpochGuard epoch(*this);
+    size_t nStart = vDescendants.size();
+    vDescendants.push_back(entryit);
+    visited(entryit);
+    // vDescendants doubles as the queue of entries whose children are unwalked
+    for (size_t i = nStart; i < vDescendants.size(); i++) {
+        BOOST_FOREACH(const txiter &childiter, GetMemPoolChildren(vDescendants[i])) {
+            if (!visited(childiter)) {
+                vDescendants.push_back(childiter);
             }
         }
     }
 }
 
+CTxMemPool::EpochGuard::EpochGuard(const CTxMemPool& poolIn) : pool(poolIn)
+{
+    AssertLockHeld(pool.cs);
+    assert(!pool.fHasEpochGuard);
+    ++pool.nEpoch;
+    pool.fHasEpochGuard = true;
+}
+
+CTxMemPool::EpochGuard::~EpochGuard()
+{
+    pool.fHasEpochGuard = false;
+}
+
 void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReason reason)
 {
     // Remove transaction from memory pool
@@ -555,10 +678,9 @@ void CTxMemPool::removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMem
                 indexed_transaction_set::const_iterator it2 = mapTx.find(txin.prevout.hash);
                 if (it2 != mapTx.end())
                     continue;
-                const CCoins *coins = pcoins->AccessCoins(txin.prevout.hash);
-                if (nCheckFrequency != 0) assert(coins);
-                int nCoinbaseMaturity = Params().GetConsensus(coins->nHeight).nCoinbaseMaturity;
-                if (!coins || (coins->IsCoinBase() && ((signed long)nMemPoolHeight) - coins->nHeight < nCoinbaseMaturity)) {
+                const Coin &coin = pcoins->AccessCoin(txin.prevout);
+                if (nCheckFrequency != 0) assert(!coin.IsSpent());
+                if (coin.IsSpent() || (coin.IsCoinBase() && ((signed long)nMemPoolHeight) - coin.nHeight < Params().GetConsensus(coin.nHeight).nCoinbaseMaturity)) {
                     txToRemove.insert(it);
                     break;
                 }
@@ -599,24 +721,24 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
 {
     LOCK(cs);
     std::vector<const CTxMemPoolEntry*> entries;
+    setEntries stage;
     for (const auto& tx : vtx)
     {
         uint256 hash = tx->GetHash();
 
         indexed_transaction_set::iterator i = mapTx.find(hash);
-        if (i != mapTx.end())
+        if (i != mapTx.end()) {
             entries.push_back(&*i);
+            stage.insert(i);
+        }
     }
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     minerPolicyEstimator->processBlock(nBlockHeight, entries);
+    // Remove the block's transactions together, so that chains confirmed by
+    // the block are walked once rather than once per transaction
+    RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
     for (const auto& tx : vtx)
     {
-        txiter it = mapTx.find(tx->GetHash());
-        if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
-        }
         removeConflicts(*tx);
         ClearPrioritisation(tx->GetHash());
     }
@@ -631,6 +753,7 @@ void CTxMemPool::_clear()
     mapNextTx.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
+    vFeeHistogram.assign(FEE_HISTOGRAM_BUCKETS, FeeHistogramBucket());
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
@@ -687,8 +810,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                     parentSigOpCost += it2->GetSigOpCost();
                 }
             } else {
-                const CCoins* coins = pcoins->AccessCoins(txin.prevout.hash);
-                assert(coins && coins->IsAvailable(txin.prevout.n));
+                assert(pcoins->HaveCoin(txin.prevout));
             }
             // Check whether its inputs are marked in mapNextTx.
             auto it3 = mapNextTx.find(txin.prevout);
@@ -772,6 +894,19 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
+
+    std::vector<FeeHistogramBucket> vCheckHistogram(FEE_HISTOGRAM_BUCKETS);
+    for (indexed_transaction_set::const_iterator it = mapTx.begin(); it != mapTx.end(); it++) {
+        FeeHistogramBucket& bucket = vCheckHistogram[GetFeeHistogramIndex(*it)];
+        bucket.nCount++;
+        bucket.nSize += it->GetTxSize();
+        bucket.nFees += it->GetModifiedFee();
+    }
+    for (unsigned int i = 0; i < FEE_HISTOGRAM_BUCKETS; i++) {
+        assert(vCheckHistogram[i].nCount == vFeeHistogram[i].nCount);
+        assert(vCheckHistogram[i].nSize == vFeeHistogram[i].nSize);
+        assert(vCheckHistogram[i].nFees == vFeeHistogram[i].nFees);
+    }
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb)
@@ -836,6 +971,21 @@ static TxMempoolInfo GetInfo(CTxMemPool::indexed_transaction_set::const_iterator
     return TxMempoolInfo{it->GetSharedTx(), it->GetTime(), CFeeRate(it->GetFee(), it->GetTxSize()), it->GetModifiedFee() - it->GetFee()};
 }
 
+std::vector<FeeHistogramBucket> CTxMemPool::GetFeeHistogram() const
+{
+    LOCK(cs);
+    return vFeeHistogram;
+}
+
+void CTxMemPool::UpdateFeeHistogram(const CTxMemPoolEntry& entry, bool add)
+{
+    FeeHistogramBucket& bucket = vFeeHistogram[GetFeeHistogramIndex(entry)];
+    const int64_t updateCount = (add ? 1 : -1);
+    bucket.nCount += updateCount;
+    bucket.nSize += updateCount * entry.GetTxSize();
+    bucket.nFees += updateCount * entry.GetModifiedFee();
+}
+
 std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
 {
     LOCK(cs);
@@ -932,7 +1082,9 @@ void CTxMemPool::PrioritiseTransaction(const uint256 hash, const std::string str
         deltas.second += nFeeDelta;
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
+            UpdateFeeHistogram(*it, false);
             mapTx.modify(it, update_fee_delta(deltas.second));
+            UpdateFeeHistogram(*it, true);
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
             uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -981,20 +1133,24 @@ bool CTxMemPool::HasNoInputsOf(const CTransaction &tx) const
 
 CCoinsViewMemPool::CCoinsViewMemPool(CCoinsView* baseIn, const CTxMemPool& mempoolIn) : CCoinsViewBacked(baseIn), mempool(mempoolIn) { }
 
-bool CCoinsViewMemPool::GetCoins(const uint256 &txid, CCoins &coins) const {
+bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
     // If an entry in the mempool exists, always return that one, as it's guaranteed to never
     // conflict with the underlying cache, and it cannot have pruned entries (as it contains full)
     // transactions. First checking the underlying cache risks returning a pruned entry instead.
-    CTransactionRef ptx = mempool.get(txid);
+    CTransactionRef ptx = mempool.get(outpoint.hash);
     if (ptx) {
-        coins = CCoins(*ptx, MEMPOOL_HEIGHT);
-        return true;
+        if (outpoint.n < ptx->vout.size()) {
+            coin = Coin(ptx->vout[outpoint.n], MEMPOOL_HEIGHT, false);
+            return true;
+        } else {
+            return false;
+        }
     }
-    return (base->GetCoins(txid, coins) && !coins.IsPruned());
+    return (base->GetCoin(outpoint, coin) && !coin.IsSpent());
 }
 
-bool CCoinsViewMemPool::HaveCoins(const uint256 &txid) const {
-    return mempool.exists(txid) || base->HaveCoins(txid);
+bool CCoinsViewMemPool::HaveCoin(const COutPoint &outpoint) const {
+    return mempool.exists(outpoint) || base->HaveCoin(outpoint);
 }
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
@@ -1105,25 +1261,60 @@ void CTxMemPool::trackPackageRemoved(const CFeeRate& rate) {
     }
 }
 
-void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<uint256>* pvNoSpendsRemaining) {
+size_t CTxMemPool::RemovalUsage(txiter entry) const {
+    // Every link of the entry also has a node in the other entry's link set
+    const TxLinks& links = mapLinks.find(entry)->second;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) + entry->DynamicMemoryUsage() +
+        2 * (memusage::DynamicUsage(links.parents) + memusage::DynamicUsage(links.children)) +
+        memusage::IncrementalDynamicUsage(mapLinks) + entry->GetTx().vin.size() * memusage::IncrementalDynamicUsage(mapNextTx) +
+        sizeof(vTxHashes[0]);
+}
+
+void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining) {
     LOCK(cs);
 
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
+    vecEntries vPackage;
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
-
-        // We set the new mempool min fee to the feerate of the removed set, plus the
-        // "minimum reasonable fee rate" (ie some value under which we consider txn
-        // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
-        // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
-        removed += incrementalRelayFee;
-        trackPackageRemoved(removed);
-        maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
-
+        // Stage the packages with the worst descendant score until removing
+        // them frees the excess by estimate, and remove them in one go. The
+        // score of an ancestor of a staged package is stale, so reaching one
+        // ends the batch; it is looked at again once its descendants are gone.
+        const size_t nExcess = DynamicMemoryUsage() - sizelimit;
+        size_t nStagedUsage = 0;
         setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
+        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        for (; it != mapTx.get<descendant_score>().end() && nStagedUsage < nExcess; ++it) {
+            txiter rootit = mapTx.project<0>(it);
+            if (stage.count(rootit))
+                continue;
+            vPackage.clear();
+            CalculateDescendants(rootit, vPackage);
+            bool fStale = false;
+            BOOST_FOREACH(txiter packageit, vPackage) {
+                if (stage.count(packageit)) {
+                    fStale = true;
+                    break;
+                }
+            }
+            if (fStale)
+                break;
+
+            // We set the new mempool min fee to the feerate of the removed set, plus the
+            // "minimum reasonable fee rate" (ie some value under which we consider txn
+            // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
+            // equal to txn which were removed with no block in between.
+            CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+            removed += incrementalRelayFee;
+            trackPackageRemoved(removed);
+            maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
+
+            BOOST_FOREACH(txiter packageit, vPackage) {
+                stage.insert(packageit);
+                nStagedUsage += RemovalUsage(packageit);
+            }
+        }
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
@@ -1138,9 +1329,7 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<uint256>* pvNoSpendsRe
                 BOOST_FOREACH(const CTxIn& txin, tx.vin) {
                     if (exists(txin.prevout.hash))
                         continue;
-                    auto iter = mapNextTx.lower_bound(COutPoint(txin.prevout.hash, 0));
-                    if (iter == mapNextTx.end() || iter->first->hash != txin.prevout.hash)
-                        pvNoSpendsRemaining->push_back(txin.prevout.hash);
+                    pvNoSpendsRemaining->push_back(txin.prevout);
                 }
             }
         }
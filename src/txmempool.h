@@ -42,7 +42,7 @@ inline bool AllowFree(double dPriority)
     return dPriority > AllowFreeThreshold();
 }
 
-/** Fake height value used in CCoins to signify they are only in the memory pool (since 0.8) */
+/** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
 struct LockPoints
@@ -112,6 +112,9 @@ private:
     int64_t nSigOpCostWithAncestors;
 
 public:
+    //! Last traversal epoch that visited this entry; see CTxMemPool::visited()
+    mutable uint64_t nEpoch;
+
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, double _entryPriority, unsigned int _entryHeight,
                     CAmount _inChainInputValue, bool spendsCoinbase,
@@ -127,6 +130,8 @@ public:
      * from entry priority. Only inputs that were originally in-chain will age.
      */
     double GetPriority(unsigned int currentHeight) const;
+    double GetEntryPriority() const { return entryPriority; }
+    CAmount GetInChainInputValue() const { return inChainInputValue; }
     const CAmount& GetFee() const { return nFee; }
     size_t GetTxSize() const;
     size_t GetTxWeight() const { return nTxWeight; }
@@ -336,6 +341,21 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/** Number of fee rate buckets in the mempool fee histogram */
+static const unsigned int FEE_HISTOGRAM_BUCKETS = 44;
+/** Lowest fee rate, in satoshis per 1000 virtual bytes, of each fee histogram bucket */
+extern const CAmount FEE_HISTOGRAM_BOUNDS[FEE_HISTOGRAM_BUCKETS];
+
+/** Mempool transactions whose own modified fee rate falls into one fee histogram bucket */
+struct FeeHistogramBucket
+{
+    uint64_t nCount; //!< number of transactions
+    uint64_t nSize;  //!< ... their total virtual size
+    CAmount nFees;   //!< ... and total modified fees
+
+    FeeHistogramBucket() : nCount(0), nSize(0), nFees(0) {}
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -443,7 +463,10 @@ private:
     mutable bool blockSinceLastRollingFeeBump;
     mutable double rollingMinimumFeeRate; //!< minimum fee to get into the pool, decreases exponentially
 
+    std::vector<FeeHistogramBucket> vFeeHistogram; //!< entries by their own modified fee rate
+
     void trackPackageRemoved(const CFeeRate& rate);
+    void UpdateFeeHistogram(const CTxMemPoolEntry& entry, bool add);
 
 public:
 
@@ -493,11 +516,12 @@ public:
         }
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
+    typedef std::vector<txiter> vecEntries;
 
     const setEntries & GetMemPoolParents(txiter entry) const;
     const setEntries & GetMemPoolChildren(txiter entry) const;
 private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
+    typedef std::map<txiter, vecEntries, CompareIteratorByHash> cacheMap;
 
     struct TxLinks {
         setEntries parents;
@@ -510,6 +534,35 @@ private:
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
+    //! Current traversal epoch, see EpochGuard
+    mutable uint64_t nEpoch;
+    mutable bool fHasEpochGuard;
+
+    /**
+     * Graph walks mark the entries they reach with the current epoch instead
+     * of collecting them in a std::set, so that a walk over a long chain does
+     * not allocate a node per entry just to avoid visiting it twice. An
+     * EpochGuard starts a fresh epoch for the duration of one walk; walks
+     * must not nest.
+     */
+    class EpochGuard
+    {
+    public:
+        explicit EpochGuard(const CTxMemPool& poolIn);
+        ~EpochGuard();
+    private:
+        const CTxMemPool& pool;
+    };
+
+    /** Mark it as visited in the current epoch; returns whether it already was. */
+    bool visited(txiter it) const
+    {
+        assert(fHasEpochGuard);
+        bool fVisited = it->nEpoch >= nEpoch;
+        it->nEpoch = nEpoch;
+        return fVisited;
+    }
+
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const;
 
 public:
@@ -546,7 +599,7 @@ public:
     void _clear(); //lock free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
     void queryHashes(std::vector<uint256>& vtxid);
-    void pruneSpent(const uint256& hash, CCoins &coins);
+    bool isSpent(const COutPoint& outpoint);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
     /**
@@ -597,6 +650,8 @@ public:
      *  Assumes that setDescendants includes all in-mempool descendants of anything
      *  already in it.  */
     void CalculateDescendants(txiter it, setEntries &setDescendants);
+    /** Append it and all its in-mempool descendants to vDescendants, each once. */
+    void CalculateDescendants(txiter it, vecEntries &vDescendants) const;
 
     /** The minimum fee to get into the mempool, which may itself not be enough
       *  for larger-sized transactions.
@@ -607,10 +662,10 @@ public:
     CFeeRate GetMinFee(size_t sizelimit) const;
 
     /** Remove transactions from the mempool until its dynamic size is <= sizelimit.
-      *  pvNoSpendsRemaining, if set, will be populated with the list of transactions
+      *  pvNoSpendsRemaining, if set, will be populated with the list of outpoints
       *  which are not in mempool which no longer have any spends in this mempool.
       */
-    void TrimToSize(size_t sizelimit, std::vector<uint256>* pvNoSpendsRemaining=NULL);
+    void TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining=NULL);
 
     /** Expire all transaction (and their dependencies) in the mempool older than time. Return the number of removed transactions. */
     int Expire(int64_t time);
@@ -636,10 +691,20 @@ public:
         return (mapTx.count(hash) != 0);
     }
 
+    bool exists(const COutPoint& outpoint) const
+    {
+        LOCK(cs);
+        auto it = mapTx.find(outpoint.hash);
+        return (it != mapTx.end() && outpoint.n < it->GetTx().vout.size());
+    }
+
     CTransactionRef get(const uint256& hash) const;
     TxMempoolInfo info(const uint256& hash) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
+    /** Count, size and fees of the transactions in each FEE_HISTOGRAM_BOUNDS bucket. */
+    std::vector<FeeHistogramBucket> GetFeeHistogram() const;
+
     /** Estimate fee rate needed to get into the next nBlocks
      *  If no answer can be given at nBlocks, return an estimate
      *  at the lowest number of blocks where one can be given
@@ -690,10 +755,15 @@ private:
     void UpdateEntryForAncestors(txiter it, const setEntries &setAncestors);
     /** For each transaction being removed, update ancestors and any direct children.
       * If updateDescendants is true, then also update in-mempool descendants'
-      * ancestor state. */
+      * ancestor state. Only ancestors outside entriesToRemove have their
+      * descendant state updated; for entries whose parents are removed as well
+      * the list of such ancestors is reused from the parent, so removing a
+      * long chain does not walk the whole chain once per entry. */
     void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry);
+    /** Upper estimate of the DynamicMemoryUsage() freed by removing an entry. */
+    size_t RemovalUsage(txiter entry) const;
 
     /** Before calling removeUnchecked for a given transaction,
      *  UpdateForRemoveFromMempool must be called on the entire (dependent) set
@@ -717,8 +787,8 @@ protected:
 
 public:
     CCoinsViewMemPool(CCoinsView* baseIn, const CTxMemPool& mempoolIn);
-    bool GetCoins(const uint256 &txid, CCoins &coins) const;
-    bool HaveCoins(const uint256 &txid) const;
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
 };
 
 // We want to sort transactions by coin age priority
@@ -0,0 +1,184 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txoutset.h"
+
+#include "compressor.h"
+#include "version.h"
+
+#include <map>
+
+#include <boost/thread/thread.hpp> // boost::this_thread::interruption_point
+
+static const unsigned char TXOUTSET_SNAPSHOT_MAGIC[5] = {'u', 't', 'x', 'o', 0xff};
+
+CCoinsStatsHasher::CCoinsStatsHasher(CCoinsStats& statsIn, const uint256& hashBlock) : stats(statsIn), ss(SER_GETHASH, PROTOCOL_VERSION), nTotalAmount(0)
+{
+    stats.hashBlock = hashBlock;
+    ss << hashBlock;
+}
+
+void CCoinsStatsHasher::ApplyOutputs()
+{
+    assert(!outputs.empty());
+    ss << hashPrev;
+    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase);
+    stats.nTransactions++;
+    for (const auto& output : outputs) {
+        ss << VARINT(output.first + 1);
+        ss << output.second.out;
+        stats.nTransactionOutputs++;
+        nTotalAmount += output.second.out.nValue;
+    }
+    ss << VARINT(0);
+    outputs.clear();
+}
+
+void CCoinsStatsHasher::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    if (!outputs.empty() && outpoint.hash != hashPrev)
+        ApplyOutputs();
+    hashPrev = outpoint.hash;
+    outputs[outpoint.n] = coin;
+}
+
+void CCoinsStatsHasher::Finish()
+{
+    if (!outputs.empty())
+        ApplyOutputs();
+    stats.hashSerialized = ss.GetHash();
+    stats.nTotalAmount = nTotalAmount;
+}
+
+CTxOutSetSnapshotHeader::CTxOutSetSnapshotHeader() : nVersion(0), nHeight(0), nChainTx(0)
+{
+    memset(pchMagic, 0, sizeof(pchMagic));
+    memset(pchMessageStart, 0, sizeof(pchMessageStart));
+}
+
+CTxOutSetSnapshotHeader::CTxOutSetSnapshotHeader(const CMessageHeader::MessageStartChars& pchMessageStartIn, const uint256& hashBlockIn, int nHeightIn, uint64_t nChainTxIn)
+    : nVersion(TXOUTSET_SNAPSHOT_VERSION), hashBlock(hashBlockIn), nHeight(nHeightIn), nChainTx(nChainTxIn)
+{
+    memcpy(pchMagic, TXOUTSET_SNAPSHOT_MAGIC, sizeof(pchMagic));
+    memcpy(pchMessageStart, pchMessageStartIn, sizeof(pchMessageStart));
+}
+
+bool CTxOutSetSnapshotHeader::IsValid() const
+{
+    return memcmp(pchMagic, TXOUTSET_SNAPSHOT_MAGIC, sizeof(pchMagic)) == 0 && nVersion == TXOUTSET_SNAPSHOT_VERSION;
+}
+
+static void WriteSnapshotGroup(CAutoFile& file, const uint256& txid, const std::vector<std::pair<uint32_t, Coin> >& vGroup)
+{
+    uint64_t nOutputs = vGroup.size();
+    uint32_t nCode = vGroup[0].second.nHeight * 2 + vGroup[0].second.fCoinBase;
+    file << VARINT(nOutputs) << txid << VARINT(nCode);
+    uint32_t nNext = 0;
+    for (const auto& output : vGroup) {
+        uint32_t nGap = output.first - nNext;
+        file << VARINT(nGap) << CTxOutCompressor(REF(output.second.out));
+        nNext = output.first + 1;
+    }
+}
+
+// Write the outputs of txid, which are sorted by index, as groups sharing the height/coinbase code
+static void WriteSnapshotTx(CAutoFile& file, const uint256& txid, const std::map<uint32_t, Coin>& outputs)
+{
+    std::vector<std::pair<uint32_t, Coin> > vGroup;
+    for (const auto& output : outputs) {
+        if (!vGroup.empty() && (output.second.nHeight != vGroup[0].second.nHeight || output.second.fCoinBase != vGroup[0].second.fCoinBase)) {
+            WriteSnapshotGroup(file, txid, vGroup);
+            vGroup.clear();
+        }
+        vGroup.push_back(output);
+    }
+    WriteSnapshotGroup(file, txid, vGroup);
+}
+
+void WriteTxOutSetSnapshot(CAutoFile& file, const CTxOutSetSnapshotHeader& header, CCoinsViewCursor* pcursor, CCoinsStats& stats)
+{
+    CCoinsStatsHasher hasher(stats, header.hashBlock);
+    file << header;
+
+    // The cursor returns the outputs of a transaction in the order of their
+    // VARINT encoded index, which is not numeric above 16511; the file
+    // stores them by index, so they are collected per transaction first
+    std::map<uint32_t, Coin> outputs;
+    uint256 txid;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin))
+            throw std::runtime_error("unable to read coin database");
+        hasher.Add(key, coin);
+        if (!outputs.empty() && key.hash != txid) {
+            WriteSnapshotTx(file, txid, outputs);
+            outputs.clear();
+        }
+        txid = key.hash;
+        outputs.emplace(key.n, std::move(coin));
+        pcursor->Next();
+    }
+    if (!outputs.empty())
+        WriteSnapshotTx(file, txid, outputs);
+    hasher.Finish();
+
+    uint64_t nEnd = 0;
+    file << VARINT(nEnd) << stats.nTransactionOutputs << stats.hashSerialized;
+}
+
+CTxOutSetSnapshotReader::CTxOutSetSnapshotReader(CAutoFile& fileIn, const CTxOutSetSnapshotHeader& header, CCoinsStats& statsIn)
+    : file(fileIn), stats(statsIn), hasher(statsIn, header.hashBlock), nCode(0), nRemaining(0), fStarted(false), fDone(false)
+{
+    stats.nHeight = header.nHeight;
+}
+
+bool CTxOutSetSnapshotReader::Next(COutPoint& outpoint, Coin& coin)
+{
+    if (fDone)
+        return false;
+
+    if (nRemaining == 0) {
+        uint64_t nOutputs;
+        file >> VARINT(nOutputs);
+        if (nOutputs == 0) {
+            hasher.Finish();
+            uint64_t nOutputsStored;
+            uint256 hashStored;
+            file >> nOutputsStored >> hashStored;
+            if (nOutputsStored != stats.nTransactionOutputs || hashStored != stats.hashSerialized)
+                throw std::ios_base::failure("snapshot checksum mismatch");
+            fDone = true;
+            return false;
+        }
+        uint256 txid;
+        file >> txid >> VARINT(nCode);
+        // Transactions come in txid order and their outputs by increasing
+        // index, which rules out duplicates
+        if (fStarted && txid < outpointNext.hash)
+            throw std::ios_base::failure("snapshot coins out of order");
+        if (!fStarted || txid != outpointNext.hash)
+            outpointNext = COutPoint(txid, 0);
+        fStarted = true;
+        nRemaining = nOutputs;
+    }
+
+    uint32_t nGap;
+    file >> VARINT(nGap);
+    uint64_t n = (uint64_t)outpointNext.n + nGap;
+    if (n >= std::numeric_limits<uint32_t>::max())
+        throw std::ios_base::failure("snapshot output index out of range");
+    outpoint = COutPoint(outpointNext.hash, n);
+    coin.nHeight = nCode >> 1;
+    coin.fCoinBase = nCode & 1;
+    file >> REF(CTxOutCompressor(coin.out));
+    if (coin.IsSpent())
+        throw std::ios_base::failure("snapshot contains a spent output");
+    outpointNext.n = n + 1;
+    nRemaining--;
+
+    hasher.Add(outpoint, coin);
+    return true;
+}
@@ -0,0 +1,136 @@
+// Copyright (c) 2026 The SmartCoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXOUTSET_H
+#define BITCOIN_TXOUTSET_H
+
+#include "arith_uint256.h"
+#include "coins.h"
+#include "hash.h"
+#include "protocol.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <map>
+#include <stdint.h>
+
+/** Statistics about the unspent transaction output set, as reported by gettxoutsetinfo */
+struct CCoinsStats
+{
+    int nHeight;
+    uint256 hashBlock;
+    uint64_t nTransactions;
+    uint64_t nTransactionOutputs;
+    uint64_t nSerializedSize;
+    uint256 hashSerialized;
+    arith_uint256 nTotalAmount;
+
+    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
+};
+
+/**
+ * Computes the counts, total amount and hash_serialized of a CCoinsStats from
+ * the coins of the set at hashBlock, passed in txid order (as a coins cursor or
+ * a snapshot reader returns them). The outputs of one transaction may come in
+ * any order.
+ */
+class CCoinsStatsHasher
+{
+public:
+    CCoinsStatsHasher(CCoinsStats& statsIn, const uint256& hashBlock);
+
+    void Add(const COutPoint& outpoint, const Coin& coin);
+    //! Account for the last transaction and set hashSerialized and nTotalAmount.
+    void Finish();
+
+private:
+    void ApplyOutputs();
+
+    CCoinsStats& stats;
+    CHashWriter ss;
+    arith_uint256 nTotalAmount;
+    uint256 hashPrev;
+    std::map<uint32_t, Coin> outputs;
+};
+
+/** Current version of the UTXO snapshot format */
+static const uint16_t TXOUTSET_SNAPSHOT_VERSION = 1;
+
+/**
+ * Header of a UTXO set snapshot file written by dumptxoutset.
+ *
+ * The header is followed by the coins in txid order, grouped by transaction:
+ * VARINT(number of outputs), txid, VARINT(height * 2 + coinbase) and for every
+ * output, by increasing index, VARINT(gap to the previous output index) and
+ * the compressed output. Unlike the database keys, which order outputs by
+ * their VARINT encoded index, the indexes here are in numeric order.
+ * A group size of 0 ends the list, followed by the number of outputs and the
+ * gettxoutsetinfo hash_serialized of the set, which doubles as the checksum.
+ */
+class CTxOutSetSnapshotHeader
+{
+public:
+    unsigned char pchMagic[5];
+    uint16_t nVersion;
+    CMessageHeader::MessageStartChars pchMessageStart;
+    //! Block the coin set belongs to
+    uint256 hashBlock;
+    int32_t nHeight;
+    //! Number of transactions in the chain up to and including hashBlock
+    uint64_t nChainTx;
+
+    CTxOutSetSnapshotHeader();
+    CTxOutSetSnapshotHeader(const CMessageHeader::MessageStartChars& pchMessageStartIn, const uint256& hashBlockIn, int nHeightIn, uint64_t nChainTxIn);
+
+    //! Whether the magic and version are ones this code can read.
+    bool IsValid() const;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(FLATDATA(pchMagic));
+        READWRITE(nVersion);
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nChainTx);
+    }
+};
+
+/**
+ * Write header and the coins from pcursor, which must be positioned at the
+ * first coin. Fills the counts, total amount and hash of stats.
+ */
+void WriteTxOutSetSnapshot(CAutoFile& file, const CTxOutSetSnapshotHeader& header, CCoinsViewCursor* pcursor, CCoinsStats& stats);
+
+/**
+ * Reads the coins of a snapshot file one by one, checking order and checksum.
+ * Coins are returned in the file's order, not in database key order.
+ */
+class CTxOutSetSnapshotReader
+{
+public:
+    //! Start reading coins; the header has already been read from file.
+    CTxOutSetSnapshotReader(CAutoFile& fileIn, const CTxOutSetSnapshotHeader& header, CCoinsStats& statsIn);
+
+    /**
+     * Read the next coin. Returns false after the last coin, once the stored
+     * output count and hash matched the coins read. Throws std::ios_base::failure
+     * on truncated, malformed or corrupted files.
+     */
+    bool Next(COutPoint& outpoint, Coin& coin);
+
+private:
+    CAutoFile& file;
+    CCoinsStats& stats;
+    CCoinsStatsHasher hasher;
+    COutPoint outpointNext;
+    uint32_t nCode;
+    uint64_t nRemaining;
+    bool fStarted;
+    bool fDone;
+};
+
+#endif // BITCOIN_TXOUTSET_H
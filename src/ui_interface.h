@@ -106,6 +106,9 @@ public:
     /** Best header has changed */
     boost::signals2::signal<void (bool, const CBlockIndex *)> NotifyHeaderTip;
 
+    /** The background miner started, stopped or measured a new hash rate */
+    boost::signals2::signal<void (bool fMining, double dHashRate)> NotifyMiningStatusChanged;
+
     /** Banlist did change. */
     boost::signals2::signal<void (void)> BannedListChanged;
 };
@@ -7,12 +7,16 @@
 
 #include "alert.h"
 #include "arith_uint256.h"
+#include "blockfilemap.h"
+#include "blockpipeline.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
+#include "crypto/scrypt.h"
 #include "hash.h"
 #include "init.h"
 #include "policy/fees.h"
@@ -66,6 +70,7 @@ CBlockIndex *pindexBestHeader = NULL;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nPrefetchThreads = 0;
 std::atomic_bool fImporting(false);
 bool fReindex = false;
 bool fTxIndex = false;
@@ -82,6 +87,7 @@ int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
 
 uint256 hashAssumeValid;
+CBlockPipeline *pblockpipeline = NULL;
 
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 CAmount maxTxFee = DEFAULT_TRANSACTION_MAXFEE;
@@ -218,6 +224,8 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
+CCoinsViewDB *pcoinsdbview = NULL;
+CCoinsViewAsyncFlush *pcoinsflusher = NULL;
 
 enum FlushStateMode {
     FLUSH_STATE_NONE,
@@ -405,15 +413,15 @@ bool CheckSequenceLocks(const CTransaction &tx, int flags, LockPoints* lp, bool
         prevheights.resize(tx.vin.size());
         for (size_t txinIndex = 0; txinIndex < tx.vin.size(); txinIndex++) {
             const CTxIn& txin = tx.vin[txinIndex];
-            CCoins coins;
-            if (!viewMemPool.GetCoins(txin.prevout.hash, coins)) {
+            Coin coin;
+            if (!viewMemPool.GetCoin(txin.prevout, coin)) {
                 return error("%s: Missing input", __func__);
             }
-            if (coins.nHeight == MEMPOOL_HEIGHT) {
+            if (coin.nHeight == MEMPOOL_HEIGHT) {
                 // Assume all mempool transaction confirm in the next block
                 prevheights[txinIndex] = tip->nHeight + 1;
             } else {
-                prevheights[txinIndex] = coins.nHeight;
+                prevheights[txinIndex] = coin.nHeight;
             }
         }
         lockPair = CalculateSequenceLocks(tx, flags, &prevheights, index);
@@ -553,9 +561,9 @@ void LimitMempoolSize(CTxMemPool& pool, size_t limit, unsigned long age) {
     if (expired != 0)
         LogPrint("mempool", "Expired %i transactions from the memory pool\n", expired);
 
-    std::vector<uint256> vNoSpendsRemaining;
+    std::vector<COutPoint> vNoSpendsRemaining;
     pool.TrimToSize(limit, &vNoSpendsRemaining);
-    BOOST_FOREACH(const uint256& removed, vNoSpendsRemaining)
+    BOOST_FOREACH(const COutPoint& removed, vNoSpendsRemaining)
         pcoinsTip->Uncache(removed);
 }
 
@@ -580,22 +588,60 @@ static bool IsCurrentForFeeEstimation()
     return true;
 }
 
-bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
-                              bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                              bool fOverrideMempoolLimit, const CAmount& nAbsurdFee, std::vector<uint256>& vHashTxnToUncache)
+/** Script flags transactions are checked against before entering the mempool */
+static unsigned int GetMemPoolScriptFlags()
+{
+    unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (!Params().RequireStandard()) {
+        scriptVerifyFlags = GetArg("-promiscuousmempoolflags", scriptVerifyFlags);
+    }
+    return scriptVerifyFlags;
+}
+
+/**
+ * A transaction on its way into the mempool. MemPoolPreChecks fills it in
+ * under cs_main and pool.cs; view then holds a private copy of the coins the
+ * transaction spends, so its scripts can be checked without any lock.
+ */
+struct MemPoolAcceptWorkspace
+{
+    CCoinsView dummy;
+    CCoinsViewCache view;
+    std::unique_ptr<CTxMemPoolEntry> entry;
+    std::set<uint256> setConflicts;
+    CTxMemPool::setEntries setAncestors;
+    CTxMemPool::setEntries allConflicting;
+    CAmount nModifiedFees;
+    CAmount nConflictingFees;
+    size_t nConflictingSize;
+    unsigned int scriptVerifyFlags;
+    //! Height the inputs are spent at, so the script phase needs no cs_main
+    int nSpendHeight;
+    //! Chain tip and mempool update count the checks ran against
+    const CBlockIndex* pindexTip;
+    unsigned int nPoolUpdated;
+
+    MemPoolAcceptWorkspace() : view(&dummy), nModifiedFees(0), nConflictingFees(0), nConflictingSize(0),
+                               scriptVerifyFlags(0), nSpendHeight(0), pindexTip(NULL), nPoolUpdated(0) {}
+};
+
+/**
+ * Everything AcceptToMemoryPoolWorker checks apart from scripts: policy,
+ * inputs, fees, ancestor limits and replacement rules. Cheap enough to run
+ * again when the chain or the mempool moved on before the transaction is
+ * added; fRecheck then skips the free transaction rate limiter, which has
+ * already counted it.
+ */
+static bool MemPoolPreChecks(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
+                             bool* pfMissingInputs, int64_t nAcceptTime, const CAmount& nAbsurdFee,
+                             std::vector<COutPoint>& coins_to_uncache, bool fRecheck, MemPoolAcceptWorkspace& ws)
 {
     const CTransaction& tx = *ptx;
     const uint256 hash = tx.GetHash();
     AssertLockHeld(cs_main);
-    if (pfMissingInputs)
-        *pfMissingInputs = false;
-
-    if (!CheckTransaction(tx, state))
-        return false; // state filled in by CheckTransaction
-
-    // Coinbase is only valid in a block, not as a loose transaction
-    if (tx.IsCoinBase())
-        return state.DoS(100, false, REJECT_INVALID, "coinbase");
+    AssertLockHeld(pool.cs);
+    ws.pindexTip = chainActive.Tip();
+    ws.nPoolUpdated = pool.GetTransactionsUpdated();
 
     // Reject transactions with witness before segregated witness activates (override with -prematurewitness)
     bool witnessEnabled = IsWitnessEnabled(chainActive.Tip(), Params().GetConsensus(chainActive.Height()));
@@ -619,9 +665,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-in-mempool");
 
     // Check for conflicts with in-memory transactions
-    std::set<uint256> setConflicts;
-    {
-    LOCK(pool.cs); // protect pool.mapNextTx
+    std::set<uint256>& setConflicts = ws.setConflicts;
     BOOST_FOREACH(const CTxIn &txin, tx.vin)
     {
         auto itConflicting = pool.mapNextTx.find(txin.prevout);
@@ -661,36 +705,34 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             }
         }
     }
-    }
 
     {
-        CCoinsView dummy;
-        CCoinsViewCache view(&dummy);
+        CCoinsView& dummy = ws.dummy;
+        CCoinsViewCache& view = ws.view;
 
         CAmount nValueIn = 0;
         LockPoints lp;
         {
-        LOCK(pool.cs);
         CCoinsViewMemPool viewMemPool(pcoinsTip, pool);
         view.SetBackend(viewMemPool);
 
-        // do we already have it?
-        bool fHadTxInCache = pcoinsTip->HaveCoinsInCache(hash);
-        if (view.HaveCoins(hash)) {
-            if (!fHadTxInCache)
-                vHashTxnToUncache.push_back(hash);
-            return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-known");
-        }
-
         // do all inputs exist?
-        // Note that this does not check for the presence of actual outputs (see the next check for that),
-        // and only helps with filling in pfMissingInputs (to determine missing vs spent).
         BOOST_FOREACH(const CTxIn txin, tx.vin) {
-            if (!pcoinsTip->HaveCoinsInCache(txin.prevout.hash))
-                vHashTxnToUncache.push_back(txin.prevout.hash);
-            if (!view.HaveCoins(txin.prevout.hash)) {
-                if (pfMissingInputs)
+            if (!pcoinsTip->HaveCoinInCache(txin.prevout)) {
+                coins_to_uncache.push_back(txin.prevout);
+            }
+            if (!view.HaveCoin(txin.prevout)) {
+                // Are inputs missing because we already have the tx?
+                for (size_t out = 0; out < tx.vout.size(); out++) {
+                    // Optimistically just do efficient check of cache for outputs
+                    if (pcoinsTip->HaveCoinInCache(COutPoint(hash, out))) {
+                        return state.Invalid(false, REJECT_ALREADY_KNOWN, "txn-already-known");
+                    }
+                }
+                // Otherwise assume this might be an orphan tx for which we just haven't seen parents yet
+                if (pfMissingInputs) {
                     *pfMissingInputs = true;
+                }
                 return false; // fMissingInputs and !state.IsInvalid() is used to detect this condition, don't set state.Invalid()
             }
         }
@@ -701,17 +743,16 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
         // Bring the best block into scope
         view.GetBestBlock();
+        ws.nSpendHeight = GetSpendHeight(view);
 
         nValueIn = view.GetValueIn(tx);
 
-        // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
+        // we have all inputs cached now, so switch back to dummy, so the scripts can be checked without locks
         view.SetBackend(dummy);
 
         // Only accept BIP68 sequence locked transactions that can be mined in the next
         // block; we don't want our mempool filled up with transactions that can't
         // be mined yet.
-        // Must keep pool.cs for this unless we change CheckSequenceLocks to take a
-        // CoinsViewCache instead of create its own
         if (!CheckSequenceLocks(tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp))
             return state.DoS(0, false, REJECT_NONSTANDARD, "non-BIP68-final");
         }
@@ -740,15 +781,16 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         // during reorgs to ensure COINBASE_MATURITY is still met.
         bool fSpendsCoinbase = false;
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
-            const CCoins *coins = view.AccessCoins(txin.prevout.hash);
-            if (coins->IsCoinBase()) {
+            const Coin &coin = view.AccessCoin(txin.prevout);
+            if (coin.IsCoinBase()) {
                 fSpendsCoinbase = true;
                 break;
             }
         }
 
-        CTxMemPoolEntry entry(ptx, nFees, nAcceptTime, dPriority, chainActive.Height(),
-                              inChainInputValue, fSpendsCoinbase, nSigOpsCost, lp);
+        ws.entry.reset(new CTxMemPoolEntry(ptx, nFees, nAcceptTime, dPriority, chainActive.Height(),
+                                           inChainInputValue, fSpendsCoinbase, nSigOpsCost, lp));
+        const CTxMemPoolEntry& entry = *ws.entry;
         unsigned int nSize = entry.GetTxSize();
 
         // Check that the transaction doesn't have an excessive number of
@@ -771,7 +813,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         // Continuously rate-limit free (really, very-low-fee) transactions
         // This mitigates 'penny-flooding' -- sending thousands of free transactions just to
         // be annoying or make others' transactions take longer to confirm.
-        if (fLimitFree && nModifiedFees < GetSmartcoinMinRelayFee(tx, nSize, !fLimitFree))
+        if (fLimitFree && !fRecheck && nModifiedFees < GetSmartcoinMinRelayFee(tx, nSize, !fLimitFree))
         {
             static CCriticalSection csFreeLimiter;
             static double dFreeCount;
@@ -797,7 +839,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
                 strprintf("%d > %d", nFees, nAbsurdFee));
 
         // Calculate in-mempool ancestors, up to a limit.
-        CTxMemPool::setEntries setAncestors;
+        CTxMemPool::setEntries& setAncestors = ws.setAncestors;
         size_t nLimitAncestors = GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
         size_t nLimitAncestorSize = GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
         size_t nLimitDescendants = GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
@@ -829,12 +871,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         CAmount nConflictingFees = 0;
         size_t nConflictingSize = 0;
         uint64_t nConflictingCount = 0;
-        CTxMemPool::setEntries allConflicting;
-
-        // If we don't hold the lock allConflicting might be incomplete; the
-        // subsequent RemoveStaged() and addUnchecked() calls don't guarantee
-        // mempool consistency for us.
-        LOCK(pool.cs);
+        CTxMemPool::setEntries& allConflicting = ws.allConflicting;
         const bool fReplacementTransaction = setConflicts.size();
         if (fReplacementTransaction)
         {
@@ -951,63 +988,127 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             }
         }
 
-        unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
-        if (!Params().RequireStandard()) {
-            scriptVerifyFlags = GetArg("-promiscuousmempoolflags", scriptVerifyFlags);
+        ws.nModifiedFees = nModifiedFees;
+        ws.nConflictingFees = nConflictingFees;
+        ws.nConflictingSize = nConflictingSize;
+        ws.scriptVerifyFlags = GetMemPoolScriptFlags();
+    }
+    return true;
+}
+
+/**
+ * Check the scripts of a transaction that passed MemPoolPreChecks against the
+ * coins in ws.view at ws.nSpendHeight. Needs no lock: the view is private to
+ * the workspace and the signature cache has its own.
+ */
+static bool MemPoolCheckScripts(const CTransaction& tx, CValidationState& state, const MemPoolAcceptWorkspace& ws, PrecomputedTransactionData& txdata)
+{
+    const CCoinsViewCache& view = ws.view;
+    const unsigned int scriptVerifyFlags = ws.scriptVerifyFlags;
+    const int nSpendHeight = ws.nSpendHeight;
+
+    if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, txdata, NULL, nSpendHeight)) {
+        // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
+        // need to turn both off, and compare against just turning off CLEANSTACK
+        // to see if the failure is specifically due to witness validation.
+        CValidationState stateDummy; // Want reported failures to be from first CheckInputs
+        if (!tx.HasWitness() && CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~(SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK), true, txdata, NULL, nSpendHeight) &&
+            !CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~SCRIPT_VERIFY_CLEANSTACK, true, txdata, NULL, nSpendHeight)) {
+            // Only the witness is missing, so the transaction itself may be fine.
+            state.SetCorruptionPossible();
         }
+        return false; // state filled in by CheckInputs
+    }
+
+    // Check again against just the consensus-critical mandatory script
+    // verification flags, in case of bugs in the standard flags that cause
+    // transactions to pass as valid when they're actually invalid. For
+    // instance the STRICTENC flag was incorrectly allowing certain
+    // CHECKSIG NOT scripts to pass, even though they were invalid.
+    //
+    // There is a similar check in CreateNewBlock() to prevent creating
+    // invalid blocks, however allowing such transactions into the mempool
+    // can be exploited as a DoS attack.
+    if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata, NULL, nSpendHeight))
+    {
+        return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
+            __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+    }
+    return true;
+}
 
-        // Check against previous transactions
-        // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        PrecomputedTransactionData txdata(tx);
-        if (!CheckInputs(tx, state, view, true, scriptVerifyFlags, true, txdata)) {
-            // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
-            // need to turn both off, and compare against just turning off CLEANSTACK
-            // to see if the failure is specifically due to witness validation.
-            CValidationState stateDummy; // Want reported failures to be from first CheckInputs
-            if (!tx.HasWitness() && CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~(SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK), true, txdata) &&
-                !CheckInputs(tx, stateDummy, view, true, scriptVerifyFlags & ~SCRIPT_VERIFY_CLEANSTACK, true, txdata)) {
-                // Only the witness is missing, so the transaction itself may be fine.
-                state.SetCorruptionPossible();
-            }
-            return false; // state filled in by CheckInputs
-        }
-
-        // Check again against just the consensus-critical mandatory script
-        // verification flags, in case of bugs in the standard flags that cause
-        // transactions to pass as valid when they're actually invalid. For
-        // instance the STRICTENC flag was incorrectly allowing certain
-        // CHECKSIG NOT scripts to pass, even though they were invalid.
-        //
-        // There is a similar check in CreateNewBlock() to prevent creating
-        // invalid blocks, however allowing such transactions into the mempool
-        // can be exploited as a DoS attack.
-        if (!CheckInputs(tx, state, view, true, MANDATORY_SCRIPT_VERIFY_FLAGS, true, txdata))
-        {
-            return error("%s: BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s, %s",
-                __func__, hash.ToString(), FormatStateMessage(state));
+bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx, bool fLimitFree,
+                              bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
+                              bool fOverrideMempoolLimit, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache)
+{
+    const CTransaction& tx = *ptx;
+    const uint256 hash = tx.GetHash();
+    if (pfMissingInputs)
+        *pfMissingInputs = false;
+
+    if (!CheckTransaction(tx, state))
+        return false; // state filled in by CheckTransaction
+
+    // Coinbase is only valid in a block, not as a loose transaction
+    if (tx.IsCoinBase())
+        return state.DoS(100, false, REJECT_INVALID, "coinbase");
+
+    MemPoolAcceptWorkspace ws;
+    {
+        LOCK2(cs_main, pool.cs);
+        if (!MemPoolPreChecks(pool, state, ptx, fLimitFree, pfMissingInputs, nAcceptTime, nAbsurdFee, coins_to_uncache, false, ws))
+            return false;
+    }
+
+    // Check against previous transactions
+    // This is done last to help prevent CPU exhaustion denial-of-service attacks.
+    // Unless the caller holds cs_main, other transactions and blocks are
+    // processed meanwhile.
+    PrecomputedTransactionData txdata(tx);
+    if (!MemPoolCheckScripts(tx, state, ws, txdata))
+        return false;
+
+    {
+        LOCK2(cs_main, pool.cs);
+        // If the chain or the mempool changed while the scripts were checked,
+        // run the other checks again. The scripts only depend on the spent
+        // outputs, which the outpoints fix, and on the flags.
+        MemPoolAcceptWorkspace* pws = &ws;
+        std::unique_ptr<MemPoolAcceptWorkspace> pwsRecheck;
+        if (ws.pindexTip != chainActive.Tip() || ws.nPoolUpdated != pool.GetTransactionsUpdated()) {
+            pwsRecheck.reset(new MemPoolAcceptWorkspace());
+            if (!MemPoolPreChecks(pool, state, ptx, fLimitFree, pfMissingInputs, nAcceptTime, nAbsurdFee, coins_to_uncache, true, *pwsRecheck))
+                return false;
+            // Coinbase maturity depends on the height the inputs are spent at
+            if (!Consensus::CheckTxInputs(Params(), tx, state, pwsRecheck->view, pwsRecheck->nSpendHeight))
+                return false;
+            if (pwsRecheck->scriptVerifyFlags != ws.scriptVerifyFlags && !MemPoolCheckScripts(tx, state, *pwsRecheck, txdata))
+                return false;
+            pws = pwsRecheck.get();
         }
+        const unsigned int nSize = pws->entry->GetTxSize();
 
         // Remove conflicting transactions from the mempool
-        BOOST_FOREACH(const CTxMemPool::txiter it, allConflicting)
+        BOOST_FOREACH(const CTxMemPool::txiter it, pws->allConflicting)
         {
             LogPrint("mempool", "replacing tx %s with %s for %s BTC additional fees, %d delta bytes\n",
                     it->GetTx().GetHash().ToString(),
                     hash.ToString(),
-                    FormatMoney(nModifiedFees - nConflictingFees),
-                    (int)nSize - (int)nConflictingSize);
+                    FormatMoney(pws->nModifiedFees - pws->nConflictingFees),
+                    (int)nSize - (int)pws->nConflictingSize);
             if (plTxnReplaced)
                 plTxnReplaced->push_back(it->GetSharedTx());
         }
-        pool.RemoveStaged(allConflicting, false, MemPoolRemovalReason::REPLACED);
+        pool.RemoveStaged(pws->allConflicting, false, MemPoolRemovalReason::REPLACED);
 
         // This transaction should only count for fee estimation if it isn't a
         // BIP 125 replacement transaction (may not be widely supported), the
         // node is not behind, and the transaction is not dependent on any other
         // transactions in the mempool.
-        bool validForFeeEstimation = !fReplacementTransaction && IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
+        bool validForFeeEstimation = pws->setConflicts.empty() && IsCurrentForFeeEstimation() && pool.HasNoInputsOf(tx);
 
         // Store transaction in memory
-        pool.addUnchecked(hash, entry, setAncestors, validForFeeEstimation);
+        pool.addUnchecked(hash, *pws->entry, pws->setAncestors, validForFeeEstimation);
 
         // trim mempool and check if tx was trimmed
         if (!fOverrideMempoolLimit) {
@@ -1026,10 +1127,11 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                         bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
                         bool fOverrideMempoolLimit, const CAmount nAbsurdFee)
 {
-    std::vector<uint256> vHashTxToUncache;
-    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, vHashTxToUncache);
+    std::vector<COutPoint> coins_to_uncache;
+    bool res = AcceptToMemoryPoolWorker(pool, state, tx, fLimitFree, pfMissingInputs, nAcceptTime, plTxnReplaced, fOverrideMempoolLimit, nAbsurdFee, coins_to_uncache);
     if (!res) {
-        BOOST_FOREACH(const uint256& hashTx, vHashTxToUncache)
+        LOCK(cs_main);
+        BOOST_FOREACH(const COutPoint& hashTx, coins_to_uncache)
             pcoinsTip->Uncache(hashTx);
     }
     // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
@@ -1081,15 +1183,8 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
     }
 
     if (fAllowSlow) { // use coin database to locate block that contains transaction, and scan it
-        int nHeight = -1;
-        {
-            const CCoinsViewCache& view = *pcoinsTip;
-            const CCoins* coins = view.AccessCoins(hash);
-            if (coins)
-                nHeight = coins->nHeight;
-        }
-        if (nHeight > 0)
-            pindexSlow = chainActive[nHeight];
+        const Coin& coin = AccessByTxid(*pcoinsTip, hash);
+        if (!coin.IsSpent()) pindexSlow = chainActive[coin.nHeight];
     }
 
     if (pindexSlow) {
@@ -1142,25 +1237,66 @@ bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHea
 /* Generic implementation of block reading that can handle
    both a block and its header.  */
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+/**
+ * Locate the block stored at pos in the memory-mapped block file. The network
+ * magic and size written in front of every block are checked and bound the
+ * returned range. Returns false if the block file cannot be mapped.
+ */
+static bool GetMappedBlock(const CDiskBlockPos& pos, std::shared_ptr<const CBlockFileMap>& map, const unsigned char*& pchBlock, unsigned int& nSize)
+{
+    if (pos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t))
+        return false;
+    map = blockfilemaps.Get(pos.nFile, pos.nPos);
+    if (!map)
+        return false;
+    const unsigned char* pchHeader = map->data() + pos.nPos - CMessageHeader::MESSAGE_START_SIZE - sizeof(uint32_t);
+    if (memcmp(pchHeader, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0)
+        return false;
+    nSize = ReadLE32(pchHeader + CMessageHeader::MESSAGE_START_SIZE);
+    if (nSize > MAX_BLOCK_SERIALIZED_SIZE)
+        return false;
+    if (pos.nPos + nSize > map->size()) {
+        map = blockfilemaps.Get(pos.nFile, pos.nPos + nSize);
+        if (!map)
+            return false;
+    }
+    pchBlock = map->data() + pos.nPos;
+    return true;
+}
+
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckPOW)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    std::shared_ptr<const CBlockFileMap> map;
+    const unsigned char* pchBlock;
+    unsigned int nSize;
+    if (GetMappedBlock(pos, map, pchBlock, nSize)) {
+        // Deserialize straight from the page cache
+        try {
+            CMemoryReader reader(SER_DISK, CLIENT_VERSION, pchBlock, nSize);
+            reader >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
-    if (!CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
 
     return true;
@@ -1168,14 +1304,62 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams))
+    // With a stored PoW hash, matching the block hash against the index is enough to
+    // know the header is the one whose PoW was verified when it was accepted.
+    bool fHavePoWHash = pindex->nStatus & BLOCK_HAVE_POW_HASH;
+    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams, !fHavePoWHash))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                 pindex->ToString(), pindex->GetBlockPos().ToString());
+    if (fHavePoWHash && !CheckProofOfWork(pindex->hashPoW, block.nBits, consensusParams))
+        return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): Errors in block header at %s", pindex->GetBlockPos().ToString());
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CBlockIndex* pindex)
+{
+    const CDiskBlockPos pos = pindex->GetBlockPos();
+    std::shared_ptr<const CBlockFileMap> map;
+    const unsigned char* pchBlock;
+    unsigned int nSize;
+    if (GetMappedBlock(pos, map, pchBlock, nSize)) {
+        vchBlock.assign(pchBlock, pchBlock + nSize);
+    } else {
+        // Open history file at the magic and size in front of the block
+        if (pos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(uint32_t))
+            return error("%s: invalid position %s", __func__, pos.ToString());
+        CDiskBlockPos posHeader(pos.nFile, pos.nPos - CMessageHeader::MESSAGE_START_SIZE - sizeof(uint32_t));
+        CAutoFile filein(OpenBlockFile(posHeader, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+        try {
+            CMessageHeader::MessageStartChars pchMessageStart;
+            filein >> FLATDATA(pchMessageStart) >> nSize;
+            if (memcmp(pchMessageStart, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0)
+                return error("%s: block magic mismatch at %s", __func__, pos.ToString());
+            if (nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                return error("%s: block size %u too large at %s", __func__, nSize, pos.ToString());
+            vchBlock.resize(nSize);
+            filein.read((char*)vchBlock.data(), nSize);
+        }
+        catch (const std::exception& e) {
+            return error("%s: I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    }
+
+    // The header comes first; its hash ties the bytes to the index entry
+    if (vchBlock.size() < BLOCK_HEADER_SIZE || Hash(vchBlock.begin(), vchBlock.begin() + BLOCK_HEADER_SIZE) != pindex->GetBlockHash())
+        return error("%s: block hash doesn't match index for %s at %s", __func__, pindex->ToString(), pos.ToString());
+    return true;
+}
+
+bool IsRawBlockSerialization(const CBlockIndex* pindex, int nSerializeFlags, const Consensus::Params& consensusParams)
+{
+    return !(nSerializeFlags & SERIALIZE_TRANSACTION_NO_WITNESS) || !IsWitnessEnabled(pindex->pprev, consensusParams);
+}
+
 // From Litecoin, not used
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
@@ -1397,24 +1581,14 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
     if (!tx.IsCoinBase()) {
         txundo.vprevout.reserve(tx.vin.size());
         BOOST_FOREACH(const CTxIn &txin, tx.vin) {
-            CCoinsModifier coins = inputs.ModifyCoins(txin.prevout.hash);
-            unsigned nPos = txin.prevout.n;
-
-            if (nPos >= coins->vout.size() || coins->vout[nPos].IsNull())
-                assert(false);
             // mark an outpoint spent, and construct undo information
-            txundo.vprevout.push_back(CTxInUndo(coins->vout[nPos]));
-            coins->Spend(nPos);
-            if (coins->vout.size() == 0) {
-                CTxInUndo& undo = txundo.vprevout.back();
-                undo.nHeight = coins->nHeight;
-                undo.fCoinBase = coins->fCoinBase;
-                undo.nVersion = coins->nVersion;
-            }
+            txundo.vprevout.emplace_back();
+            bool is_spent = inputs.SpendCoin(txin.prevout, &txundo.vprevout.back());
+            assert(is_spent);
         }
     }
     // add outputs
-    inputs.ModifyNewCoins(tx.GetHash(), tx.IsCoinBase())->FromTx(tx, nHeight);
+    AddCoins(inputs, tx, nHeight);
 }
 
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
@@ -1432,6 +1606,62 @@ bool CScriptCheck::operator()() {
     return true;
 }
 
+bool CHeaderPoWCheck::operator()() {
+    GetPoWHashes(pheaders, nCount, phashes);
+    return true;
+}
+
+bool CCoinsPrefetchCheck::operator()() {
+    for (size_t i = 0; i < nCount; i++) {
+        try {
+            if (!view->GetCoin(poutpoints[i], pcoins[i]))
+                pcoins[i].Clear();
+        } catch (const std::runtime_error&) {
+            // Leave it to the validation thread, which reports database errors
+            pcoins[i].Clear();
+        }
+    }
+    return true;
+}
+
+/** A block read from a block file on its way to AcceptBlock */
+struct CBlockLoadJob
+{
+    //! The serialized block, as read from the file
+    CDataStream ssRaw;
+    //! Where the block sits, when importing our own block files
+    CDiskBlockPos pos;
+    //! The deserialized block; NULL if it could not be deserialized
+    std::shared_ptr<CBlock> pblock;
+    //! Proof-of-work hash computed while checking it
+    uint256 hashPoW;
+    //! The block is already stored, so it is only deserialized, not checked
+    bool fHaveData;
+
+    CBlockLoadJob() : ssRaw(SER_DISK, CLIENT_VERSION), fHaveData(false) {}
+};
+
+bool CBlockLoadCheck::operator()() {
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    try {
+        pjob->ssRaw >> *pblock;
+    } catch (const std::exception& e) {
+        LogPrintf("LoadExternalBlockFile: Deserialize or I/O error - %s\n", e.what());
+        return true;
+    }
+    pjob->ssRaw.clear();
+    if (pjob->fHaveData) {
+        pjob->pblock = pblock;
+        return true;
+    }
+    // Marks the block as checked on success; on failure AcceptBlock repeats
+    // the checks and reports them with the block's context.
+    CValidationState state;
+    CheckBlock(*pblock, state, true, true, &pjob->hashPoW);
+    pjob->pblock = pblock;
+    return true;
+}
+
 int GetSpendHeight(const CCoinsViewCache& inputs)
 {
     LOCK(cs_main);
@@ -1452,22 +1682,22 @@ bool CheckTxInputs(const CChainParams& params, const CTransaction& tx, CValidati
         for (unsigned int i = 0; i < tx.vin.size(); i++)
         {
             const COutPoint &prevout = tx.vin[i].prevout;
-            const CCoins *coins = inputs.AccessCoins(prevout.hash);
-            assert(coins);
+            const Coin& coin = inputs.AccessCoin(prevout);
+            assert(!coin.IsSpent());
 
             // If prev is coinbase, check that it's matured
-            if (coins->IsCoinBase()) {
+            if (coin.IsCoinBase()) {
                 // Dogecoin: Switch maturity at depth 145,000
-                int nCoinbaseMaturity = params.GetConsensus(coins->nHeight).nCoinbaseMaturity;
-                if (nSpendHeight - coins->nHeight < nCoinbaseMaturity)
+                int nCoinbaseMaturity = params.GetConsensus(coin.nHeight).nCoinbaseMaturity;
+                if (nSpendHeight - (int)coin.nHeight < nCoinbaseMaturity)
                     return state.Invalid(false,
                         REJECT_INVALID, "bad-txns-premature-spend-of-coinbase",
-                        strprintf("tried to spend coinbase at depth %d", nSpendHeight - coins->nHeight));
+                        strprintf("tried to spend coinbase at depth %d", nSpendHeight - (int)coin.nHeight));
             }
 
             // Check for negative or overflow input values
-            nValueIn += coins->vout[prevout.n].nValue;
-            if (!MoneyRange(coins->vout[prevout.n].nValue) || !MoneyRange(nValueIn))
+            nValueIn += coin.out.nValue;
+            if (!MoneyRange(coin.out.nValue) || !MoneyRange(nValueIn))
                 return state.DoS(100, false, REJECT_INVALID, "bad-txns-inputvalues-outofrange");
 
         }
@@ -1487,11 +1717,11 @@ bool CheckTxInputs(const CChainParams& params, const CTransaction& tx, CValidati
 }
 }// namespace Consensus
 
-bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks)
+bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &inputs, bool fScriptChecks, unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks, int nSpendHeight)
 {
     if (!tx.IsCoinBase())
     {
-        if (!Consensus::CheckTxInputs(Params(), tx, state, inputs, GetSpendHeight(inputs)))
+        if (!Consensus::CheckTxInputs(Params(), tx, state, inputs, nSpendHeight >= 0 ? nSpendHeight : GetSpendHeight(inputs)))
             return false;
 
         if (pvChecks)
@@ -1509,11 +1739,19 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
         if (fScriptChecks) {
             for (unsigned int i = 0; i < tx.vin.size(); i++) {
                 const COutPoint &prevout = tx.vin[i].prevout;
-                const CCoins* coins = inputs.AccessCoins(prevout.hash);
-                assert(coins);
+                const Coin& coin = inputs.AccessCoin(prevout);
+                assert(!coin.IsSpent());
+
+                // We very carefully only pass in things to CScriptCheck which
+                // are clearly committed to by tx' witness hash. This provides
+                // a sanity check that our caching is not introducing consensus
+                // failures through additional data in, eg, the coins being
+                // spent being checked as a part of CScriptCheck.
+                const CScript& scriptPubKey = coin.out.scriptPubKey;
+                const CAmount amount = coin.out.nValue;
 
                 // Verify signature
-                CScriptCheck check(*coins, tx, i, flags, cacheStore, &txdata);
+                CScriptCheck check(scriptPubKey, amount, tx, i, flags, cacheStore, &txdata);
                 if (pvChecks) {
                     pvChecks->push_back(CScriptCheck());
                     check.swap(pvChecks->back());
@@ -1525,7 +1763,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
                         // arguments; if so, don't trigger DoS protection to
                         // avoid splitting the network between upgraded and
                         // non-upgraded nodes.
-                        CScriptCheck check2(*coins, tx, i,
+                        CScriptCheck check2(scriptPubKey, amount, tx, i,
                                 flags & ~STANDARD_NOT_MANDATORY_VERIFY_FLAGS, cacheStore, &txdata);
                         if (check2())
                             return state.Invalid(false, REJECT_NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
@@ -1623,34 +1861,30 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 } // anon namespace
 
 /**
- * Apply the undo operation of a CTxInUndo to the given chain state.
- * @param undo The undo object.
+ * Restore the UTXO in a Coin at a given COutPoint
+ * @param undo The Coin to be restored.
  * @param view The coins view to which to apply the changes.
  * @param out The out point that corresponds to the tx input.
  * @return True on success.
  */
-bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const COutPoint& out)
+bool ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 {
     bool fClean = true;
 
-    CCoinsModifier coins = view.ModifyCoins(out.hash);
-    if (undo.nHeight != 0) {
-        // undo data contains height: this is the last output of the prevout tx being spent
-        if (!coins->IsPruned())
-            fClean = fClean && error("%s: undo data overwriting existing transaction", __func__);
-        coins->Clear();
-        coins->fCoinBase = undo.fCoinBase;
-        coins->nHeight = undo.nHeight;
-        coins->nVersion = undo.nVersion;
-    } else {
-        if (coins->IsPruned())
-            fClean = fClean && error("%s: undo data adding output to missing transaction", __func__);
-    }
-    if (coins->IsAvailable(out.n))
+    if (view.HaveCoin(out))
         fClean = fClean && error("%s: undo data overwriting existing output", __func__);
-    if (coins->vout.size() < out.n+1)
-        coins->vout.resize(out.n+1);
-    coins->vout[out.n] = undo.txout;
+
+    if (undo.nHeight == 0) {
+        // Missing undo metadata (height and coinbase). Older versions included this
+        // information only in undo records for the last spend of a transactions'
+        // outputs. This implies that it must be present for some other output of the same tx.
+        const Coin& alternate = AccessByTxid(view, out.hash);
+        if (alternate.IsSpent())
+            return error("%s: undo data adding output to missing transaction", __func__);
+        undo.nHeight = alternate.nHeight;
+        undo.fCoinBase = alternate.fCoinBase;
+    }
+    view.AddCoin(out, std::move(undo), !fClean);
 
     return fClean;
 }
@@ -1678,35 +1912,28 @@ bool DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockI
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
+        bool is_coinbase = tx.IsCoinBase();
 
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
-        {
-        CCoinsModifier outs = view.ModifyCoins(hash);
-        outs->ClearUnspendable();
-
-        CCoins outsBlock(tx, pindex->nHeight);
-        // The CCoins serialization does not serialize negative numbers.
-        // No network rules currently depend on the version here, so an inconsistency is harmless
-        // but it must be corrected before txout nversion ever influences a network rule.
-        if (outsBlock.nVersion < 0)
-            outs->nVersion = outsBlock.nVersion;
-        if (*outs != outsBlock)
-            fClean = fClean && error("DisconnectBlock(): added transaction mismatch? database corrupted");
-
-        // remove outputs
-        outs->Clear();
+        for (size_t o = 0; o < tx.vout.size(); o++) {
+            if (!tx.vout[o].scriptPubKey.IsUnspendable()) {
+                COutPoint out(hash, o);
+                Coin coin;
+                bool is_spent = view.SpendCoin(out, &coin);
+                if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != (int)coin.nHeight || is_coinbase != (bool)coin.fCoinBase)
+                    fClean = fClean && error("DisconnectBlock(): added transaction mismatch? database corrupted");
+            }
         }
 
         // restore inputs
         if (i > 0) { // not coinbases
-            const CTxUndo &txundo = blockUndo.vtxundo[i-1];
+            CTxUndo &txundo = blockUndo.vtxundo[i-1];
             if (txundo.vprevout.size() != tx.vin.size())
                 return error("DisconnectBlock(): transaction and undo data inconsistent");
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
-                const CTxInUndo &undo = txundo.vprevout[j];
-                if (!ApplyTxInUndo(undo, view, out))
+                if (!ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out))
                     fClean = false;
             }
         }
@@ -1731,8 +1958,10 @@ void static FlushBlockFile(bool fFinalize = false)
 
     FILE *fileOld = OpenBlockFile(posOld);
     if (fileOld) {
-        if (fFinalize)
+        if (fFinalize) {
+            blockfilemaps.Invalidate(nLastBlockFile);
             TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
+        }
         FileCommit(fileOld);
         fclose(fileOld);
     }
@@ -1755,6 +1984,137 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CHeaderPoWCheck> headerpowcheckqueue(1);
+
+void ThreadHeaderPoWCheck() {
+    RenameThread("smartcoin-powch");
+    headerpowcheckqueue.Thread();
+}
+
+static CCheckQueue<CCoinsPrefetchCheck> coinsprefetchqueue(1);
+
+void ThreadCoinsPrefetch() {
+    RenameThread("smartcoin-prefetch");
+    coinsprefetchqueue.Thread();
+}
+
+static CCheckQueue<CBlockLoadCheck> blockloadqueue(1);
+
+void ThreadBlockLoad() {
+    RenameThread("smartcoin-blockload");
+    blockloadqueue.Thread();
+}
+
+/** Transactions whose scripts are checked per hold of the script check queue, so blocks can interleave */
+static const size_t PREVERIFY_TXS_PER_ROUND = 64;
+
+void PreverifyMemPoolScripts(CTxMemPool& pool, const std::vector<CTransactionRef>& vtx)
+{
+    if (!nScriptCheckThreads || vtx.empty())
+        return;
+
+    const unsigned int scriptVerifyFlags = GetMemPoolScriptFlags();
+
+    std::map<COutPoint, const CTxOut*> mapBatchOutputs;
+    for (const auto& tx : vtx) {
+        for (size_t i = 0; i < tx->vout.size(); i++)
+            mapBatchOutputs.emplace(COutPoint(tx->GetHash(), i), &tx->vout[i]);
+    }
+
+    for (size_t nStart = 0; nStart < vtx.size(); nStart += PREVERIFY_TXS_PER_ROUND) {
+        const size_t nEnd = std::min(vtx.size(), nStart + PREVERIFY_TXS_PER_ROUND);
+        // The checks point into vTxData, which must not reallocate
+        std::vector<PrecomputedTransactionData> vTxData;
+        vTxData.reserve(nEnd - nStart);
+        std::vector<CScriptCheck> vChecks;
+        {
+            LOCK2(cs_main, pool.cs);
+            CCoinsViewMemPool viewMemPool(pcoinsTip, pool);
+            for (size_t i = nStart; i < nEnd; i++) {
+                const CTransaction& tx = *vtx[i];
+                if (tx.IsCoinBase())
+                    continue;
+                std::vector<CTxOut> vSpent;
+                vSpent.reserve(tx.vin.size());
+                for (const CTxIn& txin : tx.vin) {
+                    auto it = mapBatchOutputs.find(txin.prevout);
+                    Coin coin;
+                    if (it != mapBatchOutputs.end())
+                        vSpent.push_back(*it->second);
+                    else if (viewMemPool.GetCoin(txin.prevout, coin))
+                        vSpent.push_back(coin.out);
+                    else
+                        break;
+                }
+                if (vSpent.size() != tx.vin.size())
+                    continue;
+                vTxData.emplace_back(tx);
+                for (size_t j = 0; j < tx.vin.size(); j++)
+                    vChecks.emplace_back(vSpent[j].scriptPubKey, vSpent[j].nValue, tx, j, scriptVerifyFlags, true, &vTxData.back());
+            }
+        }
+
+        // A failing check only makes the queue skip the rest of this round;
+        // AcceptToMemoryPool verifies everything again either way.
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+}
+
+/** Outpoints handed to a prefetch thread at a time */
+static const size_t PREFETCH_RUN_SIZE = 16;
+
+/**
+ * Load the inputs of a block that are not yet in pcoinsTip from the coins
+ * database before ConnectBlock asks for them. The reads are spread over the
+ * prefetch threads, so a block's random lookups are in flight together
+ * instead of being issued one at a time by the validation thread.
+ * Returns the number of outpoints looked up.
+ */
+static size_t PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (!nPrefetchThreads || !pcoinsflusher || block.vtx.size() < 2)
+        return 0;
+
+    // Outputs created within the block are not in the database yet
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx)
+        setBlockTxids.insert(tx->GetHash());
+
+    std::vector<COutPoint> vMissing;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!setBlockTxids.count(txin.prevout.hash) && !pcoinsTip->HaveCoinInCache(txin.prevout))
+                vMissing.push_back(txin.prevout);
+        }
+    }
+    if (vMissing.empty())
+        return 0;
+
+    std::vector<Coin> vCoins(vMissing.size());
+    const size_t nRun = std::max<size_t>(1, std::min(PREFETCH_RUN_SIZE, vMissing.size() / nPrefetchThreads));
+    std::vector<CCoinsPrefetchCheck> vChecks;
+    vChecks.reserve((vMissing.size() + nRun - 1) / nRun);
+    for (size_t i = 0; i < vMissing.size(); i += nRun)
+        vChecks.emplace_back(pcoinsflusher, &vMissing[i], &vCoins[i], std::min(nRun, vMissing.size() - i));
+    {
+        CCheckQueueControl<CCoinsPrefetchCheck> control(&coinsprefetchqueue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+
+    // The coins view cannot have changed underneath us: flushing requires cs_main.
+    for (size_t i = 0; i < vMissing.size(); i++) {
+        if (!vCoins[i].IsSpent())
+            pcoinsTip->EmplaceCoinFromBase(vMissing[i], std::move(vCoins[i]));
+    }
+    return vMissing.size();
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1800,6 +2160,40 @@ public:
 // Protected by cs_main
 static ThresholdConditionCache warningcache[VERSIONBITS_NUM_BITS];
 
+/**
+ * Whether pindex is an ancestor of the assumed-valid block deep enough below
+ * the best header that its scripts need not be verified.
+ */
+static bool IsAssumedValid(const CBlockIndex* pindex, const Consensus::Params& consensus)
+{
+    AssertLockHeld(cs_main);
+    if (!hashAssumeValid.IsNull()) {
+        // We've been configured with the hash of a block which has been externally verified to have a valid history.
+        // A suitable default value is included with the software and updated from time to time.  Because validity
+        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
+        // This setting doesn't force the selection of any particular chain but makes validating some faster by
+        //  effectively caching the result of part of the verification.
+        BlockMap::const_iterator  it = mapBlockIndex.find(hashAssumeValid);
+        if (it != mapBlockIndex.end()) {
+            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
+                pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
+                pindexBestHeader->nChainWork >= UintToArith256(consensus.nMinimumChainWork)) {
+                // This block is a member of the assumed verified chain and an ancestor of the best header.
+                // The equivalent time check discourages hashpower from extorting the network via DOS attack
+                //  into accepting an invalid block through telling users they must manually set assumevalid.
+                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
+                //  it hard to hide the implication of the demand.  This also avoids having release candidates
+                //  that are hardly doing any signature verification at all in testing without having to
+                //  artificially set the default assumed verified block further back.
+                // The test against nMinimumChainWork prevents the skipping when denied access to any chain at
+                //  least as good as the expected chain.
+                return GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensus) > 60 * 60 * 24 * 7 * 2;
+            }
+        }
+    }
+    return false;
+}
+
 static int64_t nTimeCheck = 0;
 static int64_t nTimeForks = 0;
 static int64_t nTimeVerify = 0;
@@ -1832,31 +2226,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         return true;
     }
 
-    bool fScriptChecks = true;
-    if (!hashAssumeValid.IsNull()) {
-        // We've been configured with the hash of a block which has been externally verified to have a valid history.
-        // A suitable default value is included with the software and updated from time to time.  Because validity
-        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
-        // This setting doesn't force the selection of any particular chain but makes validating some faster by
-        //  effectively caching the result of part of the verification.
-        BlockMap::const_iterator  it = mapBlockIndex.find(hashAssumeValid);
-        if (it != mapBlockIndex.end()) {
-            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->nChainWork >= UintToArith256(consensus.nMinimumChainWork)) {
-                // This block is a member of the assumed verified chain and an ancestor of the best header.
-                // The equivalent time check discourages hashpower from extorting the network via DOS attack
-                //  into accepting an invalid block through telling users they must manually set assumevalid.
-                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
-                //  it hard to hide the implication of the demand.  This also avoids having release candidates
-                //  that are hardly doing any signature verification at all in testing without having to
-                //  artificially set the default assumed verified block further back.
-                // The test against nMinimumChainWork prevents the skipping when denied access to any chain at
-                //  least as good as the expected chain.
-                fScriptChecks = (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensus) <= 60 * 60 * 24 * 7 * 2);
-            }
-        }
-    }
+    bool fScriptChecks = !IsAssumedValid(pindex, consensus);
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
     LogPrint("bench", "    - Sanity checks: %.2fms [%.2fs]\n", 0.001 * (nTime1 - nTimeStart), nTimeCheck * 0.000001);
@@ -1888,10 +2258,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     if (fEnforceBIP30) {
         for (const auto& tx : block.vtx) {
-            const CCoins* coins = view.AccessCoins(tx->GetHash());
-            if (coins && !coins->IsPruned())
-                return state.DoS(100, error("ConnectBlock(): tried to overwrite transaction"),
-                                 REJECT_INVALID, "bad-txns-BIP30");
+            for (size_t o = 0; o < tx->vout.size(); o++) {
+                if (view.HaveCoin(COutPoint(tx->GetHash(), o))) {
+                    return state.DoS(100, error("ConnectBlock(): tried to overwrite transaction"),
+                                     REJECT_INVALID, "bad-txns-BIP30");
+                }
+            }
         }
     }
 
@@ -1959,7 +2331,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             // be in ConnectBlock because they require the UTXO set
             prevheights.resize(tx.vin.size());
             for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoins(tx.vin[j].prevout.hash)->nHeight;
+                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
             }
 
             if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex)) {
@@ -2139,24 +2511,28 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
                 return AbortNode(state, "Failed to write to block index database");
             }
         }
-        // Finally remove any pruned files
-        if (fFlushForPrune)
-            UnlinkPrunedFiles(setFilesToPrune);
         nLastWrite = nNow;
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
     if (fDoFullFlush) {
-        // Typical CCoins structures on disk are around 128 bytes in size.
+        // Typical Coin structures on disk are around 48 bytes in size.
         // Pushing a new one to the database can cause it to be written
         // twice (once in the log, and once in the tables). This is already
         // an overestimation, as most will delete an existing entry or
         // overwrite one. Still, use a conservative safety factor of 2.
-        if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
+        if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
+        // The coins are written in the background unless the caller needs
+        // them on disk now, or block files are about to be removed.
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
+        if ((mode == FLUSH_STATE_ALWAYS || fFlushForPrune) && pcoinsflusher && !pcoinsflusher->Sync())
+            return AbortNode(state, "Failed to write to coin database");
         nLastFlush = nNow;
+        // Finally remove any pruned files
+        if (fFlushForPrune)
+            UnlinkPrunedFiles(setFilesToPrune);
     }
     if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
         // Update best block in wallet (so we can detect restored wallets).
@@ -2298,6 +2674,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2324,7 +2701,12 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     assert(pindexNew->pprev == chainActive.Tip());
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
-    if (!pblock) {
+    std::shared_ptr<const CBlock> pblockPipelined;
+    if (!pblock && pblockpipeline)
+        pblockPipelined = pblockpipeline->Take(pindexNew->GetBlockHash());
+    if (pblockPipelined) {
+        connectTrace.blocksConnected.emplace_back(pindexNew, pblockPipelined);
+    } else if (!pblock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         connectTrace.blocksConnected.emplace_back(pindexNew, pblockNew);
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus(pindexNew->nHeight)))
@@ -2335,8 +2717,13 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     const CBlock& blockConnecting = *connectTrace.blocksConnected.back().second;
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    const int64_t nTimeLoaded = nTime2;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    size_t nPrefetched = PrefetchBlockInputs(blockConnecting);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint("bench", "  - Prefetch inputs: %.2fms (%u lookups) [%.2fs]\n", (nTimePrefetched - nTime2) * 0.001, nPrefetched, nTimePrefetch * 0.000001);
+    nTime2 = nTimePrefetched;
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -2353,6 +2740,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
+    if (pblockPipelined)
+        pblockpipeline->RecordConnect(blockConnecting.vtx.size(), nTime4 - nTimeLoaded);
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
@@ -2456,6 +2845,8 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
             return false;
         fBlocksDisconnected = true;
     }
+    if (fBlocksDisconnected && pblockpipeline)
+        pblockpipeline->Clear();
 
     // Build list of new blocks to connect.
     std::vector<CBlockIndex*> vpindexToConnect;
@@ -2474,6 +2865,17 @@ static bool ActivateBestChainStep(CValidationState& state, const CChainParams& c
         }
         nHeight = nTargetHeight;
 
+        // Start loading the assumed-valid blocks we are about to connect
+        if (pblockpipeline) {
+            BOOST_REVERSE_FOREACH(CBlockIndex *pindexLoad, vpindexToConnect) {
+                if (pindexLoad == pindexMostWork && pblock)
+                    break;
+                if (!IsAssumedValid(pindexLoad, chainparams.GetConsensus(pindexLoad->nHeight)))
+                    break;
+                pblockpipeline->Enqueue(pindexLoad);
+            }
+        }
+
         // Connect new blocks.
         BOOST_REVERSE_FOREACH(CBlockIndex *pindexConnect, vpindexToConnect) {
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace)) {
@@ -2763,6 +3165,37 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
     return pindexNew;
 }
 
+/**
+ * Set nChainTx of pindex, whose parents all have theirs, and of the descendants
+ * that were waiting for it in mapBlocksUnlinked, making them candidates for the tip.
+ */
+static void LinkChainTx(CBlockIndex* pindexNew)
+{
+    std::deque<CBlockIndex*> queue;
+    queue.push_back(pindexNew);
+
+    // Recursively process any descendant blocks that now may be eligible to be connected.
+    while (!queue.empty()) {
+        CBlockIndex *pindex = queue.front();
+        queue.pop_front();
+        pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
+        {
+            LOCK(cs_nBlockSequenceId);
+            pindex->nSequenceId = nBlockSequenceId++;
+        }
+        if (chainActive.Tip() == NULL || !setBlockIndexCandidates.value_comp()(pindex, chainActive.Tip())) {
+            setBlockIndexCandidates.insert(pindex);
+        }
+        std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex);
+        while (range.first != range.second) {
+            std::multimap<CBlockIndex*, CBlockIndex*>::iterator it = range.first;
+            queue.push_back(it->second);
+            range.first++;
+            mapBlocksUnlinked.erase(it);
+        }
+    }
+}
+
 /** Mark a block as having its data received and checked (up to BLOCK_VALID_TRANSACTIONS). */
 bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBlockIndex *pindexNew, const CDiskBlockPos& pos)
 {
@@ -2780,29 +3213,7 @@ bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBl
 
     if (pindexNew->pprev == NULL || pindexNew->pprev->nChainTx) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
-        std::deque<CBlockIndex*> queue;
-        queue.push_back(pindexNew);
-
-        // Recursively process any descendant blocks that now may be eligible to be connected.
-        while (!queue.empty()) {
-            CBlockIndex *pindex = queue.front();
-            queue.pop_front();
-            pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
-            {
-                LOCK(cs_nBlockSequenceId);
-                pindex->nSequenceId = nBlockSequenceId++;
-            }
-            if (chainActive.Tip() == NULL || !setBlockIndexCandidates.value_comp()(pindex, chainActive.Tip())) {
-                setBlockIndexCandidates.insert(pindex);
-            }
-            std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapBlocksUnlinked.equal_range(pindex);
-            while (range.first != range.second) {
-                std::multimap<CBlockIndex*, CBlockIndex*>::iterator it = range.first;
-                queue.push_back(it->second);
-                range.first++;
-                mapBlocksUnlinked.erase(it);
-            }
-        }
+        LinkChainTx(pindexNew);
     } else {
         if (pindexNew->pprev && pindexNew->pprev->IsValid(BLOCK_VALID_TREE)) {
             mapBlocksUnlinked.insert(std::make_pair(pindexNew->pprev, pindexNew));
@@ -2812,6 +3223,70 @@ bool ReceivedBlockTransactions(const CBlock &block, CValidationState& state, CBl
     return true;
 }
 
+bool ActivateTxOutSetSnapshot(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindex, uint64_t nChainTx,
+                              const std::function<bool(COutPoint&, Coin&)>& fnNext, const std::function<bool()>& fnVerify)
+{
+    AssertLockHeld(cs_main);
+    assert(fPruneMode);
+
+    CBlockIndex* pindexOldTip = chainActive.Tip();
+    if (pindex->nHeight <= chainActive.Height() || pindex->GetAncestor(chainActive.Height()) != pindexOldTip)
+        return state.Error("snapshot block does not extend the active chain");
+    std::vector<CBlockIndex*> vPath;
+    for (CBlockIndex* pindexWalk = pindex; pindexWalk != pindexOldTip; pindexWalk = pindexWalk->pprev) {
+        if (!pindexWalk->IsValid(BLOCK_VALID_TREE))
+            return state.Error("snapshot block has invalid ancestors");
+        vPath.push_back(pindexWalk);
+    }
+    std::reverse(vPath.begin(), vPath.end());
+
+    // The old tip's coins must all be in the database before they are replaced
+    if (!FlushStateToDisk(state, FLUSH_STATE_ALWAYS))
+        return false;
+    if (pblockpipeline)
+        pblockpipeline->Clear();
+
+    try {
+        bool fMismatch = false;
+        if (!pcoinsdbview->LoadCoins(fnNext, [&fnVerify, &fMismatch]() { fMismatch = !fnVerify(); return !fMismatch; }, pindex->GetBlockHash()))
+            return AbortNode(state, fMismatch ? "UTXO snapshot changed while it was being loaded" : "Failed to write UTXO snapshot to the coin database");
+    } catch (const std::exception& e) {
+        return AbortNode(state, strprintf("Failed to load UTXO snapshot: %s", e.what()));
+    }
+    pcoinsTip->SetBestBlock(pindex->GetBlockHash());
+
+    // Blocks up to the snapshot that were never downloaded count as validated and
+    // pruned. Their transaction counts are unknown: each gets one, and the snapshot
+    // block the rest, which gives it the snapshot's nChainTx.
+    uint64_t nChainTxPrev = pindexOldTip->nChainTx;
+    for (CBlockIndex* pindexWalk : vPath) {
+        if (pindexWalk->nTx == 0)
+            pindexWalk->nTx = (pindexWalk == pindex && nChainTx > nChainTxPrev) ? nChainTx - nChainTxPrev : 1;
+        nChainTxPrev += pindexWalk->nTx;
+        if (IsWitnessEnabled(pindexWalk->pprev, chainparams.GetConsensus(pindexWalk->nHeight)))
+            pindexWalk->nStatus |= BLOCK_OPT_WITNESS;
+        pindexWalk->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        setDirtyBlockIndex.insert(pindexWalk);
+    }
+    for (CBlockIndex* pindexWalk : vPath) {
+        if (pindexWalk->nChainTx == 0)
+            LinkChainTx(pindexWalk);
+    }
+
+    chainActive.SetTip(pindex);
+    PruneBlockIndexCandidates();
+    mempool.clear();
+    if (!fHavePruned) {
+        pblocktree->WriteFlag("prunedblockfiles", true);
+        fHavePruned = true;
+    }
+    LogPrintf("%s: new best=%s height=%d log2_work=%.8g tx=%lu from UTXO snapshot\n", __func__,
+        pindex->GetBlockHash().ToString(), pindex->nHeight, log(pindex->nChainWork.getdouble()) / log(2.0), (unsigned long)pindex->nChainTx);
+
+    CheckBlockIndex(chainparams.GetConsensus(pindex->nHeight));
+    return FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
+}
+
 bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false)
 {
     LOCK(cs_LastBlockFile);
@@ -2900,19 +3375,29 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
     return true;
 }
 
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW)
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW, uint256* phashPoW)
 {
     // Check proof of work matches claimed amount
     // We don't have block height as this is called without context (i.e. without
     // knowing the previous block), but that's okay, as the checks done are permissive
     // (i.e. doesn't check work limit or whether AuxPoW is enabled)
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, Params().GetConsensus(0)))
-        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+    if (fCheckPOW) {
+        uint256 hashPoW;
+        if (phashPoW && !phashPoW->IsNull()) {
+            hashPoW = *phashPoW;
+        } else {
+            hashPoW = block.GetPoWHash();
+            if (phashPoW)
+                *phashPoW = hashPoW;
+        }
+        if (!CheckProofOfWork(hashPoW, block.nBits, Params().GetConsensus(0)))
+            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
+    }
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot)
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bool fCheckMerkleRoot, uint256* phashPoW)
 {
     // These are checks that are independent of context.
 
@@ -2921,7 +3406,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW, bo
 
     // Check that the header is valid (particularly PoW).  This is mostly
     // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, fCheckPOW))
+    if (!CheckBlockHeader(block, state, fCheckPOW, phashPoW))
         return false;
 
     // Check the merkle root.
@@ -3174,13 +3659,14 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, const CB
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* phashPoWIn = NULL)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
+    uint256 hashPoW = phashPoWIn ? *phashPoWIn : uint256();
     if (hash != chainparams.GetConsensus(0).hashGenesisBlock) {
 
         if (miSelf != mapBlockIndex.end()) {
@@ -3193,7 +3679,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state))
+        if (!CheckBlockHeader(block, state, true, &hashPoW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3212,8 +3698,13 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
         if (!ContextualCheckBlockHeader(block, state, pindexPrev, GetAdjustedTime()))
             return error("%s: Consensus::ContextualCheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
     }
-    if (pindex == NULL)
+    if (pindex == NULL) {
         pindex = AddToBlockIndex(block);
+        if (!hashPoW.IsNull()) {
+            pindex->hashPoW = hashPoW;
+            pindex->nStatus |= BLOCK_HAVE_POW_HASH;
+        }
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -3226,11 +3717,44 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Compute the PoW hashes of headers we don't know yet before taking cs_main,
+    // batching them through the multi-lane scrypt kernel.
+    std::vector<CBlockHeader> vNewHeaders;
+    std::vector<size_t> vNewIndex;
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); i++) {
+            if (!mapBlockIndex.count(headers[i].GetHash())) {
+                vNewHeaders.push_back(headers[i]);
+                vNewIndex.push_back(i);
+            }
+        }
+    }
+    std::vector<uint256> vPoWHashes(headers.size());
+    if (!vNewHeaders.empty()) {
+        std::vector<uint256> vNewPoWHashes(vNewHeaders.size());
+        if (nScriptCheckThreads) {
+            // Hand out runs that fill the multi-lane scrypt kernel to the worker threads
+            const size_t nRun = std::max(1, scrypt_multi_lanes());
+            std::vector<CHeaderPoWCheck> vChecks;
+            vChecks.reserve((vNewHeaders.size() + nRun - 1) / nRun);
+            for (size_t i = 0; i < vNewHeaders.size(); i += nRun)
+                vChecks.emplace_back(&vNewHeaders[i], &vNewPoWHashes[i], std::min(nRun, vNewHeaders.size() - i));
+            CCheckQueueControl<CHeaderPoWCheck> control(&headerpowcheckqueue);
+            control.Add(vChecks);
+            control.Wait();
+        } else {
+            GetPoWHashes(vNewHeaders.data(), vNewHeaders.size(), vNewPoWHashes.data());
+        }
+        for (size_t i = 0; i < vNewIndex.size(); i++)
+            vPoWHashes[vNewIndex[i]] = vNewPoWHashes[i];
+    }
+
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < headers.size(); i++) {
             CBlockIndex *pindex = NULL; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(headers[i], state, chainparams, &pindex, &vPoWHashes[i])) {
                 return false;
             }
             if (ppindex) {
@@ -3243,7 +3767,7 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
 }
 
 /** Store block on disk. If dbp is non-NULL, the file is known to already reside on disk */
-static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock)
+static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock, const uint256* phashPoW = NULL)
 {
     const CBlock& block = *pblock;
 
@@ -3253,7 +3777,7 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
     CBlockIndex *pindexDummy = NULL;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    if (!AcceptBlockHeader(block, state, chainparams, &pindex))
+    if (!AcceptBlockHeader(block, state, chainparams, &pindex, phashPoW))
         return false;
 
     // Try to process all requested blocks that we don't have, but only
@@ -3283,7 +3807,9 @@ static bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidation
     }
     if (fNewBlock) *fNewBlock = true;
 
-    if (!CheckBlock(block, state) ||
+    // The header's PoW hash is known by now, so CheckBlock need not hash it again
+    uint256 hashPoW = (pindex->nStatus & BLOCK_HAVE_POW_HASH) ? pindex->hashPoW : uint256();
+    if (!CheckBlock(block, state, true, true, &hashPoW) ||
         !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3443,6 +3969,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockfilemaps.Invalidate(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -3593,6 +4120,92 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
     return pindexNew;
 }
 
+/** Apply the effects of a block on the utxo cache, ignoring that it may already have been applied. */
+static bool RollforwardBlock(const CBlockIndex* pindex, CCoinsViewCache& inputs, const CChainParams& params)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, params.GetConsensus(pindex->nHeight))) {
+        return error("ReplayBlock(): ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+    }
+
+    for (const CTransactionRef& tx : block.vtx) {
+        if (!tx->IsCoinBase()) {
+            for (const CTxIn &txin : tx->vin) {
+                inputs.SpendCoin(txin.prevout);
+            }
+        }
+        // Pass check = true as every addition may be an overwrite.
+        AddCoins(inputs, *tx, pindex->nHeight, true);
+    }
+    return true;
+}
+
+bool ReplayBlocks(const CChainParams& params, CCoinsView* view)
+{
+    LOCK(cs_main);
+
+    CCoinsViewCache cache(view);
+
+    std::vector<uint256> hashHeads = view->GetHeadBlocks();
+    if (hashHeads.empty()) return true; // We're already in a consistent state.
+    if (hashHeads.size() != 2) return error("ReplayBlocks(): unknown inconsistent state");
+
+    uiInterface.ShowProgress(_("Replaying blocks..."), 0);
+    LogPrintf("Replaying blocks\n");
+
+    const CBlockIndex* pindexOld = NULL;  // Old tip during the interrupted flush.
+    const CBlockIndex* pindexNew;         // New tip during the interrupted flush.
+    const CBlockIndex* pindexFork = NULL; // Latest block common to both the old and the new tip.
+
+    if (mapBlockIndex.count(hashHeads[0]) == 0) {
+        return error("ReplayBlocks(): reorganization to unknown block requested");
+    }
+    pindexNew = mapBlockIndex[hashHeads[0]];
+
+    if (!hashHeads[1].IsNull()) { // The old tip is allowed to be 0, indicating it's the first flush.
+        if (mapBlockIndex.count(hashHeads[1]) == 0) {
+            return error("ReplayBlocks(): reorganization from unknown block requested");
+        }
+        pindexOld = mapBlockIndex[hashHeads[1]];
+        pindexFork = LastCommonAncestor(pindexOld, pindexNew);
+        assert(pindexFork != NULL);
+    }
+
+    // Rollback along the old branch.
+    while (pindexOld != pindexFork) {
+        if (pindexOld->nHeight > 0) { // Never disconnect the genesis block.
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindexOld, params.GetConsensus(pindexOld->nHeight))) {
+                return error("RollbackBlock(): ReadBlockFromDisk() failed at %d, hash=%s", pindexOld->nHeight, pindexOld->GetBlockHash().ToString());
+            }
+            LogPrintf("Rolling back %s (%i)\n", pindexOld->GetBlockHash().ToString(), pindexOld->nHeight);
+            // An unclean disconnect means the block never had all its effects
+            // applied. Writing and deleting coins are idempotent, so the result
+            // is still the UTXO set with the block undone.
+            CValidationState state;
+            bool fClean = true;
+            cache.SetBestBlock(pindexOld->GetBlockHash());
+            if (!DisconnectBlock(block, state, pindexOld, cache, &fClean)) {
+                return error("RollbackBlock(): DisconnectBlock failed at %d, hash=%s", pindexOld->nHeight, pindexOld->GetBlockHash().ToString());
+            }
+        }
+        pindexOld = pindexOld->pprev;
+    }
+
+    // Roll forward from the forking point to the new tip.
+    int nForkHeight = pindexFork ? pindexFork->nHeight : 0;
+    for (int nHeight = nForkHeight + 1; nHeight <= pindexNew->nHeight; ++nHeight) {
+        const CBlockIndex* pindex = pindexNew->GetAncestor(nHeight);
+        LogPrintf("Rolling forward %s (%i)\n", pindex->GetBlockHash().ToString(), nHeight);
+        if (!RollforwardBlock(pindex, cache, params)) return false;
+    }
+
+    cache.SetBestBlock(pindexNew->GetBlockHash());
+    cache.Flush();
+    uiInterface.ShowProgress("", 100);
+    return true;
+}
+
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
     if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
@@ -3687,6 +4300,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("txindex", fTxIndex);
     LogPrintf("%s: transaction index %s\n", __func__, fTxIndex ? "enabled" : "disabled");
 
+    // Finish a chainstate write that was interrupted
+    if (pcoinsdbview && !ReplayBlocks(chainparams, pcoinsdbview))
+        return error("%s: unable to replay blocks, rebuild the chainstate with -reindex-chainstate", __func__);
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
@@ -3965,10 +4582,81 @@ bool InitBlockIndex(const CChainParams& chainparams)
     return true;
 }
 
+/** Blocks read from a block file and handed to the block load threads at a time */
+static const size_t LOAD_RUN_BLOCKS = 128;
+/** Serialized size at which a run is handed over early */
+static const size_t LOAD_RUN_BYTES = 16 << 20;
+
+/**
+ * Scan blkdat for the next run of serialized blocks and copy them out
+ * without deserializing them. Sets fEnd once no further block can be found.
+ */
+static void ReadBlockRun(CBufferedFile& blkdat, uint64_t& nRewind, const CChainParams& chainparams, const CDiskBlockPos* dbp, std::vector<CBlockLoadJob>& vJobs, bool& fEnd)
+{
+    size_t nBytes = 0;
+    vJobs.reserve(LOAD_RUN_BLOCKS);
+    while (vJobs.size() < LOAD_RUN_BLOCKS && nBytes < LOAD_RUN_BYTES) {
+        if (blkdat.eof()) {
+            fEnd = true;
+            return;
+        }
+        boost::this_thread::interruption_point();
+
+        blkdat.SetPos(nRewind);
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> FLATDATA(buf);
+            if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            fEnd = true;
+            return;
+        }
+        try {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            blkdat.SetPos(nBlockPos);
+            CBlockLoadJob job;
+            if (dbp) {
+                job.pos = *dbp;
+                job.pos.nPos = nBlockPos;
+            }
+            job.ssRaw.resize(nSize);
+            blkdat.read(&job.ssRaw[0], nSize);
+            nRewind = blkdat.GetPos();
+            nBytes += nSize;
+            vJobs.push_back(std::move(job));
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+}
+
+// Map of disk positions for blocks with unknown parent (only used for reindex)
+static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+// Proof-of-work hashes of those blocks, so they are not hashed again when their parent shows up
+static std::map<uint256, uint256> mapUnknownParentPoW;
+
+void ClearBlocksUnknownParent()
+{
+    mapBlocksUnknownParent.clear();
+    mapUnknownParentPoW.clear();
+}
+
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp)
 {
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
@@ -3976,104 +4664,121 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> FLATDATA(buf);
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
+        // Blocks move through three runs: read from the file on this thread,
+        // deserialized and checked on the block load threads, and finally
+        // accepted here in file order. Each stage works on a different run.
+        std::vector<CBlockLoadJob> vRead, vChecking, vChecked;
+        bool fEnd = false;
+        bool fStop = false;
+        ReadBlockRun(blkdat, nRewind, chainparams, dbp, vRead, fEnd);
+        while (!fStop && (!vRead.empty() || !vChecked.empty())) {
+            vChecking.swap(vRead);
+            vRead.clear();
+            // Blocks we already store are skipped below, so do not hash them
+            {
+                LOCK(cs_main);
+                for (CBlockLoadJob& job : vChecking) {
+                    BlockMap::iterator mi = mapBlockIndex.find(Hash(job.ssRaw.begin(), job.ssRaw.begin() + 80));
+                    job.fHaveData = mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA);
+                }
             }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                // detect out of order blocks, and store them for later
-                uint256 hash = block.GetHash();
-                if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
-                    LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                            block.hashPrevBlock.ToString());
-                    if (dbp)
-                        mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+            CCheckQueueControl<CBlockLoadCheck> control(&blockloadqueue);
+            std::vector<CBlockLoadCheck> vChecks;
+            vChecks.reserve(vChecking.size());
+            for (CBlockLoadJob& job : vChecking)
+                vChecks.emplace_back(&job);
+            control.Add(vChecks);
+
+            if (!fEnd)
+                ReadBlockRun(blkdat, nRewind, chainparams, dbp, vRead, fEnd);
+
+            for (CBlockLoadJob& job : vChecked) {
+                if (!job.pblock)
                     continue;
-                }
+                try {
+                    std::shared_ptr<const CBlock> pblock = job.pblock;
+                    const CBlock& block = *pblock;
+
+                    // detect out of order blocks, and store them for later
+                    uint256 hash = block.GetHash();
+                    if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex.find(block.hashPrevBlock) == mapBlockIndex.end()) {
+                        LogPrint("reindex", "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
+                                block.hashPrevBlock.ToString());
+                        if (dbp) {
+                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, job.pos));
+                            mapUnknownParentPoW[hash] = job.hashPoW;
+                        }
+                        continue;
+                    }
 
-                // process in case the block isn't known yet
-                if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
-                    CValidationState state;
-                    if (AcceptBlock(pblock, state, chainparams, NULL, true, dbp, NULL))
-                        nLoaded++;
-                    if (state.IsError())
-                        break;
-                } else if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
-                    LogPrint("reindex", "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
-                }
+                    // process in case the block isn't known yet
+                    if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
+                        LOCK(cs_main);
+                        CValidationState state;
+                        if (AcceptBlock(pblock, state, chainparams, NULL, true, dbp ? &job.pos : NULL, NULL, &job.hashPoW))
+                            nLoaded++;
+                        if (state.IsError()) {
+                            fStop = true;
+                            break;
+                        }
+                    } else if (hash != chainparams.GetConsensus(0).hashGenesisBlock && mapBlockIndex[hash]->nHeight % 1000 == 0) {
+                        LogPrint("reindex", "Block Import: already had block %s at height %d\n", hash.ToString(), mapBlockIndex[hash]->nHeight);
+                    }
 
-                // Activate the genesis block so normal node progress can continue
-                if (hash == chainparams.GetConsensus(0).hashGenesisBlock) {
-                    CValidationState state;
-                    if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                    // Activate the genesis block so normal node progress can continue
+                    if (hash == chainparams.GetConsensus(0).hashGenesisBlock) {
+                        CValidationState state;
+                        if (!ActivateBestChain(state, chainparams)) {
+                            fStop = true;
+                            break;
+                        }
                     }
-                }
 
-                NotifyHeaderTip();
-
-                // Recursively process earlier encountered successors of this block
-                std::deque<uint256> queue;
-                queue.push_back(hash);
-                while (!queue.empty()) {
-                    uint256 head = queue.front();
-                    queue.pop_front();
-                    std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
-                    while (range.first != range.second) {
-                        std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
-                        // TODO: Need a valid consensus height
-                        if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus(0)))
-                        {
-                            LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
-                                    head.ToString());
-                            LOCK(cs_main);
-                            CValidationState dummy;
-                            if (AcceptBlock(pblockrecursive, dummy, chainparams, NULL, true, &it->second, NULL))
+                    NotifyHeaderTip();
+
+                    // Recursively process earlier encountered successors of this block
+                    std::deque<uint256> queue;
+                    queue.push_back(hash);
+                    while (!queue.empty()) {
+                        uint256 head = queue.front();
+                        queue.pop_front();
+                        std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
+                        while (range.first != range.second) {
+                            std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
+                            std::shared_ptr<CBlock> pblockrecursive = std::make_shared<CBlock>();
+                            // The PoW hash was recorded when the block was first read, and
+                            // AcceptBlock checks it
+                            if (ReadBlockFromDisk(*pblockrecursive, it->second, chainparams.GetConsensus(0), false))
                             {
-                                nLoaded++;
-                                queue.push_back(pblockrecursive->GetHash());
+                                LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__, pblockrecursive->GetHash().ToString(),
+                                        head.ToString());
+                                uint256 hashPoW;
+                                std::map<uint256, uint256>::iterator itPoW = mapUnknownParentPoW.find(pblockrecursive->GetHash());
+                                if (itPoW != mapUnknownParentPoW.end()) {
+                                    hashPoW = itPoW->second;
+                                    mapUnknownParentPoW.erase(itPoW);
+                                }
+                                LOCK(cs_main);
+                                CValidationState dummy;
+                                if (AcceptBlock(pblockrecursive, dummy, chainparams, NULL, true, &it->second, NULL, &hashPoW))
+                                {
+                                    nLoaded++;
+                                    queue.push_back(pblockrecursive->GetHash());
+                                }
                             }
+                            range.first++;
+                            mapBlocksUnknownParent.erase(it);
+                            NotifyHeaderTip();
                         }
-                        range.first++;
-                        mapBlocksUnknownParent.erase(it);
-                        NotifyHeaderTip();
                     }
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-            } catch (const std::exception& e) {
-                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+
+            control.Wait();
+            vChecked.swap(vChecking);
+            vChecking.clear();
         }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
@@ -4289,7 +4994,116 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
     return VersionBitsStateSinceHeight(chainActive.Tip(), params, pos, versionbitscache);
 }
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_METADATA = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION = 2;
+/** Transactions read from mempool.dat per round of parallel script checks */
+static const size_t MEMPOOL_LOAD_BATCH_SIZE = 1000;
+
+/**
+ * A mempool.dat record. Version 1 files only hold the transaction, its time
+ * and fee delta; version 2 adds the state the entry had in the dumped
+ * mempool, which is reused when it is loaded on top of the same tip.
+ */
+struct MempoolDumpEntry
+{
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+    CAmount nFee;
+    double entryPriority;
+    unsigned int entryHeight;
+    CAmount inChainInputValue;
+    bool fSpendsCoinbase;
+    int64_t nSigOpCost;
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+
+    MempoolDumpEntry() : nTime(0), nFeeDelta(0), nFee(0), entryPriority(0), entryHeight(0), inChainInputValue(0),
+                         fSpendsCoinbase(false), nSigOpCost(0), nCountWithAncestors(0), nSizeWithAncestors(0) {}
+};
+
+/**
+ * Add e to the mempool without running AcceptToMemoryPool, for entries dumped
+ * on top of hashBlock with script flags nScriptFlags. While those are still
+ * the current tip and flags, the scripts and the recorded fee still hold, so
+ * only check the inputs are there and unspent, the package limits and the
+ * relay policy, which may have changed since the dump. Returns false if the
+ * entry needs full validation.
+ */
+static bool LoadTrustedMempoolEntry(const MempoolDumpEntry& e, const uint256& hashBlock, unsigned int nScriptFlags)
+{
+    const CTransaction& tx = *e.tx;
+    const uint256 hash = tx.GetHash();
+    {
+        LOCK2(cs_main, mempool.cs);
+        // cs_main is released between entries, so a block may have connected
+        if (!chainActive.Tip() || chainActive.Tip()->GetBlockHash() != hashBlock || nScriptFlags != GetMemPoolScriptFlags())
+            return false;
+        if (tx.IsCoinBase() || mempool.exists(hash) || !CheckFinalTx(tx, STANDARD_LOCKTIME_VERIFY_FLAGS))
+            return false;
+
+        // Same policy checks as MemPoolPreChecks, as -datacarrier,
+        // -permitbaremultisig and the like may differ from the dumping run
+        bool witnessEnabled = IsWitnessEnabled(chainActive.Tip(), Params().GetConsensus(chainActive.Height()));
+        if (!GetBoolArg("-prematurewitness", false) && tx.HasWitness() && !witnessEnabled)
+            return false;
+        std::string reason;
+        if (fRequireStandard && !IsStandardTx(tx, reason, witnessEnabled))
+            return false;
+
+        CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+        CCoinsViewCache view(&viewMemPool);
+        BOOST_FOREACH(const CTxIn& txin, tx.vin) {
+            if (mempool.mapNextTx.count(txin.prevout) || !view.HaveCoin(txin.prevout))
+                return false;
+        }
+
+        LockPoints lp;
+        if (!CheckSequenceLocks(tx, STANDARD_LOCKTIME_VERIFY_FLAGS, &lp))
+            return false;
+
+        if (fRequireStandard && (!AreInputsStandard(tx, view) || (tx.HasWitness() && !IsWitnessStandard(tx, view))))
+            return false;
+        if (e.nSigOpCost > MAX_STANDARD_TX_SIGOPS_COST)
+            return false;
+
+        CTxMemPoolEntry entry(e.tx, e.nFee, e.nTime, e.entryPriority, e.entryHeight,
+                              e.inChainInputValue, e.fSpendsCoinbase, e.nSigOpCost, lp);
+
+        // Entries paying less than -minrelaytxfee or the mempool minimum are
+        // left to AcceptToMemoryPool and its free transaction rules
+        const unsigned int nSize = entry.GetTxSize();
+        CAmount nModifiedFees = e.nFee;
+        double nPriorityDummy = 0;
+        mempool.ApplyDeltas(hash, nPriorityDummy, nModifiedFees);
+        CAmount mempoolRejectFee = mempool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+        if (nModifiedFees < mempoolRejectFee || nModifiedFees < GetSmartcoinMinRelayFee(tx, nSize, false))
+            return false;
+        CTxMemPool::setEntries setAncestors;
+        size_t nLimitAncestors = GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT);
+        size_t nLimitAncestorSize = GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000;
+        size_t nLimitDescendants = GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT);
+        size_t nLimitDescendantSize = GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000;
+        std::string errString;
+        if (!mempool.CalculateMemPoolAncestors(entry, setAncestors, nLimitAncestors, nLimitAncestorSize, nLimitDescendants, nLimitDescendantSize, errString))
+            return false;
+
+        // If some ancestor did not make it back, the package differs from
+        // the dumped one; leave it to AcceptToMemoryPool to judge the result
+        uint64_t nSizeWithAncestors = entry.GetTxSize();
+        BOOST_FOREACH(CTxMemPool::txiter ancestorIt, setAncestors) {
+            nSizeWithAncestors += ancestorIt->GetTxSize();
+        }
+        if (setAncestors.size() + 1 != e.nCountWithAncestors || nSizeWithAncestors != e.nSizeWithAncestors)
+            return false;
+
+        // Loaded entries are not fresh observations for fee estimation
+        mempool.addUnchecked(hash, entry, setAncestors, false);
+    }
+
+    GetMainSignals().SyncTransaction(tx, NULL, CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK);
+    return true;
+}
 
 bool LoadMempool(void)
 {
@@ -4302,6 +5116,7 @@ bool LoadMempool(void)
     }
 
     int64_t count = 0;
+    int64_t trusted = 0;
     int64_t skipped = 0;
     int64_t failed = 0;
     int64_t nNow = GetTime();
@@ -4309,35 +5124,80 @@ bool LoadMempool(void)
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_NO_METADATA) {
             return false;
         }
+        // Entries dumped on top of the current tip with the current script
+        // flags were valid against exactly this chain state
+        const bool fTrustDump = version == MEMPOOL_DUMP_VERSION;
+        uint256 hashBlock;
+        uint32_t nScriptFlags = 0;
+        if (fTrustDump) {
+            file >> hashBlock;
+            file >> nScriptFlags;
+        }
         uint64_t num;
         file >> num;
         double prioritydummy = 0;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                mempool.PrioritiseTransaction(tx->GetHash(), tx->GetHash().ToString(), prioritydummy, amountdelta);
+        std::vector<MempoolDumpEntry> vBatch;
+        std::vector<CTransactionRef> vRevalidate;
+        while (num) {
+            vBatch.clear();
+            while (num && vBatch.size() < MEMPOOL_LOAD_BATCH_SIZE) {
+                num--;
+                MempoolDumpEntry e;
+                file >> e.tx;
+                file >> e.nTime;
+                file >> e.nFeeDelta;
+                if (version == MEMPOOL_DUMP_VERSION) {
+                    file >> e.nFee;
+                    file >> e.entryPriority;
+                    file >> e.entryHeight;
+                    file >> e.inChainInputValue;
+                    file >> e.fSpendsCoinbase;
+                    file >> e.nSigOpCost;
+                    file >> e.nCountWithAncestors;
+                    file >> e.nSizeWithAncestors;
+                }
+
+                CAmount amountdelta = e.nFeeDelta;
+                if (amountdelta) {
+                    mempool.PrioritiseTransaction(e.tx->GetHash(), e.tx->GetHash().ToString(), prioritydummy, amountdelta);
+                }
+                if (e.nTime + nExpiryTimeout <= nNow) {
+                    ++skipped;
+                    continue;
+                }
+                vBatch.push_back(std::move(e));
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(mempool, state, tx, true, NULL, nTime);
+
+            // Entries come parents first, so a child whose parent needs
+            // validating fails the input check and is validated after it
+            vRevalidate.clear();
+            std::vector<int64_t> vRevalidateTime;
+            BOOST_FOREACH(const MempoolDumpEntry& e, vBatch) {
+                if (fTrustDump && LoadTrustedMempoolEntry(e, hashBlock, nScriptFlags)) {
+                    ++count;
+                    ++trusted;
+                } else {
+                    vRevalidate.push_back(e.tx);
+                    vRevalidateTime.push_back(e.nTime);
+                }
+            }
+
+            // Check the scripts of the batch on all script check threads,
+            // so the serial AcceptToMemoryPool calls find them cached
+            PreverifyMemPoolScripts(mempool, vRevalidate);
+            for (size_t i = 0; i < vRevalidate.size(); i++) {
+                CValidationState state;
+                AcceptToMemoryPoolWithTime(mempool, state, vRevalidate[i], true, NULL, vRevalidateTime[i]);
                 if (state.IsValid()) {
                     ++count;
                 } else {
                     ++failed;
                 }
-            } else {
-                ++skipped;
+                if (ShutdownRequested())
+                    return false;
             }
             if (ShutdownRequested())
                 return false;
@@ -4353,27 +5213,51 @@ bool LoadMempool(void)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i successes, %i failed, %i expired\n", count, failed, skipped);
+    if (trusted) {
+        LOCK(cs_main);
+        LimitMempoolSize(mempool, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, nExpiryTimeout);
+    }
+
+    LogPrintf("Imported mempool transactions from disk: %i successes (%i without revalidation), %i failed, %i expired\n", count, trusted, failed, skipped);
     return true;
 }
 
-void DumpMempool(void)
+/** The mempool as copied under its lock, to be written to mempool.dat */
+struct MempoolSnapshot
 {
-    int64_t start = GetTimeMicros();
-
+    uint256 hashBlock;
+    unsigned int nScriptFlags;
+    //! Entries sorted parents first
+    std::vector<CTxMemPoolEntry> vEntries;
     std::map<uint256, CAmount> mapDeltas;
-    std::vector<TxMempoolInfo> vinfo;
+    int64_t nStart;
+    int64_t nCopied;
+};
 
+static void SnapshotMempool(MempoolSnapshot& snapshot)
+{
+    snapshot.nStart = GetTimeMicros();
     {
-        LOCK(mempool.cs);
+        LOCK2(cs_main, mempool.cs);
+        snapshot.hashBlock = chainActive.Tip() ? chainActive.Tip()->GetBlockHash() : uint256();
+        snapshot.nScriptFlags = GetMemPoolScriptFlags();
         for (const auto &i : mempool.mapDeltas) {
-            mapDeltas[i.first] = i.second.second;
+            snapshot.mapDeltas[i.first] = i.second.second;
+        }
+        snapshot.vEntries.reserve(mempool.mapTx.size());
+        for (const CTxMemPoolEntry& entry : mempool.mapTx) {
+            snapshot.vEntries.push_back(entry);
         }
-        vinfo = mempool.infoAll();
     }
+    // A transaction has more ancestors than any of its in-mempool parents
+    std::sort(snapshot.vEntries.begin(), snapshot.vEntries.end(), [](const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) {
+        return a.GetCountWithAncestors() < b.GetCountWithAncestors();
+    });
+    snapshot.nCopied = GetTimeMicros();
+}
 
-    int64_t mid = GetTimeMicros();
-
+static void WriteMempoolSnapshot(MempoolSnapshot& snapshot)
+{
     try {
         FILE* filestr = fopen((GetDataDir() / "mempool.dat.new").string().c_str(), "wb");
         if (!filestr) {
@@ -4384,26 +5268,61 @@ void DumpMempool(void)
 
         uint64_t version = MEMPOOL_DUMP_VERSION;
         file << version;
-
-        file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
-            mapDeltas.erase(i.tx->GetHash());
+        file << snapshot.hashBlock;
+        file << (uint32_t)snapshot.nScriptFlags;
+
+        file << (uint64_t)snapshot.vEntries.size();
+        for (const auto& i : snapshot.vEntries) {
+            file << i.GetTx();
+            file << (int64_t)i.GetTime();
+            file << (int64_t)(i.GetModifiedFee() - i.GetFee());
+            file << i.GetFee();
+            file << i.GetEntryPriority();
+            file << i.GetHeight();
+            file << i.GetInChainInputValue();
+            file << i.GetSpendsCoinbase();
+            file << i.GetSigOpCost();
+            file << i.GetCountWithAncestors();
+            file << i.GetSizeWithAncestors();
+            snapshot.mapDeltas.erase(i.GetTx().GetHash());
         }
 
-        file << mapDeltas;
+        file << snapshot.mapDeltas;
         FileCommit(file.Get());
         file.fclose();
         RenameOver(GetDataDir() / "mempool.dat.new", GetDataDir() / "mempool.dat");
         int64_t last = GetTimeMicros();
-        LogPrintf("Dumped mempool: %gs to copy, %gs to dump\n", (mid-start)*0.000001, (last-mid)*0.000001);
+        LogPrintf("Dumped mempool: %gs to copy, %gs to dump\n", (snapshot.nCopied-snapshot.nStart)*0.000001, (last-snapshot.nCopied)*0.000001);
     } catch (const std::exception& e) {
         LogPrintf("Failed to dump mempool: %s. Continuing anyway.\n", e.what());
     }
 }
 
+void DumpMempool(void)
+{
+    MempoolSnapshot snapshot;
+    SnapshotMempool(snapshot);
+    WriteMempoolSnapshot(snapshot);
+}
+
+static boost::thread threadDumpMempool;
+
+void StartDumpMempool()
+{
+    std::shared_ptr<MempoolSnapshot> snapshot = std::make_shared<MempoolSnapshot>();
+    SnapshotMempool(*snapshot);
+    threadDumpMempool = boost::thread([snapshot] {
+        RenameThread("smartcoin-dumpmempool");
+        WriteMempoolSnapshot(*snapshot);
+    });
+}
+
+void FinishDumpMempool()
+{
+    if (threadDumpMempool.joinable())
+        threadDumpMempool.join();
+}
+
 //! Guess how far we are in the verification process at the given block index
 double GuessVerificationProgress(const ChainTxData& data, CBlockIndex *pindex) {
     if (pindex == NULL)
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <exception>
+#include <functional>
 #include <map>
 #include <set>
 #include <stdint.h>
@@ -33,7 +34,10 @@
 #include <boost/filesystem/path.hpp>
 
 class CBlockIndex;
+class CBlockPipeline;
 class CBlockTreeDB;
+class CCoinsViewAsyncFlush;
+class CCoinsViewDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
@@ -42,6 +46,7 @@ class CScriptCheck;
 class CTxMemPool;
 class CValidationInterface;
 class CValidationState;
+struct CBlockLoadJob;
 struct ChainTxData;
 
 struct PrecomputedTransactionData;
@@ -79,9 +84,13 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
 /** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+static const int MAX_SCRIPTCHECK_THREADS = 64;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads reading block inputs from the coins database */
+static const int MAX_PREFETCH_THREADS = 32;
+/** -prefetchthreads default (number of coins database readers, including the validation thread) */
+static const int DEFAULT_PREFETCH_THREADS = 4;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -168,6 +177,7 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+extern int nPrefetchThreads;
 extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
@@ -186,6 +196,9 @@ extern bool fEnableReplacement;
 /** Block hash whose ancestors we will assume to have valid scripts without checking them. */
 extern uint256 hashAssumeValid;
 
+/** Loads assumed-valid blocks ahead of ConnectTip during initial sync; NULL when disabled. */
+extern CBlockPipeline *pblockpipeline;
+
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex *pindexBestHeader;
 
@@ -258,14 +271,24 @@ FILE* OpenUndoFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 boost::filesystem::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = NULL);
+/** Forget the out of order blocks LoadExternalBlockFile kept for later files, once an import is done */
+void ClearBlocksUnknownParent();
 /** Initialize a new block tree database + block data on disk */
 bool InitBlockIndex(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk */
 bool LoadBlockIndex(const CChainParams& chainparams);
+/** Finish a coins database write that was interrupted part way through, by replaying the blocks involved */
+bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header PoW checking thread */
+void ThreadHeaderPoWCheck();
+/** Run an instance of the coins prefetch thread */
+void ThreadCoinsPrefetch();
+/** Run an instance of the block file import thread */
+void ThreadBlockLoad();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -325,7 +348,9 @@ void PruneAndFlush();
 void PruneBlockFilesManual(int nPruneUpToHeight);
 
 /** (try to) add transaction to memory pool
- * plTxnReplaced will be appended to with all transactions replaced from mempool **/
+ * plTxnReplaced will be appended to with all transactions replaced from mempool.
+ * cs_main and pool.cs are only taken around the policy checks and the insertion,
+ * so callers not holding cs_main can check scripts concurrently **/
 bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx, bool fLimitFree,
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced = NULL,
                         bool fOverrideMempoolLimit=false, const CAmount nAbsurdFee=0);
@@ -335,6 +360,16 @@ bool AcceptToMemoryPoolWithTime(CTxMemPool& pool, CValidationState &state, const
                         bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced = NULL,
                         bool fOverrideMempoolLimit=false, const CAmount nAbsurdFee=0);
 
+/**
+ * Check the scripts of transactions about to be submitted to the mempool on
+ * the script check threads, so AcceptToMemoryPool finds their signatures in
+ * the signature cache. vtx may spend its own outputs; other inputs are looked
+ * up in the chain and the mempool, and transactions with unknown inputs are
+ * skipped. Does nothing without script check threads. Must not be called with
+ * cs_main held.
+ */
+void PreverifyMemPoolScripts(CTxMemPool& pool, const std::vector<CTransactionRef>& vtx);
+
 /** Convert CValidationState to a human-readable message for logging */
 std::string FormatStateMessage(const CValidationState &state);
 
@@ -372,10 +407,12 @@ int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& i
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not NULL, script checks are pushed onto it
- * instead of being performed inline.
+ * instead of being performed inline. nSpendHeight is the height the inputs are spent at; if -1,
+ * it is looked up with GetSpendHeight, which takes cs_main.
  */
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &view, bool fScriptChecks,
-                 unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL);
+                 unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL,
+                 int nSpendHeight = -1);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -453,8 +490,8 @@ private:
 
 public:
     CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
-    CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
-        scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
+    CScriptCheck(const CScript& scriptPubKeyIn, const CAmount amountIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
+        scriptPubKey(scriptPubKeyIn), amount(amountIn),
         ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
 
     bool operator()();
@@ -473,17 +510,102 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure computing the PoW hashes of a run of consecutive headers, so the
+ * context-free (and expensive) part of header validation can be spread over
+ * the worker threads. The hashes are checked against nBits later, in
+ * AcceptBlockHeader, so a failure is reported for the right header.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader *pheaders;
+    uint256 *phashes;
+    size_t nCount;
+
+public:
+    CHeaderPoWCheck(): pheaders(NULL), phashes(NULL), nCount(0) {}
+    CHeaderPoWCheck(const CBlockHeader* pheadersIn, uint256* phashesIn, size_t nCountIn) :
+        pheaders(pheadersIn), phashes(phashesIn), nCount(nCountIn) { }
+
+    bool operator()();
+
+    void swap(CHeaderPoWCheck &check) {
+        std::swap(pheaders, check.pheaders);
+        std::swap(phashes, check.phashes);
+        std::swap(nCount, check.nCount);
+    }
+};
+
+/**
+ * Closure reading a run of outpoints from the coins database ahead of
+ * ConnectBlock. Outpoints that are not found leave their Coin spent.
+ */
+class CCoinsPrefetchCheck
+{
+private:
+    const CCoinsView *view;
+    const COutPoint *poutpoints;
+    Coin *pcoins;
+    size_t nCount;
+
+public:
+    CCoinsPrefetchCheck(): view(NULL), poutpoints(NULL), pcoins(NULL), nCount(0) {}
+    CCoinsPrefetchCheck(const CCoinsView* viewIn, const COutPoint* poutpointsIn, Coin* pcoinsIn, size_t nCountIn) :
+        view(viewIn), poutpoints(poutpointsIn), pcoins(pcoinsIn), nCount(nCountIn) { }
+
+    bool operator()();
+
+    void swap(CCoinsPrefetchCheck &check) {
+        std::swap(view, check.view);
+        std::swap(poutpoints, check.poutpoints);
+        std::swap(pcoins, check.pcoins);
+        std::swap(nCount, check.nCount);
+    }
+};
+
+/**
+ * Closure deserializing a block read during -reindex or -loadblock and
+ * running the context-free checks on it, proof of work and merkle root
+ * included, so the importing thread only has to accept it in file order.
+ */
+class CBlockLoadCheck
+{
+private:
+    CBlockLoadJob *pjob;
+
+public:
+    CBlockLoadCheck(): pjob(NULL) {}
+    explicit CBlockLoadCheck(CBlockLoadJob* pjobIn) : pjob(pjobIn) { }
+
+    bool operator()();
+
+    void swap(CBlockLoadCheck &check) {
+        std::swap(pjob, check.pjob);
+    }
+};
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckPOW = true);
+/** Reads the block at pindex. If the index carries a verified PoW hash (BLOCK_HAVE_POW_HASH) the
+ *  scrypt/X11 hash is not recomputed; the block is tied to the index entry by its SHA256d hash instead. */
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Reads the block at pindex as stored, i.e. in its network serialization including witness data,
+ *  without decoding it. The bytes are only checked against the index by the hash of their header. */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& vchBlock, const CBlockIndex* pindex);
+/** Whether the stored bytes of the block at pindex equal its serialization with nSerializeFlags, so that
+ *  ReadRawBlockFromDisk can replace reading and re-serializing it. That holds for witness serialization,
+ *  and for blocks before segwit activation, which carry no witness to strip. Requires cs_main. */
+bool IsRawBlockSerialization(const CBlockIndex* pindex, int nSerializeFlags, const Consensus::Params& consensusParams);
 
 /** Functions for validating blocks and updating the block tree */
 
-/** Context-independent validity checks */
-bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true);
-bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
+/** Context-independent validity checks. If phashPoW points to a non-null hash it is used as the
+ *  header's precomputed PoW hash; otherwise it receives the PoW hash computed for the check. */
+bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, bool fCheckPOW = true, uint256* phashPoW = NULL);
+bool CheckBlock(const CBlock& block, CValidationState& state, bool fCheckPOW = true, bool fCheckMerkleRoot = true, uint256* phashPoW = NULL);
 
 /** Context-dependent validity checks.
  *  By "context", we mean only the previous block headers, but not the UTXO
@@ -538,6 +660,16 @@ bool InvalidateBlock(CValidationState& state, const CChainParams& chainparams, C
 /** Remove invalidity status from a block and its descendants. */
 bool ResetBlockFailureFlags(CBlockIndex *pindex);
 
+/**
+ * Replace the chain state by a UTXO snapshot at pindex, which must extend the
+ * active chain, with the coins fnNext hands out. The load is only committed if
+ * fnVerify, called once fnNext is exhausted, returns true. Blocks up to pindex
+ * that were never downloaded are taken as valid and accounted as pruned, so
+ * this requires prune mode. Requires cs_main.
+ */
+bool ActivateTxOutSetSnapshot(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindex, uint64_t nChainTx,
+                              const std::function<bool(COutPoint&, Coin&)>& fnNext, const std::function<bool()>& fnVerify);
+
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
 
@@ -547,6 +679,12 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the coins database (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
+/** Global variable that points to the background writer between pcoinsTip and the coins database (protected by cs_main) */
+extern CCoinsViewAsyncFlush *pcoinsflusher;
+
 /**
  * Return the spend height, which is one more than the inputs.GetBestBlock().
  * While checking, GetBestBlock() refers to the parent block. (protected by cs_main)
@@ -579,6 +717,12 @@ CBlockFileInfo* GetBlockFileInfo(size_t n);
 /** Dump the mempool to disk. */
 void DumpMempool();
 
+/** Copy the mempool and write it to disk on a background thread. */
+void StartDumpMempool();
+
+/** Wait for a dump started by StartDumpMempool to finish. */
+void FinishDumpMempool();
+
 /** Load the mempool from disk. */
 bool LoadMempool();
 
@@ -168,18 +168,26 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 
     const Consensus::Params& consensusParams = Params().GetConsensus(pindex->nHeight);
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+    std::vector<unsigned char> vchRawBlock;
+    bool fRawBlock;
     {
         LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
+        // Publish the stored bytes when they already are the requested serialization
+        fRawBlock = IsRawBlockSerialization(pindex, RPCSerializationFlags(), consensusParams) && ReadRawBlockFromDisk(vchRawBlock, pindex);
+        if (!fRawBlock) {
+            CBlock block;
+            if(!ReadBlockFromDisk(block, pindex, consensusParams))
+            {
+                zmqError("Can't read block from disk");
+                return false;
+            }
+
+            ss << block;
         }
-
-        ss << block;
     }
 
+    if (fRawBlock)
+        return SendMessage(MSG_RAWBLOCK, vchRawBlock.data(), vchRawBlock.size());
     return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
 }
 